@@ -0,0 +1,1047 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "furry.h"
+#include "furry_alloc.h"
+#include "furry_anim.h"
+#include "furry_audio.h"
+#include "furry_batch.h"
+#include "furry_cache.h"
+#include "furry_layout.h"
+#include "furry_lazy.h"
+#include "furry_pack.h"
+#include "furry_platform.h"
+#include "furry_replay.h"
+#include "furry_seen.h"
+#include "furry_soft.h"
+#include "furry_text.h"
+#include "furry_trace.h"
+#include "furry_video.h"
+#include "furry_worker.h"
+
+/* Headless micro-benchmarks; run `furry_bench [section]` from a Release build. */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+typedef struct ToneState {
+    unsigned channels;
+    size_t position;
+    size_t length;
+} ToneState;
+
+static size_t tone_read(void *state, float *out_frames, size_t frame_count) {
+    ToneState *tone = state;
+    size_t n = tone->length - tone->position;
+    if (n > frame_count) {
+        n = frame_count;
+    }
+    for (size_t i = 0; i < n * tone->channels; ++i) {
+        out_frames[i] = ((tone->position * tone->channels + i) & 64) ? 0.25f : -0.25f;
+    }
+    tone->position += n;
+    return n;
+}
+
+static int tone_seek(void *state, size_t frame) {
+    ((ToneState *)state)->position = frame;
+    return 0;
+}
+
+static ToneState tone_states[16];
+static size_t tone_state_count;
+
+/* Music files are long 44.1 kHz stereo (forcing resampling); everything else is a short mono blip. */
+static int open_tone(const char *path, FurryAudioDecoder *out_decoder, void *user_data) {
+    (void)user_data;
+    if (tone_state_count == sizeof(tone_states) / sizeof(tone_states[0])) {
+        tone_state_count = 0;
+    }
+    ToneState *tone = &tone_states[tone_state_count++];
+    int music = strstr(path, "music") != NULL;
+    tone->channels = music ? 2 : 1;
+    tone->position = 0;
+    tone->length = music ? 44100 * 60 : 4800;
+    out_decoder->state = tone;
+    out_decoder->channels = tone->channels;
+    out_decoder->sample_rate = music ? 44100 : 48000;
+    out_decoder->read = tone_read;
+    out_decoder->seek = tone_seek;
+    out_decoder->close = NULL;
+    return 0;
+}
+
+static int bench_audio(void) {
+    FurryAudioConfig config;
+    furry_audio_default_config(&config);
+    config.offline = 1;
+    config.max_sfx_voices = 32;
+    config.open_decoder = open_tone;
+    FurryAudio *audio = NULL;
+    if (furry_audio_create(&config, &audio) != 0) {
+        return 1;
+    }
+    furry_audio_preload_sfx(audio, "click");
+    furry_audio_play_music(audio, "music_a", 1);
+
+    enum { PERIOD = 256, SECONDS = 30 };
+    static float out[PERIOD * 2];
+    size_t periods = (size_t)config.sample_rate * SECONDS / PERIOD;
+    double worst = 0.0;
+    double start = now_seconds();
+    for (size_t p = 0; p < periods; ++p) {
+        if (p % 8 == 0) {
+            furry_audio_play_sfx(audio, "click", FURRY_AUDIO_BUS_SFX, 0.5f);
+        }
+        if (p % 2000 == 1000) {
+            furry_audio_play_music(audio, p % 4000 == 1000 ? "music_b" : "music_a", 1);
+        }
+        double t0 = now_seconds();
+        furry_audio_render(audio, out, PERIOD);
+        double dt = now_seconds() - t0;
+        worst = dt > worst ? dt : worst;
+        furry_audio_update(audio);
+    }
+    double elapsed = now_seconds() - start;
+
+    FurryAudioStats stats;
+    furry_audio_stats(audio, &stats);
+    double period_budget = (double)PERIOD / config.sample_rate;
+    printf("audio: %d s of 48 kHz stereo in %.3f s (%.0fx realtime)\n", SECONDS, elapsed, SECONDS / elapsed);
+    printf("audio: period %d frames, mean %.2f us, worst %.2f us (budget %.0f us)\n", PERIOD, elapsed / periods * 1e6, worst * 1e6,
+           period_budget * 1e6);
+    printf("audio: voices stolen %zu, underruns %zu, dropped commands %zu\n", stats.voices_stolen, stats.underruns,
+           stats.commands_dropped);
+    furry_audio_destroy(audio);
+    return 0;
+}
+
+static int compare_doubles(const void *lhs, const void *rhs) {
+    double a = *(const double *)lhs;
+    double b = *(const double *)rhs;
+    return (a > b) - (a < b);
+}
+
+/* VM on the worker thread with a deliberately slow step every iteration; the frame loop only polls. */
+static int bench_worker(void) {
+    const char *script =
+        "start:\n"
+        "set n := 0\n"
+        "loop:\n"
+        "set n := n + 1\n"
+        "bg frame\n"
+        "ui_text counter|tick\n"
+        "set k := 0\n"
+        "spin:\n"
+        "set k := k + 1\n"
+        "if k < 200|spin\n"
+        "if n < 2000|loop\n"
+        "end\n";
+    FurryProgram program;
+    if (furry_compile_script(script, &program) != 0) {
+        return 1;
+    }
+    enum { MAX_SAMPLES = 8192 };
+    static double latency[MAX_SAMPLES];
+    static FurryHostCommand batch[64];
+    size_t samples = 0;
+    double worst_poll = 0.0;
+    size_t frames = 0;
+
+    FurryRuntimeConfig runtime = {.max_steps = 2000000};
+    FurryWorkerConfig config = {.command_capacity = 64};
+    FurryWorker *worker = NULL;
+    if (furry_worker_start(&program, &runtime, &config, &worker) != 0) {
+        furry_free_program(&program);
+        return 1;
+    }
+    double start = now_seconds();
+    int finished = 0;
+    while (!finished) {
+        double t0 = now_seconds();
+        size_t got = furry_worker_poll(worker, batch, 64);
+        double received = now_seconds();
+        for (size_t i = 0; i < got; ++i) {
+            if (batch[i].op == FURRY_OP_END) {
+                finished = 1;
+            }
+            if (samples < MAX_SAMPLES) {
+                latency[samples++] = received - (double)batch[i].issued_ns / 1e9;
+            }
+        }
+        double dt = now_seconds() - t0;
+        worst_poll = dt > worst_poll ? dt : worst_poll;
+        frames++;
+        struct timespec frame = {0, 1000000L};
+        thrd_sleep(&frame, NULL);
+    }
+    double elapsed = now_seconds() - start;
+    FurryWorkerStats stats;
+    furry_worker_stats(worker, &stats);
+    int rc = furry_worker_join(worker);
+    furry_free_program(&program);
+
+    qsort(latency, samples, sizeof(double), compare_doubles);
+    printf("worker: %zu commands over %zu frames in %.3f s, %zu producer stalls, max depth %zu\n", stats.commands_published, frames,
+           elapsed, stats.producer_stalls, stats.max_queue_depth);
+    printf("worker: command latency p50 %.1f us, p99 %.1f us, max %.1f us; worst frame-side poll %.2f us\n",
+           latency[samples / 2] * 1e6, latency[samples * 99 / 100] * 1e6, latency[samples - 1] * 1e6, worst_poll * 1e6);
+    return rc;
+}
+
+/* A stand-in for the platform's event queue: the VM's wake callback and a simulated player post to it. */
+typedef struct IdleQueue {
+    mtx_t lock;
+    cnd_t ready;
+    int wake;
+    unsigned long long press_ns;
+    int presses;
+} IdleQueue;
+
+static unsigned long long now_nanoseconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+static void idle_wake(void *user_data) {
+    IdleQueue *queue = user_data;
+    mtx_lock(&queue->lock);
+    queue->wake = 1;
+    cnd_signal(&queue->ready);
+    mtx_unlock(&queue->lock);
+}
+
+/* Reads each line for 100 ms, then presses Return. */
+static int idle_player(void *arg) {
+    IdleQueue *queue = arg;
+    for (int i = 0; i < queue->presses; ++i) {
+        struct timespec reading = {0, 100000000L};
+        thrd_sleep(&reading, NULL);
+        mtx_lock(&queue->lock);
+        queue->press_ns = now_nanoseconds();
+        cnd_signal(&queue->ready);
+        mtx_unlock(&queue->lock);
+    }
+    return 0;
+}
+
+/*
+ * A VN idling on dialogue: ten say lines, each read for 100 ms. The event-driven loop sleeps until the
+ * player or the VM wakes it and paces frames with FurryPacer; the baseline polls every millisecond and
+ * draws at 60 Hz. Reports process CPU over wall time and press-to-next-line latency.
+ */
+static int bench_idle_run(const FurryProgram *program, int event_driven) {
+    /* One press per say line in the script below. */
+    enum { LINES = 10 };
+    IdleQueue queue = {.presses = LINES};
+    if (mtx_init(&queue.lock, mtx_plain) != thrd_success || cnd_init(&queue.ready) != thrd_success) {
+        return 1;
+    }
+    FurryRuntimeConfig runtime = {.max_steps = 1000};
+    FurryWorkerConfig config = {.wait_on_say = 1, .wake = event_driven ? idle_wake : NULL, .wake_user_data = &queue};
+    FurryWorker *worker = NULL;
+    thrd_t player;
+    if (furry_worker_start(program, &runtime, &config, &worker) != 0) {
+        return 1;
+    }
+    if (thrd_create(&player, idle_player, &queue) != thrd_success) {
+        furry_worker_join(worker);
+        return 1;
+    }
+    FurryPacer pacer;
+    FurryInputRouter router;
+    furry_pacer_init(&pacer, 60.0);
+    furry_router_reset(&router);
+    FurryHostCommand command;
+    double latency_total = 0.0;
+    double latency_max = 0.0;
+    size_t lines_shown = 0;
+    size_t loops = 0;
+    unsigned long long pending_press = 0;
+    int line_arrived = 0;
+    int ended = 0;
+    clock_t cpu_start = clock();
+    double start = now_seconds();
+    while (!ended) {
+        loops++;
+        unsigned long long press = 0;
+        if (event_driven) {
+            long long timeout = furry_pacer_timeout(&pacer, now_nanoseconds(), 0);
+            mtx_lock(&queue.lock);
+            while (!queue.wake && queue.press_ns == 0 && timeout != 0) {
+                if (timeout < 0) {
+                    cnd_wait(&queue.ready, &queue.lock);
+                    continue;
+                }
+                unsigned long long deadline = now_nanoseconds() + (unsigned long long)timeout;
+                struct timespec until = {(time_t)(deadline / 1000000000ull), (long)(deadline % 1000000000ull)};
+                cnd_timedwait(&queue.ready, &queue.lock, &until);
+                break;
+            }
+            queue.wake = 0;
+            press = queue.press_ns;
+            queue.press_ns = 0;
+            mtx_unlock(&queue.lock);
+        } else {
+            struct timespec tick = {0, 1000000L};
+            thrd_sleep(&tick, NULL);
+            mtx_lock(&queue.lock);
+            press = queue.press_ns;
+            queue.press_ns = 0;
+            mtx_unlock(&queue.lock);
+        }
+        if (press != 0) {
+            FurryPlatformEvent key = {.type = FURRY_EVENT_KEY, .key = FURRY_KEY_RETURN, .timestamp_ns = press};
+            FurryWorkerInput input;
+            furry_pacer_input(&pacer, press);
+            if (furry_router_event(&router, &key, &input)) {
+                furry_worker_send(worker, &input);
+                pending_press = press;
+            }
+        }
+        while (furry_worker_poll(worker, &command, 1) == 1) {
+            furry_router_command(&router, &command);
+            furry_pacer_invalidate(&pacer);
+            line_arrived |= command.op == FURRY_OP_SAY && pending_press != 0;
+            ended |= command.op == FURRY_OP_END;
+        }
+        unsigned long long now = now_nanoseconds();
+        if (furry_pacer_due(&pacer, now, !event_driven)) {
+            furry_pacer_frame_done(&pacer, now);
+            if (line_arrived) {
+                double latency = (double)(now - pending_press) / 1e9;
+                latency_total += latency;
+                latency_max = latency > latency_max ? latency : latency_max;
+                lines_shown++;
+                line_arrived = 0;
+                pending_press = 0;
+            }
+        }
+    }
+    double wall = now_seconds() - start;
+    double cpu = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+    thrd_join(player, NULL);
+    int rc = furry_worker_join(worker);
+    cnd_destroy(&queue.ready);
+    mtx_destroy(&queue.lock);
+    printf("idle %-12s: %.2f s wall, CPU %.2f%%, %zu loop wakeups, %zu frames; press to next line avg %.2f ms, max %.2f ms\n",
+           event_driven ? "event-driven" : "polling", wall, cpu / wall * 100.0, loops, pacer.stats.frames,
+           lines_shown > 0 ? latency_total / (double)lines_shown * 1e3 : 0.0, latency_max * 1e3);
+    return rc;
+}
+
+static int bench_idle(void) {
+    FurryProgram program;
+    if (furry_compile_script("say A|1\nsay A|2\nsay A|3\nsay A|4\nsay A|5\nsay A|6\nsay A|7\nsay A|8\nsay A|9\nsay A|10\nend\n",
+                             &program) != 0) {
+        return 1;
+    }
+    int rc = bench_idle_run(&program, 1);
+    rc |= bench_idle_run(&program, 0);
+    furry_free_program(&program);
+    return rc;
+}
+
+/* 16 windows x 16 rows x 32 cells: full solves on resize, then one dirty cell or one dirty window per frame. */
+static int bench_layout(void) {
+    enum { WINDOWS = 16, ROWS = 16, CELLS = 32, FRAMES = 2000 };
+    FurryLayout *layout = NULL;
+    if (furry_layout_create(WINDOWS * ROWS * (CELLS + 1) + WINDOWS, &layout) != 0) {
+        return 1;
+    }
+    furry_layout_set_viewport(layout, 1920.0f, 1080.0f);
+    FurryLayoutSpec window = {{0.0f, FURRY_LAYOUT_PX}, {0.0f, FURRY_LAYOUT_PX}, {0.25f, FURRY_LAYOUT_PARENT}, {0.25f, FURRY_LAYOUT_PARENT},
+                              0.0f, 0.0f, 0.0f, 0.0f};
+    FurryLayoutSpec row = {{8.0f, FURRY_LAYOUT_PX}, {0.0f, FURRY_LAYOUT_PARENT}, {1.0f, FURRY_LAYOUT_PARENT}, {1.0f / ROWS, FURRY_LAYOUT_PARENT},
+                           0.0f, 0.0f, 0.0f, 0.0f};
+    FurryLayoutSpec cell = {{0.0f, FURRY_LAYOUT_PARENT}, {0.0f, FURRY_LAYOUT_PX}, {1.0f / CELLS, FURRY_LAYOUT_PARENT}, {24.0f, FURRY_LAYOUT_PX},
+                            0.0f, 0.5f, 0.0f, 0.5f};
+    int windows[WINDOWS];
+    int first_cell = -1;
+    for (int wi = 0; wi < WINDOWS; ++wi) {
+        window.x.value = (float)(wi % 4) * 480.0f;
+        window.y.value = (float)(wi / 4) * 270.0f;
+        furry_layout_add(layout, -1, &window, &windows[wi]);
+        for (int r = 0; r < ROWS; ++r) {
+            int row_node = -1;
+            row.y.value = (float)r / ROWS;
+            furry_layout_add(layout, windows[wi], &row, &row_node);
+            for (int c = 0; c < CELLS; ++c) {
+                cell.x.value = (float)c / CELLS;
+                furry_layout_add(layout, row_node, &cell, first_cell < 0 ? &first_cell : NULL);
+            }
+        }
+    }
+    size_t nodes = furry_layout_node_count(layout);
+
+    double start = now_seconds();
+    size_t solved = 0;
+    for (int f = 0; f < 200; ++f) {
+        furry_layout_set_viewport(layout, 1920.0f + (float)(f & 1), 1080.0f);
+        solved += furry_layout_update(layout);
+    }
+    double full = (now_seconds() - start) / 200;
+
+    start = now_seconds();
+    for (int f = 0; f < FRAMES; ++f) {
+        cell.h.value = 24.0f + (float)(f & 7);
+        furry_layout_set_spec(layout, first_cell + (f * 37) % (ROWS * CELLS), &cell);
+        solved += furry_layout_update(layout);
+    }
+    double one_cell = (now_seconds() - start) / FRAMES;
+
+    start = now_seconds();
+    for (int f = 0; f < FRAMES; ++f) {
+        window.x.value = (float)(f % 480);
+        window.y.value = 0.0f;
+        furry_layout_set_spec(layout, windows[f % WINDOWS], &window);
+        solved += furry_layout_update(layout);
+    }
+    double one_window = (now_seconds() - start) / FRAMES;
+
+    size_t rect_count = 0;
+    const FurryRect *rects = furry_layout_rects(layout, &rect_count);
+    printf("layout: %zu nodes; full solve %.1f us (%.1f ns/node)\n", nodes, full * 1e6, full * 1e9 / (double)nodes);
+    printf("layout: one dirty cell %.2f us, one dirty window subtree (%d nodes) %.1f us; checksum %.1f over %zu solves\n", one_cell * 1e6,
+           ROWS * (CELLS + 1) + 1, one_window * 1e6, rects[rect_count - 1].x, solved);
+    furry_layout_destroy(layout);
+    return 0;
+}
+
+static int bench_raster(void) {
+    enum { SPRITES = 256, FRAMES = 60 };
+    FurrySoftConfig config = {.width = 1280, .height = 720};
+    FurrySoftRenderer *renderer = NULL;
+    if (furry_soft_create(&config, &renderer) != 0) {
+        return 1;
+    }
+    char asset[32];
+    double start = now_seconds();
+    for (int f = 0; f < FRAMES; ++f) {
+        furry_soft_clear(renderer, 0x203040ffu);
+        for (int i = 0; i < SPRITES; ++i) {
+            snprintf(asset, sizeof(asset), "sprite_%d.png", i & 7);
+            furry_soft_draw_sprite(renderer, asset, (float)((i * 37) % 100) / 100.0f, (float)((i * 53) % 100) / 100.0f + 0.1f,
+                                   (float)((i * 11 + f * 3) % 360));
+        }
+        furry_soft_draw_text(renderer, 16, 16, 2, 0xffffffffu, "FURRY software rasterizer benchmark");
+    }
+    double elapsed = now_seconds() - start;
+    FurrySoftStats stats;
+    furry_soft_stats(renderer, &stats);
+    printf("raster: %dx%d, %d rotated sprites/frame: %.2f ms/frame, %.0f sprites/s, %.1f Mpixels blended/s; hash %08x\n", config.width,
+           config.height, SPRITES, elapsed * 1e3 / FRAMES, (double)stats.sprites / elapsed, (double)stats.pixels_blended / elapsed / 1e6,
+           furry_soft_hash(renderer));
+    furry_soft_destroy(renderer);
+    return 0;
+}
+
+static int bench_text(void) {
+    enum { LINES = 200, PASSES = 50 };
+    FurryTextCache *cache = NULL;
+    if (furry_text_create(NULL, &cache) != 0) {
+        return 1;
+    }
+    char lines[LINES][160];
+    for (int i = 0; i < LINES; ++i) {
+        snprintf(lines[i], sizeof(lines[i]), "Line %d: the lanterns along the harbour flicker while %s waits for the ferry, counting %d gulls.",
+                 i, (i & 1) ? "Mira" : "Tobias", i * 7 % 31);
+    }
+    FurryTextStyle style = {16, 480.0f, 0.0f};
+    FurryTextLayout layout = {0};
+    size_t glyphs = 0;
+    double start = now_seconds();
+    for (int i = 0; i < LINES; ++i) {
+        furry_text_layout(cache, lines[i], &style, &layout);
+        glyphs += layout.quad_count;
+    }
+    double cold = now_seconds() - start;
+    FurryTextStats cold_stats;
+    furry_text_stats(cache, &cold_stats);
+
+    start = now_seconds();
+    for (int p = 0; p < PASSES; ++p) {
+        for (int i = 0; i < LINES; ++i) {
+            furry_text_layout(cache, lines[i], &style, &layout);
+            glyphs += layout.quad_count;
+        }
+    }
+    double warm = (now_seconds() - start) / PASSES;
+    FurryTextStats stats;
+    furry_text_stats(cache, &stats);
+    printf("text: %d-line backlog: first layout %.1f us (%zu glyphs rasterized), re-layout %.1f us, %zu new rasterizations; %zu quads\n", LINES,
+           cold * 1e6, cold_stats.glyph_misses, warm * 1e6, stats.glyph_misses - cold_stats.glyph_misses, glyphs);
+    furry_text_layout_free(&layout);
+    furry_text_destroy(cache);
+    return 0;
+}
+
+static int bench_batch(void) {
+    enum { SPRITES = 5000, TEXTURES = 24, FRAMES = 200 };
+    FurryBatchConfig config = {SPRITES, NULL, NULL};
+    FurryBatch *batch = NULL;
+    if (furry_batch_create(&config, &batch) != 0) {
+        return 1;
+    }
+    FurrySprite sprite = {0, 0, FURRY_BLEND_ALPHA, 0.0f, 0.0f, 64.0f, 64.0f, 0.5f, 0.5f, 0.0f, {0.0f, 0.0f, 1.0f, 1.0f}, 0xffffffffu};
+    static const int layers[3] = {FURRY_BATCH_LAYER_BG, FURRY_BATCH_LAYER_FG, FURRY_BATCH_LAYER_UI};
+    size_t naive_binds = 0;
+    unsigned seed = 12345u;
+    double start = now_seconds();
+    for (int f = 0; f < FRAMES; ++f) {
+        furry_batch_begin(batch, 1920.0f, 1080.0f);
+        unsigned last_texture = ~0u;
+        for (int i = 0; i < SPRITES; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            sprite.texture = (seed >> 8) % TEXTURES;
+            sprite.layer = layers[(seed >> 20) % 3];
+            sprite.blend = sprite.layer == FURRY_BATCH_LAYER_BG ? FURRY_BLEND_OPAQUE : FURRY_BLEND_ALPHA;
+            sprite.x = (float)((seed >> 4) % 2000);
+            sprite.y = (float)((seed >> 12) % 1100);
+            sprite.rotation_deg = (float)(i % 360);
+            naive_binds += sprite.texture != last_texture;
+            last_texture = sprite.texture;
+            furry_batch_add(batch, &sprite);
+        }
+        furry_batch_end(batch);
+    }
+    double elapsed = now_seconds() - start;
+    FurryBatchStats stats;
+    furry_batch_stats(batch, &stats);
+    printf("batch: %d sprites over %d textures x 3 layers: %.1f ns/sprite; %zu draws, %zu texture and %zu blend changes per frame "
+           "(naive: %d draws, %zu binds); %zu culled\n",
+           SPRITES, TEXTURES, elapsed * 1e9 / ((double)SPRITES * FRAMES), stats.draws, stats.texture_changes, stats.blend_changes, SPRITES,
+           naive_binds / FRAMES, stats.culled);
+    furry_batch_destroy(batch);
+    return 0;
+}
+
+static int bench_anim(void) {
+    enum { ELEMENTS = 5000, FRAMES = 600 };
+    static const char *clips[] = {"idle", "pulse", "shake", "bounce", "fade_in"};
+    FurryAnim *anim = NULL;
+    if (furry_anim_create(ELEMENTS, &anim) != 0 || furry_anim_define_builtins(anim) != 0) {
+        furry_anim_destroy(anim);
+        return 1;
+    }
+    for (int i = 0; i < ELEMENTS; ++i) {
+        furry_anim_play(anim, clips[i % 5], (FurryAnimMode)(1 + i % 2), (unsigned long long)i, NULL);
+    }
+    size_t events = 0;
+    double worst = 0.0;
+    double start = now_seconds();
+    for (int f = 0; f < FRAMES; ++f) {
+        double frame_start = now_seconds();
+        furry_anim_update(anim, 1.0f / 60.0f);
+        double frame = now_seconds() - frame_start;
+        worst = frame > worst ? frame : worst;
+        size_t count = 0;
+        furry_anim_events(anim, &count);
+        events += count;
+    }
+    double elapsed = now_seconds() - start;
+    size_t slots = 0;
+    const float *y = furry_anim_values(anim, FURRY_ANIM_Y, &slots);
+    printf("anim: %d elements x %d channels: %.1f us/update (worst %.1f us), %.1f ns/channel; %zu loop events; y[0] %.2f\n", ELEMENTS,
+           FURRY_ANIM_PROPERTY_COUNT, elapsed * 1e6 / FRAMES, worst * 1e6, elapsed * 1e9 / ((double)FRAMES * ELEMENTS * FURRY_ANIM_PROPERTY_COUNT),
+           events, (double)y[0]);
+    furry_anim_destroy(anim);
+    return 0;
+}
+
+/* Real-time playback: a 60 fps stream with a costly decoder, presented on a 60 Hz clock. */
+static int bench_video(void) {
+    enum { FRAMES = 90 };
+    FurryVideoPattern pattern = {640, 360, 60.0, FRAMES, 3000};
+    FurryVideoConfig config;
+    furry_video_default_config(&config);
+    config.open_decoder = furry_video_open_test_pattern;
+    config.decoder_user_data = &pattern;
+    FurryVideo *video = NULL;
+    if (furry_video_open(&config, "bench.mp4", 0, &video) != 0) {
+        return 1;
+    }
+    struct timespec tick = {0, 16666667L};
+    double present_total = 0.0;
+    double worst = 0.0;
+    size_t calls = 0;
+    double start = now_seconds();
+    for (;;) {
+        double now = now_seconds() - start;
+        FurryVideoFrame frame;
+        double call_start = now_seconds();
+        furry_video_present(video, now, &frame);
+        double call = now_seconds() - call_start;
+        present_total += call;
+        worst = call > worst ? call : worst;
+        calls++;
+        if (furry_video_finished(video, now) || now > 10.0) {
+            break;
+        }
+        thrd_sleep(&tick, NULL);
+    }
+    double elapsed = now_seconds() - start;
+    FurryVideoStats stats;
+    furry_video_stats(video, &stats);
+    printf("video: %d frames %dx%d in %.2f s: %zu presented, %zu dropped, %zu repeated, %zu underruns; present %.2f us (worst %.1f us)\n",
+           FRAMES, pattern.width, pattern.height, elapsed, stats.frames_presented, stats.frames_dropped, stats.frames_repeated,
+           stats.underruns, present_total * 1e6 / (double)calls, worst * 1e6);
+    furry_video_close(video);
+    return 0;
+}
+
+static int pick_rotating(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    (void)prompt;
+    (void)choices;
+    size_t *picks = user_data;
+    return (int)((*picks)++ % count);
+}
+
+/* Records a 20000-choice session once, then replays it with all host output stubbed. */
+static int bench_replay(void) {
+    const char *script =
+        "start:\n"
+        "set n := 0\n"
+        "loop:\n"
+        "set n := n + 1\n"
+        "say Narrator|tick\n"
+        "bg frame\n"
+        "choice Pick|Left->left|Right->right|Wait->next\n"
+        "left:\n"
+        "set k := n * 2\n"
+        "goto next\n"
+        "right:\n"
+        "set k := n + 3\n"
+        "next:\n"
+        "if n < 20000|loop\n"
+        "end\n";
+    FurryProgram program;
+    if (furry_compile_script(script, &program) != 0) {
+        return 1;
+    }
+    size_t picks = 0;
+    FurryRuntimeConfig host = {.max_steps = 10000000, .choose_option = pick_rotating, .user_data = &picks};
+    FurryRuntimeConfig config;
+    FurryReplay *replay = NULL;
+    if (furry_replay_record_begin(&program, &host, &replay, &config) != 0) {
+        furry_free_program(&program);
+        return 1;
+    }
+    double start = now_seconds();
+    furry_replay_record_end(replay, furry_run_program(&program, &config));
+    double record = now_seconds() - start;
+
+    enum { RUNS = 5 };
+    int rc = 0;
+    start = now_seconds();
+    for (int run = 0; run < RUNS; ++run) {
+        rc |= furry_replay_run(&program, replay);
+    }
+    double play = (now_seconds() - start) / RUNS;
+    FurryReplayStats stats;
+    furry_replay_stats(replay, &stats);
+    printf("replay: %zu steps, %zu choices in %zu log bytes (%.2f bytes/choice); record %.2f ms, replay %.2f ms (%.1f M steps/s)\n",
+           stats.steps, stats.choices, stats.log_bytes, (double)stats.log_bytes / (double)stats.choices, record * 1e3, play * 1e3,
+           (double)stats.steps / play / 1e6);
+    furry_replay_destroy(replay);
+    furry_free_program(&program);
+    return rc;
+}
+
+static int count_host(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)op;
+    (void)ins;
+    (void)snapshot;
+    (*(size_t *)user_data)++;
+    return 0;
+}
+
+static int count_say(const char *speaker, const char *text, void *user_data) {
+    (void)speaker;
+    (void)text;
+    (*(size_t *)user_data)++;
+    return 0;
+}
+
+/* A 5000-line chapter read once with a seen set, then skipped: host calls and time for each. */
+static int bench_skip(void) {
+    enum { LINES = 5000 };
+    size_t cap = (size_t)LINES * 96 + 64;
+    char *script = malloc(cap);
+    if (script == NULL) {
+        return 1;
+    }
+    size_t used = (size_t)snprintf(script, cap, "start:\n");
+    for (int i = 0; i < LINES; ++i) {
+        used += (size_t)snprintf(script + used, cap - used, "say Narrator|line %d\nbg room%d.png\nfg hero.png|%d|1|0|idle\n%s", i,
+                                 i % 7, i % 3, i % 50 == 0 ? "music theme.ogg\nsfx page.wav\n" : "");
+    }
+    snprintf(script + used, cap - used, "choice Next|On->done\ndone:\nend\n");
+    FurryProgram program;
+    int rc = furry_compile_script(script, &program);
+    free(script);
+    if (rc != 0) {
+        return 1;
+    }
+    FurrySeenSet *seen = NULL;
+    if (furry_seen_create(&program, &seen) != 0) {
+        furry_free_program(&program);
+        return 1;
+    }
+    size_t calls = 0;
+    FurryRuntimeConfig config = {
+        .max_steps = 10000000, .choose_option = pick_rotating, .on_host_command = count_host, .on_say = count_say, .user_data = &calls, .seen = seen};
+    double start = now_seconds();
+    rc = furry_run_program(&program, &config);
+    double read = now_seconds() - start;
+    size_t read_calls = calls;
+
+    calls = 0;
+    config.skip_mode = FURRY_SKIP_SEEN;
+    start = now_seconds();
+    rc |= furry_run_program(&program, &config);
+    double skip = now_seconds() - start;
+    printf("skip: %d lines, %zu seen; read %zu host calls in %.2f ms, skip %zu host calls in %.2f ms\n", LINES, furry_seen_count(seen),
+           read_calls, read * 1e3, calls, skip * 1e3);
+    furry_seen_destroy(seen);
+    furry_free_program(&program);
+    return rc;
+}
+
+/* FNV-1a over every host call, to check that two runs interleave the contexts identically. */
+static int hash_host(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)snapshot;
+    unsigned long long *hash = user_data;
+    *hash = (*hash ^ (unsigned long long)op) * 1099511628211ull;
+    for (const char *c = ins->a; *c != '\0'; ++c) {
+        *hash = (*hash ^ (unsigned char)*c) * 1099511628211ull;
+    }
+    return 0;
+}
+
+/*
+ * 500 ambient contexts (a sprite swap every 16 ms each) for 10 s of virtual script time, next to a story
+ * that only waits. Reports scheduling cost per context turn, the VM memory each context slot adds, and
+ * whether a second run produces the same host calls in the same order.
+ */
+static int bench_contexts(void) {
+    enum { CONTEXTS = 500 };
+    char script[512];
+    snprintf(script, sizeof(script),
+             "start:\nloop:\nspawn crowd\nadd spawned=1\nif spawned < %d|loop\nwait 10000\nend\n"
+             "crowd:\nadd turns=1\nfg walker.png|0|1|0|walk\nwait 16\ngoto crowd\n",
+             CONTEXTS);
+    FurryProgram program;
+    FurryProgram empty;
+    if (furry_compile_script(script, &program) != 0) {
+        return 1;
+    }
+    if (furry_compile_script("start:\nwait 10000\nend\n", &empty) != 0) {
+        furry_free_program(&program);
+        return 1;
+    }
+    FurryMemoryStats memory;
+    unsigned long long hashes[2];
+    FurryRuntimeConfig config = {.max_steps = 10000000, .on_host_command = hash_host, .max_contexts = CONTEXTS};
+    furry_memory_reset_peaks();
+    config.user_data = &hashes[0];
+    int rc = furry_run_program(&empty, &config);
+    furry_memory_stats(&memory);
+    size_t base_peak = memory.peak_bytes[FURRY_MEM_VM];
+
+    double seconds[2];
+    for (int run = 0; run < 2; ++run) {
+        hashes[run] = 14695981039346656037ull;
+        config.user_data = &hashes[run];
+        furry_memory_reset_peaks();
+        double start = now_seconds();
+        rc |= furry_run_program(&program, &config);
+        seconds[run] = now_seconds() - start;
+    }
+    furry_memory_stats(&memory);
+    /* Each context turns once at t = 0, 16, ... up to the story's wakeup at 10000. */
+    double turns = (double)CONTEXTS * (10000 / 16 + 1);
+    double best = seconds[0] < seconds[1] ? seconds[0] : seconds[1];
+    printf("contexts: %d for 10 s script time, %.0f turns in %.2f ms (%.0f ns/turn), %zu VM bytes per context, runs %s\n", CONTEXTS, turns,
+           best * 1e3, best / turns * 1e9, (memory.peak_bytes[FURRY_MEM_VM] - base_peak) / CONTEXTS,
+           hashes[0] == hashes[1] ? "identical" : "DIFFER");
+    furry_free_program(&empty);
+    furry_free_program(&program);
+    return rc | (hashes[0] != hashes[1]);
+}
+
+/* The skip bench's chapter read with tracing off, at host level and at VM level; drained between runs. */
+static int bench_trace(void) {
+    enum { LINES = 5000, RUNS = 10 };
+    size_t cap = (size_t)LINES * 96 + 64;
+    char *script = malloc(cap);
+    FurryTraceEvent *events = malloc(65536 * sizeof(FurryTraceEvent));
+    if (script == NULL || events == NULL) {
+        free(script);
+        free(events);
+        return 1;
+    }
+    size_t used = (size_t)snprintf(script, cap, "start:\n");
+    for (int i = 0; i < LINES; ++i) {
+        used += (size_t)snprintf(script + used, cap - used, "say Narrator|line %d\nset n=%d\nbg room%d.png\nfg hero.png|%d|1|0|idle\n", i, i,
+                                 i % 7, i % 3);
+    }
+    snprintf(script + used, cap - used, "end\n");
+    FurryProgram program;
+    int rc = furry_compile_script(script, &program);
+    free(script);
+    if (rc != 0) {
+        free(events);
+        return 1;
+    }
+    size_t calls = 0;
+    FurryRuntimeConfig config = {.max_steps = 10000000, .on_host_command = count_host, .on_say = count_say, .user_data = &calls};
+    static const char *const names[] = {"off", "host", "vm"};
+    rc = furry_trace_begin(FURRY_TRACE_OFF, NULL);
+    for (int level = FURRY_TRACE_OFF; level <= FURRY_TRACE_VM; ++level) {
+        furry_trace_set_level((FurryTraceLevel)level);
+        double total = 0.0;
+        size_t drained = 0;
+        for (int run = 0; run < RUNS; ++run) {
+            double start = now_seconds();
+            rc |= furry_run_program(&program, &config);
+            total += now_seconds() - start;
+            drained += furry_trace_drain(events, 65536);
+        }
+        FurryTraceStats stats;
+        furry_trace_stats(&stats);
+        printf("trace %-4s: %.2f ms per run, %zu events per run, %zu dropped\n", names[level], total / RUNS * 1e3, drained / RUNS,
+               stats.dropped);
+    }
+    furry_trace_end();
+    free(events);
+    furry_free_program(&program);
+    return rc;
+}
+
+/* 2000 script-like assets of 4 KB: pack with LZ, then open, look every path up and read it back. */
+static int bench_pack(void) {
+    enum { ASSETS = 2000, ASSET_SIZE = 4096 };
+    static unsigned char asset[ASSET_SIZE];
+    static unsigned char out[ASSET_SIZE];
+    char path[64];
+    FurryPackWriterConfig config = {.compress = 1};
+    FurryPackWriter *writer = NULL;
+    if (furry_pack_writer_create(&config, &writer) != 0) {
+        return 1;
+    }
+    double start = now_seconds();
+    for (int i = 0; i < ASSETS; ++i) {
+        for (size_t b = 0; b < ASSET_SIZE; ++b) {
+            asset[b] = (unsigned char)("ui_text caption|Chapter and verse\n"[b % 34] ^ ((b * 7 + (size_t)i) % 61 == 0));
+        }
+        snprintf(path, sizeof(path), "ui/chapter_%04d.txt", i);
+        if (furry_pack_writer_add(writer, path, asset, sizeof(asset)) != 0) {
+            furry_pack_writer_destroy(writer);
+            return 1;
+        }
+    }
+    int rc = furry_pack_writer_finish(writer, "bench_assets.fpk");
+    furry_pack_writer_destroy(writer);
+    double build = now_seconds() - start;
+
+    FurryPack *pack = NULL;
+    start = now_seconds();
+    rc |= furry_pack_open("bench_assets.fpk", &pack);
+    double open = now_seconds() - start;
+    if (rc != 0) {
+        remove("bench_assets.fpk");
+        return 1;
+    }
+    static FurryPackEntry entries[ASSETS];
+    start = now_seconds();
+    for (int i = 0; i < ASSETS; ++i) {
+        snprintf(path, sizeof(path), "ui/chapter_%04d.txt", i);
+        rc |= furry_pack_find(pack, path, &entries[i]);
+    }
+    double find = now_seconds() - start;
+    size_t stored = 0;
+    start = now_seconds();
+    for (int i = 0; i < ASSETS; ++i) {
+        rc |= furry_pack_read(pack, &entries[i], out, sizeof(out));
+        stored += entries[i].stored_size;
+    }
+    double read = now_seconds() - start;
+    printf("pack: %d assets, %.1f%% of raw size; build %.1f ms, open %.1f us, find %.0f ns (with path formatting), read %.0f MB/s\n", ASSETS,
+           100.0 * (double)stored / (double)(ASSETS * ASSET_SIZE), build * 1e3, open * 1e6, find * 1e9 / ASSETS,
+           (double)ASSETS * ASSET_SIZE / read / 1e6);
+    furry_pack_close(pack);
+    remove("bench_assets.fpk");
+    return rc;
+}
+
+/* A 3000-scene script compiled from source against loaded from a warm compile cache. */
+static int bench_cache(void) {
+    enum { SCENES = 3000, RUNS = 20 };
+    size_t capacity = (size_t)SCENES * 160 + 64;
+    char *script = malloc(capacity);
+    if (script == NULL) {
+        return 1;
+    }
+    size_t size = (size_t)snprintf(script, capacity, "start:\nset n := 0\n");
+    for (int i = 0; i < SCENES; ++i) {
+        size += (size_t)snprintf(script + size, capacity - size,
+                                 "scene_%d:\nsay Narrator|Scene %d begins.\nset n := n + %d\nif n > %d|scene_%d\nbg room_%d\n", i, i,
+                                 i % 7, i * 3, (i + 1) % SCENES, i % 12);
+    }
+    snprintf(script + size, capacity - size, "end\n");
+
+    FurryCompileCache *cache = NULL;
+    FurryProgram program;
+    FurryCompileError error;
+    int rc = furry_compile_cache_open("bench_cache", NULL, &cache);
+    double start = now_seconds();
+    for (int run = 0; run < RUNS && rc == 0; ++run) {
+        rc |= furry_compile_script_ex(script, &program, &error);
+        furry_free_program(&program);
+    }
+    double compile = (now_seconds() - start) / RUNS;
+    rc |= furry_compile_cached(cache, script, &program, &error);
+    furry_free_program(&program);
+    start = now_seconds();
+    for (int run = 0; run < RUNS && rc == 0; ++run) {
+        rc |= furry_compile_cached(cache, script, &program, &error);
+        furry_free_program(&program);
+    }
+    double hit = (now_seconds() - start) / RUNS;
+    FurryCompileCacheStats stats;
+    furry_compile_cache_stats(cache, &stats);
+    printf("cache: %zu KB script; compile %.2f ms, cache hit %.2f ms (%.1fx), %zu hits\n", size / 1024, compile * 1e3, hit * 1e3,
+           compile / hit, stats.hits);
+    furry_compile_cache_close(cache);
+
+    /* A cache too small for any entry empties the directory so it can be removed. */
+    FurryCompileCacheConfig purge = {.max_bytes = 1};
+    if (furry_compile_cache_open("bench_cache", &purge, &cache) == 0) {
+        furry_compile_cached(cache, "start:\nend\n", &program, &error);
+        furry_free_program(&program);
+        furry_compile_cache_close(cache);
+    }
+    remove("bench_cache");
+    free(script);
+    return rc;
+}
+
+static int stop_at_first_say(const char *speaker, const char *text, void *user_data) {
+    (void)speaker;
+    (void)text;
+    (void)user_data;
+    return 1;
+}
+
+/* Time to the first say line, full compile against lazy, for a small and a large script. */
+static int bench_lazy(void) {
+    static const int sizes[] = {1000, 16000};
+    int rc = 0;
+    for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); ++n) {
+        int scenes = sizes[n];
+        size_t capacity = (size_t)scenes * 160 + 64;
+        char *script = malloc(capacity);
+        if (script == NULL) {
+            return 1;
+        }
+        size_t size = (size_t)snprintf(script, capacity, "start:\nset n := 0\ngoto scene_0\n");
+        for (int i = 0; i < scenes; ++i) {
+            size += (size_t)snprintf(script + size, capacity - size,
+                                     "scene_%d:\nsay Narrator|Scene %d begins.\nset n := n + %d\nif n > %d|scene_%d\nbg room_%d\n", i, i,
+                                     i % 7, i * 3, (i + 1) % scenes, i % 12);
+        }
+        snprintf(script + size, capacity - size, "end\n");
+
+        FurryRuntimeConfig config = {.max_steps = 1000, .on_say = stop_at_first_say};
+        FurryProgram program;
+        FurryCompileError error;
+        double start = now_seconds();
+        rc |= furry_compile_script_ex(script, &program, &error);
+        furry_run_program(&program, &config);
+        double eager = now_seconds() - start;
+        furry_free_program(&program);
+
+        FurryLazyProgram *lazy = NULL;
+        start = now_seconds();
+        rc |= furry_lazy_open(script, NULL, &lazy, &error);
+        config.lazy = lazy;
+        furry_run_program(furry_lazy_program(lazy), &config);
+        double first = now_seconds() - start;
+        furry_lazy_close(lazy);
+
+        FurryLazyConfig background = {.background = 1};
+        FurryLazyStats stats;
+        start = now_seconds();
+        rc |= furry_lazy_open(script, &background, &lazy, &error);
+        rc |= furry_lazy_finish(lazy, &error);
+        double finish = now_seconds() - start;
+        furry_lazy_stats(lazy, &stats);
+        furry_lazy_close(lazy);
+        printf("lazy: %zu KB script, %zu blocks; first line eager %.2f ms, lazy %.3f ms; background finish %.2f ms (%zu blocks off-thread)\n",
+               size / 1024, stats.blocks, eager * 1e3, first * 1e3, finish * 1e3, stats.background_blocks);
+        free(script);
+    }
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    const char *only = argc > 1 ? argv[1] : NULL;
+    int rc = 0;
+    if (only == NULL || strcmp(only, "audio") == 0) {
+        rc |= bench_audio();
+    }
+    if (only == NULL || strcmp(only, "anim") == 0) {
+        rc |= bench_anim();
+    }
+    if (only == NULL || strcmp(only, "cache") == 0) {
+        rc |= bench_cache();
+    }
+    if (only == NULL || strcmp(only, "idle") == 0) {
+        rc |= bench_idle();
+    }
+    if (only == NULL || strcmp(only, "lazy") == 0) {
+        rc |= bench_lazy();
+    }
+    if (only == NULL || strcmp(only, "layout") == 0) {
+        rc |= bench_layout();
+    }
+    if (only == NULL || strcmp(only, "raster") == 0) {
+        rc |= bench_raster();
+    }
+    if (only == NULL || strcmp(only, "batch") == 0) {
+        rc |= bench_batch();
+    }
+    if (only == NULL || strcmp(only, "pack") == 0) {
+        rc |= bench_pack();
+    }
+    if (only == NULL || strcmp(only, "text") == 0) {
+        rc |= bench_text();
+    }
+    if (only == NULL || strcmp(only, "trace") == 0) {
+        rc |= bench_trace();
+    }
+    if (only == NULL || strcmp(only, "video") == 0) {
+        rc |= bench_video();
+    }
+    if (only == NULL || strcmp(only, "replay") == 0) {
+        rc |= bench_replay();
+    }
+    if (only == NULL || strcmp(only, "contexts") == 0) {
+        rc |= bench_contexts();
+    }
+    if (only == NULL || strcmp(only, "skip") == 0) {
+        rc |= bench_skip();
+    }
+    if (only == NULL || strcmp(only, "worker") == 0) {
+        rc |= bench_worker();
+    }
+    return rc;
+}
@@ -13,6 +13,11 @@
 #define FURRY_MAX_VARS 128
 #define FURRY_MAX_CALLSTACK 128
 #define FURRY_MAX_ERROR_TEXT 256
+#define FURRY_MAX_EXPR_STACK 32
+#define FURRY_MAX_BINDINGS 256
+#define FURRY_MAX_SCENE_SPRITES 16
+#define FURRY_MAX_SCENE_LAYERS 8
+#define FURRY_MAX_CONTEXT_CALLSTACK 16
 
 typedef enum FurryOpCode {
     FURRY_OP_LABEL = 0,
@@ -39,12 +44,50 @@ typedef enum FurryOpCode {
     FURRY_OP_SAVE,
     FURRY_OP_LOAD,
     FURRY_OP_CHOICE,
+    FURRY_OP_IF,
+    FURRY_OP_SET_EXPR,
+    FURRY_OP_SPAWN,
+    FURRY_OP_WAIT,
+    FURRY_OP_WAIT_EVENT,
+    FURRY_OP_SIGNAL,
     FURRY_OP_END
 } FurryOpCode;
 
+typedef enum FurryExprOpCode {
+    FURRY_EXPR_PUSH_INT = 0,
+    FURRY_EXPR_PUSH_STR,
+    FURRY_EXPR_LOAD_VAR,
+    FURRY_EXPR_NEG,
+    FURRY_EXPR_NOT,
+    FURRY_EXPR_ADD,
+    FURRY_EXPR_SUB,
+    FURRY_EXPR_MUL,
+    FURRY_EXPR_DIV,
+    FURRY_EXPR_MOD,
+    FURRY_EXPR_EQ,
+    FURRY_EXPR_NE,
+    FURRY_EXPR_LT,
+    FURRY_EXPR_LE,
+    FURRY_EXPR_GT,
+    FURRY_EXPR_GE,
+    FURRY_EXPR_AND_JUMP,
+    FURRY_EXPR_OR_JUMP,
+    FURRY_EXPR_TO_BOOL,
+    FURRY_EXPR_END
+} FurryExprOpCode;
+
+/* One stack-machine step; arg is an int literal, string pool offset, var slot or jump target. */
+typedef struct FurryExprOp {
+    unsigned char op;
+    int arg;
+} FurryExprOp;
+
 typedef struct FurryChoice {
     char text[FURRY_MAX_TEXT];
     char target[FURRY_MAX_LABEL];
+    /* Instruction index of the target label, resolved at compile time. */
+    int target_index;
+    unsigned text_id;
 } FurryChoice;
 
 typedef struct FurryInstruction {
@@ -53,6 +96,10 @@ typedef struct FurryInstruction {
     char b[FURRY_MAX_TEXT];
     char c[FURRY_MAX_TEXT];
     int i;
+    int target;
+    int slot;
+    unsigned name_id;
+    unsigned text_id;
     FurryChoice choices[FURRY_MAX_CHOICES];
     size_t choice_count;
 } FurryInstruction;
@@ -60,6 +107,12 @@ typedef struct FurryInstruction {
 typedef struct FurryProgram {
     FurryInstruction *code;
     size_t count;
+    FurryExprOp *expr_code;
+    size_t expr_count;
+    char *expr_strings;
+    size_t expr_strings_size;
+    char (*var_names)[FURRY_MAX_KEY];
+    size_t var_name_count;
 } FurryProgram;
 
 typedef struct FurryVar {
@@ -67,21 +120,148 @@ typedef struct FurryVar {
     char value[FURRY_MAX_VALUE];
 } FurryVar;
 
+/* An fg sprite as last shown; a later fg of the same asset moves it, and bg clears them all. */
+typedef struct FurrySceneSprite {
+    char asset[FURRY_MAX_ASSET];
+    float x;
+    float y;
+    float rotation;
+    char animation[FURRY_MAX_LABEL];
+} FurrySceneSprite;
+
+/* A top-level ui layer, restored by re-running its block at ui_begin instruction `ip`. */
+typedef struct FurrySceneLayer {
+    char name[FURRY_MAX_NAME];
+    size_t ip;
+} FurrySceneLayer;
+
+/*
+ * What is on screen and playing, kept up to date by bg/fg/music/ui_begin.
+ * music_frame is the track position in output frames; the VM fills it from
+ * config.audio at each save, hosts with their own audio set it in save_slot.
+ * Only static ui blocks (ui nodes only, no branching) are kept as layers.
+ */
+typedef struct FurrySceneState {
+    char bg[FURRY_MAX_ASSET];
+    char music[FURRY_MAX_ASSET];
+    size_t music_frame;
+    size_t sprite_count;
+    FurrySceneSprite sprites[FURRY_MAX_SCENE_SPRITES];
+    size_t layer_count;
+    FurrySceneLayer layers[FURRY_MAX_SCENE_LAYERS];
+} FurrySceneState;
+
 typedef struct FurryRuntimeSnapshot {
     size_t ip;
     size_t callstack_depth;
     size_t callstack[FURRY_MAX_CALLSTACK];
     size_t var_count;
     FurryVar vars[FURRY_MAX_VARS];
+    FurrySceneState scene;
 } FurryRuntimeSnapshot;
 
+/*
+ * A ui_bind node whose variable changed since the last host sync. layer is ""
+ * outside a ui block; the strings are only valid during the callback.
+ */
+typedef struct FurryBindUpdate {
+    const char *layer;
+    const char *id;
+    const char *key;
+    const char *value;
+} FurryBindUpdate;
+
+typedef struct FurryLocale FurryLocale;
+typedef struct FurrySaveStore FurrySaveStore;
+typedef struct FurryAudio FurryAudio;
+typedef struct FurryUiTree FurryUiTree;
+typedef struct FurryUiPatch FurryUiPatch;
+typedef struct FurrySeenSet FurrySeenSet;
+typedef struct FurryLazyProgram FurryLazyProgram;
+
+/*
+ * Skip mode runs the script without presenting it: say lines are not shown,
+ * sfx are dropped, and bg/fg/music and static ui layers are only tracked in
+ * the scene. When skipping stops, the scene goes to the host once, the way a
+ * load restores it, so a long skip costs a handful of host calls.
+ */
+typedef enum FurrySkipMode {
+    FURRY_SKIP_OFF = 0,
+    /* Stop at the first say the seen set has not recorded. */
+    FURRY_SKIP_SEEN,
+    /* Fast-forward through everything up to a choice. */
+    FURRY_SKIP_ALL
+} FurrySkipMode;
+
+typedef enum FurrySkipStop {
+    FURRY_SKIP_STOP_UNSEEN = 0,
+    FURRY_SKIP_STOP_CHOICE,
+    FURRY_SKIP_STOP_BUDGET,
+    FURRY_SKIP_STOP_END
+} FurrySkipStop;
+
+/*
+ * spawn label starts a background context at label: its own ip and a call
+ * stack of up to FURRY_MAX_CONTEXT_CALLSTACK frames, sharing the variables and
+ * the program with the main script. Contexts are scheduled cooperatively, in
+ * spawn order, whenever the main script waits (wait ms, wait_event name) and
+ * every context_budget main instructions; each turn runs until the context
+ * waits, ends (end, or return from its first frame) or uses up its budget.
+ * signal name wakes every context waiting on name, the main one included.
+ * Contexts may not say, choose, save or load, are not part of a save, and are
+ * all stopped by a load.
+ */
 typedef struct FurryRuntimeConfig {
     int max_steps;
     int (*choose_option)(const char *prompt, const FurryChoice *choices, size_t count, void *user_data);
     int (*on_host_command)(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data);
     int (*save_slot)(const char *slot, const FurryRuntimeSnapshot *snapshot, void *user_data);
     int (*load_slot)(const char *slot, FurryRuntimeSnapshot *snapshot, void *user_data);
+    int (*on_say)(const char *speaker, const char *text, void *user_data);
     void *user_data;
+    const FurryLocale *locale;
+    FurrySaveStore *save_store;
+    FurryAudio *audio;
+    FurryUiTree *ui_tree;
+    int (*on_ui_patch)(const FurryUiPatch *patch, void *user_data);
+    /*
+     * Called before the VM hands control to the host (say, choice, host
+     * commands, retained ui_end, end) with only the bindings whose variable
+     * changed since the previous call. A node's first ui_bind counts as a change.
+     */
+    int (*on_bind_update)(const FurryBindUpdate *updates, size_t count, void *user_data);
+    /*
+     * Called once after a load (and when a skip stops) with the current scene,
+     * before its ui layers are re-run. Without it the scene goes to
+     * on_host_command as bg, fg and music instructions; config.audio resumes
+     * music at music_frame either way.
+     */
+    int (*on_scene_restore)(const FurrySceneState *scene, void *user_data);
+    /* Every instruction that runs is marked here (furry_seen.h); FURRY_SKIP_SEEN reads it. */
+    FurrySeenSet *seen;
+    FurrySkipMode skip_mode;
+    /* Instructions one skip may run before it stops; 0 means no limit. */
+    int skip_budget;
+    /*
+     * Called after the scene is flushed when skipping stops; the result is the
+     * mode to continue in (the stopping say or choice is presented either way).
+     * Without it, skipping ends at the first stop.
+     */
+    FurrySkipMode (*on_skip_stop)(FurrySkipStop reason, void *user_data);
+    /* Required when running furry_lazy_program(lazy): pending blocks are compiled as the VM reaches them. */
+    FurryLazyProgram *lazy;
+    /*
+     * spawn: at most max_contexts spawned contexts at once (0 means 256), each
+     * running up to context_budget instructions per turn (0 means 64).
+     */
+    size_t max_contexts;
+    int context_budget;
+    /*
+     * Script time in milliseconds, for wait. Without it the VM keeps a virtual
+     * clock that only moves when every context is waiting, jumping straight to
+     * the next wakeup; with it, the VM sleeps until then.
+     */
+    unsigned long long (*clock_ms)(void *user_data);
 } FurryRuntimeConfig;
 
 typedef struct FurryCompileError {
@@ -90,14 +270,26 @@ typedef struct FurryCompileError {
 } FurryCompileError;
 
 const char *furry_version(void);
+const char *furry_audio_backend_name(void);
 
 int furry_compile_script(const char *script, FurryProgram *out_program);
 int furry_compile_script_ex(const char *script, FurryProgram *out_program, FurryCompileError *out_error);
 int furry_run_program(const FurryProgram *program, const FurryRuntimeConfig *config);
+/*
+ * For on_say and choose_option callbacks, on the VM's thread: gives the
+ * spawned contexts due at the current script time one turn while the main
+ * context waits for the player. out_wait_ms (optional) is set to the
+ * milliseconds until a context needs another turn, or -1 when none is waiting
+ * on time. FURRY_ERR outside such a callback or when a context failed; the run
+ * then fails once the callback returns.
+ */
+int furry_run_background(long long *out_wait_ms);
 void furry_free_program(FurryProgram *program);
 
 int furry_snapshot_save(const FurryRuntimeSnapshot *snapshot, char *out_text, size_t out_size);
 int furry_snapshot_load(const char *text, FurryRuntimeSnapshot *out_snapshot);
 int furry_media_is_supported(const char *asset_path);
+/* Asset path an instruction loads (bg/fg/ui_image/ui_anim/ui_video/music/sfx), or NULL. */
+const char *furry_instruction_asset(const FurryInstruction *ins);
 
 #endif
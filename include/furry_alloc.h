@@ -0,0 +1,62 @@
+#ifndef FURRY_ALLOC_H
+#define FURRY_ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Every heap allocation FURRY makes goes through one allocator and is tagged
+ * with the subsystem that owns it, so an embedder can route memory to its own
+ * arenas and watch per-subsystem budgets. Buffers that cross the API in the
+ * other direction (FurrySoftImage pixels from a load_image callback, decoder
+ * state owned by host decoders) stay with their creator's allocator.
+ */
+
+typedef enum FurryMemTag {
+    FURRY_MEM_GENERAL = 0,
+    FURRY_MEM_COMPILER,
+    FURRY_MEM_VM,
+    FURRY_MEM_SCRATCH,
+    FURRY_MEM_SAVE,
+    FURRY_MEM_LOCALE,
+    FURRY_MEM_ASSETS,
+    FURRY_MEM_AUDIO,
+    FURRY_MEM_VIDEO,
+    FURRY_MEM_TEXT,
+    FURRY_MEM_UI,
+    FURRY_MEM_RENDER,
+    FURRY_MEM_ANIM,
+    FURRY_MEM_REPLAY,
+    FURRY_MEM_TRACE,
+    FURRY_MEM_TAG_COUNT
+} FurryMemTag;
+
+/*
+ * One entry point, in the style of lua_Alloc: ptr NULL allocates new_size
+ * bytes, new_size 0 frees ptr, anything else resizes. old_size is the size of
+ * ptr's block. Returned memory must be aligned for any type. Called from the
+ * VM worker, audio and video decode threads too, so it must be thread-safe.
+ */
+typedef void *(*FurryAllocFn)(void *ptr, size_t old_size, size_t new_size, FurryMemTag tag, void *user_data);
+
+typedef struct FurryAllocator {
+    FurryAllocFn fn;
+    void *user_data;
+} FurryAllocator;
+
+/* Process-wide; NULL restores malloc/realloc/free. Only call while no FURRY object or program is alive. */
+void furry_set_allocator(const FurryAllocator *allocator);
+
+/* Bytes are as requested by FURRY, excluding the allocator's own bookkeeping. */
+typedef struct FurryMemoryStats {
+    size_t current_bytes[FURRY_MEM_TAG_COUNT];
+    size_t peak_bytes[FURRY_MEM_TAG_COUNT];
+    size_t allocations[FURRY_MEM_TAG_COUNT];
+} FurryMemoryStats;
+
+void furry_memory_stats(FurryMemoryStats *out_stats);
+
+/* Restarts every peak at its current value, e.g. at the start of a scene. */
+void furry_memory_reset_peaks(void);
+const char *furry_memory_tag_name(FurryMemTag tag);
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef FURRY_ANIM_H
+#define FURRY_ANIM_H
+
+#include <stddef.h>
+
+/*
+ * Keyframe animation for fg animation names and ui_anim play modes. A clip
+ * is a set of per-property key tracks; playing it creates an instance whose
+ * x/y offset, rotation, scale and alpha are re-evaluated by furry_anim_update.
+ * Channels live in property-major SoA arrays indexed by instance slot, and
+ * each frame is one SIMD pass that steps every channel through its current
+ * eased segment; only channels crossing a key fall back to scalar code.
+ */
+
+typedef struct FurryAnim FurryAnim;
+
+typedef enum FurryAnimProperty {
+    FURRY_ANIM_X = 0,
+    FURRY_ANIM_Y,
+    FURRY_ANIM_ROTATION,
+    FURRY_ANIM_SCALE,
+    FURRY_ANIM_ALPHA,
+    FURRY_ANIM_PROPERTY_COUNT
+} FurryAnimProperty;
+
+/* Easing from a key towards the next one; STEP holds the key's value. */
+typedef enum FurryAnimEase {
+    FURRY_EASE_LINEAR = 0,
+    FURRY_EASE_IN_QUAD,
+    FURRY_EASE_OUT_QUAD,
+    FURRY_EASE_IN_OUT,
+    FURRY_EASE_IN_CUBIC,
+    FURRY_EASE_OUT_CUBIC,
+    FURRY_EASE_STEP
+} FurryAnimEase;
+
+typedef enum FurryAnimMode {
+    FURRY_ANIM_ONCE = 0,
+    FURRY_ANIM_LOOP,
+    FURRY_ANIM_PINGPONG
+} FurryAnimMode;
+
+typedef struct FurryAnimKey {
+    FurryAnimProperty property;
+    float time;
+    float value;
+    FurryAnimEase ease;
+} FurryAnimKey;
+
+typedef enum FurryAnimEventType {
+    FURRY_ANIM_FINISHED = 0,
+    FURRY_ANIM_LOOPED
+} FurryAnimEventType;
+
+/* tag is the value given to furry_anim_play, e.g. a sprite id or a pending VM wait. */
+typedef struct FurryAnimEvent {
+    unsigned handle;
+    FurryAnimEventType type;
+    unsigned long long tag;
+} FurryAnimEvent;
+
+int furry_anim_create(size_t capacity_hint, FurryAnim **out_anim);
+void furry_anim_destroy(FurryAnim *anim);
+
+/*
+ * Defines or replaces a clip. Keys may come in any property order but must be
+ * sorted by time within a property; the clip lasts until its latest key.
+ * Properties without keys stay at rest (0, scale 1, alpha 1).
+ */
+int furry_anim_define(FurryAnim *anim, const char *name, const FurryAnimKey *keys, size_t key_count);
+
+/* fade_in, fade_out, idle, bounce, shake and pulse. */
+int furry_anim_define_builtins(FurryAnim *anim);
+
+/* "once", "loop" or "pingpong", as written in ui_anim. */
+int furry_anim_parse_mode(const char *text, FurryAnimMode *out_mode);
+
+/* Handles are never 0; a handle goes stale once stopped, even when its slot is reused. */
+int furry_anim_play(FurryAnim *anim, const char *clip, FurryAnimMode mode, unsigned long long tag, unsigned *out_handle);
+int furry_anim_stop(FurryAnim *anim, unsigned handle);
+
+/*
+ * Advances every instance by dt seconds. Instances played ONCE hold their
+ * final values after FINISHED until stopped; LOOP and PINGPONG report LOOPED
+ * at each wrap. Events stay readable until the next update.
+ */
+int furry_anim_update(FurryAnim *anim, float dt);
+const FurryAnimEvent *furry_anim_events(const FurryAnim *anim, size_t *out_count);
+
+int furry_anim_sample(const FurryAnim *anim, unsigned handle, float out_values[FURRY_ANIM_PROPERTY_COUNT]);
+
+/* Bulk access: one property for every slot below *out_slots; furry_anim_slot maps a handle to its index. */
+const float *furry_anim_values(const FurryAnim *anim, FurryAnimProperty property, size_t *out_slots);
+size_t furry_anim_slot(unsigned handle);
+size_t furry_anim_active(const FurryAnim *anim);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef FURRY_AUDIO_H
+#define FURRY_AUDIO_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Engine mixer behind `music` and `sfx`. Output is interleaved stereo float at
+ * config.sample_rate.
+ *
+ * Threads:
+ *   - game thread: every furry_audio_* call except furry_audio_render (single producer)
+ *   - audio thread: furry_audio_render, normally the device callback; lock-free
+ *   - decode thread: keeps each music stream's ring decode_ahead_frames ahead
+ *
+ * With config.offline set there is no device and no decode thread: the caller
+ * drives furry_audio_render directly, which decodes inline. That is the
+ * headless test/benchmark mode (the equivalent of miniaudio's null device).
+ */
+
+typedef enum FurryAudioBus {
+    FURRY_AUDIO_BUS_MASTER = 0,
+    FURRY_AUDIO_BUS_MUSIC,
+    FURRY_AUDIO_BUS_SFX,
+    FURRY_AUDIO_BUS_VOICE,
+    FURRY_AUDIO_BUS_COUNT
+} FurryAudioBus;
+
+/* Pull decoder producing interleaved float frames with 1 or 2 channels at its native rate. */
+typedef struct FurryAudioDecoder {
+    void *state;
+    unsigned channels;
+    unsigned sample_rate;
+    size_t (*read)(void *state, float *out_frames, size_t frame_count);
+    int (*seek)(void *state, size_t frame);
+    void (*close)(void *state);
+} FurryAudioDecoder;
+
+typedef int (*FurryAudioOpenFn)(const char *path, FurryAudioDecoder *out_decoder, void *user_data);
+
+typedef struct FurryAudioConfig {
+    unsigned sample_rate;
+    unsigned max_sfx_voices;
+    unsigned decode_ahead_frames;
+    unsigned crossfade_ms;
+    float duck_level;
+    unsigned duck_release_ms;
+    int offline;
+    const char *asset_root;
+    FurryAudioOpenFn open_decoder;
+    void *decoder_user_data;
+} FurryAudioConfig;
+
+typedef struct FurryAudioStats {
+    size_t frames_rendered;
+    size_t underruns;
+    size_t voices_stolen;
+    size_t commands_dropped;
+    unsigned active_voices;
+    unsigned active_streams;
+} FurryAudioStats;
+
+void furry_audio_default_config(FurryAudioConfig *config);
+int furry_audio_create(const FurryAudioConfig *config, FurryAudio **out_audio);
+void furry_audio_destroy(FurryAudio *audio);
+
+int furry_audio_preload_sfx(FurryAudio *audio, const char *name);
+int furry_audio_play_music(FurryAudio *audio, const char *track, int loop);
+/* Starts at start_frame (output frames) when the decoder can seek there, else from the top. */
+int furry_audio_play_music_at(FurryAudio *audio, const char *track, int loop, size_t start_frame);
+int furry_audio_stop_music(FurryAudio *audio, unsigned fade_ms);
+int furry_audio_play_sfx(FurryAudio *audio, const char *name, FurryAudioBus bus, float gain);
+int furry_audio_set_bus_volume(FurryAudio *audio, FurryAudioBus bus, float volume, unsigned fade_ms);
+
+/* Game thread: frees streams the mixer has finished with. */
+void furry_audio_update(FurryAudio *audio);
+size_t furry_audio_render(FurryAudio *audio, float *out_frames, size_t frame_count);
+void furry_audio_stats(FurryAudio *audio, FurryAudioStats *out_stats);
+/* Output frames of the current track played so far (start offset included), as of the last render; 0 when stopped. */
+size_t furry_audio_music_position(FurryAudio *audio);
+
+/* Built-in decoder for 16-bit PCM and 32-bit float WAV files. */
+int furry_audio_open_wav(const char *path, FurryAudioDecoder *out_decoder, void *user_data);
+
+#endif
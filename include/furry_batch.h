@@ -0,0 +1,114 @@
+#ifndef FURRY_BATCH_H
+#define FURRY_BATCH_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * CPU-side sprite batching. Between furry_batch_begin and furry_batch_end a
+ * frontend submits every sprite of the frame; end sorts the visible ones by
+ * layer, then texture, then blend mode (submission order breaks ties), and
+ * packs the result into one instance array plus a short draw list where each
+ * draw is a single texture/blend state over a contiguous instance range.
+ * Painter's order is kept between layers, and within a layer only among
+ * sprites that share a texture and blend mode, so overlapping sprites that must
+ * stack go on different layers.
+ *
+ * furry_batch_host_command feeds bg and fg commands straight in; ui_image
+ * and friends are placed by the frontend's UI layout and added with
+ * furry_batch_add on FURRY_BATCH_LAYER_UI.
+ */
+
+#define FURRY_BATCH_LAYER_BG 0
+#define FURRY_BATCH_LAYER_FG 64
+#define FURRY_BATCH_LAYER_UI 128
+#define FURRY_BATCH_MAX_LAYER 255
+#define FURRY_BATCH_MAX_TEXTURE 0xffffffu
+
+typedef struct FurryBatch FurryBatch;
+
+typedef enum FurryBlendMode {
+    FURRY_BLEND_OPAQUE = 0,
+    FURRY_BLEND_ALPHA,
+    FURRY_BLEND_ADDITIVE
+} FurryBlendMode;
+
+/* Where an asset lives: texture (atlas page) id, sub-rect uv (u0, v0, u1, v1) and its size in pixels. */
+typedef struct FurryBatchTexture {
+    unsigned texture;
+    float uv[4];
+    float width;
+    float height;
+} FurryBatchTexture;
+
+typedef int (*FurryBatchResolveFn)(const char *asset, FurryBatchTexture *out_texture, void *user_data);
+
+typedef struct FurryBatchConfig {
+    size_t capacity_hint;
+    FurryBatchResolveFn resolve;
+    void *user_data;
+} FurryBatchConfig;
+
+/* (x, y) is where the pivot point (0..1 of the sprite) lands; rotation is clockwise. tint is 0xRRGGBBAA. */
+typedef struct FurrySprite {
+    unsigned texture;
+    int layer;
+    FurryBlendMode blend;
+    float x;
+    float y;
+    float w;
+    float h;
+    float pivot_x;
+    float pivot_y;
+    float rotation_deg;
+    float uv[4];
+    unsigned tint;
+} FurrySprite;
+
+/*
+ * Packed per-instance vertex data. transform maps the unit quad to pixels:
+ * screen = (t[0]*u + t[1]*v + t[4], t[2]*u + t[3]*v + t[5]) for u, v in 0..1.
+ */
+typedef struct FurrySpriteInstance {
+    float transform[6];
+    float uv[4];
+    unsigned tint;
+} FurrySpriteInstance;
+
+typedef struct FurryDrawCall {
+    unsigned texture;
+    FurryBlendMode blend;
+    size_t first_instance;
+    size_t instance_count;
+} FurryDrawCall;
+
+typedef struct FurryBatchStats {
+    size_t submitted;
+    size_t culled;
+    size_t draws;
+    size_t texture_changes;
+    size_t blend_changes;
+} FurryBatchStats;
+
+int furry_batch_create(const FurryBatchConfig *config, FurryBatch **out_batch);
+void furry_batch_destroy(FurryBatch *batch);
+
+void furry_batch_begin(FurryBatch *batch, float viewport_width, float viewport_height);
+/* Sprites entirely outside the viewport are counted as culled and dropped. */
+int furry_batch_add(FurryBatch *batch, const FurrySprite *sprite);
+int furry_batch_end(FurryBatch *batch);
+
+const FurrySpriteInstance *furry_batch_instances(const FurryBatch *batch, size_t *out_count);
+const FurryDrawCall *furry_batch_draws(const FurryBatch *batch, size_t *out_count);
+/* Stats of the last furry_batch_end. */
+void furry_batch_stats(const FurryBatch *batch, FurryBatchStats *out_stats);
+
+/*
+ * on_host_command adapter with the batch as user_data: bg covers the viewport
+ * opaque on FURRY_BATCH_LAYER_BG, fg asset|x|y|rot places the sprite's
+ * bottom-centre at normalized (x, y) on FURRY_BATCH_LAYER_FG. Needs a resolver.
+ */
+int furry_batch_host_command(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef FURRY_BUILDER_H
+#define FURRY_BUILDER_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Builds a FurryProgram from typed calls instead of script text, for tools
+ * and frontends (the Lua binding in furry_lua.h sits on top of this). Each
+ * furry_emit_* call appends one instruction exactly as the matching script
+ * line would; arguments are taken verbatim, so '|', '->' and ':' need no
+ * escaping. Numeric arguments are formatted the way hosts read them from
+ * scripts ("%g").
+ *
+ * Instructions go through the same checks as furry_compile_script_ex
+ * (media extensions, expressions, variable slots) and labels are resolved at
+ * finish. The first failing call poisons the builder: later calls return
+ * FURRY_ERR and finish reports that error, with line set to the 1-based
+ * number of the emit call that failed.
+ */
+
+typedef struct FurryProgramBuilder FurryProgramBuilder;
+
+typedef struct FurryBuilderOption {
+    const char *text;
+    const char *target;
+} FurryBuilderOption;
+
+int furry_builder_create(FurryProgramBuilder **out_builder);
+void furry_builder_destroy(FurryProgramBuilder *builder);
+
+/* The error that poisoned the builder, or NULL. */
+const FurryCompileError *furry_builder_error(const FurryProgramBuilder *builder);
+
+/* Resolves labels and moves the program out; the builder is empty afterwards and can be reused. */
+int furry_builder_finish(FurryProgramBuilder *builder, FurryProgram *out_program, FurryCompileError *out_error);
+
+int furry_emit_label(FurryProgramBuilder *builder, const char *name);
+int furry_emit_say(FurryProgramBuilder *builder, const char *speaker, const char *text);
+int furry_emit_goto(FurryProgramBuilder *builder, const char *label);
+int furry_emit_call(FurryProgramBuilder *builder, const char *label);
+int furry_emit_return(FurryProgramBuilder *builder);
+int furry_emit_set(FurryProgramBuilder *builder, const char *key, const char *value);
+int furry_emit_set_expr(FurryProgramBuilder *builder, const char *key, const char *expr);
+int furry_emit_add(FurryProgramBuilder *builder, const char *key, int amount);
+int furry_emit_if_eq(FurryProgramBuilder *builder, const char *key, const char *value, const char *label);
+int furry_emit_if(FurryProgramBuilder *builder, const char *expr, const char *label);
+int furry_emit_choice(FurryProgramBuilder *builder, const char *prompt, const FurryBuilderOption *options, size_t count);
+int furry_emit_save(FurryProgramBuilder *builder, const char *slot);
+int furry_emit_load(FurryProgramBuilder *builder, const char *slot);
+int furry_emit_end(FurryProgramBuilder *builder);
+int furry_emit_spawn(FurryProgramBuilder *builder, const char *label);
+int furry_emit_wait(FurryProgramBuilder *builder, int ms);
+int furry_emit_wait_event(FurryProgramBuilder *builder, const char *event);
+int furry_emit_signal(FurryProgramBuilder *builder, const char *event);
+
+int furry_emit_bg(FurryProgramBuilder *builder, const char *asset);
+int furry_emit_fg(FurryProgramBuilder *builder, const char *asset, double x, double y, double rotation, const char *animation);
+int furry_emit_music(FurryProgramBuilder *builder, const char *asset);
+int furry_emit_sfx(FurryProgramBuilder *builder, const char *asset);
+
+int furry_emit_ui_begin(FurryProgramBuilder *builder, const char *layer);
+int furry_emit_ui_end(FurryProgramBuilder *builder);
+int furry_emit_ui_panel(FurryProgramBuilder *builder, const char *id, double x, double y, double w, double h);
+int furry_emit_ui_text(FurryProgramBuilder *builder, const char *id, const char *text);
+int furry_emit_ui_image(FurryProgramBuilder *builder, const char *id, const char *asset);
+int furry_emit_ui_anim(FurryProgramBuilder *builder, const char *id, const char *asset, const char *play_mode);
+int furry_emit_ui_video(FurryProgramBuilder *builder, const char *id, const char *asset, int loop);
+int furry_emit_ui_bind(FurryProgramBuilder *builder, const char *id, const char *key);
+int furry_emit_button(FurryProgramBuilder *builder, const char *id, const char *label, const char *target);
+
+#endif
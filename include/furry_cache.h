@@ -0,0 +1,43 @@
+#ifndef FURRY_CACHE_H
+#define FURRY_CACHE_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * On-disk compile cache for unchanged scripts (editor previews, test runs).
+ * Entries are keyed by a hash of the source text, furry_version() and the
+ * compiled layout (instruction size and limits), so a different engine build
+ * never reads another's entries; the source length and CRC are checked too.
+ *
+ * Each entry is written to a process-unique temporary file and renamed into
+ * place, so concurrent processes sharing a directory never see a partial
+ * entry. Hits refresh the entry's modification time, and after every store
+ * the oldest entries are deleted until the directory fits max_bytes (LRU).
+ * Scripts that fail to compile are not cached.
+ */
+
+typedef struct FurryCompileCache FurryCompileCache;
+
+typedef struct FurryCompileCacheConfig {
+    /* 0 means 64 MB. */
+    size_t max_bytes;
+} FurryCompileCacheConfig;
+
+typedef struct FurryCompileCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+} FurryCompileCacheStats;
+
+/* Creates dir if needed. */
+int furry_compile_cache_open(const char *dir, const FurryCompileCacheConfig *config, FurryCompileCache **out_cache);
+void furry_compile_cache_close(FurryCompileCache *cache);
+
+/* furry_compile_script_ex through the cache; a NULL cache just compiles. */
+int furry_compile_cached(FurryCompileCache *cache, const char *script, FurryProgram *out_program, FurryCompileError *out_error);
+void furry_compile_cache_stats(const FurryCompileCache *cache, FurryCompileCacheStats *out_stats);
+
+#endif
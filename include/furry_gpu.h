@@ -0,0 +1,57 @@
+#ifndef FURRY_GPU_H
+#define FURRY_GPU_H
+
+#include <stddef.h>
+
+/*
+ * API-neutral pieces of a GPU frontend, kept out of the Vulkan module so they
+ * build and test everywhere.
+ *
+ * FurryStagingRing hands out byte ranges of one persistently mapped upload
+ * buffer to frames in flight. Allocations only move the head forward; when
+ * frame slot N's fence signals, furry_staging_retire(N) releases everything
+ * that frame allocated, so uploads never wait on a frame that is not the
+ * oldest. An allocation never straddles the end of the buffer; the remainder
+ * is skipped instead.
+ */
+
+#define FURRY_GPU_MAX_FRAMES 3
+
+typedef struct FurryStagingRing {
+    size_t capacity;
+    /* Running byte counts; offsets into the buffer are these modulo capacity. */
+    unsigned long long head;
+    unsigned long long tail;
+    unsigned long long frame_end[FURRY_GPU_MAX_FRAMES];
+    size_t allocated;
+    size_t skipped;
+} FurryStagingRing;
+
+void furry_staging_init(FurryStagingRing *ring, size_t capacity);
+/*
+ * Reserves size bytes at an offset aligned to alignment (a power of two).
+ * Fails when the ring is full; retire the oldest frame in flight and retry.
+ */
+int furry_staging_alloc(FurryStagingRing *ring, size_t size, size_t alignment, size_t *out_offset);
+/* Marks the end of what frame slot `frame` allocated, just before it is submitted. */
+void furry_staging_close_frame(FurryStagingRing *ring, unsigned frame);
+/* The GPU is done with frame slot `frame`; its allocations are reused. */
+void furry_staging_retire(FurryStagingRing *ring, unsigned frame);
+size_t furry_staging_used(const FurryStagingRing *ring);
+
+/*
+ * Driver pipeline-cache blobs on disk. The file carries a key (hash the
+ * device's vendor, device, driver version and cache UUID into it) and a CRC,
+ * so a blob from another driver or a torn write is never handed back to the
+ * driver. Saves replace the file atomically.
+ */
+int furry_gpu_cache_save(const char *path, unsigned long long key, const void *data, size_t size);
+/*
+ * Reads the blob saved under key. With out_data NULL only *out_size is set, as
+ * with vkGetPipelineCacheData; otherwise out_capacity must hold the whole blob.
+ */
+int furry_gpu_cache_load(const char *path, unsigned long long key, void *out_data, size_t out_capacity, size_t *out_size);
+/* FNV-1a over size bytes, continuing from hash; start from 0 for a fresh key. */
+unsigned long long furry_gpu_cache_key(unsigned long long hash, const void *data, size_t size);
+
+#endif
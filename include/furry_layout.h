@@ -0,0 +1,72 @@
+#ifndef FURRY_LAYOUT_H
+#define FURRY_LAYOUT_H
+
+#include <stddef.h>
+
+/*
+ * Engine-side UI layout. Nodes form a tree of nested panels; each is sized
+ * and offset in pixels, as a fraction of its parent, or as a fraction of the
+ * viewport, then placed by an anchor point on the parent and a pivot point on
+ * itself (both 0..1). Node data is stored as structure-of-arrays, and changes
+ * only mark the touched node dirty: furry_layout_update re-lays out just the
+ * dirty subtrees into a flat rect array indexed by node id.
+ */
+
+typedef struct FurryLayout FurryLayout;
+
+typedef enum FurryLayoutUnit {
+    FURRY_LAYOUT_PX = 0,
+    FURRY_LAYOUT_PARENT,
+    FURRY_LAYOUT_VIEWPORT
+} FurryLayoutUnit;
+
+typedef struct FurryLayoutLength {
+    float value;
+    FurryLayoutUnit unit;
+} FurryLayoutLength;
+
+typedef struct FurryLayoutSpec {
+    FurryLayoutLength x;
+    FurryLayoutLength y;
+    FurryLayoutLength w;
+    FurryLayoutLength h;
+    float anchor_x;
+    float anchor_y;
+    float pivot_x;
+    float pivot_y;
+} FurryLayoutSpec;
+
+/* Absolute pixels, top-left origin; tightly packed for direct upload. */
+typedef struct FurryRect {
+    float x;
+    float y;
+    float w;
+    float h;
+} FurryRect;
+
+int furry_layout_create(size_t capacity_hint, FurryLayout **out_layout);
+void furry_layout_destroy(FurryLayout *layout);
+void furry_layout_clear(FurryLayout *layout);
+
+void furry_layout_set_viewport(FurryLayout *layout, float width, float height);
+
+/* parent < 0 attaches to the viewport. Node ids are dense and assigned in creation order. */
+int furry_layout_add(FurryLayout *layout, int parent, const FurryLayoutSpec *spec, int *out_node);
+int furry_layout_set_spec(FurryLayout *layout, int node, const FurryLayoutSpec *spec);
+
+/* Re-lays out dirty subtrees; returns how many nodes were recomputed. */
+size_t furry_layout_update(FurryLayout *layout);
+const FurryRect *furry_layout_rects(const FurryLayout *layout, size_t *out_count);
+size_t furry_layout_node_count(const FurryLayout *layout);
+
+/*
+ * Parses one ui_panel field: "120px" pixels, "25%" of the parent, "0.5vp" of
+ * the viewport along the same axis, and a bare number as a normalized parent
+ * fraction.
+ */
+int furry_layout_parse_length(const char *text, FurryLayoutLength *out_length);
+
+/* Builds a spec from ui_panel x|y|w|h strings with a top-left anchor and pivot. */
+int furry_layout_spec_from_panel(const char *x, const char *y, const char *w, const char *h, FurryLayoutSpec *out_spec);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef FURRY_LAZY_H
+#define FURRY_LAZY_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Lazy compilation for very large scripts. furry_lazy_open runs a prepass
+ * that only finds line boundaries, labels and ui nesting, splits the script
+ * into blocks at top-level labels and compiles the first block. The rest is
+ * left blank until the VM reaches it (FurryRuntimeConfig.lazy) or
+ * furry_lazy_poll installs it. Labels are in place from the start, so jumps
+ * and choices resolve before their target is compiled.
+ *
+ * With background = 1 a thread parses the remaining blocks in script order.
+ * Parsed blocks are only installed (expressions, variable slots, jump
+ * targets) by the thread that runs the program, so the VM never sees the
+ * program change under it.
+ *
+ * Errors only show up when their block is compiled. Release builds should
+ * still compile with furry_compile_script_ex or call furry_lazy_finish, which
+ * reports the first error. Replays, seen sets, locale extraction and asset
+ * listing read every instruction and need a finished program.
+ */
+
+typedef struct FurryLazyConfig {
+    int background;
+} FurryLazyConfig;
+
+typedef struct FurryLazyStats {
+    size_t blocks;
+    size_t installed_blocks;
+    /* Blocks the background thread parsed before the VM needed them. */
+    size_t background_blocks;
+} FurryLazyStats;
+
+int furry_lazy_open(const char *script, const FurryLazyConfig *config, FurryLazyProgram **out_lazy, FurryCompileError *out_error);
+void furry_lazy_close(FurryLazyProgram *lazy);
+
+/* Valid until furry_lazy_close; instructions are never moved. */
+const FurryProgram *furry_lazy_program(const FurryLazyProgram *lazy);
+
+/* Compiles the block holding ip if it is still pending, waiting for the background thread if it has it. */
+int furry_lazy_ensure(FurryLazyProgram *lazy, size_t ip, FurryCompileError *out_error);
+/* Installs whatever the background thread has parsed so far; never waits. */
+int furry_lazy_poll(FurryLazyProgram *lazy, FurryCompileError *out_error);
+/* Compiles every remaining block; the result is a complete program, as from furry_compile_script_ex. */
+int furry_lazy_finish(FurryLazyProgram *lazy, FurryCompileError *out_error);
+void furry_lazy_stats(const FurryLazyProgram *lazy, FurryLazyStats *out_stats);
+
+#endif
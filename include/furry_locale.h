@@ -0,0 +1,46 @@
+#ifndef FURRY_LOCALE_H
+#define FURRY_LOCALE_H
+
+#include <stdio.h>
+
+#include "furry.h"
+
+/*
+ * Localized text lives outside the compiled program. The compiler tags every
+ * `say` speaker/line, `ui_text`, `button` label and `choice` prompt/option with
+ * a stable id (a hash of the source text); translations are stored in binary
+ * tables that are memory-mapped one language at a time.
+ *
+ * Workflow:
+ *   1. furry_locale_export_template(program, "en.txt")   -> "id<TAB>text" lines
+ *   2. translators edit a copy, e.g. "de.txt"
+ *   3. furry_locale_build_table("de.txt", "de.fyl")
+ *   4. furry_locale_open("de.fyl", &locale); config.locale = locale;
+ *   5. furry_locale_switch(locale, "fr.fyl") at any time, even mid-run.
+ *
+ * Switching is safe while programs run on other threads (furry_worker): the
+ * old table stays mapped until a later switch or close finds no run using the
+ * locale. Switch and close themselves must not race each other.
+ */
+
+/* 32-bit hash of text; the compiler rejects scripts where two different texts share an id. */
+unsigned furry_locale_string_id(const char *text);
+
+int furry_locale_export_template(const FurryProgram *program, const char *path);
+int furry_locale_build_table(const char *source_path, const char *table_path);
+
+int furry_locale_open(const char *table_path, FurryLocale **out_locale);
+int furry_locale_switch(FurryLocale *locale, const char *table_path);
+void furry_locale_close(FurryLocale *locale);
+
+/*
+ * Returns NULL when the active table has no entry. Pointers stay valid for the rest of the
+ * furry_run_program they were looked up in; outside a run, until the next switch or close.
+ */
+const char *furry_locale_lookup(const FurryLocale *locale, unsigned id);
+size_t furry_locale_string_count(const FurryLocale *locale);
+
+/* Writes "id<TAB>source text" for every program string missing from the table; returns the count. */
+size_t furry_locale_report_missing(const FurryLocale *locale, const FurryProgram *program, FILE *out);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef FURRY_LUA_H
+#define FURRY_LUA_H
+
+#include "furry.h"
+#include "furry_builder.h"
+
+/*
+ * Optional Lua frontend over FurryProgramBuilder, built when FURRY_ENABLE_LUA
+ * finds Lua 5.3/5.4 (the library then defines FURRY_HAVE_LUA). Lua authoring
+ * code builds programs in process, with no script text in between:
+ *
+ *   local b = furry.builder()
+ *   b:label("start")
+ *   b:say("Guide", "Pipes | arrows -> and colons: all literal")
+ *   b:choice("Where to?", {{"Left", "left"}, {"Right", "right"}})
+ *   b:ui_panel("root", 0, 0, 1, 1)
+ *
+ * Methods are the furry_emit_* names without the prefix, except where the
+ * name is a Lua keyword: goto -> jump, return -> ret, if -> when, end -> stop.
+ * A failing method raises a Lua error, so the message points at the Lua line.
+ */
+
+struct lua_State;
+
+/* Module loader: require("furry") or luaL_requiref(L, "furry", luaopen_furry, 1). */
+int luaopen_furry(struct lua_State *L);
+
+/* The builder behind a furry.builder() value at index; raises a Lua error if it is not one. */
+FurryProgramBuilder *furry_lua_check_builder(struct lua_State *L, int index);
+
+/*
+ * Runs a Lua file in a fresh state with the module loaded and a builder in
+ * the global `program`, then finishes it. out_error->line is the Lua line
+ * that failed, or the emit number for label errors found at finish.
+ */
+int furry_lua_build_file(const char *path, FurryProgram *out_program, FurryCompileError *out_error);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef FURRY_PACK_H
+#define FURRY_PACK_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Asset pack: many assets in one file, so a game opens and maps a single file
+ * instead of stat/opening every image, track and clip it references.
+ *
+ * Layout: header, an index of fixed entries sorted by path hash, a name blob,
+ * then entry data. Every entry starts on the writer's alignment boundary, so a
+ * stored entry can be handed to a texture upload straight from the mapping.
+ * Entries may be compressed with the built-in LZ codec (byte-oriented, no
+ * entropy stage, decodes at memory speed); the writer keeps whichever form is
+ * smaller by a useful margin.
+ *
+ * Paths are stored as written in scripts, with '\' folded to '/' and leading
+ * "./" removed, and compared case-sensitively.
+ */
+
+typedef struct FurryPack FurryPack;
+typedef struct FurryPackWriter FurryPackWriter;
+
+typedef struct FurryPackWriterConfig {
+    /* Power of two; 0 means 64. */
+    size_t alignment;
+    /* Try the LZ codec on every entry. */
+    int compress;
+} FurryPackWriterConfig;
+
+typedef struct FurryPackEntry {
+    const char *path;
+    /* Points into the mapping for stored entries; NULL for compressed ones, read those with furry_pack_read. */
+    const void *data;
+    size_t size;
+    size_t stored_size;
+    int compressed;
+    /* Position in the index, as used by furry_pack_entry_at. */
+    size_t index;
+} FurryPackEntry;
+
+int furry_pack_writer_create(const FurryPackWriterConfig *config, FurryPackWriter **out_writer);
+/* Copies (and possibly compresses) data now; duplicate paths are rejected at finish. */
+int furry_pack_writer_add(FurryPackWriter *writer, const char *path, const void *data, size_t size);
+int furry_pack_writer_add_file(FurryPackWriter *writer, const char *path, const char *file_path);
+int furry_pack_writer_finish(FurryPackWriter *writer, const char *out_path);
+void furry_pack_writer_destroy(FurryPackWriter *writer);
+
+int furry_pack_open(const char *path, FurryPack **out_pack);
+void furry_pack_close(FurryPack *pack);
+
+size_t furry_pack_count(const FurryPack *pack);
+int furry_pack_entry_at(const FurryPack *pack, size_t index, FurryPackEntry *out_entry);
+int furry_pack_find(const FurryPack *pack, const char *path, FurryPackEntry *out_entry);
+
+/* Copies or decompresses an entry into out (at least entry->size bytes) and verifies its checksum. */
+int furry_pack_read(const FurryPack *pack, const FurryPackEntry *entry, void *out, size_t out_size);
+
+/*
+ * Compile-time check that every asset the program references (see
+ * furry_instruction_asset) is in the pack; reports the first missing one the
+ * way furry_compile_script_ex reports errors.
+ */
+int furry_pack_check_program(const FurryPack *pack, const FurryProgram *program, FurryCompileError *out_error);
+
+/* The in-tree codec, exposed for tools and tests. Bound is the worst-case compressed size. */
+size_t furry_lz_bound(size_t size);
+size_t furry_lz_compress(const void *src, size_t src_size, void *dst, size_t dst_capacity);
+/* Returns FURRY_OK only if src decodes to exactly dst_size bytes. */
+int furry_lz_decompress(const void *src, size_t src_size, void *dst, size_t dst_size);
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef FURRY_PLATFORM_H
+#define FURRY_PLATFORM_H
+
+#include <stddef.h>
+
+#include "furry_worker.h"
+
+/*
+ * Window-system-neutral pieces of a platform loop, kept out of the SDL3
+ * module so they build and test everywhere.
+ *
+ * FurryPacer decides how long the loop may sleep. A VN spends most of its
+ * time showing a still line of dialogue, so with nothing animating and nothing
+ * changed the loop blocks on the event queue with no timeout. Input, a host
+ * command or anything else that changes the screen invalidates it for one
+ * frame. While something animates, frames follow target_hz, or vsync when
+ * target_hz is 0 and the present call does the waiting.
+ *
+ * FurryInputRouter turns key and pointer events into worker inputs: advance
+ * while a say line waits, and number keys while a choice waits.
+ */
+
+/* furry_pacer_timeout: block until the next event. */
+#define FURRY_PACER_FOREVER (-1LL)
+
+#define FURRY_PLATFORM_TEXT 256
+
+/* Key codes match SDL's: printable keys are their character. */
+#define FURRY_KEY_RETURN '\r'
+#define FURRY_KEY_ESCAPE 27
+#define FURRY_KEY_SPACE ' '
+
+typedef struct FurryPacerStats {
+    size_t frames;
+    /* Loop iterations that blocked with no timeout, or until a frame deadline. */
+    size_t idle_waits;
+    size_t timed_waits;
+    size_t inputs;
+    /* From an input event's timestamp to the end of the first frame drawn after it. */
+    size_t latency_samples;
+    unsigned long long latency_total_ns;
+    unsigned long long latency_max_ns;
+} FurryPacerStats;
+
+typedef struct FurryPacer {
+    unsigned long long period_ns;
+    unsigned long long next_frame_ns;
+    int dirty;
+    /* Oldest input not yet on screen; 0 when there is none. */
+    unsigned long long pending_input_ns;
+    FurryPacerStats stats;
+} FurryPacer;
+
+typedef enum FurryPlatformEventType {
+    FURRY_EVENT_QUIT = 0,
+    FURRY_EVENT_KEY,
+    FURRY_EVENT_POINTER,
+    /* Committed text, from the keyboard or an IME. */
+    FURRY_EVENT_TEXT,
+    /* IME composition in progress: text is the preedit string, cursor and selection are in characters. */
+    FURRY_EVENT_COMPOSE,
+    FURRY_EVENT_RESIZE,
+    FURRY_EVENT_EXPOSE
+} FurryPlatformEventType;
+
+typedef struct FurryPlatformEvent {
+    FurryPlatformEventType type;
+    /* In the clock passed to the pacer. */
+    unsigned long long timestamp_ns;
+    int key;
+    int repeat;
+    int button;
+    float x;
+    float y;
+    int width;
+    int height;
+    int cursor;
+    int selection;
+    char text[FURRY_PLATFORM_TEXT];
+} FurryPlatformEvent;
+
+typedef enum FurryRouterWait {
+    FURRY_ROUTER_IDLE = 0,
+    FURRY_ROUTER_SAY,
+    FURRY_ROUTER_CHOICE
+} FurryRouterWait;
+
+typedef struct FurryInputRouter {
+    FurryRouterWait waiting;
+    size_t choice_count;
+} FurryInputRouter;
+
+/* target_hz <= 0 leaves pacing to the present call (vsync). */
+void furry_pacer_init(FurryPacer *pacer, double target_hz);
+/* The screen changed; draw one frame. */
+void furry_pacer_invalidate(FurryPacer *pacer);
+/* An input event at event_ns; invalidates and starts a latency sample. */
+void furry_pacer_input(FurryPacer *pacer, unsigned long long event_ns);
+/*
+ * How long the loop may wait for events before drawing: FURRY_PACER_FOREVER
+ * when idle, 0 to draw now, otherwise nanoseconds to the next frame deadline.
+ */
+long long furry_pacer_timeout(FurryPacer *pacer, unsigned long long now_ns, int animating);
+/* Whether a frame should be drawn at now_ns; furry_pacer_timeout without the bookkeeping. */
+int furry_pacer_due(const FurryPacer *pacer, unsigned long long now_ns, int animating);
+/* A frame was drawn and presented at now_ns. */
+void furry_pacer_frame_done(FurryPacer *pacer, unsigned long long now_ns);
+
+void furry_router_reset(FurryInputRouter *router);
+/* Tracks what the VM waits for from the worker's records. */
+void furry_router_command(FurryInputRouter *router, const FurryHostCommand *command);
+/* Returns 1 and fills out_input when the event answers the current wait; the wait is then over. */
+int furry_router_event(FurryInputRouter *router, const FurryPlatformEvent *event, FurryWorkerInput *out_input);
+
+#endif
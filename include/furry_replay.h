@@ -0,0 +1,70 @@
+#ifndef FURRY_REPLAY_H
+#define FURRY_REPLAY_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Deterministic record/replay of a furry_run_program playthrough. Recording
+ * wraps the host's callbacks and logs every input the VM cannot compute by
+ * itself: choice indices, load_slot results (return code and snapshot) and
+ * non-zero return codes from on_say/on_host_command/save_slot/on_ui_patch/
+ * on_bind_update/on_scene_restore. Records are keyed by step, the ordinal of
+ * the VM's call into choose_option/on_say/on_host_command/save_slot/
+ * load_slot/on_scene_restore, and
+ * delta-encoded, so a long session is a few bytes per choice. Recording
+ * turns skip mode off, since what a skip suppresses depends on the seen set.
+ *
+ * Replay stubs out every host callback, audio and locale and feeds the log
+ * back, so the VM runs flat out: a replay file doubles as a regression test
+ * (it must consume the same inputs and end with the same result) and as a
+ * production-derived benchmark workload.
+ *
+ * Typical use:
+ *   furry_replay_record_begin(&program, &host_config, &replay, &config);
+ *   result = furry_run_program(&program, &config);
+ *   furry_replay_record_end(replay, result);
+ *   furry_replay_save(replay, "session.fyr");
+ *   ...
+ *   furry_replay_load("session.fyr", &replay);
+ *   furry_replay_run(&program, replay);
+ */
+
+typedef struct FurryReplay FurryReplay;
+
+typedef struct FurryReplayStats {
+    size_t steps;
+    size_t records;
+    size_t choices;
+    size_t loads;
+    size_t log_bytes;
+    int result;
+    /* Replay only: step at which the VM asked for something the log does not hold, or 0. */
+    size_t diverged_at;
+} FurryReplayStats;
+
+/*
+ * Fills out_config with host_config's settings and recording wrappers around
+ * its callbacks; run the program with out_config. Callbacks the host left
+ * NULL are recorded as succeeding without the VM's default console output.
+ * The built-in save_store is read and written through the wrappers. Record
+ * with furry_run_program, not furry_worker, which replaces the callbacks.
+ */
+int furry_replay_record_begin(const FurryProgram *program, const FurryRuntimeConfig *host_config, FurryReplay **out_replay,
+                              FurryRuntimeConfig *out_config);
+void furry_replay_record_end(FurryReplay *replay, int run_result);
+
+int furry_replay_save(const FurryReplay *replay, const char *path);
+int furry_replay_load(const char *path, FurryReplay **out_replay);
+void furry_replay_destroy(FurryReplay *replay);
+
+/*
+ * Replays the log against program with all host output stubbed. Returns
+ * FURRY_OK only if the program matches the recorded one, every record was
+ * consumed at its step and the run ended with the recorded result.
+ */
+int furry_replay_run(const FurryProgram *program, FurryReplay *replay);
+void furry_replay_stats(const FurryReplay *replay, FurryReplayStats *out_stats);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FURRY_SAVE_H
+#define FURRY_SAVE_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Built-in save backend used when FurryRuntimeConfig.save_store is set and no
+ * save_slot/load_slot callbacks are provided.
+ *
+ * All slots live in one append-only log of checksummed records (<path>) with a
+ * slot index checkpoint (<path>.idx). Saves are encoded on the caller's thread
+ * into a double-buffered pending set and written by a background thread that
+ * batches one fsync per wake-up, so the VM never waits on disk. Torn tails are
+ * dropped on open, and the log is compacted when dead records dominate.
+ */
+
+typedef struct FurrySaveStoreConfig {
+    size_t compact_min_bytes;
+} FurrySaveStoreConfig;
+
+typedef struct FurrySaveSlotInfo {
+    char slot[FURRY_MAX_NAME];
+    unsigned long long sequence;
+    size_t size;
+} FurrySaveSlotInfo;
+
+typedef struct FurrySaveStoreStats {
+    size_t records_written;
+    size_t batches;
+    size_t fsyncs;
+    size_t compactions;
+    size_t log_bytes;
+    size_t live_bytes;
+} FurrySaveStoreStats;
+
+int furry_save_store_open(const char *path, const FurrySaveStoreConfig *config, FurrySaveStore **out_store);
+void furry_save_store_close(FurrySaveStore *store);
+
+int furry_save_store_put(FurrySaveStore *store, const char *slot, const FurryRuntimeSnapshot *snapshot);
+int furry_save_store_get(FurrySaveStore *store, const char *slot, FurryRuntimeSnapshot *out_snapshot);
+size_t furry_save_store_list(FurrySaveStore *store, FurrySaveSlotInfo *out_slots, size_t max_slots);
+
+/* Blocks until every accepted save is on disk; meant for shutdown or tests, not the VM thread. */
+int furry_save_store_flush(FurrySaveStore *store);
+void furry_save_store_stats(FurrySaveStore *store, FurrySaveStoreStats *out_stats);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef FURRY_SDL_H
+#define FURRY_SDL_H
+
+#include <stddef.h>
+
+#include "furry_platform.h"
+#include "furry_worker.h"
+
+/*
+ * SDL3 platform loop; built when CMake finds SDL3 (FURRY_HAVE_SDL3). It owns
+ * the window, keyboard, pointer and IME text events, and paces frames with a
+ * FurryPacer: with nothing animating it sleeps in SDL_WaitEvent until input
+ * or the VM wakes it, so a VN idling on dialogue uses next to no CPU.
+ *
+ * Attach a worker started with wake = furry_sdl_wake and wake_user_data = the
+ * platform. Its records are drained only when it signals, go to on_command,
+ * and drive a FurryInputRouter; Return, Space or a left click then advances a
+ * say line and 1-9 answers a choice. Every event also reaches on_event, which
+ * can send its own inputs (a clicked choice button, say).
+ *
+ * on_frame draws and presents (the Vulkan renderer through the window from
+ * furry_sdl_window, for instance) and returns nonzero while something is
+ * still animating. Set video_driver to "offscreen" or "dummy" to run without
+ * a display.
+ */
+
+typedef struct FurrySdlPlatform FurrySdlPlatform;
+
+typedef struct FurrySdlConfig {
+    const char *title;
+    int width;
+    int height;
+    /* Frame rate while animating; 0 means present paces to vsync, or 60 when vsync is off. */
+    double target_hz;
+    /* The on_frame present waits for vertical blank. */
+    int vsync;
+    int resizable;
+    int hidden;
+    /* SDL_HINT_VIDEO_DRIVER, e.g. "offscreen" or "dummy" for headless tests; NULL keeps SDL's choice. */
+    const char *video_driver;
+    /* Created with SDL_WINDOW_VULKAN, for a surface from furry_sdl_window. */
+    int vulkan;
+    /* FURRY_ERR from on_command or on_event stops the loop with an error. */
+    int (*on_command)(const FurryHostCommand *command, void *user_data);
+    int (*on_event)(const FurryPlatformEvent *event, void *user_data);
+    /* Returns 1 while animating, 0 when the frame can stay on screen, -1 to stop with an error. */
+    int (*on_frame)(unsigned long long now_ns, void *user_data);
+    void *user_data;
+} FurrySdlConfig;
+
+typedef struct FurrySdlStats {
+    FurryPacerStats pacing;
+    size_t events;
+    size_t wakes;
+    size_t commands;
+    /* Wall and process CPU time since furry_sdl_create. */
+    unsigned long long wall_ns;
+    unsigned long long cpu_ns;
+} FurrySdlStats;
+
+/* When SDL itself fails, SDL_GetError() on the calling thread says why. */
+int furry_sdl_create(const FurrySdlConfig *config, FurrySdlPlatform **out_platform);
+void furry_sdl_destroy(FurrySdlPlatform *platform);
+
+/* Starts routing the worker's records; NULL detaches. The worker must use furry_sdl_wake. */
+void furry_sdl_attach_worker(FurrySdlPlatform *platform, FurryWorker *worker);
+/* Thread-safe; wakes the loop to drain the worker. Matches FurryWorkerConfig.wake. */
+void furry_sdl_wake(void *platform);
+
+/* Runs until the window closes, furry_sdl_quit, or the attached worker's END record. */
+int furry_sdl_run(FurrySdlPlatform *platform);
+/*
+ * One loop iteration: waits as the pacer allows (never longer than
+ * max_wait_ns when that is >= 0), handles events and commands, draws if due.
+ * Returns 1 to keep going, 0 once quit or after the worker's END record,
+ * and -1 when a callback failed.
+ */
+int furry_sdl_step(FurrySdlPlatform *platform, long long max_wait_ns);
+void furry_sdl_quit(FurrySdlPlatform *platform);
+void furry_sdl_invalidate(FurrySdlPlatform *platform);
+
+/* Where the IME should place its candidate window, in window pixels; cursor is the offset of the caret from x. */
+void furry_sdl_set_text_area(FurrySdlPlatform *platform, int x, int y, int w, int h, int cursor);
+/* The SDL_Window. */
+void *furry_sdl_window(FurrySdlPlatform *platform);
+/* Monotonic clock used for event timestamps and on_frame. */
+unsigned long long furry_sdl_now(void);
+void furry_sdl_stats(const FurrySdlPlatform *platform, FurrySdlStats *out_stats);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef FURRY_SEEN_H
+#define FURRY_SEEN_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Per-program "already read" record for skip mode: one bit per instruction,
+ * set by the VM as each instruction runs (FurryRuntimeConfig.seen). The file
+ * form is a small header plus the raw bitset, about 1 KB per 8000 lines of
+ * script. It carries the program's fingerprint, so a set saved against an
+ * edited script is refused by furry_seen_load instead of marking the wrong lines.
+ */
+
+int furry_seen_create(const FurryProgram *program, FurrySeenSet **out_seen);
+void furry_seen_destroy(FurrySeenSet *seen);
+
+int furry_seen_contains(const FurrySeenSet *seen, size_t ip);
+void furry_seen_mark(FurrySeenSet *seen, size_t ip);
+/* Number of instructions marked so far. */
+size_t furry_seen_count(const FurrySeenSet *seen);
+
+/* Written to a temporary file and renamed over path. */
+int furry_seen_save(const FurrySeenSet *seen, const char *path);
+/* Merges the bits saved at path into seen; fails without changes if the file is missing, corrupt or for another program. */
+int furry_seen_load(FurrySeenSet *seen, const char *path);
+
+#endif
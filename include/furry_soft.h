@@ -0,0 +1,69 @@
+#ifndef FURRY_SOFT_H
+#define FURRY_SOFT_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Reference CPU renderer for golden-image tests and benchmarks on machines
+ * without a GPU. Plug furry_soft_host_command in as on_host_command (with the
+ * renderer as user_data) and bg, fg, ui_* and button commands draw immediately
+ * into an opaque RGBA8 framebuffer:
+ *   - bg scales the image over the whole frame
+ *   - fg asset|x|y|rot places the sprite's bottom-centre at (x, y) in
+ *     normalized screen space, rotated rot degrees clockwise, bilinear-sampled
+ *   - ui_panel fills its rect (furry_layout panel units) and starts a column
+ *     that ui_text, button and ui_image/anim/video lines flow down
+ *
+ * Images are premultiplied RGBA8. The built-in loader reads binary PPM (P6);
+ * other assets get a deterministic placeholder derived from the asset name.
+ * Colors passed as `unsigned rgba` are 0xRRGGBBAA with straight alpha.
+ */
+
+typedef struct FurrySoftRenderer FurrySoftRenderer;
+
+typedef struct FurrySoftImage {
+    int width;
+    int height;
+    unsigned char *pixels;
+} FurrySoftImage;
+
+/* Fills out_image with malloc'd straight-alpha RGBA8 pixels; the renderer premultiplies and owns them. */
+typedef int (*FurrySoftImageFn)(const char *path, FurrySoftImage *out_image, void *user_data);
+
+typedef struct FurrySoftConfig {
+    int width;
+    int height;
+    const char *asset_root;
+    FurrySoftImageFn load_image;
+    void *user_data;
+} FurrySoftConfig;
+
+typedef struct FurrySoftStats {
+    size_t sprites;
+    size_t glyphs;
+    size_t pixels_blended;
+} FurrySoftStats;
+
+int furry_soft_create(const FurrySoftConfig *config, FurrySoftRenderer **out_renderer);
+void furry_soft_destroy(FurrySoftRenderer *renderer);
+
+int furry_soft_host_command(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data);
+
+void furry_soft_clear(FurrySoftRenderer *renderer, unsigned rgba);
+int furry_soft_draw_sprite(FurrySoftRenderer *renderer, const char *asset, float x, float y, float rotation_deg);
+void furry_soft_draw_text(FurrySoftRenderer *renderer, int x, int y, int scale, unsigned rgba, const char *text);
+
+const unsigned char *furry_soft_pixels(const FurrySoftRenderer *renderer, int *out_width, int *out_height);
+unsigned furry_soft_hash(const FurrySoftRenderer *renderer);
+void furry_soft_stats(const FurrySoftRenderer *renderer, FurrySoftStats *out_stats);
+
+int furry_soft_write_ppm(const FurrySoftRenderer *renderer, const char *path);
+int furry_soft_write_png(const FurrySoftRenderer *renderer, const char *path);
+int furry_soft_load_ppm(const char *path, FurrySoftImage *out_image, void *user_data);
+
+/* Width in pixels of text drawn by furry_soft_draw_text at the given scale. */
+int furry_soft_text_width(const char *text, int scale);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef FURRY_TEXT_H
+#define FURRY_TEXT_H
+
+#include <stddef.h>
+
+/*
+ * CPU-side text: UTF-8 decoding, word wrap and a glyph cache packed into a
+ * single-channel coverage atlas. Frontends lay text out into positioned quads
+ * and draw them from the atlas; glyphs are rasterized once per (codepoint,
+ * pixel size) and stay cached until the atlas runs out of room, when the
+ * least recently used shelf of glyphs is evicted.
+ */
+
+typedef struct FurryTextCache FurryTextCache;
+
+/*
+ * One rasterized glyph. coverage is width x height 8-bit alpha with the given
+ * stride, owned by the rasterizer and only read until the next call. bearing_x
+ * and bearing_y offset the bitmap from the pen position and the top of the
+ * line box.
+ */
+typedef struct FurryGlyphBitmap {
+    int width;
+    int height;
+    int stride;
+    int bearing_x;
+    int bearing_y;
+    int advance;
+    const unsigned char *coverage;
+} FurryGlyphBitmap;
+
+typedef int (*FurryGlyphRasterFn)(unsigned codepoint, int pixel_size, FurryGlyphBitmap *out_bitmap, void *user_data);
+
+typedef struct FurryTextConfig {
+    int atlas_width;
+    int atlas_height;
+    FurryGlyphRasterFn rasterize;
+    void *user_data;
+} FurryTextConfig;
+
+typedef struct FurryTextStyle {
+    int pixel_size;
+    float max_width;
+    float line_height;
+} FurryTextStyle;
+
+/* Position relative to the layout's top-left corner; uv in atlas pixels. */
+typedef struct FurryGlyphQuad {
+    float x;
+    float y;
+    float w;
+    float h;
+    float u;
+    float v;
+    unsigned codepoint;
+} FurryGlyphQuad;
+
+typedef struct FurryTextLayout {
+    FurryGlyphQuad *quads;
+    size_t quad_count;
+    size_t quad_capacity;
+    size_t line_count;
+    float width;
+    float height;
+} FurryTextLayout;
+
+typedef struct FurryTextStats {
+    size_t glyph_hits;
+    size_t glyph_misses;
+    size_t evictions;
+    size_t cached_glyphs;
+} FurryTextStats;
+
+/* Zero atlas sizes mean 512x512; a NULL rasterizer means furry_text_builtin_raster. */
+int furry_text_create(const FurryTextConfig *config, FurryTextCache **out_cache);
+void furry_text_destroy(FurryTextCache *cache);
+
+/*
+ * Lays out text, wrapping at spaces, after hyphens and between CJK characters
+ * when max_width > 0; words wider than a line break anywhere. line_height 0
+ * means pixel_size * 9 / 8. Reuses out_layout's quad buffer; free it with
+ * furry_text_layout_free. Fails if the glyphs of one call cannot share the
+ * atlas.
+ */
+int furry_text_layout(FurryTextCache *cache, const char *text, const FurryTextStyle *style, FurryTextLayout *out_layout);
+void furry_text_layout_free(FurryTextLayout *layout);
+
+/*
+ * The atlas is only written by furry_text_layout. generation changes when
+ * glyphs are evicted, which invalidates quads from earlier layouts.
+ */
+const unsigned char *furry_text_atlas(const FurryTextCache *cache, int *out_width, int *out_height, unsigned *out_generation);
+
+/* Returns 1 and the region written since the last call, or 0 when nothing changed. */
+int furry_text_atlas_take_dirty(FurryTextCache *cache, int *out_x, int *out_y, int *out_w, int *out_h);
+void furry_text_stats(const FurryTextCache *cache, FurryTextStats *out_stats);
+
+/* Decodes one code point and returns the bytes consumed; malformed input yields U+FFFD. */
+size_t furry_utf8_decode(const char *text, size_t length, unsigned *out_codepoint);
+
+/* 5x7 ASCII bitmap font scaled by pixel_size / 8; other code points render as '?'. */
+int furry_text_builtin_raster(unsigned codepoint, int pixel_size, FurryGlyphBitmap *out_bitmap, void *user_data);
+
+#endif
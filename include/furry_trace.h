@@ -0,0 +1,89 @@
+#ifndef FURRY_TRACE_H
+#define FURRY_TRACE_H
+
+#include <stddef.h>
+
+/*
+ * Timeline tracing of the VM and its host. Each thread that records an event
+ * gets its own lock-free ring of fixed-size binary events, so tracing never
+ * takes a lock on the VM, audio or worker threads; a full ring drops the new
+ * event and counts it. With the level at FURRY_TRACE_OFF every trace point
+ * is a single relaxed load and branch.
+ *
+ * furry_trace_export_chrome drains the rings into Chrome trace JSON, which
+ * chrome://tracing, Perfetto (ui.perfetto.dev) and Speedscope open directly.
+ * Event times are TIME_UTC; the export makes them relative to
+ * furry_trace_begin and keeps the absolute start in its metadata.
+ */
+
+typedef enum FurryTraceLevel {
+    FURRY_TRACE_OFF = 0,
+    /* Host callbacks with their duration, compile phases and asset loads. */
+    FURRY_TRACE_HOST,
+    /* Also the VM's instruction batches between host callbacks. */
+    FURRY_TRACE_VM
+} FurryTraceLevel;
+
+typedef enum FurryTraceKind {
+    FURRY_TRACE_BATCH = 0,
+    FURRY_TRACE_HOST_COMMAND,
+    FURRY_TRACE_SAY,
+    FURRY_TRACE_CHOOSE,
+    FURRY_TRACE_SAVE,
+    FURRY_TRACE_LOAD,
+    FURRY_TRACE_SCENE_RESTORE,
+    FURRY_TRACE_BIND_UPDATE,
+    FURRY_TRACE_COMPILE,
+    FURRY_TRACE_VALIDATE,
+    FURRY_TRACE_LAZY_PREPASS,
+    FURRY_TRACE_LAZY_PARSE,
+    FURRY_TRACE_LAZY_INSTALL,
+    FURRY_TRACE_ASSET_LOAD,
+    FURRY_TRACE_KIND_COUNT
+} FurryTraceKind;
+
+typedef struct FurryTraceEvent {
+    unsigned long long start_ns;
+    unsigned long long duration_ns;
+    FurryTraceKind kind;
+    /* Instruction count for batches and compile phases, the opcode for host commands, bytes for asset loads. */
+    unsigned arg;
+    /* 1-based, in the order threads first recorded. */
+    unsigned thread;
+    /* Asset path or instruction operand, truncated. */
+    char detail[36];
+} FurryTraceEvent;
+
+typedef struct FurryTraceConfig {
+    /* Ring capacity per thread; 0 means 65536 events (6 MB). */
+    size_t events_per_thread;
+} FurryTraceConfig;
+
+typedef struct FurryTraceStats {
+    size_t threads;
+    size_t recorded;
+    size_t dropped;
+} FurryTraceStats;
+
+/*
+ * Discards any previous capture and starts recording at level. Like
+ * furry_set_allocator, only call while no other thread is recording.
+ */
+int furry_trace_begin(FurryTraceLevel level, const FurryTraceConfig *config);
+/* Changes the level of a running capture; FURRY_TRACE_OFF pauses it. */
+void furry_trace_set_level(FurryTraceLevel level);
+FurryTraceLevel furry_trace_level(void);
+/* Stops recording and frees the rings; same threading rule as furry_trace_begin. */
+void furry_trace_end(void);
+
+/* Names the calling thread in exports; threads FURRY starts name themselves. */
+void furry_trace_thread_name(const char *name);
+
+/* Moves up to max_events recorded events into out_events, thread by thread; returns the count. */
+size_t furry_trace_drain(FurryTraceEvent *out_events, size_t max_events);
+/* Drains everything recorded so far into a Chrome trace JSON file. */
+int furry_trace_export_chrome(const char *path);
+void furry_trace_stats(FurryTraceStats *out_stats);
+const char *furry_trace_kind_name(FurryTraceKind kind);
+
+#endif
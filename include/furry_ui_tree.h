@@ -0,0 +1,72 @@
+#ifndef FURRY_UI_TREE_H
+#define FURRY_UI_TREE_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Retained UI: every `ui_begin layer` ... `ui_end` declaration is diffed by
+ * node id against the layer's previous declaration, and only the differences
+ * reach the host as patches. Set FurryRuntimeConfig.ui_tree to enable it in
+ * the VM; ui_* instructions and buttons inside a block then go to
+ * on_ui_patch instead of on_host_command.
+ *
+ * Node values by kind (unused values are ""):
+ *   ui_panel x, y, w, h | ui_text text | ui_image asset | ui_anim asset, mode
+ *   ui_video asset, loop | ui_bind key | button label, action
+ */
+
+#define FURRY_UI_NODE_VALUES 4
+#define FURRY_UI_MAX_DEPTH 8
+
+typedef enum FurryUiPatchType {
+    FURRY_UI_PATCH_CREATE = 0,
+    FURRY_UI_PATCH_UPDATE,
+    FURRY_UI_PATCH_REMOVE
+} FurryUiPatchType;
+
+/*
+ * Per ui_end, REMOVE patches come first, highest old index first, then
+ * CREATE/UPDATE in declaration order with the node's new index, so applying
+ * them in order keeps a host-side list in sync. UPDATE names the changed value
+ * in field.
+ */
+struct FurryUiPatch {
+    FurryUiPatchType type;
+    const char *layer;
+    const char *id;
+    FurryOpCode kind;
+    size_t index;
+    int field;
+    const char *values[FURRY_UI_NODE_VALUES];
+};
+
+typedef int (*FurryUiPatchFn)(const FurryUiPatch *patch, void *user_data);
+
+typedef struct FurryUiTreeStats {
+    size_t declarations;
+    size_t skipped;
+    size_t nodes_declared;
+    size_t patches;
+} FurryUiTreeStats;
+
+int furry_ui_tree_create(FurryUiTree **out_tree);
+void furry_ui_tree_destroy(FurryUiTree *tree);
+
+/*
+ * source identifies where a declaration came from (0 = unknown). The VM passes
+ * key for static blocks and skips straight past ui_end when
+ * furry_ui_tree_try_skip reports the layer already holds that declaration.
+ */
+int furry_ui_tree_begin(FurryUiTree *tree, const char *layer, unsigned long long source);
+int furry_ui_tree_try_skip(FurryUiTree *tree, const char *layer, unsigned long long source);
+int furry_ui_tree_node(FurryUiTree *tree, FurryOpCode kind, const char *id, const char *const values[FURRY_UI_NODE_VALUES]);
+int furry_ui_tree_end(FurryUiTree *tree, FurryUiPatchFn emit, void *user_data);
+
+/* Drops a layer, emitting REMOVE for each of its nodes. */
+int furry_ui_tree_clear(FurryUiTree *tree, const char *layer, FurryUiPatchFn emit, void *user_data);
+size_t furry_ui_tree_node_count(const FurryUiTree *tree, const char *layer);
+void furry_ui_tree_stats(const FurryUiTree *tree, FurryUiTreeStats *out_stats);
+
+#endif
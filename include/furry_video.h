@@ -0,0 +1,96 @@
+#ifndef FURRY_VIDEO_H
+#define FURRY_VIDEO_H
+
+#include <stddef.h>
+
+/*
+ * Decode-ahead playback for `ui_video id|asset|loop_flag`. A decode thread
+ * fills a bounded queue of RGBA8 frames ahead of presentation; the render
+ * thread calls furry_video_present with its clock and gets the newest frame
+ * that is due, dropping frames it is late for and repeating the current one
+ * when the next is not due yet. Frame buffers come from a pool sized at open,
+ * and decoded and recycled frames move between the threads through two
+ * lock-free rings, so playback allocates nothing per frame.
+ *
+ * Threads:
+ *   - render thread: every furry_video_* call
+ *   - decode thread: the decoder's read_frame/rewind, unless config.offline,
+ *     in which case furry_video_present decodes inline (tests and benchmarks)
+ */
+
+typedef struct FurryVideo FurryVideo;
+
+/* Pull decoder producing tightly packed width x height RGBA8 frames. */
+typedef struct FurryVideoDecoder {
+    void *state;
+    int width;
+    int height;
+    double frame_rate;
+    /* Decodes the next frame and its presentation time in seconds; sets *out_end instead at end of stream. */
+    int (*read_frame)(void *state, unsigned char *out_rgba, double *out_pts, int *out_end);
+    int (*rewind)(void *state);
+    void (*close)(void *state);
+} FurryVideoDecoder;
+
+typedef int (*FurryVideoOpenFn)(const char *path, FurryVideoDecoder *out_decoder, void *user_data);
+
+typedef struct FurryVideoConfig {
+    unsigned queue_frames;
+    int offline;
+    const char *asset_root;
+    FurryVideoOpenFn open_decoder;
+    void *decoder_user_data;
+} FurryVideoConfig;
+
+/* Valid until the next furry_video_present. frame counts from 0 within each loop. */
+typedef struct FurryVideoFrame {
+    const unsigned char *pixels;
+    int width;
+    int height;
+    double pts;
+    size_t frame;
+    int is_new;
+} FurryVideoFrame;
+
+typedef struct FurryVideoStats {
+    size_t frames_decoded;
+    size_t frames_presented;
+    size_t frames_dropped;
+    size_t frames_repeated;
+    size_t underruns;
+    size_t loops;
+} FurryVideoStats;
+
+/* Synthetic decoder settings; furry_video_open_test_pattern takes one as user_data (NULL = 320x180 at 30 fps, 90 frames). */
+typedef struct FurryVideoPattern {
+    int width;
+    int height;
+    double frame_rate;
+    size_t frame_count;
+    unsigned decode_cost_us;
+} FurryVideoPattern;
+
+void furry_video_default_config(FurryVideoConfig *config);
+
+/*
+ * loop mirrors ui_video's loop_flag: the stream rewinds seamlessly, with pts
+ * continuing to increase. No codec is built in, so config.open_decoder must be
+ * set (furry_video_open_test_pattern for synthetic streams).
+ */
+int furry_video_open(const FurryVideoConfig *config, const char *asset, int loop, FurryVideo **out_video);
+void furry_video_close(FurryVideo *video);
+
+/*
+ * now is seconds since playback started. Returns FURRY_OK with pixels NULL
+ * until the first frame is decoded.
+ */
+int furry_video_present(FurryVideo *video, double now, FurryVideoFrame *out_frame);
+
+/* 1 once a non-looping stream has shown its last frame for its full duration. */
+int furry_video_finished(const FurryVideo *video, double now);
+void furry_video_stats(const FurryVideo *video, FurryVideoStats *out_stats);
+
+/* Moving colour bars with the frame number in the first pixel (R = low byte, G = high byte). */
+int furry_video_open_test_pattern(const char *path, FurryVideoDecoder *out_decoder, void *user_data);
+
+#endif
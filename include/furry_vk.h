@@ -0,0 +1,83 @@
+#ifndef FURRY_VK_H
+#define FURRY_VK_H
+
+#include <stddef.h>
+
+#include "furry.h"
+#include "furry_soft.h"
+
+/*
+ * Vulkan renderer for the host command stream; built when CMake finds the
+ * Vulkan SDK (FURRY_HAVE_VULKAN). It draws into an offscreen RGBA8 target,
+ * so it runs headless on a software ICD such as lavapipe or SwiftShader;
+ * presenting the target to a window is the platform layer's job.
+ *
+ * Plug furry_vk_host_command in as on_host_command with the renderer as
+ * user_data. Commands update a retained scene, like furry_soft's:
+ *   - bg replaces the scene with one opaque full-screen sprite
+ *   - fg asset|x|y|rot adds a sprite, placed as by furry_batch_host_command
+ *   - ui_begin clears the UI; ui_panel, ui_text, button and ui_image/anim/video
+ *     flow down a column as in furry_soft
+ * furry_vk_render_frame then draws the scene: one FurryBatch pass, one
+ * instanced draw per texture/blend run, instance data and texture uploads
+ * going through a persistently mapped staging ring shared by the frames in
+ * flight (see furry_gpu.h). Each frame slot has its own command pool and
+ * fence, and the CPU only waits when it is about to reuse a slot.
+ *
+ * Pipelines are created through a VkPipelineCache loaded from and saved to
+ * pipeline_cache_path, so only the first run pays for shader compilation.
+ */
+
+#define FURRY_VK_MAX_TEXTURES 1024
+
+typedef struct FurryVkRenderer FurryVkRenderer;
+
+typedef struct FurryVkConfig {
+    int width;
+    int height;
+    /* 2 or 3; 0 means 2. */
+    unsigned frames_in_flight;
+    /* Staging ring size; 0 means 16 MB. A texture must fit in it whole. */
+    size_t staging_bytes;
+    /* NULL keeps the pipeline cache in memory only. */
+    const char *pipeline_cache_path;
+    /* Enables VK_LAYER_KHRONOS_validation when it is installed. */
+    int validation;
+    const char *asset_root;
+    /* Same contract as furry_soft; NULL reads binary PPM, and missing images get a placeholder. */
+    FurrySoftImageFn load_image;
+    void *user_data;
+} FurryVkConfig;
+
+typedef struct FurryVkStats {
+    size_t frames;
+    size_t draws;
+    size_t instances;
+    size_t textures;
+    size_t texture_uploads;
+    size_t upload_bytes;
+    /* Times an upload had to wait for an older frame to free staging space. */
+    size_t staging_waits;
+    /* Bytes of pipeline cache found on disk at create; 0 on a cold start. */
+    size_t pipeline_cache_bytes;
+    /* Name of the physical device in use. */
+    char device[256];
+} FurryVkStats;
+
+/* Fails when no Vulkan device with a graphics queue is available. */
+int furry_vk_create(const FurryVkConfig *config, FurryVkRenderer **out_renderer);
+/* Waits for the GPU and saves the pipeline cache. */
+void furry_vk_destroy(FurryVkRenderer *renderer);
+
+int furry_vk_host_command(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data);
+void furry_vk_clear(FurryVkRenderer *renderer);
+
+/* Records and submits one frame of the retained scene; returns once submitted, not when drawn. */
+int furry_vk_render_frame(FurryVkRenderer *renderer);
+/* Waits for every frame in flight. */
+int furry_vk_wait_idle(FurryVkRenderer *renderer);
+/* Copies the last rendered frame out as premultiplied RGBA8, width * height * 4 bytes; waits for it. */
+int furry_vk_read_pixels(FurryVkRenderer *renderer, unsigned char *out_pixels, size_t out_size);
+void furry_vk_stats(const FurryVkRenderer *renderer, FurryVkStats *out_stats);
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef FURRY_WORKER_H
+#define FURRY_WORKER_H
+
+#include <stddef.h>
+
+#include "furry.h"
+
+/*
+ * Threaded runtime: furry_run_program runs on a worker thread and every host
+ * command is copied into a self-contained FurryHostCommand published on a
+ * lock-free SPSC ring. The render thread drains it with furry_worker_poll and
+ * answers choices/advances on a second ring with furry_worker_send. Neither
+ * call blocks; when the command ring is full the VM thread waits instead
+ * (back-pressure), so a slow script step only delays commands, never a frame.
+ * While the script waits for an advance or a choice the VM thread sleeps until
+ * furry_worker_send delivers one, waking only to give spawned contexts their
+ * turns. Script time for wait runs on the real clock (clock_ms if set).
+ *
+ * save_slot/load_slot, save_store, audio and locale from the runtime config are
+ * used on the worker thread. choose_option/on_host_command/on_say are replaced,
+ * and on_scene_restore and on_skip_stop are ignored: a load or the end of a
+ * skip publishes its scene as bg, fg and music records ahead of the restored
+ * ui layers, and a skip ends at its first stop. The seen set is only touched
+ * on the worker thread.
+ */
+
+typedef struct FurryWorker FurryWorker;
+
+typedef enum FurryWorkerInputType {
+    FURRY_INPUT_CHOICE = 0,
+    FURRY_INPUT_ADVANCE,
+    FURRY_INPUT_STOP
+} FurryWorkerInputType;
+
+typedef struct FurryWorkerInput {
+    FurryWorkerInputType type;
+    int value;
+} FurryWorkerInput;
+
+/*
+ * op is the instruction (SAY: a=speaker b=text, CHOICE: a=prompt + choices)
+ * or FURRY_OP_END with i = furry_run_program's result as the final record.
+ * With a ui_tree, retained-UI patches arrive as records with ui_patch set to
+ * 1 + FurryUiPatchType: op = node kind, a = node id, b = layer, i = field,
+ * ui_index = index and choices[0..3].text = node values. When the runtime
+ * config sets on_bind_update, each bind update arrives as a record with
+ * bind_update = 1: op = FURRY_OP_UI_BIND, a = node id, b = layer, c = value
+ * and choices[0].text = key.
+ * issued_ns is TIME_UTC in nanoseconds when the VM published the record.
+ */
+typedef struct FurryHostCommand {
+    unsigned long long sequence;
+    unsigned long long issued_ns;
+    FurryOpCode op;
+    int i;
+    int ui_patch;
+    int bind_update;
+    size_t ui_index;
+    char a[FURRY_MAX_TEXT];
+    char b[FURRY_MAX_TEXT];
+    char c[FURRY_MAX_TEXT];
+    size_t choice_count;
+    FurryChoice choices[FURRY_MAX_CHOICES];
+} FurryHostCommand;
+
+typedef struct FurryWorkerConfig {
+    size_t command_capacity;
+    size_t input_capacity;
+    int wait_on_say;
+    /*
+     * Called on the VM thread after every published record, so a render
+     * thread blocked in its event loop can wake and poll instead of polling on
+     * a timer. Must be thread-safe and cheap; furry_sdl_wake fits.
+     */
+    void (*wake)(void *user_data);
+    void *wake_user_data;
+} FurryWorkerConfig;
+
+typedef struct FurryWorkerStats {
+    size_t commands_published;
+    size_t producer_stalls;
+    size_t max_queue_depth;
+    size_t inputs_dropped;
+} FurryWorkerStats;
+
+int furry_worker_start(const FurryProgram *program, const FurryRuntimeConfig *runtime_config, const FurryWorkerConfig *config,
+                       FurryWorker **out_worker);
+size_t furry_worker_poll(FurryWorker *worker, FurryHostCommand *out_commands, size_t max_commands);
+int furry_worker_send(FurryWorker *worker, const FurryWorkerInput *input);
+int furry_worker_finished(FurryWorker *worker);
+void furry_worker_stats(FurryWorker *worker, FurryWorkerStats *out_stats);
+
+/* Stops the VM at its next host command if still running, joins it and returns the run result. */
+int furry_worker_join(FurryWorker *worker);
+
+#endif
@@ -0,0 +1,13 @@
+#version 450
+
+// Premultiplied RGBA8 textures; the glyph atlas is R8 viewed as (r, r, r, r).
+layout(set = 0, binding = 0) uniform sampler2D sprite_texture;
+
+layout(location = 0) in vec2 in_uv;
+layout(location = 1) in vec4 in_tint;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = texture(sprite_texture, in_uv) * in_tint;
+}
@@ -0,0 +1,25 @@
+#version 450
+
+// One FurrySpriteInstance per instance; the unit quad comes from gl_VertexIndex (4-vertex strip).
+layout(location = 0) in vec4 in_linear;
+layout(location = 1) in vec2 in_offset;
+layout(location = 2) in vec4 in_uv;
+layout(location = 3) in uint in_tint;
+
+layout(push_constant) uniform Push {
+    vec2 viewport;
+} push;
+
+layout(location = 0) out vec2 out_uv;
+layout(location = 1) out vec4 out_tint;
+
+void main() {
+    vec2 corner = vec2(float(gl_VertexIndex & 1), float(gl_VertexIndex >> 1));
+    vec2 pixel = vec2(in_linear.x * corner.x + in_linear.y * corner.y + in_offset.x,
+                      in_linear.z * corner.x + in_linear.w * corner.y + in_offset.y);
+    gl_Position = vec4(pixel / push.viewport * 2.0 - 1.0, 0.0, 1.0);
+    out_uv = mix(in_uv.xy, in_uv.zw, corner);
+    // 0xRRGGBBAA, straight alpha; textures are premultiplied, so the tint is too.
+    vec4 tint = vec4(uvec4(in_tint >> 24, in_tint >> 16, in_tint >> 8, in_tint) & 0xffu) / 255.0;
+    out_tint = vec4(tint.rgb * tint.a, tint.a);
+}
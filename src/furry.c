@@ -1,16 +1,136 @@
 #include "furry.h"
+#include "furry_audio.h"
+#include "furry_internal.h"
+#include "furry_lazy.h"
+#include "furry_locale.h"
+#include "furry_save.h"
+#include "furry_seen.h"
+#include "furry_ui_tree.h"
 
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <strings.h>
 #include <string.h>
+#include <threads.h>
 
-#define FURRY_OK 0
-#define FURRY_ERR 1
+#define COMPILE_TEMP_SIZE (FURRY_MAX_TEXT * 2)
+#define COMPILE_SCRATCH_CHUNK (16 * 1024)
+#define DEFAULT_MAX_CONTEXTS 256
+#define DEFAULT_CONTEXT_BUDGET 64
+
+/* step() results besides FURRY_OK and FURRY_ERR. */
+#define STEP_END 2
+#define STEP_SUSPEND 3
+
+typedef struct RuntimeBinding {
+    const char *layer;
+    const char *id;
+    int slot;
+    unsigned epoch;
+    int next;
+} RuntimeBinding;
+
+typedef struct RuntimeUiScope {
+    const char *layer;
+    unsigned epoch;
+} RuntimeUiScope;
+
+typedef enum RuntimeWait {
+    WAIT_NONE = 0,
+    WAIT_TIME,
+    WAIT_EVENT
+} RuntimeWait;
+
+/* A spawned context; the main context keeps its ip and call stack in the snapshot and only uses the wait fields. */
+typedef struct RuntimeContext {
+    size_t ip;
+    unsigned long long wake_ms;
+    /* The wait_event instruction's name while waiting on an event. */
+    const char *event;
+    unsigned char live;
+    unsigned char wait;
+    unsigned char depth;
+    size_t callstack[FURRY_MAX_CONTEXT_CALLSTACK];
+} RuntimeContext;
 
 typedef struct RuntimeState {
+    const FurryProgram *program;
     FurryRuntimeSnapshot snap;
+    /* Per-slot tables below hold slot_capacity entries (bitsets slot_capacity / 64 words), grown with program->var_name_count. */
+    size_t slot_capacity;
+    int *slot_index;
+    const FurryLocale *locale;
+    FurryInstruction localized_ins;
+    FurryChoice localized_choices[FURRY_MAX_CHOICES];
+    int ui_depth;
+
+    /* ui_bind: variable slots changed since the last host sync, and per slot the list of nodes bound to it. */
+    unsigned long long *dirty;
+    unsigned long long *bound;
+    RuntimeBinding bindings[FURRY_MAX_BINDINGS];
+    size_t binding_count;
+    int *bind_head;
+    int bind_index_stale;
+    RuntimeUiScope scopes[FURRY_UI_MAX_DEPTH];
+    size_t scope_depth;
+    unsigned epoch;
+    FurryBindUpdate updates[FURRY_MAX_BINDINGS];
+    int (*bind_fn)(const FurryBindUpdate *, size_t, void *);
+    void *user_data;
+
+    /* Host hooks shared by the run loop and scene restore. */
+    int (*host_fn)(FurryOpCode, const FurryInstruction *, const FurryRuntimeSnapshot *, void *);
+    int (*scene_fn)(const FurrySceneState *, void *);
+    FurryAudio *audio;
+    FurryUiTree *ui_tree;
+    FurryUiPatchFn patch_fn;
+
+    /* Skip mode: scene parts and ui layers held back until the skip stops. */
+    FurrySeenSet *seen;
+    FurrySkipMode skip_mode;
+    FurrySkipMode (*skip_fn)(FurrySkipStop, void *);
+    int skip_budget;
+    int skip_steps;
+    int skipping;
+    unsigned skip_parts;
+    size_t skip_layers[FURRY_MAX_SCENE_LAYERS];
+    size_t skip_layer_count;
+
+    /* Lazily compiled programs: the block known to be compiled, [lazy_begin, lazy_end). */
+    FurryLazyProgram *lazy;
+    size_t lazy_begin;
+    size_t lazy_end;
+
+    /* FURRY_TRACE_VM: the instructions run since the last host callback. */
+    unsigned long long trace_batch_start;
+    unsigned trace_batch_count;
+
+    /* Instruction hooks; without them the VM prints. */
+    int (*choose_fn)(const char *, const FurryChoice *, size_t, void *);
+    int (*save_fn)(const char *, const FurryRuntimeSnapshot *, void *);
+    int (*load_fn)(const char *, FurryRuntimeSnapshot *, void *);
+    int (*say_fn)(const char *, const char *, void *);
+    FurrySaveStore *save_store;
+
+    /*
+     * spawn: contexts in spawn order, allocated on the first spawn. A running
+     * context is swapped into snap, its frames pushed above the main context's
+     * at stack_base; running is NULL while the main context runs.
+     */
+    RuntimeContext *contexts;
+    size_t context_capacity;
+    size_t context_count;
+    size_t context_runnable;
+    int context_budget;
+    /* The run's max_steps, which also bounds a single context turn held open by a ui block. */
+    int max_steps;
+    RuntimeContext *running;
+    size_t stack_base;
+    RuntimeContext main_wait;
+    unsigned long long (*clock_fn)(void *);
+    unsigned long long now_ms;
+    int background_failed;
 } RuntimeState;
 
 static int find_label(const FurryProgram *program, const char *label);
@@ -42,7 +162,7 @@ static int safe_copy(char *dst, size_t dst_size, const char *src) {
 
 static int append_instruction(FurryProgram *program, const FurryInstruction *ins) {
     size_t next = program->count + 1;
-    FurryInstruction *resized = realloc(program->code, next * sizeof(FurryInstruction));
+    FurryInstruction *resized = furry_realloc(FURRY_MEM_COMPILER, program->code, next * sizeof(FurryInstruction));
     if (resized == NULL) {
         return FURRY_ERR;
     }
@@ -52,9 +172,9 @@ static int append_instruction(FurryProgram *program, const FurryInstruction *ins
     return FURRY_OK;
 }
 
-static int parse_choice_option(const char *token, FurryChoice *out) {
-    char temp[FURRY_MAX_TEXT * 2];
-    if (safe_copy(temp, sizeof(temp), token) != FURRY_OK) {
+static int parse_choice_option(FurryScratch *scratch, const char *token, FurryChoice *out) {
+    char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+    if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, token) != FURRY_OK) {
         return FURRY_ERR;
     }
     char *arrow = strstr(temp, "->");
@@ -101,10 +221,68 @@ const char *furry_version(void) {
     return "0.4.0";
 }
 
-static int validate_program_references(const FurryProgram *program, FurryCompileError *out_error) {
+static int is_ui_node_op(FurryOpCode op) {
+    return (op >= FURRY_OP_UI_BEGIN && op <= FURRY_OP_UI_BIND) || op == FURRY_OP_BUTTON;
+}
+
+/* A ui block holding only ui/button instructions declares the same nodes every time; target = its ui_end, else -1. */
+static unsigned long long hash_bytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static unsigned long long hash_text(unsigned long long hash, const char *text) {
+    return hash_bytes(hash, text, strlen(text) + 1);
+}
+
+/* ui_begin of a static block: target is its ui_end and i a hash of the block's source, which keys the ui tree's skip. */
+static void mark_static_ui_blocks(FurryProgram *program, size_t start, size_t end) {
+    for (size_t i = start; i < end; ++i) {
+        FurryInstruction *begin = &program->code[i];
+        if (begin->op != FURRY_OP_UI_BEGIN) {
+            continue;
+        }
+        begin->target = -1;
+        int depth = 0;
+        for (size_t j = i; j < end && is_ui_node_op(program->code[j].op); ++j) {
+            if (program->code[j].op == FURRY_OP_UI_BEGIN) {
+                depth++;
+            } else if (program->code[j].op == FURRY_OP_UI_END && --depth == 0) {
+                begin->target = (int)j;
+                break;
+            }
+        }
+        if (begin->target < 0) {
+            continue;
+        }
+        unsigned long long hash = 14695981039346656037ull;
+        for (size_t j = i; j <= (size_t)begin->target; ++j) {
+            const FurryInstruction *ins = &program->code[j];
+            hash = hash_bytes(hash, &ins->op, sizeof(ins->op));
+            hash = hash_text(hash_text(hash_text(hash, ins->a), ins->b), ins->c);
+            hash = hash_text(hash_text(hash, ins->choices[0].text), ins->choices[0].target);
+        }
+        begin->i = (int)(unsigned)(hash ^ (hash >> 32));
+    }
+}
+
+static int find_label_linear(const FurryProgram *program, const char *label, void *user_data) {
+    (void)user_data;
+    return find_label(program, label);
+}
+
+int furry_validate_range(FurryProgram *program, size_t start, size_t end, FurryLabelLookup lookup, void *lookup_data,
+                         FurryCompileError *out_error) {
+    if (lookup == NULL) {
+        lookup = find_label_linear;
+    }
     int ui_depth = 0;
-    for (size_t i = 0; i < program->count; ++i) {
-        const FurryInstruction *ins = &program->code[i];
+    for (size_t i = start; i < end; ++i) {
+        FurryInstruction *ins = &program->code[i];
         if (ins->op == FURRY_OP_UI_BEGIN) {
             ui_depth++;
         } else if (ins->op == FURRY_OP_UI_END) {
@@ -118,12 +296,14 @@ static int validate_program_references(const FurryProgram *program, FurryCompile
             ui_depth--;
         }
 
-        if (ins->op == FURRY_OP_GOTO || ins->op == FURRY_OP_CALL || ins->op == FURRY_OP_IF_EQ || ins->op == FURRY_OP_BUTTON) {
-            const char *target = ins->op == FURRY_OP_IF_EQ ? ins->c : ins->a;
-            if (ins->op == FURRY_OP_BUTTON) {
+        if (ins->op == FURRY_OP_GOTO || ins->op == FURRY_OP_CALL || ins->op == FURRY_OP_IF_EQ || ins->op == FURRY_OP_IF ||
+            ins->op == FURRY_OP_BUTTON || ins->op == FURRY_OP_SPAWN) {
+            const char *target = ins->a;
+            if (ins->op == FURRY_OP_IF_EQ || ins->op == FURRY_OP_IF || ins->op == FURRY_OP_BUTTON) {
                 target = ins->c;
             }
-            if (find_label(program, target) < 0) {
+            ins->target = lookup(program, target, lookup_data);
+            if (ins->target < 0) {
                 if (out_error != NULL) {
                     out_error->line = (int)i + 1;
                     snprintf(out_error->message, sizeof(out_error->message), "unknown label target '%.120s'", target);
@@ -132,7 +312,8 @@ static int validate_program_references(const FurryProgram *program, FurryCompile
             }
         } else if (ins->op == FURRY_OP_CHOICE) {
             for (size_t c = 0; c < ins->choice_count; ++c) {
-                if (find_label(program, ins->choices[c].target) < 0) {
+                ins->choices[c].target_index = lookup(program, ins->choices[c].target, lookup_data);
+                if (ins->choices[c].target_index < 0) {
                     if (out_error != NULL) {
                         out_error->line = (int)i + 1;
                         snprintf(out_error->message, sizeof(out_error->message), "unknown choice label target '%.120s'", ins->choices[c].target);
@@ -145,12 +326,455 @@ static int validate_program_references(const FurryProgram *program, FurryCompile
 
     if (ui_depth != 0) {
         if (out_error != NULL) {
-            out_error->line = (int)program->count;
+            out_error->line = (int)end;
             snprintf(out_error->message, sizeof(out_error->message), "%s", "unclosed ui_begin block");
         }
         return FURRY_ERR;
     }
 
+    mark_static_ui_blocks(program, start, end);
+    return FURRY_OK;
+}
+
+int furry_validate_program(FurryProgram *program, FurryCompileError *out_error) {
+    if (furry_validate_range(program, 0, program->count, NULL, NULL, out_error) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return furry_check_string_ids(program, out_error);
+}
+
+static unsigned text_id_or_none(const char *text) {
+    return text[0] == '\0' ? 0u : furry_locale_string_id(text);
+}
+
+/* Tags player-visible text with stable ids so it can be swapped for a translation at runtime. */
+static void assign_string_ids(FurryInstruction *ins) {
+    if (ins->op == FURRY_OP_SAY) {
+        ins->name_id = text_id_or_none(ins->a);
+        ins->text_id = text_id_or_none(ins->b);
+    } else if (ins->op == FURRY_OP_UI_TEXT || ins->op == FURRY_OP_BUTTON) {
+        ins->text_id = text_id_or_none(ins->b);
+    } else if (ins->op == FURRY_OP_CHOICE) {
+        ins->text_id = text_id_or_none(ins->a);
+        for (size_t c = 0; c < ins->choice_count; ++c) {
+            ins->choices[c].text_id = text_id_or_none(ins->choices[c].text);
+        }
+    }
+}
+
+/*
+ * Everything after parsing, shared with FurryProgramBuilder and the lazy compiler: media checks,
+ * expressions, string ids and variable slots. err is left empty when the instruction itself is malformed.
+ */
+int furry_prepare_instruction(FurryProgram *program, FurryInstruction *ins, char *err, size_t err_size) {
+    err[0] = '\0';
+    if ((ins->op == FURRY_OP_UI_IMAGE || ins->op == FURRY_OP_UI_ANIM || ins->op == FURRY_OP_UI_VIDEO) &&
+        !has_supported_media_extension(ins->b)) {
+        return FURRY_ERR;
+    }
+    if ((ins->op == FURRY_OP_SET_EXPR || ins->op == FURRY_OP_IF) && furry_expr_compile(program, ins->b, &ins->i, err, err_size) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+
+    assign_string_ids(ins);
+
+    if (ins->op == FURRY_OP_SET || ins->op == FURRY_OP_SET_EXPR || ins->op == FURRY_OP_ADD || ins->op == FURRY_OP_IF_EQ ||
+        ins->op == FURRY_OP_UI_BIND) {
+        ins->slot = furry_program_intern_var(program, ins->op == FURRY_OP_UI_BIND ? ins->b : ins->a);
+        if (ins->slot < 0) {
+            snprintf(err, err_size, "%s", "variable name too long");
+            return FURRY_ERR;
+        }
+    }
+    return FURRY_OK;
+}
+
+int furry_compile_instruction(FurryProgram *program, FurryInstruction *ins, char *err, size_t err_size) {
+    if (furry_prepare_instruction(program, ins, err, err_size) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return append_instruction(program, ins);
+}
+
+/* Parses one trimmed, non-empty, non-comment script line into ins; the line is modified. */
+int furry_parse_line(FurryScratch *scratch, char *line, FurryInstruction *ins) {
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == ':') {
+        line[len - 1] = '\0';
+        trim(line);
+        ins->op = FURRY_OP_LABEL;
+        return safe_copy(ins->a, sizeof(ins->a), line);
+    }
+
+    if (strncmp(line, "say ", 4) == 0) {
+        char *payload = line + 4;
+        char *sep = strchr(payload, '|');
+        if (sep == NULL) {
+            return FURRY_ERR;
+        }
+        *sep = '\0';
+        trim(payload);
+        trim(sep + 1);
+        ins->op = FURRY_OP_SAY;
+        if (safe_copy(ins->a, sizeof(ins->a), payload) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), sep + 1) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "goto ", 5) == 0) {
+        ins->op = FURRY_OP_GOTO;
+        trim(line + 5);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 5) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "call ", 5) == 0) {
+        ins->op = FURRY_OP_CALL;
+        trim(line + 5);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 5) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strcmp(line, "return") == 0) {
+        ins->op = FURRY_OP_RETURN;
+    } else if (strncmp(line, "set ", 4) == 0) {
+        ins->op = FURRY_OP_SET;
+        char *key = line + 4;
+        char *sep = strchr(key, '=');
+        if (sep == NULL) {
+            return FURRY_ERR;
+        }
+        *sep = '\0';
+        if (sep > key && sep[-1] == ':') {
+            ins->op = FURRY_OP_SET_EXPR;
+            sep[-1] = '\0';
+        }
+        trim(key);
+        trim(sep + 1);
+        if (safe_copy(ins->a, sizeof(ins->a), key) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), sep + 1) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "if ", 3) == 0) {
+        ins->op = FURRY_OP_IF;
+        char *expr = line + 3;
+        char *sep = strrchr(expr, '|');
+        if (sep == NULL || (sep > expr && sep[-1] == '|')) {
+            return FURRY_ERR;
+        }
+        *sep = '\0';
+        trim(expr);
+        trim(sep + 1);
+        if (safe_copy(ins->b, sizeof(ins->b), expr) != FURRY_OK ||
+            safe_copy(ins->c, sizeof(ins->c), sep + 1) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "add ", 4) == 0) {
+        ins->op = FURRY_OP_ADD;
+        char *key = line + 4;
+        char *sep = strchr(key, '=');
+        if (sep == NULL) {
+            return FURRY_ERR;
+        }
+        *sep = '\0';
+        trim(key);
+        trim(sep + 1);
+        ins->i = atoi(sep + 1);
+        if (safe_copy(ins->a, sizeof(ins->a), key) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "if_eq ", 6) == 0) {
+        ins->op = FURRY_OP_IF_EQ;
+        char *payload = line + 6;
+        char *p1 = strchr(payload, '|');
+        if (p1 == NULL) {
+            return FURRY_ERR;
+        }
+        *p1 = '\0';
+        char *p2 = strchr(p1 + 1, '|');
+        if (p2 == NULL) {
+            return FURRY_ERR;
+        }
+        *p2 = '\0';
+        trim(payload);
+        trim(p1 + 1);
+        trim(p2 + 1);
+        if (safe_copy(ins->a, sizeof(ins->a), payload) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), p1 + 1) != FURRY_OK ||
+            safe_copy(ins->c, sizeof(ins->c), p2 + 1) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "bg ", 3) == 0) {
+        ins->op = FURRY_OP_BG;
+        trim(line + 3);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 3) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "fg ", 3) == 0) {
+        ins->op = FURRY_OP_FG;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 3) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *asset = temp;
+        char *x = split_once(asset, '|');
+        char *y = x == NULL ? NULL : split_once(x, '|');
+        char *rotation = y == NULL ? NULL : split_once(y, '|');
+        char *anim = rotation == NULL ? NULL : split_once(rotation, '|');
+        if (asset == NULL || x == NULL || y == NULL || rotation == NULL || anim == NULL) {
+            return FURRY_ERR;
+        }
+        trim(asset);
+        trim(x);
+        trim(y);
+        trim(rotation);
+        trim(anim);
+        if (safe_copy(ins->a, sizeof(ins->a), asset) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), x) != FURRY_OK ||
+            safe_copy(ins->c, sizeof(ins->c), y) != FURRY_OK ||
+            safe_copy(ins->choices[0].text, sizeof(ins->choices[0].text), rotation) != FURRY_OK ||
+            safe_copy(ins->choices[0].target, sizeof(ins->choices[0].target), anim) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "button ", 7) == 0) {
+        ins->op = FURRY_OP_BUTTON;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 7) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *id = temp;
+        char *label = split_once(id, '|');
+        char *target = label == NULL ? NULL : split_once(label, '|');
+        if (id == NULL || label == NULL || target == NULL) {
+            return FURRY_ERR;
+        }
+        trim(id);
+        trim(label);
+        trim(target);
+        if (safe_copy(ins->a, sizeof(ins->a), id) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), label) != FURRY_OK ||
+            safe_copy(ins->c, sizeof(ins->c), target) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "ui_begin ", 9) == 0) {
+        ins->op = FURRY_OP_UI_BEGIN;
+        trim(line + 9);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 9) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strcmp(line, "ui_end") == 0) {
+        ins->op = FURRY_OP_UI_END;
+    } else if (strncmp(line, "ui_panel ", 9) == 0) {
+        ins->op = FURRY_OP_UI_PANEL;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 9) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *id = temp;
+        char *x = split_once(id, '|');
+        char *y = x == NULL ? NULL : split_once(x, '|');
+        char *w = y == NULL ? NULL : split_once(y, '|');
+        char *h = w == NULL ? NULL : split_once(w, '|');
+        if (id == NULL || x == NULL || y == NULL || w == NULL || h == NULL) {
+            return FURRY_ERR;
+        }
+        trim(id);
+        trim(x);
+        trim(y);
+        trim(w);
+        trim(h);
+        if (safe_copy(ins->a, sizeof(ins->a), id) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), x) != FURRY_OK ||
+            safe_copy(ins->c, sizeof(ins->c), y) != FURRY_OK ||
+            safe_copy(ins->choices[0].text, sizeof(ins->choices[0].text), w) != FURRY_OK ||
+            safe_copy(ins->choices[0].target, sizeof(ins->choices[0].target), h) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "ui_text ", 8) == 0) {
+        ins->op = FURRY_OP_UI_TEXT;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 8) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *id = temp;
+        char *text = split_once(id, '|');
+        if (id == NULL || text == NULL) {
+            return FURRY_ERR;
+        }
+        trim(id);
+        trim(text);
+        if (safe_copy(ins->a, sizeof(ins->a), id) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), text) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "ui_image ", 9) == 0) {
+        ins->op = FURRY_OP_UI_IMAGE;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 9) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *id = temp;
+        char *asset = split_once(id, '|');
+        if (id == NULL || asset == NULL) {
+            return FURRY_ERR;
+        }
+        trim(id);
+        trim(asset);
+        if (safe_copy(ins->a, sizeof(ins->a), id) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), asset) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "ui_anim ", 8) == 0) {
+        ins->op = FURRY_OP_UI_ANIM;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 8) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *id = temp;
+        char *asset = split_once(id, '|');
+        char *mode = asset == NULL ? NULL : split_once(asset, '|');
+        if (id == NULL || asset == NULL || mode == NULL) {
+            return FURRY_ERR;
+        }
+        trim(id);
+        trim(asset);
+        trim(mode);
+        if (safe_copy(ins->a, sizeof(ins->a), id) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), asset) != FURRY_OK ||
+            safe_copy(ins->c, sizeof(ins->c), mode) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "ui_video ", 9) == 0) {
+        ins->op = FURRY_OP_UI_VIDEO;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 9) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *id = temp;
+        char *asset = split_once(id, '|');
+        char *loop = asset == NULL ? NULL : split_once(asset, '|');
+        if (id == NULL || asset == NULL || loop == NULL) {
+            return FURRY_ERR;
+        }
+        trim(id);
+        trim(asset);
+        trim(loop);
+        if (safe_copy(ins->a, sizeof(ins->a), id) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), asset) != FURRY_OK ||
+            safe_copy(ins->c, sizeof(ins->c), loop) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "ui_bind ", 8) == 0) {
+        ins->op = FURRY_OP_UI_BIND;
+        char *temp = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE);
+        if (temp == NULL || safe_copy(temp, COMPILE_TEMP_SIZE, line + 8) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        char *id = temp;
+        char *key = split_once(id, '|');
+        if (id == NULL || key == NULL) {
+            return FURRY_ERR;
+        }
+        trim(id);
+        trim(key);
+        if (safe_copy(ins->a, sizeof(ins->a), id) != FURRY_OK ||
+            safe_copy(ins->b, sizeof(ins->b), key) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "music ", 6) == 0) {
+        ins->op = FURRY_OP_MUSIC;
+        trim(line + 6);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 6) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "sfx ", 4) == 0) {
+        ins->op = FURRY_OP_SFX;
+        trim(line + 4);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 4) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "save ", 5) == 0) {
+        ins->op = FURRY_OP_SAVE;
+        trim(line + 5);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 5) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "load ", 5) == 0) {
+        ins->op = FURRY_OP_LOAD;
+        trim(line + 5);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 5) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "choice ", 7) == 0) {
+        ins->op = FURRY_OP_CHOICE;
+        char *choice_buf = furry_scratch_alloc(scratch, COMPILE_TEMP_SIZE * 2);
+        if (choice_buf == NULL || safe_copy(choice_buf, COMPILE_TEMP_SIZE * 2, line + 7) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+
+        char *cursor = choice_buf;
+        char *sep = strchr(cursor, '|');
+        if (sep == NULL) {
+            return FURRY_ERR;
+        }
+        *sep = '\0';
+        trim(cursor);
+        if (safe_copy(ins->a, sizeof(ins->a), cursor) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+
+        cursor = sep + 1;
+        while (*cursor != '\0') {
+            char *next = strchr(cursor, '|');
+            if (next != NULL) {
+                *next = '\0';
+            }
+            trim(cursor);
+            if (ins->choice_count >= FURRY_MAX_CHOICES) {
+                return FURRY_ERR;
+            }
+            if (parse_choice_option(scratch, cursor, &ins->choices[ins->choice_count]) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            ins->choice_count++;
+            if (next == NULL) {
+                break;
+            }
+            cursor = next + 1;
+        }
+
+        if (ins->choice_count == 0) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "spawn ", 6) == 0) {
+        ins->op = FURRY_OP_SPAWN;
+        trim(line + 6);
+        if (safe_copy(ins->a, sizeof(ins->a), line + 6) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "wait ", 5) == 0) {
+        ins->op = FURRY_OP_WAIT;
+        char *end = NULL;
+        long ms = strtol(line + 5, &end, 10);
+        trim(end);
+        if (end == line + 5 || *end != '\0' || ms < 0 || ms > 86400000L) {
+            return FURRY_ERR;
+        }
+        ins->i = (int)ms;
+    } else if (strncmp(line, "wait_event ", 11) == 0) {
+        ins->op = FURRY_OP_WAIT_EVENT;
+        trim(line + 11);
+        if (line[11] == '\0' || safe_copy(ins->a, sizeof(ins->a), line + 11) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strncmp(line, "signal ", 7) == 0) {
+        ins->op = FURRY_OP_SIGNAL;
+        trim(line + 7);
+        if (line[7] == '\0' || safe_copy(ins->a, sizeof(ins->a), line + 7) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (strcmp(line, "end") == 0) {
+        ins->op = FURRY_OP_END;
+    } else {
+        return FURRY_ERR;
+    }
     return FURRY_OK;
 }
 
@@ -168,377 +792,42 @@ static int compile_script_internal(const char *script, FurryProgram *out_program
         out_error->message[0] = '\0';
     }
 
-    out_program->code = NULL;
-    out_program->count = 0;
+    memset(out_program, 0, sizeof(*out_program));
 
-    char *buffer = malloc(strlen(script) + 1);
+    unsigned long long trace_start = furry_trace_on(FURRY_TRACE_HOST) ? furry_trace_now() : 0;
+    char *buffer = furry_alloc(FURRY_MEM_COMPILER, strlen(script) + 1);
     if (buffer == NULL) {
         return FURRY_ERR;
     }
+    /* The instruction under construction and its split buffers live here, reset per line, instead of on the stack. */
+    FurryScratch scratch;
+    furry_scratch_init(&scratch, COMPILE_SCRATCH_CHUNK);
     strcpy(buffer, script);
 
     int line_number = 0;
+    char expr_error[FURRY_MAX_ERROR_TEXT];
     char *line = strtok(buffer, "\n");
     while (line != NULL) {
         line_number++;
+        expr_error[0] = '\0';
         trim(line);
         if (line[0] == '\0' || line[0] == '#') {
             line = strtok(NULL, "\n");
             continue;
         }
 
-        FurryInstruction ins;
-        memset(&ins, 0, sizeof(ins));
-
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == ':') {
-            line[len - 1] = '\0';
-            trim(line);
-            ins.op = FURRY_OP_LABEL;
-            if (safe_copy(ins.a, sizeof(ins.a), line) != FURRY_OK || append_instruction(out_program, &ins) != FURRY_OK) {
-                furry_free_program(out_program);
-                free(buffer);
-                return FURRY_ERR;
-            }
-            line = strtok(NULL, "\n");
-            continue;
+        furry_scratch_reset(&scratch);
+        FurryInstruction *ins = furry_scratch_alloc(&scratch, sizeof(FurryInstruction));
+        if (ins == NULL) {
+            goto compile_error;
         }
+        memset(ins, 0, sizeof(*ins));
 
-        if (strncmp(line, "say ", 4) == 0) {
-            char *payload = line + 4;
-            char *sep = strchr(payload, '|');
-            if (sep == NULL) {
-                goto compile_error;
-            }
-            *sep = '\0';
-            trim(payload);
-            trim(sep + 1);
-            ins.op = FURRY_OP_SAY;
-            if (safe_copy(ins.a, sizeof(ins.a), payload) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), sep + 1) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "goto ", 5) == 0) {
-            ins.op = FURRY_OP_GOTO;
-            trim(line + 5);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 5) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "call ", 5) == 0) {
-            ins.op = FURRY_OP_CALL;
-            trim(line + 5);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 5) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strcmp(line, "return") == 0) {
-            ins.op = FURRY_OP_RETURN;
-        } else if (strncmp(line, "set ", 4) == 0) {
-            ins.op = FURRY_OP_SET;
-            char *key = line + 4;
-            char *sep = strchr(key, '=');
-            if (sep == NULL) {
-                goto compile_error;
-            }
-            *sep = '\0';
-            trim(key);
-            trim(sep + 1);
-            if (safe_copy(ins.a, sizeof(ins.a), key) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), sep + 1) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "add ", 4) == 0) {
-            ins.op = FURRY_OP_ADD;
-            char *key = line + 4;
-            char *sep = strchr(key, '=');
-            if (sep == NULL) {
-                goto compile_error;
-            }
-            *sep = '\0';
-            trim(key);
-            trim(sep + 1);
-            ins.i = atoi(sep + 1);
-            if (safe_copy(ins.a, sizeof(ins.a), key) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "if_eq ", 6) == 0) {
-            ins.op = FURRY_OP_IF_EQ;
-            char *payload = line + 6;
-            char *p1 = strchr(payload, '|');
-            if (p1 == NULL) {
-                goto compile_error;
-            }
-            *p1 = '\0';
-            char *p2 = strchr(p1 + 1, '|');
-            if (p2 == NULL) {
-                goto compile_error;
-            }
-            *p2 = '\0';
-            trim(payload);
-            trim(p1 + 1);
-            trim(p2 + 1);
-            if (safe_copy(ins.a, sizeof(ins.a), payload) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), p1 + 1) != FURRY_OK ||
-                safe_copy(ins.c, sizeof(ins.c), p2 + 1) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "bg ", 3) == 0) {
-            ins.op = FURRY_OP_BG;
-            trim(line + 3);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 3) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "fg ", 3) == 0) {
-            ins.op = FURRY_OP_FG;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 3) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *asset = temp;
-            char *x = split_once(asset, '|');
-            char *y = x == NULL ? NULL : split_once(x, '|');
-            char *rotation = y == NULL ? NULL : split_once(y, '|');
-            char *anim = rotation == NULL ? NULL : split_once(rotation, '|');
-            if (asset == NULL || x == NULL || y == NULL || rotation == NULL || anim == NULL) {
-                goto compile_error;
-            }
-            trim(asset);
-            trim(x);
-            trim(y);
-            trim(rotation);
-            trim(anim);
-            if (safe_copy(ins.a, sizeof(ins.a), asset) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), x) != FURRY_OK ||
-                safe_copy(ins.c, sizeof(ins.c), y) != FURRY_OK ||
-                safe_copy(ins.choices[0].text, sizeof(ins.choices[0].text), rotation) != FURRY_OK ||
-                safe_copy(ins.choices[0].target, sizeof(ins.choices[0].target), anim) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "button ", 7) == 0) {
-            ins.op = FURRY_OP_BUTTON;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 7) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *id = temp;
-            char *label = split_once(id, '|');
-            char *target = label == NULL ? NULL : split_once(label, '|');
-            if (id == NULL || label == NULL || target == NULL) {
-                goto compile_error;
-            }
-            trim(id);
-            trim(label);
-            trim(target);
-            if (safe_copy(ins.a, sizeof(ins.a), id) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), label) != FURRY_OK ||
-                safe_copy(ins.c, sizeof(ins.c), target) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "ui_begin ", 9) == 0) {
-            ins.op = FURRY_OP_UI_BEGIN;
-            trim(line + 9);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 9) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strcmp(line, "ui_end") == 0) {
-            ins.op = FURRY_OP_UI_END;
-        } else if (strncmp(line, "ui_panel ", 9) == 0) {
-            ins.op = FURRY_OP_UI_PANEL;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 9) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *id = temp;
-            char *x = split_once(id, '|');
-            char *y = x == NULL ? NULL : split_once(x, '|');
-            char *w = y == NULL ? NULL : split_once(y, '|');
-            char *h = w == NULL ? NULL : split_once(w, '|');
-            if (id == NULL || x == NULL || y == NULL || w == NULL || h == NULL) {
-                goto compile_error;
-            }
-            trim(id);
-            trim(x);
-            trim(y);
-            trim(w);
-            trim(h);
-            if (safe_copy(ins.a, sizeof(ins.a), id) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), x) != FURRY_OK ||
-                safe_copy(ins.c, sizeof(ins.c), y) != FURRY_OK ||
-                safe_copy(ins.choices[0].text, sizeof(ins.choices[0].text), w) != FURRY_OK ||
-                safe_copy(ins.choices[0].target, sizeof(ins.choices[0].target), h) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "ui_text ", 8) == 0) {
-            ins.op = FURRY_OP_UI_TEXT;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 8) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *id = temp;
-            char *text = split_once(id, '|');
-            if (id == NULL || text == NULL) {
-                goto compile_error;
-            }
-            trim(id);
-            trim(text);
-            if (safe_copy(ins.a, sizeof(ins.a), id) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), text) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "ui_image ", 9) == 0) {
-            ins.op = FURRY_OP_UI_IMAGE;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 9) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *id = temp;
-            char *asset = split_once(id, '|');
-            if (id == NULL || asset == NULL) {
-                goto compile_error;
-            }
-            trim(id);
-            trim(asset);
-            if (!has_supported_media_extension(asset)) {
-                goto compile_error;
-            }
-            if (safe_copy(ins.a, sizeof(ins.a), id) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), asset) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "ui_anim ", 8) == 0) {
-            ins.op = FURRY_OP_UI_ANIM;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 8) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *id = temp;
-            char *asset = split_once(id, '|');
-            char *mode = asset == NULL ? NULL : split_once(asset, '|');
-            if (id == NULL || asset == NULL || mode == NULL) {
-                goto compile_error;
-            }
-            trim(id);
-            trim(asset);
-            trim(mode);
-            if (!has_supported_media_extension(asset)) {
-                goto compile_error;
-            }
-            if (safe_copy(ins.a, sizeof(ins.a), id) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), asset) != FURRY_OK ||
-                safe_copy(ins.c, sizeof(ins.c), mode) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "ui_video ", 9) == 0) {
-            ins.op = FURRY_OP_UI_VIDEO;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 9) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *id = temp;
-            char *asset = split_once(id, '|');
-            char *loop = asset == NULL ? NULL : split_once(asset, '|');
-            if (id == NULL || asset == NULL || loop == NULL) {
-                goto compile_error;
-            }
-            trim(id);
-            trim(asset);
-            trim(loop);
-            if (!has_supported_media_extension(asset)) {
-                goto compile_error;
-            }
-            if (safe_copy(ins.a, sizeof(ins.a), id) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), asset) != FURRY_OK ||
-                safe_copy(ins.c, sizeof(ins.c), loop) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "ui_bind ", 8) == 0) {
-            ins.op = FURRY_OP_UI_BIND;
-            char temp[FURRY_MAX_TEXT * 2];
-            if (safe_copy(temp, sizeof(temp), line + 8) != FURRY_OK) {
-                goto compile_error;
-            }
-            char *id = temp;
-            char *key = split_once(id, '|');
-            if (id == NULL || key == NULL) {
-                goto compile_error;
-            }
-            trim(id);
-            trim(key);
-            if (safe_copy(ins.a, sizeof(ins.a), id) != FURRY_OK ||
-                safe_copy(ins.b, sizeof(ins.b), key) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "music ", 6) == 0) {
-            ins.op = FURRY_OP_MUSIC;
-            trim(line + 6);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 6) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "sfx ", 4) == 0) {
-            ins.op = FURRY_OP_SFX;
-            trim(line + 4);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 4) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "save ", 5) == 0) {
-            ins.op = FURRY_OP_SAVE;
-            trim(line + 5);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 5) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "load ", 5) == 0) {
-            ins.op = FURRY_OP_LOAD;
-            trim(line + 5);
-            if (safe_copy(ins.a, sizeof(ins.a), line + 5) != FURRY_OK) {
-                goto compile_error;
-            }
-        } else if (strncmp(line, "choice ", 7) == 0) {
-            ins.op = FURRY_OP_CHOICE;
-            char choice_buf[FURRY_MAX_TEXT * 4];
-            if (safe_copy(choice_buf, sizeof(choice_buf), line + 7) != FURRY_OK) {
-                goto compile_error;
-            }
-
-            char *cursor = choice_buf;
-            char *sep = strchr(cursor, '|');
-            if (sep == NULL) {
-                goto compile_error;
-            }
-            *sep = '\0';
-            trim(cursor);
-            if (safe_copy(ins.a, sizeof(ins.a), cursor) != FURRY_OK) {
-                goto compile_error;
-            }
-
-            cursor = sep + 1;
-            while (*cursor != '\0') {
-                char *next = strchr(cursor, '|');
-                if (next != NULL) {
-                    *next = '\0';
-                }
-                trim(cursor);
-                if (ins.choice_count >= FURRY_MAX_CHOICES) {
-                    goto compile_error;
-                }
-                if (parse_choice_option(cursor, &ins.choices[ins.choice_count]) != FURRY_OK) {
-                    goto compile_error;
-                }
-                ins.choice_count++;
-                if (next == NULL) {
-                    break;
-                }
-                cursor = next + 1;
-            }
-
-            if (ins.choice_count == 0) {
-                goto compile_error;
-            }
-        } else if (strcmp(line, "end") == 0) {
-            ins.op = FURRY_OP_END;
-        } else {
+        if (furry_parse_line(&scratch, line, ins) != FURRY_OK) {
             goto compile_error;
         }
 
-        if (append_instruction(out_program, &ins) != FURRY_OK) {
+        if (furry_compile_instruction(out_program, ins, expr_error, sizeof(expr_error)) != FURRY_OK) {
             goto compile_error;
         }
 
@@ -548,19 +837,30 @@ static int compile_script_internal(const char *script, FurryProgram *out_program
 compile_error:
         if (out_error != NULL) {
             out_error->line = line_number;
-            snprintf(out_error->message, sizeof(out_error->message), "%s", "invalid syntax, malformed command, or unsupported media extension");
+            snprintf(out_error->message, sizeof(out_error->message), "%s",
+                     expr_error[0] != '\0' ? expr_error : "invalid syntax, malformed command, or unsupported media extension");
         }
         furry_free_program(out_program);
-        free(buffer);
+        furry_free(buffer);
+        furry_scratch_free(&scratch);
         return FURRY_ERR;
     }
 
-    free(buffer);
+    furry_free(buffer);
+    furry_scratch_free(&scratch);
 
-    if (validate_program_references(out_program, out_error) != FURRY_OK) {
+    if (trace_start != 0) {
+        unsigned long long now = furry_trace_now();
+        furry_trace_record(FURRY_TRACE_COMPILE, trace_start, now - trace_start, (unsigned)out_program->count, NULL);
+        trace_start = now;
+    }
+    if (furry_validate_program(out_program, out_error) != FURRY_OK) {
         furry_free_program(out_program);
         return FURRY_ERR;
     }
+    if (trace_start != 0) {
+        furry_trace_record(FURRY_TRACE_VALIDATE, trace_start, furry_trace_now() - trace_start, (unsigned)out_program->count, NULL);
+    }
 
     return FURRY_OK;
 }
@@ -582,15 +882,6 @@ static int find_label(const FurryProgram *program, const char *label) {
     return -1;
 }
 
-static const char *get_var(const RuntimeState *state, const char *key) {
-    for (size_t i = 0; i < state->snap.var_count; ++i) {
-        if (strcmp(state->snap.vars[i].key, key) == 0) {
-            return state->snap.vars[i].value;
-        }
-    }
-    return "";
-}
-
 static int set_var(RuntimeState *state, const char *key, const char *value) {
     for (size_t i = 0; i < state->snap.var_count; ++i) {
         if (strcmp(state->snap.vars[i].key, key) == 0) {
@@ -611,235 +902,1207 @@ static int set_var(RuntimeState *state, const char *key, const char *value) {
     return FURRY_OK;
 }
 
-static int choose_default(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
-    (void)user_data;
-    printf("[CHOICE] %s\n", prompt);
-    for (size_t i = 0; i < count; ++i) {
-        printf("  %zu) %s\n", i + 1, choices[i].text);
+static void reset_slot_cache(RuntimeState *state) {
+    for (size_t i = 0; i < state->slot_capacity; ++i) {
+        state->slot_index[i] = -1;
     }
-    return 0;
 }
 
-static int jump_to_label(const FurryProgram *program, RuntimeState *state, const char *label) {
-    int idx = find_label(program, label);
-    if (idx < 0) {
+static int grow_slot_table(void **table, size_t item_size, size_t old_count, size_t new_count, int fill) {
+    unsigned char *resized = furry_realloc(FURRY_MEM_VM, *table, new_count * item_size);
+    if (resized == NULL) {
         return FURRY_ERR;
     }
-    state->snap.ip = (size_t)idx + 1;
+    memset(resized + old_count * item_size, fill, (new_count - old_count) * item_size);
+    *table = resized;
     return FURRY_OK;
 }
 
-int furry_run_program(const FurryProgram *program, const FurryRuntimeConfig *config) {
-    if (program == NULL || program->code == NULL || program->count == 0) {
+/* Sizes the per-slot tables for the program's variable slots; lazy programs gain slots as blocks compile. */
+static int reserve_slots(RuntimeState *state) {
+    size_t needed = state->program->var_name_count;
+    if (needed <= state->slot_capacity) {
+        return FURRY_OK;
+    }
+    size_t next = state->slot_capacity == 0 ? 64 : state->slot_capacity;
+    while (next < needed) {
+        next *= 2;
+    }
+    size_t words = state->slot_capacity / 64;
+    if (grow_slot_table((void **)&state->slot_index, sizeof(int), state->slot_capacity, next, 0xff) != FURRY_OK ||
+        grow_slot_table((void **)&state->bind_head, sizeof(int), state->slot_capacity, next, 0xff) != FURRY_OK ||
+        grow_slot_table((void **)&state->dirty, sizeof(unsigned long long), words, next / 64, 0) != FURRY_OK ||
+        grow_slot_table((void **)&state->bound, sizeof(unsigned long long), words, next / 64, 0) != FURRY_OK) {
         return FURRY_ERR;
     }
+    state->slot_capacity = next;
+    return FURRY_OK;
+}
 
-    int max_steps = 50000;
-    RuntimeState state;
-    memset(&state, 0, sizeof(state));
-
-    int (*choose_fn)(const char *, const FurryChoice *, size_t, void *) = choose_default;
-    int (*host_fn)(FurryOpCode, const FurryInstruction *, const FurryRuntimeSnapshot *, void *) = NULL;
-    int (*save_fn)(const char *, const FurryRuntimeSnapshot *, void *) = NULL;
-    int (*load_fn)(const char *, FurryRuntimeSnapshot *, void *) = NULL;
-    void *choice_user_data = NULL;
-    if (config != NULL) {
-        if (config->max_steps > 0) {
-            max_steps = config->max_steps;
-        }
-        if (config->choose_option != NULL) {
-            choose_fn = config->choose_option;
+/* Maps a compile-time variable slot to its snapshot entry, caching the index after the first hit. */
+static int resolve_slot(RuntimeState *state, int slot) {
+    int idx = state->slot_index[slot];
+    if (idx >= 0) {
+        return idx;
+    }
+    const char *key = state->program->var_names[slot];
+    for (size_t i = 0; i < state->snap.var_count; ++i) {
+        if (strcmp(state->snap.vars[i].key, key) == 0) {
+            state->slot_index[slot] = (int)i;
+            return (int)i;
         }
-        host_fn = config->on_host_command;
-        save_fn = config->save_slot;
-        load_fn = config->load_slot;
-        choice_user_data = config->user_data;
     }
+    return -1;
+}
 
-    int steps = 0;
-    while (state.snap.ip < program->count && steps < max_steps) {
-        const FurryInstruction *ins = &program->code[state.snap.ip];
+static const char *get_slot(RuntimeState *state, int slot) {
+    int idx = resolve_slot(state, slot);
+    return idx < 0 ? "" : state->snap.vars[idx].value;
+}
 
-        switch (ins->op) {
-            case FURRY_OP_LABEL:
-                state.snap.ip++;
-                break;
-            case FURRY_OP_SAY:
-                printf("%s: %s\n", ins->a, ins->b);
-                state.snap.ip++;
-                break;
-            case FURRY_OP_GOTO:
-                if (jump_to_label(program, &state, ins->a) != FURRY_OK) {
-                    return FURRY_ERR;
-                }
-                break;
-            case FURRY_OP_CALL:
-                if (state.snap.callstack_depth >= FURRY_MAX_CALLSTACK) {
-                    return FURRY_ERR;
-                }
-                state.snap.callstack[state.snap.callstack_depth++] = state.snap.ip + 1;
-                if (jump_to_label(program, &state, ins->a) != FURRY_OK) {
-                    return FURRY_ERR;
-                }
-                break;
-            case FURRY_OP_RETURN:
-                if (state.snap.callstack_depth == 0) {
-                    return FURRY_ERR;
-                }
-                state.snap.ip = state.snap.callstack[--state.snap.callstack_depth];
-                break;
-            case FURRY_OP_SET:
-                if (set_var(&state, ins->a, ins->b) != FURRY_OK) {
-                    return FURRY_ERR;
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_ADD: {
-                int next = atoi(get_var(&state, ins->a)) + ins->i;
-                char out[FURRY_MAX_VALUE];
-                snprintf(out, sizeof(out), "%d", next);
-                if (set_var(&state, ins->a, out) != FURRY_OK) {
-                    return FURRY_ERR;
-                }
-                state.snap.ip++;
-                break;
-            }
-            case FURRY_OP_IF_EQ:
-                if (strcmp(get_var(&state, ins->a), ins->b) == 0) {
-                    if (jump_to_label(program, &state, ins->c) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    state.snap.ip++;
-                }
-                break;
-            case FURRY_OP_BG:
-                if (host_fn != NULL) {
-                    if (host_fn(ins->op, ins, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[BG] %s\n", ins->a);
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_FG:
-                if (host_fn != NULL) {
-                    if (host_fn(ins->op, ins, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[FG] asset=%s x=%s y=%s rot=%s anim=%s\n", ins->a, ins->b, ins->c, ins->choices[0].text, ins->choices[0].target);
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_BUTTON:
-                if (host_fn != NULL) {
-                    if (host_fn(ins->op, ins, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[BUTTON] id=%s label=%s action=%s\n", ins->a, ins->b, ins->c);
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_UI_BEGIN:
-            case FURRY_OP_UI_END:
-            case FURRY_OP_UI_PANEL:
-            case FURRY_OP_UI_TEXT:
-            case FURRY_OP_UI_IMAGE:
-            case FURRY_OP_UI_ANIM:
-            case FURRY_OP_UI_VIDEO:
-            case FURRY_OP_UI_BIND:
-                if (host_fn != NULL) {
-                    if (host_fn(ins->op, ins, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[UI] op=%d a=%s b=%s c=%s\n", (int)ins->op, ins->a, ins->b, ins->c);
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_MUSIC:
-                if (host_fn != NULL) {
-                    if (host_fn(ins->op, ins, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[MUSIC:miniaudio] %s\n", ins->a);
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_SFX:
-                if (host_fn != NULL) {
-                    if (host_fn(ins->op, ins, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[SFX:miniaudio] %s\n", ins->a);
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_SAVE:
-                if (save_fn != NULL) {
-                    if (save_fn(ins->a, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[SAVE] slot=%s ip=%zu vars=%zu\n", ins->a, state.snap.ip, state.snap.var_count);
-                }
-                state.snap.ip++;
-                break;
-            case FURRY_OP_LOAD:
-                if (load_fn != NULL) {
-                    if (load_fn(ins->a, &state.snap, choice_user_data) != FURRY_OK) {
-                        return FURRY_ERR;
-                    }
-                    if (state.snap.ip >= program->count) {
-                        return FURRY_ERR;
-                    }
-                } else {
-                    printf("[LOAD] slot=%s (no loader configured, ignored)\n", ins->a);
-                    state.snap.ip++;
-                }
-                break;
-            case FURRY_OP_CHOICE: {
-                int selected = choose_fn(ins->a, ins->choices, ins->choice_count, choice_user_data);
-                if (selected < 0 || (size_t)selected >= ins->choice_count) {
-                    return FURRY_ERR;
-                }
-                if (jump_to_label(program, &state, ins->choices[selected].target) != FURRY_OK) {
-                    return FURRY_ERR;
-                }
-                break;
-            }
-            case FURRY_OP_END:
-                return FURRY_OK;
-            default:
-                return FURRY_ERR;
-        }
+static void mark_dirty(RuntimeState *state, int slot) {
+    state->dirty[slot >> 6] |= 1ull << (slot & 63);
+}
 
-        steps++;
+static void mark_all_dirty(RuntimeState *state) {
+    for (size_t w = 0; w < state->slot_capacity / 64; ++w) {
+        state->dirty[w] = ~0ull;
     }
-
-    return FURRY_ERR;
 }
 
-int furry_snapshot_save(const FurryRuntimeSnapshot *snapshot, char *out_text, size_t out_size) {
-    if (snapshot == NULL || out_text == NULL || out_size == 0) {
-        return FURRY_ERR;
+static int set_slot(RuntimeState *state, int slot, const char *value) {
+    int idx = resolve_slot(state, slot);
+    if (idx >= 0) {
+        if (strcmp(state->snap.vars[idx].value, value) != 0) {
+            mark_dirty(state, slot);
+        }
+        return safe_copy(state->snap.vars[idx].value, sizeof(state->snap.vars[idx].value), value);
     }
-
-    int written = snprintf(out_text, out_size, "ip=%zu;depth=%zu;vars=%zu", snapshot->ip, snapshot->callstack_depth, snapshot->var_count);
-    if (written < 0 || (size_t)written >= out_size) {
+    if (set_var(state, state->program->var_names[slot], value) != FURRY_OK) {
         return FURRY_ERR;
     }
+    mark_dirty(state, slot);
+    state->slot_index[slot] = (int)state->snap.var_count - 1;
     return FURRY_OK;
 }
 
-int furry_snapshot_load(const char *text, FurryRuntimeSnapshot *out_snapshot) {
-    if (text == NULL || out_snapshot == NULL) {
-        return FURRY_ERR;
+static const char *load_expr_var(int slot, void *user_data) {
+    return get_slot((RuntimeState *)user_data, slot);
+}
+
+static void enter_bind_scope(RuntimeState *state, const char *layer) {
+    if (state->bind_fn != NULL && state->scope_depth < FURRY_UI_MAX_DEPTH) {
+        state->scopes[state->scope_depth].layer = layer;
+        state->scopes[state->scope_depth].epoch = ++state->epoch;
+    }
+    state->scope_depth++;
+}
+
+/* At ui_end, bindings of the layer that this declaration did not repeat are dropped. */
+static void exit_bind_scope(RuntimeState *state) {
+    if (state->scope_depth == 0 || --state->scope_depth >= FURRY_UI_MAX_DEPTH || state->bind_fn == NULL) {
+        return;
+    }
+    const RuntimeUiScope *scope = &state->scopes[state->scope_depth];
+    size_t kept = 0;
+    for (size_t i = 0; i < state->binding_count; ++i) {
+        if (state->bindings[i].epoch != scope->epoch && strcmp(state->bindings[i].layer, scope->layer) == 0) {
+            continue;
+        }
+        state->bindings[kept++] = state->bindings[i];
+    }
+    if (kept != state->binding_count) {
+        state->binding_count = kept;
+        state->bind_index_stale = 1;
+    }
+}
+
+/* Registers a ui_bind node; a new or re-keyed binding is reported at the next sync. */
+static int bind_node(RuntimeState *state, const FurryInstruction *ins) {
+    if (state->bind_fn == NULL) {
+        return FURRY_OK;
+    }
+    size_t top = state->scope_depth < FURRY_UI_MAX_DEPTH ? state->scope_depth : FURRY_UI_MAX_DEPTH;
+    const char *layer = top > 0 ? state->scopes[top - 1].layer : "";
+    RuntimeBinding *binding = NULL;
+    for (size_t i = 0; i < state->binding_count && binding == NULL; ++i) {
+        if (strcmp(state->bindings[i].id, ins->a) == 0 && strcmp(state->bindings[i].layer, layer) == 0) {
+            binding = &state->bindings[i];
+        }
+    }
+    if (binding == NULL) {
+        if (state->binding_count >= FURRY_MAX_BINDINGS) {
+            return FURRY_ERR;
+        }
+        binding = &state->bindings[state->binding_count++];
+        binding->layer = layer;
+        binding->id = ins->a;
+        binding->slot = -1;
+    }
+    binding->epoch = top > 0 ? state->scopes[top - 1].epoch : 0;
+    if (binding->slot != ins->slot) {
+        binding->slot = ins->slot;
+        state->bind_index_stale = 1;
+        mark_dirty(state, ins->slot);
+    }
+    return FURRY_OK;
+}
+
+static void rebuild_bind_index(RuntimeState *state) {
+    for (size_t w = 0; w < state->slot_capacity / 64; ++w) {
+        state->bound[w] = 0;
+    }
+    for (size_t s = 0; s < state->slot_capacity; ++s) {
+        state->bind_head[s] = -1;
+    }
+    for (size_t i = state->binding_count; i-- > 0;) {
+        RuntimeBinding *binding = &state->bindings[i];
+        binding->next = state->bind_head[binding->slot];
+        state->bind_head[binding->slot] = (int)i;
+        state->bound[binding->slot >> 6] |= 1ull << (binding->slot & 63);
+    }
+    state->bind_index_stale = 0;
+}
+
+static int lowest_bit(unsigned long long bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int bit = 0;
+    while ((bits & 1ull) == 0) {
+        bits >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/* Records the instruction batch that ran since the last host callback. */
+static void trace_flush_batch(RuntimeState *state) {
+    if (state->trace_batch_count > 0) {
+        furry_trace_record(FURRY_TRACE_BATCH, state->trace_batch_start, furry_trace_now() - state->trace_batch_start,
+                           state->trace_batch_count, NULL);
+        state->trace_batch_count = 0;
+    }
+}
+
+/* Start time of a traced host callback, or 0 with tracing off; closes the batch the callback interrupts. */
+static unsigned long long trace_call_begin(RuntimeState *state) {
+    if (!furry_trace_on(FURRY_TRACE_HOST)) {
+        return 0;
+    }
+    trace_flush_batch(state);
+    return furry_trace_now();
+}
+
+static void trace_call_end(FurryTraceKind kind, unsigned long long start, unsigned arg, const char *detail) {
+    if (start != 0) {
+        furry_trace_record(kind, start, furry_trace_now() - start, arg, detail);
+    }
+}
+
+static int call_host(RuntimeState *state, const FurryInstruction *ins) {
+    unsigned long long start = trace_call_begin(state);
+    int result = state->host_fn(ins->op, ins, &state->snap, state->user_data);
+    trace_call_end(FURRY_TRACE_HOST_COMMAND, start, (unsigned)ins->op, ins->a);
+    return result;
+}
+
+/* Host sync point: reports the nodes bound to every variable dirtied since the previous one, then clears the dirty set. */
+static int sync_bindings(RuntimeState *state) {
+    if (state->bind_fn == NULL) {
+        return FURRY_OK;
+    }
+    if (state->bind_index_stale) {
+        rebuild_bind_index(state);
+    }
+    size_t count = 0;
+    for (size_t w = 0; w < state->slot_capacity / 64; ++w) {
+        unsigned long long bits = state->dirty[w] & state->bound[w];
+        state->dirty[w] = 0;
+        while (bits != 0) {
+            int slot = (int)w * 64 + lowest_bit(bits);
+            bits &= bits - 1;
+            const char *value = get_slot(state, slot);
+            for (int i = state->bind_head[slot]; i >= 0; i = state->bindings[i].next) {
+                FurryBindUpdate *update = &state->updates[count++];
+                update->layer = state->bindings[i].layer;
+                update->id = state->bindings[i].id;
+                update->key = state->program->var_names[slot];
+                update->value = value;
+            }
+        }
+    }
+    if (count == 0) {
+        return FURRY_OK;
+    }
+    unsigned long long start = trace_call_begin(state);
+    int result = state->bind_fn(state->updates, count, state->user_data);
+    trace_call_end(FURRY_TRACE_BIND_UPDATE, start, (unsigned)count, NULL);
+    return result;
+}
+
+/* Instructions that reach the host directly; pending bind updates go out just before them. */
+static int is_host_sync(const RuntimeState *state, const FurryInstruction *ins, int retained_ui) {
+    switch (ins->op) {
+        case FURRY_OP_SAY:
+        case FURRY_OP_CHOICE:
+        case FURRY_OP_BG:
+        case FURRY_OP_FG:
+        case FURRY_OP_MUSIC:
+        case FURRY_OP_SFX:
+        case FURRY_OP_END:
+            return 1;
+        case FURRY_OP_BUTTON:
+            return !retained_ui || state->ui_depth == 0;
+        default:
+            return !retained_ui && is_ui_node_op(ins->op);
+    }
+}
+
+static const char *localized(const RuntimeState *state, unsigned id, const char *fallback) {
+    const char *text = furry_locale_lookup(state->locale, id);
+    return text != NULL ? text : fallback;
+}
+
+/* Hosts receive a translated copy of text-bearing instructions; the program itself stays language-neutral. */
+static const FurryInstruction *localize_instruction(RuntimeState *state, const FurryInstruction *ins) {
+    const char *text = furry_locale_lookup(state->locale, ins->text_id);
+    if (text == NULL) {
+        return ins;
+    }
+    state->localized_ins = *ins;
+    snprintf(state->localized_ins.b, sizeof(state->localized_ins.b), "%s", text);
+    return &state->localized_ins;
+}
+
+static const FurryChoice *localize_choices(RuntimeState *state, const FurryInstruction *ins) {
+    if (state->locale == NULL) {
+        return ins->choices;
+    }
+    for (size_t c = 0; c < ins->choice_count; ++c) {
+        state->localized_choices[c] = ins->choices[c];
+        snprintf(state->localized_choices[c].text, sizeof(state->localized_choices[c].text), "%s",
+                 localized(state, ins->choices[c].text_id, ins->choices[c].text));
+    }
+    return state->localized_choices;
+}
+
+static int print_ui_patch(const FurryUiPatch *patch, void *user_data) {
+    (void)user_data;
+    static const char *const names[] = {"create", "update", "remove"};
+    printf("[UI PATCH] %s layer=%s id=%s index=%zu field=%d\n", names[patch->type], patch->layer, patch->id, patch->index, patch->field);
+    return FURRY_OK;
+}
+
+/*
+ * Identifies one static ui block as rendered under the current locale: by its source, not the
+ * program's address, since a ui tree outlives programs freed and recompiled in the same place.
+ */
+static unsigned long long ui_source_key(const RuntimeState *state, const FurryInstruction *begin) {
+    unsigned generation = furry_locale_generation(state->locale);
+    unsigned long long hash = hash_bytes(14695981039346656037ull, &state->snap.ip, sizeof(state->snap.ip));
+    hash = hash_bytes(hash, &begin->i, sizeof(begin->i));
+    hash = hash_bytes(hash, &generation, sizeof(generation));
+    return hash == 0 ? 1 : hash;
+}
+
+/* Retained-UI path: nodes accumulate in the tree and ui_end emits the diff. */
+static int retain_ui_instruction(RuntimeState *state, FurryUiTree *tree, const FurryInstruction *ins, FurryUiPatchFn emit,
+                                 void *user_data) {
+    if (ins->op == FURRY_OP_UI_BEGIN) {
+        unsigned long long source = ins->target >= 0 ? ui_source_key(state, ins) : 0;
+        if (furry_ui_tree_try_skip(tree, ins->a, source)) {
+            state->snap.ip = (size_t)ins->target + 1;
+            return FURRY_OK;
+        }
+        if (furry_ui_tree_begin(tree, ins->a, source) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        enter_bind_scope(state, ins->a);
+        state->ui_depth++;
+    } else if (ins->op == FURRY_OP_UI_END) {
+        exit_bind_scope(state);
+        if (furry_ui_tree_end(tree, emit != NULL ? emit : print_ui_patch, user_data) != FURRY_OK || sync_bindings(state) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        state->ui_depth--;
+    } else {
+        if (ins->op == FURRY_OP_UI_BIND && bind_node(state, ins) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        ins = localize_instruction(state, ins);
+        const char *values[FURRY_UI_NODE_VALUES] = {ins->b, ins->c, ins->choices[0].text, ins->choices[0].target};
+        if (furry_ui_tree_node(tree, ins->op, ins->a, values) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    state->snap.ip++;
+    return FURRY_OK;
+}
+
+/* ui/button instruction outside the run loop's bookkeeping; restore_scene re-runs layers through it. */
+static int run_ui_instruction(RuntimeState *state, const FurryInstruction *ins) {
+    if (state->ui_tree != NULL && (ins->op != FURRY_OP_BUTTON || state->ui_depth > 0)) {
+        return retain_ui_instruction(state, state->ui_tree, ins, state->patch_fn, state->user_data);
+    }
+    if (ins->op == FURRY_OP_UI_BEGIN) {
+        enter_bind_scope(state, ins->a);
+    } else if (ins->op == FURRY_OP_UI_END) {
+        exit_bind_scope(state);
+    } else if (ins->op == FURRY_OP_UI_BIND && bind_node(state, ins) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    ins = localize_instruction(state, ins);
+    if (state->host_fn != NULL) {
+        if (call_host(state, ins) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    } else if (ins->op == FURRY_OP_BUTTON) {
+        printf("[BUTTON] id=%s label=%s action=%s\n", ins->a, ins->b, ins->c);
+    } else {
+        printf("[UI] op=%d a=%s b=%s c=%s\n", (int)ins->op, ins->a, ins->b, ins->c);
+    }
+    state->snap.ip++;
+    return FURRY_OK;
+}
+
+/* Assets past FURRY_MAX_ASSET cannot be kept and are left out of the scene. */
+static void scene_set_bg(FurrySceneState *scene, const char *asset) {
+    if (safe_copy(scene->bg, sizeof(scene->bg), asset) != FURRY_OK) {
+        scene->bg[0] = '\0';
+    }
+    scene->sprite_count = 0;
+}
+
+static void scene_set_music(FurrySceneState *scene, const char *asset) {
+    if (safe_copy(scene->music, sizeof(scene->music), asset) != FURRY_OK) {
+        scene->music[0] = '\0';
+    }
+    scene->music_frame = 0;
+}
+
+static void scene_show_sprite(FurrySceneState *scene, const FurryInstruction *ins) {
+    if (strlen(ins->a) >= FURRY_MAX_ASSET) {
+        return;
+    }
+    size_t i = 0;
+    while (i < scene->sprite_count && strcmp(scene->sprites[i].asset, ins->a) != 0) {
+        i++;
+    }
+    if (i == FURRY_MAX_SCENE_SPRITES) {
+        memmove(&scene->sprites[0], &scene->sprites[1], (FURRY_MAX_SCENE_SPRITES - 1) * sizeof(FurrySceneSprite));
+        i = FURRY_MAX_SCENE_SPRITES - 1;
+    } else if (i == scene->sprite_count) {
+        scene->sprite_count++;
+    }
+    FurrySceneSprite *sprite = &scene->sprites[i];
+    safe_copy(sprite->asset, sizeof(sprite->asset), ins->a);
+    sprite->x = strtof(ins->b, NULL);
+    sprite->y = strtof(ins->c, NULL);
+    sprite->rotation = strtof(ins->choices[0].text, NULL);
+    snprintf(sprite->animation, sizeof(sprite->animation), "%s", ins->choices[0].target);
+}
+
+/* A re-declared layer moves to the top; one whose block can branch is forgotten, since it cannot be re-run on its own. */
+static void scene_begin_layer(FurrySceneState *scene, const FurryInstruction *ins, size_t ip) {
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        if (strcmp(scene->layers[i].name, ins->a) == 0) {
+            memmove(&scene->layers[i], &scene->layers[i + 1], (scene->layer_count - i - 1) * sizeof(FurrySceneLayer));
+            scene->layer_count--;
+            break;
+        }
+    }
+    if (ins->target < 0 || strlen(ins->a) >= FURRY_MAX_NAME) {
+        return;
+    }
+    if (scene->layer_count == FURRY_MAX_SCENE_LAYERS) {
+        memmove(&scene->layers[0], &scene->layers[1], (FURRY_MAX_SCENE_LAYERS - 1) * sizeof(FurrySceneLayer));
+        scene->layer_count--;
+    }
+    FurrySceneLayer *layer = &scene->layers[scene->layer_count++];
+    safe_copy(layer->name, sizeof(layer->name), ins->a);
+    layer->ip = ip;
+}
+
+static int emit_scene_instruction(RuntimeState *state, FurryOpCode op, const char *asset) {
+    FurryInstruction *ins = &state->localized_ins;
+    ins->op = op;
+    snprintf(ins->a, sizeof(ins->a), "%s", asset);
+    return call_host(state, ins);
+}
+
+#define SCENE_BG 1u
+#define SCENE_SPRITES 2u
+#define SCENE_MUSIC 4u
+
+/* Hands the host the given parts of the scene at once: on_scene_restore gets all of it, on_host_command one instruction per item. */
+static int emit_scene(RuntimeState *state, unsigned parts) {
+    const FurrySceneState *scene = &state->snap.scene;
+    if (state->scene_fn != NULL) {
+        unsigned long long start = trace_call_begin(state);
+        int result = state->scene_fn(scene, state->user_data);
+        trace_call_end(FURRY_TRACE_SCENE_RESTORE, start, 0, scene->bg);
+        return result;
+    }
+    if (state->host_fn == NULL) {
+        printf("[SCENE] bg=%s sprites=%zu music=%s layers=%zu\n", scene->bg, scene->sprite_count, scene->music, scene->layer_count);
+        return FURRY_OK;
+    }
+    memset(&state->localized_ins, 0, sizeof(state->localized_ins));
+    if ((parts & SCENE_BG) && scene->bg[0] != '\0' && emit_scene_instruction(state, FURRY_OP_BG, scene->bg) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; (parts & SCENE_SPRITES) && i < scene->sprite_count; ++i) {
+        const FurrySceneSprite *sprite = &scene->sprites[i];
+        FurryInstruction *ins = &state->localized_ins;
+        snprintf(ins->b, sizeof(ins->b), "%g", (double)sprite->x);
+        snprintf(ins->c, sizeof(ins->c), "%g", (double)sprite->y);
+        snprintf(ins->choices[0].text, sizeof(ins->choices[0].text), "%g", (double)sprite->rotation);
+        snprintf(ins->choices[0].target, sizeof(ins->choices[0].target), "%s", sprite->animation);
+        if (emit_scene_instruction(state, FURRY_OP_FG, sprite->asset) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    memset(&state->localized_ins, 0, sizeof(state->localized_ins));
+    if ((parts & SCENE_MUSIC) && scene->music[0] != '\0' && emit_scene_instruction(state, FURRY_OP_MUSIC, scene->music) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+/* Re-runs a saved ui layer from its ui_begin through its ui_end; the caller restores the ip. */
+static int rerun_scene_layer(RuntimeState *state, const FurrySceneLayer *layer) {
+    /* Layers from an older build of the script may no longer line up; those are skipped. */
+    const FurryProgram *program = state->program;
+    size_t ip = layer->ip;
+    if (state->lazy != NULL && ip < program->count && furry_lazy_ensure(state->lazy, ip, NULL) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    if (ip >= program->count || program->code[ip].op != FURRY_OP_UI_BEGIN || program->code[ip].target < 0 ||
+        strcmp(program->code[ip].a, layer->name) != 0) {
+        return FURRY_OK;
+    }
+    size_t end = (size_t)program->code[ip].target;
+    for (state->snap.ip = ip; state->snap.ip <= end;) {
+        if (run_ui_instruction(state, &program->code[state->snap.ip]) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    return FURRY_OK;
+}
+
+/* After a load: hands the host the whole scene at once, then re-runs the saved ui layers in order. */
+static int restore_scene(RuntimeState *state) {
+    const FurrySceneState *scene = &state->snap.scene;
+    if (scene->sprite_count > FURRY_MAX_SCENE_SPRITES || scene->layer_count > FURRY_MAX_SCENE_LAYERS) {
+        return FURRY_ERR;
+    }
+    if (state->audio != NULL) {
+        int rc = scene->music[0] != '\0' ? furry_audio_play_music_at(state->audio, scene->music, 1, scene->music_frame)
+                                         : furry_audio_stop_music(state->audio, 0);
+        if (rc != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    if (emit_scene(state, SCENE_BG | SCENE_SPRITES | SCENE_MUSIC) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    /* Whatever a skip had pending is replaced by the loaded scene. */
+    state->skip_parts = 0;
+    state->skip_layer_count = 0;
+
+    size_t resume = state->snap.ip;
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        if (rerun_scene_layer(state, &scene->layers[i]) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    state->snap.ip = resume;
+    return FURRY_OK;
+}
+
+/* Static top-level ui blocks passed while skipping; they run once, when the skip stops. */
+static void note_skipped_layer(RuntimeState *state, size_t ip) {
+    for (size_t i = 0; i < state->skip_layer_count; ++i) {
+        if (state->skip_layers[i] == ip) {
+            return;
+        }
+    }
+    if (state->skip_layer_count == FURRY_MAX_SCENE_LAYERS) {
+        memmove(state->skip_layers, state->skip_layers + 1, (FURRY_MAX_SCENE_LAYERS - 1) * sizeof(state->skip_layers[0]));
+        state->skip_layer_count--;
+    }
+    state->skip_layers[state->skip_layer_count++] = ip;
+}
+
+/*
+ * Ends a skip: what changed in the scene goes to the host once, the layers
+ * declared along the way are run, and bindings are synced. on_skip_stop then
+ * picks the mode to continue in.
+ */
+static int stop_skip(RuntimeState *state, FurrySkipStop reason) {
+    const FurrySceneState *scene = &state->snap.scene;
+    if ((state->skip_parts & SCENE_MUSIC) && state->audio != NULL && scene->music[0] != '\0' &&
+        furry_audio_play_music(state->audio, scene->music, 1) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    if (state->skip_parts != 0 && emit_scene(state, state->skip_parts) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    size_t resume = state->snap.ip;
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        for (size_t j = 0; j < state->skip_layer_count; ++j) {
+            if (scene->layers[i].ip == state->skip_layers[j] && rerun_scene_layer(state, &scene->layers[i]) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+        }
+    }
+    state->snap.ip = resume;
+    state->skip_parts = 0;
+    state->skip_layer_count = 0;
+    state->skip_steps = 0;
+    if (state->bind_fn != NULL && sync_bindings(state) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    state->skip_mode = state->skip_fn != NULL ? state->skip_fn(reason, state->user_data) : FURRY_SKIP_OFF;
+    return FURRY_OK;
+}
+
+static int choose_default(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    (void)user_data;
+    printf("[CHOICE] %s\n", prompt);
+    for (size_t i = 0; i < count; ++i) {
+        printf("  %zu) %s\n", i + 1, choices[i].text);
+    }
+    return 0;
+}
+
+static thread_local RuntimeState *callback_state;
+
+static void update_clock(RuntimeState *state) {
+    if (state->clock_fn != NULL) {
+        state->now_ms = state->clock_fn(state->user_data);
+    }
+}
+
+static int spawn_context(RuntimeState *state, const FurryInstruction *ins) {
+    if (state->contexts == NULL) {
+        state->contexts = furry_calloc(FURRY_MEM_VM, state->context_capacity, sizeof(RuntimeContext));
+        if (state->contexts == NULL) {
+            return FURRY_ERR;
+        }
+    }
+    if (state->context_count >= state->context_capacity) {
+        return FURRY_ERR;
+    }
+    RuntimeContext *ctx = &state->contexts[state->context_count++];
+    memset(ctx, 0, offsetof(RuntimeContext, callstack));
+    ctx->ip = (size_t)ins->target + 1;
+    ctx->live = 1;
+    return FURRY_OK;
+}
+
+static void wait_for_time(RuntimeContext *ctx, unsigned long long wake_ms) {
+    ctx->wait = WAIT_TIME;
+    ctx->wake_ms = wake_ms;
+}
+
+static void signal_event(RuntimeState *state, const char *event) {
+    if (state->main_wait.wait == WAIT_EVENT && strcmp(state->main_wait.event, event) == 0) {
+        state->main_wait.wait = WAIT_NONE;
+    }
+    for (size_t c = 0; c < state->context_count; ++c) {
+        RuntimeContext *ctx = &state->contexts[c];
+        if (ctx->live && ctx->wait == WAIT_EVENT && strcmp(ctx->event, event) == 0) {
+            ctx->wait = WAIT_NONE;
+        }
+    }
+}
+
+/* Earliest wake_ms among the contexts (main included) waiting on time; 0 when none is. */
+static int next_wakeup(const RuntimeState *state, unsigned long long *out_ms) {
+    int found = state->main_wait.wait == WAIT_TIME;
+    unsigned long long next = state->main_wait.wake_ms;
+    for (size_t c = 0; c < state->context_count; ++c) {
+        const RuntimeContext *ctx = &state->contexts[c];
+        if (ctx->live && ctx->wait == WAIT_TIME && (!found || ctx->wake_ms < next)) {
+            next = ctx->wake_ms;
+            found = 1;
+        }
+    }
+    *out_ms = next;
+    return found;
+}
+
+static int step(const FurryProgram *program, RuntimeState *state);
+
+/* One turn of a spawned context: swapped into snap, run until it waits, ends or uses its budget, swapped back. */
+static int run_context(const FurryProgram *program, RuntimeState *state, RuntimeContext *ctx) {
+    size_t main_ip = state->snap.ip;
+    size_t base = state->snap.callstack_depth;
+    if (base + ctx->depth > FURRY_MAX_CALLSTACK) {
+        return FURRY_ERR;
+    }
+    memcpy(&state->snap.callstack[base], ctx->callstack, ctx->depth * sizeof(size_t));
+    state->snap.callstack_depth = base + ctx->depth;
+    state->snap.ip = ctx->ip;
+    state->running = ctx;
+    state->stack_base = base;
+
+    int rc = FURRY_OK;
+    /* A turn never ends inside a ui block, so the main context never sees one half built; one that never leaves it fails the run. */
+    for (int steps = 0; steps < state->context_budget || state->ui_depth > 0 || state->scope_depth > 0; ++steps) {
+        if (state->snap.ip >= program->count || (steps >= state->context_budget && steps >= state->max_steps)) {
+            rc = FURRY_ERR;
+            break;
+        }
+        rc = step(program, state);
+        if (rc == STEP_END) {
+            ctx->live = 0;
+        }
+        if (rc != FURRY_OK) {
+            break;
+        }
+    }
+    if (rc == STEP_SUSPEND || rc == STEP_END) {
+        rc = FURRY_OK;
+    }
+
+    ctx->ip = state->snap.ip;
+    ctx->depth = (unsigned char)(state->snap.callstack_depth - base);
+    memcpy(ctx->callstack, &state->snap.callstack[base], ctx->depth * sizeof(size_t));
+    state->snap.ip = main_ip;
+    state->snap.callstack_depth = base;
+    state->running = NULL;
+    state->stack_base = 0;
+    return rc;
+}
+
+/*
+ * Gives every runnable context one turn, in spawn order, at the current
+ * script time. A context spawned during the round first runs in the next one;
+ * finished contexts are dropped afterwards, keeping the order.
+ */
+static int run_round(const FurryProgram *program, RuntimeState *state) {
+    update_clock(state);
+    if (state->main_wait.wait == WAIT_TIME && state->main_wait.wake_ms <= state->now_ms) {
+        state->main_wait.wait = WAIT_NONE;
+    }
+    size_t count = state->context_count;
+    for (size_t c = 0; c < count; ++c) {
+        RuntimeContext *ctx = &state->contexts[c];
+        if (ctx->live && ctx->wait == WAIT_TIME && ctx->wake_ms <= state->now_ms) {
+            ctx->wait = WAIT_NONE;
+        }
+        if (ctx->live && ctx->wait == WAIT_NONE && run_context(program, state, ctx) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    size_t kept = 0;
+    state->context_runnable = 0;
+    for (size_t c = 0; c < state->context_count; ++c) {
+        if (state->contexts[c].live) {
+            state->context_runnable += state->contexts[c].wait == WAIT_NONE;
+            if (kept != c) {
+                state->contexts[kept] = state->contexts[c];
+            }
+            kept++;
+        }
+    }
+    state->context_count = kept;
+    return FURRY_OK;
+}
+
+/*
+ * The main context waits: run rounds until it may go on. When every context
+ * waits the clock moves to the next wakeup, virtually or by sleeping; with
+ * nothing waiting on time the script can never wake up.
+ */
+static int wait_main(const FurryProgram *program, RuntimeState *state, int *steps, int max_steps) {
+    for (;;) {
+        if (run_round(program, state) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        if (state->main_wait.wait == WAIT_NONE) {
+            return FURRY_OK;
+        }
+        if (++*steps >= max_steps) {
+            return FURRY_ERR;
+        }
+        unsigned long long wake_ms;
+        if (state->context_runnable > 0) {
+            continue;
+        }
+        if (!next_wakeup(state, &wake_ms)) {
+            return FURRY_ERR;
+        }
+        if (state->clock_fn == NULL) {
+            state->now_ms = wake_ms;
+        } else if (wake_ms > state->now_ms) {
+            unsigned long long ms = wake_ms - state->now_ms;
+            struct timespec interval = {(time_t)(ms / 1000u), (long)(ms % 1000u) * 1000000L};
+            thrd_sleep(&interval, NULL);
+        }
+    }
+}
+
+int furry_run_background(long long *out_wait_ms) {
+    if (out_wait_ms != NULL) {
+        *out_wait_ms = -1;
+    }
+    RuntimeState *state = callback_state;
+    if (state == NULL || state->background_failed) {
+        return FURRY_ERR;
+    }
+    if (state->context_count == 0 || state->ui_depth > 0 || state->scope_depth > 0) {
+        return FURRY_OK;
+    }
+    /* Host callbacks made by the contexts cannot start another round. */
+    callback_state = NULL;
+    int rc = run_round(state->program, state);
+    callback_state = state;
+    if (rc != FURRY_OK) {
+        state->background_failed = 1;
+        return FURRY_ERR;
+    }
+    unsigned long long wake_ms;
+    if (out_wait_ms != NULL && state->context_runnable > 0) {
+        *out_wait_ms = 0;
+    } else if (out_wait_ms != NULL && next_wakeup(state, &wake_ms)) {
+        *out_wait_ms = wake_ms > state->now_ms ? (long long)(wake_ms - state->now_ms) : 0;
+    }
+    return FURRY_OK;
+}
+
+/* Say and choice callbacks may run the spawned contexts with furry_run_background. */
+static void begin_player_wait(RuntimeState *state) {
+    if (state->running == NULL) {
+        callback_state = state;
+    }
+}
+
+static int end_player_wait(RuntimeState *state) {
+    callback_state = NULL;
+    return state->background_failed ? FURRY_ERR : FURRY_OK;
+}
+
+/* Runs the instruction at snap.ip for the running context. */
+static int step(const FurryProgram *program, RuntimeState *state) {
+    const FurryInstruction *ins = &program->code[state->snap.ip];
+    if (state->lazy != NULL && (state->snap.ip < state->lazy_begin || state->snap.ip >= state->lazy_end)) {
+        if (furry_lazy_enter(state->lazy, state->snap.ip, &state->lazy_begin, &state->lazy_end) != FURRY_OK ||
+            reserve_slots(state) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    RuntimeContext *ctx = state->running;
+    if (ctx == NULL) {
+        /* The instruction that stops a skip is presented normally, whatever mode on_skip_stop picks. */
+        state->skipping = state->skip_mode != FURRY_SKIP_OFF;
+    }
+    if (ctx == NULL && state->skipping) {
+        int stop = -1;
+        if (ins->op == FURRY_OP_CHOICE) {
+            stop = FURRY_SKIP_STOP_CHOICE;
+        } else if (ins->op == FURRY_OP_SAY && state->skip_mode == FURRY_SKIP_SEEN && !furry_seen_contains(state->seen, state->snap.ip)) {
+            stop = FURRY_SKIP_STOP_UNSEEN;
+        } else if (ins->op == FURRY_OP_END) {
+            stop = FURRY_SKIP_STOP_END;
+        } else if (state->skip_budget > 0 && state->skip_steps >= state->skip_budget) {
+            stop = FURRY_SKIP_STOP_BUDGET;
+        }
+        if (stop >= 0) {
+            if (stop_skip(state, (FurrySkipStop)stop) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            state->skipping = 0;
+        } else {
+            state->skip_steps++;
+        }
+    }
+    if (ctx != NULL && (ins->op == FURRY_OP_SAY || ins->op == FURRY_OP_CHOICE || ins->op == FURRY_OP_SAVE || ins->op == FURRY_OP_LOAD)) {
+        return FURRY_ERR;
+    }
+    furry_seen_mark(state->seen, state->snap.ip);
+    if (furry_trace_on(FURRY_TRACE_VM) && state->trace_batch_count++ == 0) {
+        state->trace_batch_start = furry_trace_now();
+    }
+    if (state->bind_fn != NULL && !state->skipping && is_host_sync(state, ins, state->ui_tree != NULL) && sync_bindings(state) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+
+    switch (ins->op) {
+        case FURRY_OP_LABEL:
+            state->snap.ip++;
+            break;
+        case FURRY_OP_SAY:
+            if (state->skipping) {
+                /* Not shown. */
+            } else if (state->say_fn != NULL) {
+                unsigned long long start = trace_call_begin(state);
+                begin_player_wait(state);
+                int said = state->say_fn(localized(state, ins->name_id, ins->a), localized(state, ins->text_id, ins->b), state->user_data);
+                trace_call_end(FURRY_TRACE_SAY, start, 0, ins->a);
+                if (end_player_wait(state) != FURRY_OK || said != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else {
+                printf("%s: %s\n", localized(state, ins->name_id, ins->a), localized(state, ins->text_id, ins->b));
+            }
+            state->snap.ip++;
+            break;
+        case FURRY_OP_GOTO:
+            state->snap.ip = (size_t)ins->target + 1;
+            break;
+        case FURRY_OP_CALL:
+            if (state->snap.callstack_depth >= FURRY_MAX_CALLSTACK ||
+                (ctx != NULL && state->snap.callstack_depth - state->stack_base >= FURRY_MAX_CONTEXT_CALLSTACK)) {
+                return FURRY_ERR;
+            }
+            state->snap.callstack[state->snap.callstack_depth++] = state->snap.ip + 1;
+            state->snap.ip = (size_t)ins->target + 1;
+            break;
+        case FURRY_OP_RETURN:
+            if (state->snap.callstack_depth == state->stack_base) {
+                /* Returning from a spawned context's first frame ends it. */
+                return ctx != NULL ? STEP_END : FURRY_ERR;
+            }
+            state->snap.ip = state->snap.callstack[--state->snap.callstack_depth];
+            break;
+        case FURRY_OP_SET:
+            if (set_slot(state, ins->slot, ins->b) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            state->snap.ip++;
+            break;
+        case FURRY_OP_ADD: {
+            int next = atoi(get_slot(state, ins->slot)) + ins->i;
+            char out[FURRY_MAX_VALUE];
+            snprintf(out, sizeof(out), "%d", next);
+            if (set_slot(state, ins->slot, out) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            state->snap.ip++;
+            break;
+        }
+        case FURRY_OP_IF_EQ:
+            if (strcmp(get_slot(state, ins->slot), ins->b) == 0) {
+                state->snap.ip = (size_t)ins->target + 1;
+            } else {
+                state->snap.ip++;
+            }
+            break;
+        case FURRY_OP_IF: {
+            FurryExprValue result;
+            if (furry_expr_eval(program, ins->i, load_expr_var, state, &result) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            state->snap.ip = furry_expr_truthy(&result) ? (size_t)ins->target + 1 : state->snap.ip + 1;
+            break;
+        }
+        case FURRY_OP_SET_EXPR: {
+            FurryExprValue result;
+            char out[FURRY_MAX_VALUE];
+            if (furry_expr_eval(program, ins->i, load_expr_var, state, &result) != FURRY_OK ||
+                furry_expr_format(&result, out, sizeof(out)) != FURRY_OK ||
+                set_slot(state, ins->slot, out) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            state->snap.ip++;
+            break;
+        }
+        case FURRY_OP_BG:
+            if (state->skipping) {
+                state->skip_parts |= SCENE_BG | SCENE_SPRITES;
+            } else if (state->host_fn != NULL) {
+                if (call_host(state, ins) != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else {
+                printf("[BG] %s\n", ins->a);
+            }
+            scene_set_bg(&state->snap.scene, ins->a);
+            state->snap.ip++;
+            break;
+        case FURRY_OP_FG:
+            if (state->skipping) {
+                state->skip_parts |= SCENE_SPRITES;
+            } else if (state->host_fn != NULL) {
+                if (call_host(state, ins) != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else {
+                printf("[FG] asset=%s x=%s y=%s rot=%s anim=%s\n", ins->a, ins->b, ins->c, ins->choices[0].text, ins->choices[0].target);
+            }
+            scene_show_sprite(&state->snap.scene, ins);
+            state->snap.ip++;
+            break;
+        case FURRY_OP_BUTTON:
+        case FURRY_OP_UI_BEGIN:
+        case FURRY_OP_UI_END:
+        case FURRY_OP_UI_PANEL:
+        case FURRY_OP_UI_TEXT:
+        case FURRY_OP_UI_IMAGE:
+        case FURRY_OP_UI_ANIM:
+        case FURRY_OP_UI_VIDEO:
+        case FURRY_OP_UI_BIND:
+            if (ins->op == FURRY_OP_UI_BEGIN && state->scope_depth == 0) {
+                scene_begin_layer(&state->snap.scene, ins, state->snap.ip);
+                if (state->skipping && ins->target >= 0) {
+                    note_skipped_layer(state, state->snap.ip);
+                    state->snap.ip = (size_t)ins->target + 1;
+                    break;
+                }
+            }
+            if (run_ui_instruction(state, ins) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            break;
+        case FURRY_OP_MUSIC:
+            if (state->skipping) {
+                state->skip_parts |= SCENE_MUSIC;
+            } else if (state->audio != NULL && furry_audio_play_music(state->audio, ins->a, 1) != FURRY_OK) {
+                return FURRY_ERR;
+            } else if (state->host_fn != NULL) {
+                if (call_host(state, ins) != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else if (state->audio == NULL) {
+                printf("[MUSIC:miniaudio] %s\n", ins->a);
+            }
+            scene_set_music(&state->snap.scene, ins->a);
+            state->snap.ip++;
+            break;
+        case FURRY_OP_SFX:
+            if (state->skipping) {
+                state->snap.ip++;
+                break;
+            }
+            if (state->audio != NULL && furry_audio_play_sfx(state->audio, ins->a, FURRY_AUDIO_BUS_SFX, 1.0f) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            if (state->host_fn != NULL) {
+                if (call_host(state, ins) != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else if (state->audio == NULL) {
+                printf("[SFX:miniaudio] %s\n", ins->a);
+            }
+            state->snap.ip++;
+            break;
+        case FURRY_OP_SAVE:
+            if (state->audio != NULL) {
+                state->snap.scene.music_frame = furry_audio_music_position(state->audio);
+            }
+            if (state->save_fn != NULL) {
+                unsigned long long start = trace_call_begin(state);
+                int saved = state->save_fn(ins->a, &state->snap, state->user_data);
+                trace_call_end(FURRY_TRACE_SAVE, start, 0, ins->a);
+                if (saved != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else if (state->save_store != NULL) {
+                /* The built-in store records the resume point after the save instruction. */
+                state->snap.ip++;
+                if (furry_save_store_put(state->save_store, ins->a, &state->snap) != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+                break;
+            } else {
+                printf("[SAVE] slot=%s ip=%zu vars=%zu\n", ins->a, state->snap.ip, state->snap.var_count);
+            }
+            state->snap.ip++;
+            break;
+        case FURRY_OP_LOAD:
+            if (state->load_fn != NULL || state->save_store != NULL) {
+                /* Spawned contexts belong to the story position being left. */
+                state->context_count = 0;
+                state->context_runnable = 0;
+            }
+            if (state->load_fn != NULL) {
+                unsigned long long start = trace_call_begin(state);
+                int loaded = state->load_fn(ins->a, &state->snap, state->user_data);
+                trace_call_end(FURRY_TRACE_LOAD, start, 0, ins->a);
+                if (loaded != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+                reset_slot_cache(state);
+                mark_all_dirty(state);
+                if (state->snap.ip >= program->count || restore_scene(state) != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else if (state->save_store != NULL) {
+                if (furry_save_store_get(state->save_store, ins->a, &state->snap) != FURRY_OK || state->snap.ip >= program->count) {
+                    return FURRY_ERR;
+                }
+                reset_slot_cache(state);
+                mark_all_dirty(state);
+                if (restore_scene(state) != FURRY_OK) {
+                    return FURRY_ERR;
+                }
+            } else {
+                printf("[LOAD] slot=%s (no loader configured, ignored)\n", ins->a);
+                state->snap.ip++;
+            }
+            break;
+        case FURRY_OP_CHOICE: {
+            unsigned long long start = trace_call_begin(state);
+            begin_player_wait(state);
+            int selected = state->choose_fn(localized(state, ins->text_id, ins->a), localize_choices(state, ins), ins->choice_count, state->user_data);
+            trace_call_end(FURRY_TRACE_CHOOSE, start, (unsigned)ins->choice_count, ins->a);
+            if (end_player_wait(state) != FURRY_OK || selected < 0 || (size_t)selected >= ins->choice_count) {
+                return FURRY_ERR;
+            }
+            state->snap.ip = (size_t)ins->choices[selected].target_index + 1;
+            break;
+        }
+        case FURRY_OP_SPAWN:
+            if (spawn_context(state, ins) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            state->snap.ip++;
+            break;
+        case FURRY_OP_WAIT:
+            state->snap.ip++;
+            /* Skipping fast-forwards script time too. */
+            if (ctx == NULL && state->skipping) {
+                break;
+            }
+            if (state->ui_depth > 0 || state->scope_depth > 0) {
+                return FURRY_ERR;
+            }
+            update_clock(state);
+            wait_for_time(ctx != NULL ? ctx : &state->main_wait, state->now_ms + (unsigned long long)ins->i);
+            return STEP_SUSPEND;
+        case FURRY_OP_WAIT_EVENT: {
+            if (state->ui_depth > 0 || state->scope_depth > 0) {
+                return FURRY_ERR;
+            }
+            RuntimeContext *waiter = ctx != NULL ? ctx : &state->main_wait;
+            waiter->wait = WAIT_EVENT;
+            waiter->event = ins->a;
+            state->snap.ip++;
+            return STEP_SUSPEND;
+        }
+        case FURRY_OP_SIGNAL:
+            signal_event(state, ins->a);
+            state->snap.ip++;
+            break;
+        case FURRY_OP_END:
+            return STEP_END;
+        default:
+            return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+static int run_program(const FurryProgram *program, const FurryRuntimeConfig *config, RuntimeState *state) {
+    int max_steps = 50000;
+    state->program = program;
+    reset_slot_cache(state);
+
+    state->choose_fn = choose_default;
+    state->context_capacity = DEFAULT_MAX_CONTEXTS;
+    state->context_budget = DEFAULT_CONTEXT_BUDGET;
+    if (config != NULL) {
+        if (config->max_steps > 0) {
+            max_steps = config->max_steps;
+        }
+        if (config->choose_option != NULL) {
+            state->choose_fn = config->choose_option;
+        }
+        state->host_fn = config->on_host_command;
+        state->scene_fn = config->on_scene_restore;
+        state->save_fn = config->save_slot;
+        state->load_fn = config->load_slot;
+        state->say_fn = config->on_say;
+        state->locale = config->locale;
+        state->save_store = config->save_store;
+        state->audio = config->audio;
+        state->ui_tree = config->ui_tree;
+        state->patch_fn = config->on_ui_patch;
+        state->bind_fn = config->on_bind_update;
+        state->user_data = config->user_data;
+        state->seen = config->seen;
+        state->skip_mode = config->skip_mode;
+        state->skip_fn = config->on_skip_stop;
+        state->skip_budget = config->skip_budget;
+        state->lazy = config->lazy;
+        if (config->max_contexts > 0) {
+            state->context_capacity = config->max_contexts;
+        }
+        if (config->context_budget > 0) {
+            state->context_budget = config->context_budget;
+        }
+        state->clock_fn = config->clock_ms;
+    }
+    if ((state->lazy != NULL && furry_lazy_program(state->lazy) != program) || reserve_slots(state) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+
+    state->max_steps = max_steps;
+    int steps = 0;
+    while (state->snap.ip < program->count && steps < max_steps) {
+        int rc = step(program, state);
+        if (rc == STEP_END) {
+            return FURRY_OK;
+        }
+        if (rc == STEP_SUSPEND) {
+            rc = wait_main(program, state, &steps, max_steps);
+        }
+        if (rc != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        steps++;
+        /* A main script that never waits still leaves the contexts a turn now and then. */
+        if (state->context_count > 0 && steps % state->context_budget == 0 && state->ui_depth == 0 && state->scope_depth == 0 &&
+            run_round(program, state) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+
+    return FURRY_ERR;
+}
+
+int furry_run_program(const FurryProgram *program, const FurryRuntimeConfig *config) {
+    if (program == NULL || program->code == NULL || program->count == 0) {
+        return FURRY_ERR;
+    }
+    /* Tens of kilobytes with the binding tables; kept off the caller's stack, which may be a worker thread's. */
+    RuntimeState *state = furry_calloc(FURRY_MEM_VM, 1, sizeof(RuntimeState));
+    if (state == NULL) {
+        return FURRY_ERR;
+    }
+    const FurryLocale *locale = config != NULL ? config->locale : NULL;
+    furry_locale_begin_run(locale);
+    int result = run_program(program, config, state);
+    furry_locale_end_run(locale);
+    trace_flush_batch(state);
+    furry_free(state->contexts);
+    furry_free(state->slot_index);
+    furry_free(state->bind_head);
+    furry_free(state->dirty);
+    furry_free(state->bound);
+    furry_free(state);
+    return result;
+}
+
+int furry_snapshot_save(const FurryRuntimeSnapshot *snapshot, char *out_text, size_t out_size) {
+    if (snapshot == NULL || out_text == NULL || out_size == 0) {
+        return FURRY_ERR;
+    }
+
+    int written = snprintf(out_text, out_size, "ip=%zu;depth=%zu;vars=%zu", snapshot->ip, snapshot->callstack_depth, snapshot->var_count);
+    if (written < 0 || (size_t)written >= out_size) {
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_snapshot_load(const char *text, FurryRuntimeSnapshot *out_snapshot) {
+    if (text == NULL || out_snapshot == NULL) {
+        return FURRY_ERR;
     }
 
     memset(out_snapshot, 0, sizeof(*out_snapshot));
@@ -862,11 +2125,46 @@ int furry_media_is_supported(const char *asset_path) {
     return has_supported_media_extension(asset_path);
 }
 
+const char *furry_instruction_asset(const FurryInstruction *ins) {
+    if (ins == NULL) {
+        return NULL;
+    }
+    switch (ins->op) {
+        case FURRY_OP_BG:
+        case FURRY_OP_FG:
+        case FURRY_OP_MUSIC:
+        case FURRY_OP_SFX:
+            return ins->a;
+        case FURRY_OP_UI_IMAGE:
+        case FURRY_OP_UI_ANIM:
+        case FURRY_OP_UI_VIDEO:
+            return ins->b;
+        default:
+            return NULL;
+    }
+}
+
+unsigned long long furry_program_fingerprint(const FurryProgram *program) {
+    unsigned long long hash = 14695981039346656037ull;
+    for (size_t n = 0; n < program->count; ++n) {
+        const FurryInstruction *ins = &program->code[n];
+        int fields[4] = {(int)ins->op, ins->i, ins->target, ins->slot};
+        hash = hash_bytes(hash, fields, sizeof(fields));
+        hash = hash_text(hash_text(hash_text(hash, ins->a), ins->b), ins->c);
+        for (size_t c = 0; c < ins->choice_count; ++c) {
+            hash = hash_text(hash_text(hash, ins->choices[c].text), ins->choices[c].target);
+        }
+    }
+    return hash;
+}
+
 void furry_free_program(FurryProgram *program) {
     if (program == NULL) {
         return;
     }
-    free(program->code);
-    program->code = NULL;
-    program->count = 0;
+    furry_free(program->code);
+    furry_free(program->expr_code);
+    furry_free(program->expr_strings);
+    furry_free(program->var_names);
+    memset(program, 0, sizeof(*program));
 }
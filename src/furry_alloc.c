@@ -0,0 +1,200 @@
+#include "furry_alloc.h"
+#include "furry_internal.h"
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Each block starts with its requested size and tag, padded so the payload keeps malloc's alignment. */
+typedef union BlockHeader {
+    struct {
+        size_t size;
+        FurryMemTag tag;
+    } info;
+    max_align_t align;
+} BlockHeader;
+
+static void *libc_alloc(void *ptr, size_t old_size, size_t new_size, FurryMemTag tag, void *user_data) {
+    (void)old_size;
+    (void)tag;
+    (void)user_data;
+    if (new_size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    return realloc(ptr, new_size);
+}
+
+static FurryAllocator allocator = {libc_alloc, NULL};
+static atomic_size_t current_bytes[FURRY_MEM_TAG_COUNT];
+static atomic_size_t peak_bytes[FURRY_MEM_TAG_COUNT];
+static atomic_size_t allocations[FURRY_MEM_TAG_COUNT];
+
+void furry_set_allocator(const FurryAllocator *custom) {
+    if (custom != NULL && custom->fn != NULL) {
+        allocator = *custom;
+    } else {
+        allocator.fn = libc_alloc;
+        allocator.user_data = NULL;
+    }
+}
+
+static void account(FurryMemTag tag, size_t added, size_t removed) {
+    size_t now = added >= removed
+                     ? atomic_fetch_add_explicit(&current_bytes[tag], added - removed, memory_order_relaxed) + (added - removed)
+                     : atomic_fetch_sub_explicit(&current_bytes[tag], removed - added, memory_order_relaxed) - (removed - added);
+    size_t peak = atomic_load_explicit(&peak_bytes[tag], memory_order_relaxed);
+    while (now > peak &&
+           !atomic_compare_exchange_weak_explicit(&peak_bytes[tag], &peak, now, memory_order_relaxed, memory_order_relaxed)) {
+        continue;
+    }
+}
+
+static void *track(BlockHeader *header, FurryMemTag tag, size_t size) {
+    if (header == NULL) {
+        return NULL;
+    }
+    header->info.size = size;
+    header->info.tag = tag;
+    atomic_fetch_add_explicit(&allocations[tag], 1, memory_order_relaxed);
+    account(tag, size, 0);
+    return header + 1;
+}
+
+void *furry_alloc(FurryMemTag tag, size_t size) {
+    if ((unsigned)tag >= FURRY_MEM_TAG_COUNT || size > (size_t)-1 - sizeof(BlockHeader)) {
+        return NULL;
+    }
+    return track(allocator.fn(NULL, 0, sizeof(BlockHeader) + size, tag, allocator.user_data), tag, size);
+}
+
+void *furry_calloc(FurryMemTag tag, size_t count, size_t size) {
+    if (size != 0 && count > (size_t)-1 / size) {
+        return NULL;
+    }
+    /* libc's calloc gets fresh pages from the OS already zeroed; large lazily-filled arrays never touch most of them. */
+    if (allocator.fn == libc_alloc) {
+        if ((unsigned)tag >= FURRY_MEM_TAG_COUNT || count * size > (size_t)-1 - sizeof(BlockHeader)) {
+            return NULL;
+        }
+        return track(calloc(1, sizeof(BlockHeader) + count * size), tag, count * size);
+    }
+    void *ptr = furry_alloc(tag, count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/* Like realloc; a block keeps the tag it was first allocated with. */
+void *furry_realloc(FurryMemTag tag, void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return furry_alloc(tag, size);
+    }
+    if (size == 0) {
+        furry_free(ptr);
+        return NULL;
+    }
+    if (size > (size_t)-1 - sizeof(BlockHeader)) {
+        return NULL;
+    }
+    BlockHeader *header = (BlockHeader *)ptr - 1;
+    size_t old_size = header->info.size;
+    tag = header->info.tag;
+    header = allocator.fn(header, sizeof(BlockHeader) + old_size, sizeof(BlockHeader) + size, tag, allocator.user_data);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->info.size = size;
+    account(tag, size, old_size);
+    return header + 1;
+}
+
+void furry_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    BlockHeader *header = (BlockHeader *)ptr - 1;
+    size_t size = header->info.size;
+    FurryMemTag tag = header->info.tag;
+    atomic_fetch_sub_explicit(&current_bytes[tag], size, memory_order_relaxed);
+    allocator.fn(header, sizeof(BlockHeader) + size, 0, tag, allocator.user_data);
+}
+
+void furry_memory_stats(FurryMemoryStats *out_stats) {
+    if (out_stats == NULL) {
+        return;
+    }
+    for (int tag = 0; tag < FURRY_MEM_TAG_COUNT; ++tag) {
+        out_stats->current_bytes[tag] = atomic_load_explicit(&current_bytes[tag], memory_order_relaxed);
+        out_stats->peak_bytes[tag] = atomic_load_explicit(&peak_bytes[tag], memory_order_relaxed);
+        out_stats->allocations[tag] = atomic_load_explicit(&allocations[tag], memory_order_relaxed);
+    }
+}
+
+void furry_memory_reset_peaks(void) {
+    for (int tag = 0; tag < FURRY_MEM_TAG_COUNT; ++tag) {
+        atomic_store_explicit(&peak_bytes[tag], atomic_load_explicit(&current_bytes[tag], memory_order_relaxed), memory_order_relaxed);
+    }
+}
+
+const char *furry_memory_tag_name(FurryMemTag tag) {
+    static const char *const names[FURRY_MEM_TAG_COUNT] = {"general", "compiler", "vm",   "scratch", "save",   "locale", "assets", "audio",
+                                                           "video",   "text",     "ui",   "render",  "anim",   "replay", "trace"};
+    return (unsigned)tag < FURRY_MEM_TAG_COUNT ? names[tag] : "unknown";
+}
+
+/* Scratch arenas: bump allocation from chunks; reset keeps the newest chunk for reuse. */
+struct FurryScratchChunk {
+    struct FurryScratchChunk *next;
+    size_t capacity;
+};
+
+#define SCRATCH_ALIGN alignof(max_align_t)
+#define SCRATCH_ROUND(n) (((n) + SCRATCH_ALIGN - 1) & ~(SCRATCH_ALIGN - 1))
+
+void furry_scratch_init(FurryScratch *scratch, size_t chunk_size) {
+    scratch->chunks = NULL;
+    scratch->used = 0;
+    scratch->chunk_size = chunk_size > 0 ? chunk_size : 4096;
+}
+
+void *furry_scratch_alloc(FurryScratch *scratch, size_t size) {
+    size = SCRATCH_ROUND(size);
+    struct FurryScratchChunk *chunk = scratch->chunks;
+    if (chunk == NULL || chunk->capacity - scratch->used < size) {
+        size_t capacity = size > scratch->chunk_size ? size : scratch->chunk_size;
+        chunk = furry_alloc(FURRY_MEM_SCRATCH, SCRATCH_ROUND(sizeof(struct FurryScratchChunk)) + capacity);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = scratch->chunks;
+        chunk->capacity = capacity;
+        scratch->chunks = chunk;
+        scratch->used = 0;
+    }
+    unsigned char *ptr = (unsigned char *)chunk + SCRATCH_ROUND(sizeof(struct FurryScratchChunk)) + scratch->used;
+    scratch->used += size;
+    return ptr;
+}
+
+void furry_scratch_reset(FurryScratch *scratch) {
+    if (scratch->chunks == NULL) {
+        return;
+    }
+    struct FurryScratchChunk *older = scratch->chunks->next;
+    while (older != NULL) {
+        struct FurryScratchChunk *next = older->next;
+        furry_free(older);
+        older = next;
+    }
+    scratch->chunks->next = NULL;
+    scratch->used = 0;
+}
+
+void furry_scratch_free(FurryScratch *scratch) {
+    furry_scratch_reset(scratch);
+    furry_free(scratch->chunks);
+    scratch->chunks = NULL;
+}
@@ -0,0 +1,579 @@
+#include "furry_anim.h"
+#include "furry_internal.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FURRY_ANIM_SSE2 1
+#endif
+
+#define ANIM_SLOT_BITS 20
+#define ANIM_SLOT_MASK ((1u << ANIM_SLOT_BITS) - 1)
+#define ANIM_PROPS FURRY_ANIM_PROPERTY_COUNT
+
+enum { ANIM_FREE = 0, ANIM_PLAYING, ANIM_FINISHED };
+
+/* Per-channel SoA columns; channel index = property * capacity + slot. */
+enum { CH_U = 0, CH_RATE, CH_V0, CH_DV, CH_EA, CH_EB, CH_EC, CH_OUT, CH_COLUMNS };
+
+typedef struct AnimKey {
+    float time;
+    float value;
+    FurryAnimEase ease;
+} AnimKey;
+
+typedef struct AnimClip {
+    char name[FURRY_MAX_NAME];
+    float duration;
+    size_t first[ANIM_PROPS];
+    size_t count[ANIM_PROPS];
+} AnimClip;
+
+struct FurryAnim {
+    AnimClip *clips;
+    size_t clip_count;
+    size_t clip_capacity;
+    AnimKey *keys;
+    size_t key_count;
+    size_t key_capacity;
+
+    size_t capacity;
+    size_t high_water;
+    size_t active;
+    int *clip_of;
+    unsigned char *mode;
+    unsigned char *state;
+    unsigned char *resync;
+    unsigned *generation;
+    float *time;
+    float *dir;
+    unsigned long long *tag;
+    size_t *free_slots;
+    size_t free_count;
+    float *channels[CH_COLUMNS];
+
+    size_t *resync_slots;
+    size_t resync_count;
+    size_t *fixups;
+    size_t fixup_count;
+    FurryAnimEvent *events;
+    size_t event_count;
+    size_t event_capacity;
+};
+
+/* Every easing is a cubic a*u + b*u^2 + c*u^3 on [0, 1], so one branch-free formula evaluates all of them. */
+static const float ease_coefficients[][3] = {
+    {1.0f, 0.0f, 0.0f},  {0.0f, 1.0f, 0.0f}, {2.0f, -1.0f, 0.0f}, {0.0f, 3.0f, -2.0f},
+    {0.0f, 0.0f, 1.0f},  {3.0f, -3.0f, 1.0f}, {0.0f, 0.0f, 0.0f},
+};
+
+static const float rest_values[ANIM_PROPS] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f};
+
+static void *grow_array(void *array, size_t old_count, size_t new_count, size_t item_size) {
+    void *grown = furry_realloc(FURRY_MEM_ANIM, array, new_count * item_size);
+    if (grown != NULL && new_count > old_count) {
+        memset((unsigned char *)grown + old_count * item_size, 0, (new_count - old_count) * item_size);
+    }
+    return grown;
+}
+
+static int grow_instances(FurryAnim *anim, size_t capacity) {
+    if (capacity > ANIM_SLOT_MASK + 1u) {
+        return FURRY_ERR;
+    }
+    size_t old = anim->capacity;
+#define ANIM_GROW(field)                                                            \
+    do {                                                                            \
+        void *grown = grow_array(anim->field, old, capacity, sizeof(*anim->field)); \
+        if (grown == NULL) {                                                        \
+            return FURRY_ERR;                                                       \
+        }                                                                           \
+        anim->field = grown;                                                        \
+    } while (0)
+    ANIM_GROW(clip_of);
+    ANIM_GROW(mode);
+    ANIM_GROW(state);
+    ANIM_GROW(resync);
+    ANIM_GROW(generation);
+    ANIM_GROW(time);
+    ANIM_GROW(dir);
+    ANIM_GROW(tag);
+    ANIM_GROW(free_slots);
+    ANIM_GROW(resync_slots);
+#undef ANIM_GROW
+    size_t *fixups = furry_realloc(FURRY_MEM_ANIM, anim->fixups, sizeof(size_t) * capacity * ANIM_PROPS);
+    if (fixups == NULL) {
+        return FURRY_ERR;
+    }
+    anim->fixups = fixups;
+    /* Re-stride the property-major columns; new slots start at rest. All are allocated first, so a failure leaves the old stride intact. */
+    float *columns[CH_COLUMNS];
+    for (int column = 0; column < CH_COLUMNS; ++column) {
+        columns[column] = furry_calloc(FURRY_MEM_ANIM, capacity * ANIM_PROPS, sizeof(float));
+        if (columns[column] == NULL) {
+            while (column-- > 0) {
+                furry_free(columns[column]);
+            }
+            return FURRY_ERR;
+        }
+    }
+    for (int column = 0; column < CH_COLUMNS; ++column) {
+        float *grown = columns[column];
+        for (int prop = 0; prop < ANIM_PROPS; ++prop) {
+            if (anim->channels[column] != NULL) {
+                memcpy(grown + (size_t)prop * capacity, anim->channels[column] + (size_t)prop * old, sizeof(float) * old);
+            }
+            if (column == CH_V0 || column == CH_OUT) {
+                for (size_t slot = old; slot < capacity; ++slot) {
+                    grown[(size_t)prop * capacity + slot] = rest_values[prop];
+                }
+            }
+        }
+        furry_free(anim->channels[column]);
+        anim->channels[column] = grown;
+    }
+    anim->capacity = capacity;
+    return FURRY_OK;
+}
+
+int furry_anim_create(size_t capacity_hint, FurryAnim **out_anim) {
+    if (out_anim == NULL) {
+        return FURRY_ERR;
+    }
+    *out_anim = NULL;
+    FurryAnim *anim = furry_calloc(FURRY_MEM_ANIM, 1, sizeof(FurryAnim));
+    if (anim == NULL) {
+        return FURRY_ERR;
+    }
+    if (grow_instances(anim, capacity_hint > 0 ? capacity_hint : 64) != FURRY_OK) {
+        furry_anim_destroy(anim);
+        return FURRY_ERR;
+    }
+    *out_anim = anim;
+    return FURRY_OK;
+}
+
+void furry_anim_destroy(FurryAnim *anim) {
+    if (anim == NULL) {
+        return;
+    }
+    furry_free(anim->clips);
+    furry_free(anim->keys);
+    furry_free(anim->clip_of);
+    furry_free(anim->mode);
+    furry_free(anim->state);
+    furry_free(anim->resync);
+    furry_free(anim->generation);
+    furry_free(anim->time);
+    furry_free(anim->dir);
+    furry_free(anim->tag);
+    furry_free(anim->free_slots);
+    furry_free(anim->resync_slots);
+    furry_free(anim->fixups);
+    furry_free(anim->events);
+    for (int column = 0; column < CH_COLUMNS; ++column) {
+        furry_free(anim->channels[column]);
+    }
+    furry_free(anim);
+}
+
+static int find_clip(const FurryAnim *anim, const char *name) {
+    for (size_t i = 0; i < anim->clip_count; ++i) {
+        if (strcmp(anim->clips[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int furry_anim_define(FurryAnim *anim, const char *name, const FurryAnimKey *keys, size_t key_count) {
+    if (anim == NULL || name == NULL || name[0] == '\0' || strlen(name) >= FURRY_MAX_NAME || (keys == NULL && key_count > 0)) {
+        return FURRY_ERR;
+    }
+    AnimClip clip;
+    memset(&clip, 0, sizeof(clip));
+    snprintf(clip.name, sizeof(clip.name), "%s", name);
+    float last_time[ANIM_PROPS];
+    for (int prop = 0; prop < ANIM_PROPS; ++prop) {
+        last_time[prop] = -1.0f;
+    }
+    for (size_t i = 0; i < key_count; ++i) {
+        const FurryAnimKey *key = &keys[i];
+        if ((unsigned)key->property >= ANIM_PROPS || (unsigned)key->ease > FURRY_EASE_STEP || !(key->time >= 0.0f) ||
+            key->time < last_time[key->property] || !isfinite(key->value)) {
+            return FURRY_ERR;
+        }
+        last_time[key->property] = key->time;
+        clip.count[key->property]++;
+        clip.duration = key->time > clip.duration ? key->time : clip.duration;
+    }
+    if (anim->key_count + key_count > anim->key_capacity) {
+        size_t capacity = anim->key_capacity == 0 ? 64 : anim->key_capacity;
+        while (capacity < anim->key_count + key_count) {
+            capacity *= 2;
+        }
+        AnimKey *grown = furry_realloc(FURRY_MEM_ANIM, anim->keys, sizeof(AnimKey) * capacity);
+        if (grown == NULL) {
+            return FURRY_ERR;
+        }
+        anim->keys = grown;
+        anim->key_capacity = capacity;
+    }
+    /* Keys are grouped per property; a replaced clip's old keys are simply left unused. */
+    size_t cursor = anim->key_count;
+    for (int prop = 0; prop < ANIM_PROPS; ++prop) {
+        clip.first[prop] = cursor;
+        for (size_t i = 0; i < key_count; ++i) {
+            if (keys[i].property == (FurryAnimProperty)prop) {
+                anim->keys[cursor].time = keys[i].time;
+                anim->keys[cursor].value = keys[i].value;
+                anim->keys[cursor].ease = keys[i].ease;
+                cursor++;
+            }
+        }
+    }
+    anim->key_count = cursor;
+
+    int existing = find_clip(anim, name);
+    if (existing >= 0) {
+        anim->clips[existing] = clip;
+        return FURRY_OK;
+    }
+    if (anim->clip_count == anim->clip_capacity) {
+        size_t capacity = anim->clip_capacity == 0 ? 16 : anim->clip_capacity * 2;
+        AnimClip *grown = furry_realloc(FURRY_MEM_ANIM, anim->clips, sizeof(AnimClip) * capacity);
+        if (grown == NULL) {
+            return FURRY_ERR;
+        }
+        anim->clips = grown;
+        anim->clip_capacity = capacity;
+    }
+    anim->clips[anim->clip_count++] = clip;
+    return FURRY_OK;
+}
+
+int furry_anim_define_builtins(FurryAnim *anim) {
+    static const FurryAnimKey fade_in[] = {{FURRY_ANIM_ALPHA, 0.0f, 0.0f, FURRY_EASE_OUT_QUAD}, {FURRY_ANIM_ALPHA, 0.3f, 1.0f, FURRY_EASE_LINEAR}};
+    static const FurryAnimKey fade_out[] = {{FURRY_ANIM_ALPHA, 0.0f, 1.0f, FURRY_EASE_IN_QUAD}, {FURRY_ANIM_ALPHA, 0.3f, 0.0f, FURRY_EASE_LINEAR}};
+    static const FurryAnimKey idle[] = {{FURRY_ANIM_Y, 0.0f, 0.0f, FURRY_EASE_IN_OUT},
+                                        {FURRY_ANIM_Y, 1.0f, -4.0f, FURRY_EASE_IN_OUT},
+                                        {FURRY_ANIM_Y, 2.0f, 0.0f, FURRY_EASE_LINEAR}};
+    static const FurryAnimKey bounce[] = {{FURRY_ANIM_Y, 0.0f, 0.0f, FURRY_EASE_OUT_QUAD},
+                                          {FURRY_ANIM_Y, 0.2f, -24.0f, FURRY_EASE_IN_QUAD},
+                                          {FURRY_ANIM_Y, 0.4f, 0.0f, FURRY_EASE_LINEAR}};
+    static const FurryAnimKey shake[] = {{FURRY_ANIM_X, 0.0f, 0.0f, FURRY_EASE_LINEAR},  {FURRY_ANIM_X, 0.08f, -6.0f, FURRY_EASE_LINEAR},
+                                         {FURRY_ANIM_X, 0.16f, 6.0f, FURRY_EASE_LINEAR}, {FURRY_ANIM_X, 0.24f, -4.0f, FURRY_EASE_LINEAR},
+                                         {FURRY_ANIM_X, 0.32f, 4.0f, FURRY_EASE_LINEAR}, {FURRY_ANIM_X, 0.4f, 0.0f, FURRY_EASE_LINEAR}};
+    static const FurryAnimKey pulse[] = {{FURRY_ANIM_SCALE, 0.0f, 1.0f, FURRY_EASE_IN_OUT},
+                                         {FURRY_ANIM_SCALE, 0.5f, 1.08f, FURRY_EASE_IN_OUT},
+                                         {FURRY_ANIM_SCALE, 1.0f, 1.0f, FURRY_EASE_LINEAR}};
+    if (furry_anim_define(anim, "fade_in", fade_in, sizeof(fade_in) / sizeof(fade_in[0])) != FURRY_OK ||
+        furry_anim_define(anim, "fade_out", fade_out, sizeof(fade_out) / sizeof(fade_out[0])) != FURRY_OK ||
+        furry_anim_define(anim, "idle", idle, sizeof(idle) / sizeof(idle[0])) != FURRY_OK ||
+        furry_anim_define(anim, "bounce", bounce, sizeof(bounce) / sizeof(bounce[0])) != FURRY_OK ||
+        furry_anim_define(anim, "shake", shake, sizeof(shake) / sizeof(shake[0])) != FURRY_OK ||
+        furry_anim_define(anim, "pulse", pulse, sizeof(pulse) / sizeof(pulse[0])) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_anim_parse_mode(const char *text, FurryAnimMode *out_mode) {
+    if (text == NULL || out_mode == NULL) {
+        return FURRY_ERR;
+    }
+    if (strcmp(text, "once") == 0) {
+        *out_mode = FURRY_ANIM_ONCE;
+    } else if (strcmp(text, "loop") == 0) {
+        *out_mode = FURRY_ANIM_LOOP;
+    } else if (strcmp(text, "pingpong") == 0) {
+        *out_mode = FURRY_ANIM_PINGPONG;
+    } else {
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+static float ease_poly(size_t index, float *const *ch, float u) {
+    u = u < 0.0f ? 0.0f : (u > 1.0f ? 1.0f : u);
+    return u * (ch[CH_EA][index] + u * (ch[CH_EB][index] + u * ch[CH_EC][index]));
+}
+
+/* Points a channel at the key segment containing its instance's time, scalar path for key crossings and wraps. */
+static void resegment(FurryAnim *anim, size_t slot, int prop) {
+    float *const *ch = anim->channels;
+    size_t index = (size_t)prop * anim->capacity + slot;
+    const AnimClip *clip = &anim->clips[anim->clip_of[slot]];
+    const AnimKey *keys = anim->keys + clip->first[prop];
+    size_t n = clip->count[prop];
+    float t = anim->time[slot];
+    int forward = anim->dir[slot] > 0.0f;
+    float a = 0.0f;
+    float b = clip->duration;
+    float v0 = rest_values[prop];
+    float dv = 0.0f;
+    FurryAnimEase ease = FURRY_EASE_STEP;
+    if (n > 0) {
+        if (forward ? t < keys[0].time : t <= keys[0].time) {
+            b = keys[0].time;
+            v0 = keys[0].value;
+        } else {
+            size_t i = 0;
+            while (i + 1 < n && (forward ? keys[i + 1].time <= t : keys[i + 1].time < t)) {
+                i++;
+            }
+            a = keys[i].time;
+            v0 = keys[i].value;
+            if (i + 1 < n) {
+                b = keys[i + 1].time;
+                dv = keys[i + 1].value - v0;
+                ease = keys[i].ease;
+            }
+        }
+    }
+    float span = b - a;
+    ch[CH_U][index] = span > 0.0f ? (t - a) / span : 1.0f;
+    ch[CH_RATE][index] = span > 0.0f && anim->state[slot] == ANIM_PLAYING ? anim->dir[slot] / span : 0.0f;
+    ch[CH_V0][index] = v0;
+    ch[CH_DV][index] = dv;
+    ch[CH_EA][index] = ease_coefficients[ease][0];
+    ch[CH_EB][index] = ease_coefficients[ease][1];
+    ch[CH_EC][index] = ease_coefficients[ease][2];
+    ch[CH_OUT][index] = v0 + dv * ease_poly(index, ch, ch[CH_U][index]);
+}
+
+static void resegment_all(FurryAnim *anim, size_t slot) {
+    for (int prop = 0; prop < ANIM_PROPS; ++prop) {
+        resegment(anim, slot, prop);
+    }
+}
+
+static int decode_handle(const FurryAnim *anim, unsigned handle, size_t *out_slot) {
+    size_t slot = handle & ANIM_SLOT_MASK;
+    if (handle == 0 || slot >= anim->high_water || anim->state[slot] == ANIM_FREE || anim->generation[slot] != handle >> ANIM_SLOT_BITS) {
+        return FURRY_ERR;
+    }
+    *out_slot = slot;
+    return FURRY_OK;
+}
+
+size_t furry_anim_slot(unsigned handle) {
+    return handle & ANIM_SLOT_MASK;
+}
+
+int furry_anim_play(FurryAnim *anim, const char *clip, FurryAnimMode mode, unsigned long long tag, unsigned *out_handle) {
+    if (anim == NULL || clip == NULL || (unsigned)mode > FURRY_ANIM_PINGPONG) {
+        return FURRY_ERR;
+    }
+    int clip_index = find_clip(anim, clip);
+    if (clip_index < 0) {
+        return FURRY_ERR;
+    }
+    size_t slot;
+    if (anim->free_count > 0) {
+        slot = anim->free_slots[--anim->free_count];
+    } else {
+        if (anim->high_water == anim->capacity && grow_instances(anim, anim->capacity * 2) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        slot = anim->high_water++;
+    }
+    unsigned generation = (anim->generation[slot] + 1u) & (0xffffffffu >> ANIM_SLOT_BITS);
+    anim->generation[slot] = generation == 0 ? 1u : generation;
+    anim->clip_of[slot] = clip_index;
+    anim->mode[slot] = (unsigned char)mode;
+    anim->state[slot] = anim->clips[clip_index].duration > 0.0f ? ANIM_PLAYING : ANIM_FINISHED;
+    anim->resync[slot] = 0;
+    anim->time[slot] = 0.0f;
+    anim->dir[slot] = 1.0f;
+    anim->tag[slot] = tag;
+    resegment_all(anim, slot);
+    anim->active++;
+    if (out_handle != NULL) {
+        *out_handle = (anim->generation[slot] << ANIM_SLOT_BITS) | (unsigned)slot;
+    }
+    return FURRY_OK;
+}
+
+int furry_anim_stop(FurryAnim *anim, unsigned handle) {
+    size_t slot = 0;
+    if (anim == NULL || decode_handle(anim, handle, &slot) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    anim->state[slot] = ANIM_FREE;
+    for (int prop = 0; prop < ANIM_PROPS; ++prop) {
+        size_t index = (size_t)prop * anim->capacity + slot;
+        anim->channels[CH_U][index] = 0.0f;
+        anim->channels[CH_RATE][index] = 0.0f;
+        anim->channels[CH_DV][index] = 0.0f;
+        anim->channels[CH_V0][index] = rest_values[prop];
+        anim->channels[CH_OUT][index] = rest_values[prop];
+    }
+    anim->free_slots[anim->free_count++] = slot;
+    anim->active--;
+    return FURRY_OK;
+}
+
+static int push_event(FurryAnim *anim, size_t slot, FurryAnimEventType type) {
+    if (anim->event_count == anim->event_capacity) {
+        size_t capacity = anim->event_capacity == 0 ? 32 : anim->event_capacity * 2;
+        FurryAnimEvent *grown = furry_realloc(FURRY_MEM_ANIM, anim->events, sizeof(FurryAnimEvent) * capacity);
+        if (grown == NULL) {
+            return FURRY_ERR;
+        }
+        anim->events = grown;
+        anim->event_capacity = capacity;
+    }
+    FurryAnimEvent *event = &anim->events[anim->event_count++];
+    event->handle = (anim->generation[slot] << ANIM_SLOT_BITS) | (unsigned)slot;
+    event->type = type;
+    event->tag = anim->tag[slot];
+    return FURRY_OK;
+}
+
+/* Clip clock: wraps, reflects or finishes at the clip's ends. */
+static int advance_clock(FurryAnim *anim, size_t slot, float dt) {
+    float duration = anim->clips[anim->clip_of[slot]].duration;
+    float t = anim->time[slot] + dt * anim->dir[slot];
+    int forward = anim->dir[slot] > 0.0f;
+    anim->time[slot] = t;
+    if ((forward && t < duration) || (!forward && t > 0.0f)) {
+        return FURRY_OK;
+    }
+    FurryAnimEventType type = FURRY_ANIM_LOOPED;
+    switch ((FurryAnimMode)anim->mode[slot]) {
+        case FURRY_ANIM_ONCE:
+            anim->time[slot] = forward ? duration : 0.0f;
+            anim->state[slot] = ANIM_FINISHED;
+            type = FURRY_ANIM_FINISHED;
+            break;
+        case FURRY_ANIM_LOOP:
+            anim->time[slot] = fmodf(t, duration);
+            break;
+        case FURRY_ANIM_PINGPONG: {
+            /* Unfold to a 2x-long forward timeline: [0, d) plays forward, [d, 2d) backward. */
+            float period = 2.0f * duration;
+            float phase = fmodf(forward ? t : period - t, period);
+            phase = phase < 0.0f ? phase + period : phase;
+            anim->dir[slot] = phase < duration ? 1.0f : -1.0f;
+            anim->time[slot] = phase < duration ? phase : period - phase;
+            break;
+        }
+    }
+    if (!anim->resync[slot]) {
+        anim->resync[slot] = 1;
+        anim->resync_slots[anim->resync_count++] = slot;
+    }
+    return push_event(anim, slot, type);
+}
+
+/*
+ * Steps u and re-evaluates v0 + dv * ease(u) for a contiguous run of
+ * channels, queueing lanes whose u left [0, 1] for resegmenting.
+ */
+static void step_channels(FurryAnim *anim, size_t begin, size_t end, float dt) {
+    float *u = anim->channels[CH_U];
+    const float *rate = anim->channels[CH_RATE];
+    const float *v0 = anim->channels[CH_V0];
+    const float *dv = anim->channels[CH_DV];
+    const float *ea = anim->channels[CH_EA];
+    const float *eb = anim->channels[CH_EB];
+    const float *ec = anim->channels[CH_EC];
+    float *out = anim->channels[CH_OUT];
+    size_t i = begin;
+#if defined(FURRY_ANIM_SSE2)
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= end; i += 4) {
+        __m128 vu = _mm_add_ps(_mm_loadu_ps(u + i), _mm_mul_ps(vdt, _mm_loadu_ps(rate + i)));
+        _mm_storeu_ps(u + i, vu);
+        __m128 c = _mm_min_ps(_mm_max_ps(vu, zero), one);
+        __m128 poly = _mm_mul_ps(c, _mm_add_ps(_mm_loadu_ps(ea + i), _mm_mul_ps(c, _mm_add_ps(_mm_loadu_ps(eb + i), _mm_mul_ps(c, _mm_loadu_ps(ec + i))))));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(v0 + i), _mm_mul_ps(_mm_loadu_ps(dv + i), poly)));
+        int crossed = _mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(vu, zero), _mm_cmpgt_ps(vu, one)));
+        for (int lane = 0; crossed != 0; ++lane, crossed >>= 1) {
+            if (crossed & 1) {
+                anim->fixups[anim->fixup_count++] = i + (size_t)lane;
+            }
+        }
+    }
+#endif
+    for (; i < end; ++i) {
+        u[i] += dt * rate[i];
+        float c = u[i] < 0.0f ? 0.0f : (u[i] > 1.0f ? 1.0f : u[i]);
+        out[i] = v0[i] + dv[i] * (c * (ea[i] + c * (eb[i] + c * ec[i])));
+        if (u[i] < 0.0f || u[i] > 1.0f) {
+            anim->fixups[anim->fixup_count++] = i;
+        }
+    }
+}
+
+int furry_anim_update(FurryAnim *anim, float dt) {
+    if (anim == NULL || !(dt >= 0.0f)) {
+        return FURRY_ERR;
+    }
+    anim->event_count = 0;
+    anim->fixup_count = 0;
+    anim->resync_count = 0;
+    for (size_t slot = 0; slot < anim->high_water; ++slot) {
+        if (anim->state[slot] == ANIM_PLAYING && advance_clock(anim, slot, dt) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    for (int prop = 0; prop < ANIM_PROPS; ++prop) {
+        size_t base = (size_t)prop * anim->capacity;
+        step_channels(anim, base, base + anim->high_water, dt);
+    }
+    for (size_t i = 0; i < anim->fixup_count; ++i) {
+        size_t slot = anim->fixups[i] % anim->capacity;
+        if (!anim->resync[slot]) {
+            resegment(anim, slot, (int)(anim->fixups[i] / anim->capacity));
+        }
+    }
+    for (size_t i = 0; i < anim->resync_count; ++i) {
+        size_t slot = anim->resync_slots[i];
+        anim->resync[slot] = 0;
+        resegment_all(anim, slot);
+    }
+    return FURRY_OK;
+}
+
+const FurryAnimEvent *furry_anim_events(const FurryAnim *anim, size_t *out_count) {
+    if (anim == NULL) {
+        return NULL;
+    }
+    if (out_count != NULL) {
+        *out_count = anim->event_count;
+    }
+    return anim->events;
+}
+
+int furry_anim_sample(const FurryAnim *anim, unsigned handle, float out_values[FURRY_ANIM_PROPERTY_COUNT]) {
+    size_t slot = 0;
+    if (anim == NULL || out_values == NULL || decode_handle(anim, handle, &slot) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    for (int prop = 0; prop < ANIM_PROPS; ++prop) {
+        out_values[prop] = anim->channels[CH_OUT][(size_t)prop * anim->capacity + slot];
+    }
+    return FURRY_OK;
+}
+
+const float *furry_anim_values(const FurryAnim *anim, FurryAnimProperty property, size_t *out_slots) {
+    if (anim == NULL || (unsigned)property >= ANIM_PROPS) {
+        return NULL;
+    }
+    if (out_slots != NULL) {
+        *out_slots = anim->high_water;
+    }
+    return anim->channels[CH_OUT] + (size_t)property * anim->capacity;
+}
+
+size_t furry_anim_active(const FurryAnim *anim) {
+    return anim == NULL ? 0 : anim->active;
+}
@@ -0,0 +1,892 @@
+#include "furry_audio.h"
+#include "furry_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#define AUDIO_CHANNELS 2
+#define AUDIO_BLOCK_FRAMES 256
+#define AUDIO_COMMAND_CAPACITY 256
+#define AUDIO_MAX_VOICES 64
+#define AUDIO_DUCK_ATTACK_MS 40
+#define AUDIO_DECODE_INTERVAL_NS 5000000L
+
+typedef enum AudioCommandType {
+    AUDIO_CMD_PLAY_MUSIC = 0,
+    AUDIO_CMD_STOP_MUSIC,
+    AUDIO_CMD_PLAY_SFX,
+    AUDIO_CMD_BUS_VOLUME
+} AudioCommandType;
+
+typedef struct AudioCommand {
+    int type;
+    int bus;
+    float value;
+    unsigned fade_frames;
+    void *ptr;
+    size_t frame;
+} AudioCommand;
+
+typedef struct AudioSample {
+    char name[FURRY_MAX_ASSET];
+    float *frames;
+    size_t frame_count;
+} AudioSample;
+
+/* Linear resampler + channel mapper from a decoder's native format to mixer stereo. */
+typedef struct AudioConverter {
+    FurryAudioDecoder decoder;
+    int loop;
+    int eof;
+    int primed;
+    double step;
+    double pos;
+    float frame0[AUDIO_CHANNELS];
+    float frame1[AUDIO_CHANNELS];
+    float src[AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+    size_t src_count;
+    size_t src_index;
+} AudioConverter;
+
+typedef struct AudioStream {
+    AudioConverter conv;
+    FurrySpscRing ring;
+    atomic_int eof;
+    atomic_int retired;
+    struct AudioStream *next;
+} AudioStream;
+
+typedef struct AudioRamp {
+    float value;
+    float target;
+    float step;
+} AudioRamp;
+
+typedef struct MusicSlot {
+    AudioStream *stream;
+    AudioRamp gain;
+    int retire_at_silence;
+} MusicSlot;
+
+typedef struct AudioVoice {
+    const AudioSample *sample;
+    size_t position;
+    float gain;
+    int bus;
+    unsigned serial;
+} AudioVoice;
+
+struct FurryAudio {
+    FurryAudioConfig config;
+    char asset_root[FURRY_MAX_ASSET];
+    FurrySpscRing commands;
+
+    /* Game thread. */
+    AudioSample **samples;
+    size_t sample_count;
+    size_t sample_capacity;
+    size_t commands_dropped;
+
+    /* Streams shared between game and decode threads; the mixer only flips `retired`. */
+    mtx_t decode_lock;
+    AudioStream *streams;
+    thrd_t decode_thread;
+    atomic_int stop;
+    int decode_thread_started;
+
+    /* Audio thread. */
+    MusicSlot music;
+    MusicSlot fading;
+    size_t music_frame;
+    AudioVoice voices[AUDIO_MAX_VOICES];
+    unsigned voice_serial;
+    AudioRamp buses[FURRY_AUDIO_BUS_COUNT];
+    AudioRamp duck;
+    float mix[FURRY_AUDIO_BUS_COUNT][AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+    float stream_block[AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+
+    atomic_size_t frames_rendered;
+    atomic_size_t underruns;
+    atomic_size_t voices_stolen;
+    atomic_uint active_voices;
+    atomic_size_t music_position;
+
+    void *device;
+};
+
+void furry_audio_default_config(FurryAudioConfig *config) {
+    if (config == NULL) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->sample_rate = 48000;
+    config->max_sfx_voices = 16;
+    config->decode_ahead_frames = 48000 / 2;
+    config->crossfade_ms = 1000;
+    config->duck_level = 0.35f;
+    config->duck_release_ms = 400;
+}
+
+static unsigned ms_to_frames(const FurryAudio *audio, unsigned ms) {
+    return (unsigned)((unsigned long long)ms * audio->config.sample_rate / 1000u);
+}
+
+static void ramp_to(AudioRamp *ramp, float target, unsigned frames) {
+    ramp->target = target;
+    if (frames == 0) {
+        ramp->value = target;
+        ramp->step = 0.0f;
+    } else {
+        ramp->step = (target - ramp->value) / (float)frames;
+    }
+}
+
+static float ramp_next(AudioRamp *ramp) {
+    float value = ramp->value;
+    if (ramp->step != 0.0f) {
+        ramp->value += ramp->step;
+        if ((ramp->step > 0.0f && ramp->value >= ramp->target) || (ramp->step < 0.0f && ramp->value <= ramp->target)) {
+            ramp->value = ramp->target;
+            ramp->step = 0.0f;
+        }
+    }
+    return value;
+}
+
+/* ---- format conversion (game/decode threads) ---- */
+
+static int converter_init(AudioConverter *conv, const FurryAudioDecoder *decoder, unsigned sample_rate, int loop) {
+    if (decoder->read == NULL || decoder->sample_rate == 0 || decoder->channels == 0 || decoder->channels > AUDIO_CHANNELS) {
+        return FURRY_ERR;
+    }
+    memset(conv, 0, sizeof(*conv));
+    conv->decoder = *decoder;
+    conv->loop = loop;
+    conv->step = (double)decoder->sample_rate / (double)sample_rate;
+    return FURRY_OK;
+}
+
+static int next_source_frame(AudioConverter *conv, float out[AUDIO_CHANNELS]) {
+    if (conv->src_index >= conv->src_count) {
+        conv->src_index = 0;
+        conv->src_count = conv->decoder.read(conv->decoder.state, conv->src, AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS / conv->decoder.channels);
+        if (conv->src_count == 0 && conv->loop && conv->decoder.seek != NULL && conv->decoder.seek(conv->decoder.state, 0) == FURRY_OK) {
+            conv->src_count = conv->decoder.read(conv->decoder.state, conv->src, AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS / conv->decoder.channels);
+        }
+        if (conv->src_count == 0) {
+            conv->eof = 1;
+            return 0;
+        }
+    }
+    const float *frame = conv->src + conv->src_index * conv->decoder.channels;
+    out[0] = frame[0];
+    out[1] = conv->decoder.channels > 1 ? frame[1] : frame[0];
+    conv->src_index++;
+    return 1;
+}
+
+static size_t converter_read(AudioConverter *conv, float *out, size_t frames) {
+    if (!conv->primed) {
+        if (!next_source_frame(conv, conv->frame0)) {
+            return 0;
+        }
+        if (!next_source_frame(conv, conv->frame1)) {
+            memcpy(conv->frame1, conv->frame0, sizeof(conv->frame1));
+        }
+        conv->primed = 1;
+    }
+    size_t produced = 0;
+    while (produced < frames) {
+        while (conv->pos >= 1.0) {
+            if (conv->eof) {
+                return produced;
+            }
+            memcpy(conv->frame0, conv->frame1, sizeof(conv->frame0));
+            if (!next_source_frame(conv, conv->frame1)) {
+                memcpy(conv->frame1, conv->frame0, sizeof(conv->frame1));
+            }
+            conv->pos -= 1.0;
+        }
+        float t = (float)conv->pos;
+        out[produced * 2] = conv->frame0[0] + (conv->frame1[0] - conv->frame0[0]) * t;
+        out[produced * 2 + 1] = conv->frame0[1] + (conv->frame1[1] - conv->frame0[1]) * t;
+        conv->pos += conv->step;
+        produced++;
+    }
+    return produced;
+}
+
+static void converter_close(AudioConverter *conv) {
+    if (conv->decoder.close != NULL) {
+        conv->decoder.close(conv->decoder.state);
+    }
+    conv->decoder.close = NULL;
+}
+
+static int open_asset(FurryAudio *audio, const char *name, FurryAudioDecoder *out_decoder) {
+    char path[FURRY_MAX_ASSET * 2];
+    if (audio->asset_root[0] != '\0') {
+        snprintf(path, sizeof(path), "%s/%s", audio->asset_root, name);
+    } else {
+        snprintf(path, sizeof(path), "%s", name);
+    }
+    memset(out_decoder, 0, sizeof(*out_decoder));
+    unsigned long long trace_start = furry_trace_on(FURRY_TRACE_HOST) ? furry_trace_now() : 0;
+    int rc = audio->config.open_decoder != NULL ? audio->config.open_decoder(path, out_decoder, audio->config.decoder_user_data)
+                                                : furry_audio_open_default(path, out_decoder);
+    if (trace_start != 0) {
+        furry_trace_record(FURRY_TRACE_ASSET_LOAD, trace_start, furry_trace_now() - trace_start, 0, name);
+    }
+    return rc;
+}
+
+/* Keeps a stream's ring topped up; runs on the decode thread, or inline when offline. */
+static void fill_stream(AudioStream *stream) {
+    float block[AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS];
+    while (!atomic_load_explicit(&stream->eof, memory_order_relaxed)) {
+        size_t writable = furry_spsc_writable(&stream->ring);
+        if (writable == 0) {
+            return;
+        }
+        size_t want = writable < AUDIO_BLOCK_FRAMES ? writable : AUDIO_BLOCK_FRAMES;
+        size_t got = converter_read(&stream->conv, block, want);
+        furry_spsc_write(&stream->ring, block, got);
+        if (got < want) {
+            atomic_store_explicit(&stream->eof, 1, memory_order_release);
+        }
+    }
+}
+
+static void pump_streams(FurryAudio *audio) {
+    mtx_lock(&audio->decode_lock);
+    for (AudioStream *stream = audio->streams; stream != NULL; stream = stream->next) {
+        if (!atomic_load_explicit(&stream->retired, memory_order_acquire)) {
+            fill_stream(stream);
+        }
+    }
+    mtx_unlock(&audio->decode_lock);
+}
+
+static int decode_main(void *arg) {
+    FurryAudio *audio = arg;
+    furry_trace_thread_name("furry audio decode");
+    struct timespec interval = {0, AUDIO_DECODE_INTERVAL_NS};
+    while (!atomic_load_explicit(&audio->stop, memory_order_acquire)) {
+        pump_streams(audio);
+        thrd_sleep(&interval, NULL);
+    }
+    return 0;
+}
+
+static void free_stream(AudioStream *stream) {
+    converter_close(&stream->conv);
+    furry_spsc_free(&stream->ring);
+    furry_free(stream);
+}
+
+/* ---- audio thread ---- */
+
+static void retire_slot(MusicSlot *slot) {
+    if (slot->stream != NULL) {
+        atomic_store_explicit(&slot->stream->retired, 1, memory_order_release);
+    }
+    memset(slot, 0, sizeof(*slot));
+}
+
+static void start_voice(FurryAudio *audio, const AudioCommand *cmd) {
+    unsigned limit = audio->config.max_sfx_voices;
+    AudioVoice *target = NULL;
+    for (unsigned i = 0; i < limit; ++i) {
+        if (audio->voices[i].sample == NULL) {
+            target = &audio->voices[i];
+            break;
+        }
+        if (target == NULL || audio->voices[i].serial < target->serial) {
+            target = &audio->voices[i];
+        }
+    }
+    if (target->sample != NULL) {
+        atomic_fetch_add_explicit(&audio->voices_stolen, 1, memory_order_relaxed);
+    }
+    target->sample = cmd->ptr;
+    target->position = 0;
+    target->gain = cmd->value;
+    target->bus = cmd->bus;
+    target->serial = ++audio->voice_serial;
+}
+
+static void apply_commands(FurryAudio *audio) {
+    AudioCommand cmd;
+    while (furry_spsc_read(&audio->commands, &cmd, 1) == 1) {
+        switch ((AudioCommandType)cmd.type) {
+            case AUDIO_CMD_PLAY_MUSIC:
+                retire_slot(&audio->fading);
+                if (audio->music.stream != NULL && cmd.fade_frames > 0) {
+                    audio->fading = audio->music;
+                    audio->fading.retire_at_silence = 1;
+                    ramp_to(&audio->fading.gain, 0.0f, cmd.fade_frames);
+                    audio->music.stream = NULL;
+                }
+                retire_slot(&audio->music);
+                audio->music.stream = cmd.ptr;
+                audio->music_frame = cmd.frame;
+                audio->music.gain.value = audio->fading.stream != NULL ? 0.0f : 1.0f;
+                ramp_to(&audio->music.gain, 1.0f, audio->fading.stream != NULL ? cmd.fade_frames : 0);
+                break;
+            case AUDIO_CMD_STOP_MUSIC:
+                audio->music_frame = 0;
+                if (cmd.fade_frames == 0) {
+                    retire_slot(&audio->music);
+                } else if (audio->music.stream != NULL) {
+                    retire_slot(&audio->fading);
+                    audio->fading = audio->music;
+                    audio->fading.retire_at_silence = 1;
+                    ramp_to(&audio->fading.gain, 0.0f, cmd.fade_frames);
+                    memset(&audio->music, 0, sizeof(audio->music));
+                }
+                break;
+            case AUDIO_CMD_PLAY_SFX:
+                start_voice(audio, &cmd);
+                break;
+            case AUDIO_CMD_BUS_VOLUME:
+                ramp_to(&audio->buses[cmd.bus], cmd.value, cmd.fade_frames);
+                break;
+        }
+    }
+}
+
+static size_t mix_music(FurryAudio *audio, MusicSlot *slot, float *bus, size_t frames) {
+    if (slot->stream == NULL) {
+        return 0;
+    }
+    size_t got = furry_spsc_read(&slot->stream->ring, audio->stream_block, frames);
+    if (got < frames) {
+        if (atomic_load_explicit(&slot->stream->eof, memory_order_acquire) && furry_spsc_readable(&slot->stream->ring) == 0) {
+            slot->retire_at_silence = 1;
+            slot->gain.value = 0.0f;
+            slot->gain.step = 0.0f;
+        } else {
+            atomic_fetch_add_explicit(&audio->underruns, 1, memory_order_relaxed);
+        }
+    }
+    for (size_t i = 0; i < got; ++i) {
+        float gain = ramp_next(&slot->gain);
+        bus[i * 2] += audio->stream_block[i * 2] * gain;
+        bus[i * 2 + 1] += audio->stream_block[i * 2 + 1] * gain;
+    }
+    if (slot->retire_at_silence && slot->gain.value <= 0.0f) {
+        retire_slot(slot);
+    }
+    return got;
+}
+
+static unsigned mix_voices(FurryAudio *audio, size_t frames, int *voice_bus_active) {
+    unsigned active = 0;
+    for (unsigned v = 0; v < audio->config.max_sfx_voices; ++v) {
+        AudioVoice *voice = &audio->voices[v];
+        if (voice->sample == NULL) {
+            continue;
+        }
+        size_t remaining = voice->sample->frame_count - voice->position;
+        size_t n = remaining < frames ? remaining : frames;
+        const float *src = voice->sample->frames + voice->position * AUDIO_CHANNELS;
+        float *bus = audio->mix[voice->bus];
+        for (size_t i = 0; i < n * AUDIO_CHANNELS; ++i) {
+            bus[i] += src[i] * voice->gain;
+        }
+        voice->position += n;
+        if (voice->bus == FURRY_AUDIO_BUS_VOICE) {
+            *voice_bus_active = 1;
+        }
+        if (voice->position >= voice->sample->frame_count) {
+            voice->sample = NULL;
+        } else {
+            active++;
+        }
+    }
+    return active;
+}
+
+size_t furry_audio_render(FurryAudio *audio, float *out_frames, size_t frame_count) {
+    if (audio == NULL || out_frames == NULL) {
+        return 0;
+    }
+    apply_commands(audio);
+    if (audio->config.offline) {
+        pump_streams(audio);
+    }
+
+    unsigned active = 0;
+    size_t done = 0;
+    while (done < frame_count) {
+        size_t n = frame_count - done;
+        if (n > AUDIO_BLOCK_FRAMES) {
+            n = AUDIO_BLOCK_FRAMES;
+        }
+        memset(audio->mix, 0, sizeof(audio->mix));
+        audio->music_frame += mix_music(audio, &audio->music, audio->mix[FURRY_AUDIO_BUS_MUSIC], n);
+        if (audio->music.stream == NULL) {
+            audio->music_frame = 0;
+        }
+        mix_music(audio, &audio->fading, audio->mix[FURRY_AUDIO_BUS_MUSIC], n);
+        int voice_bus_active = 0;
+        active = mix_voices(audio, n, &voice_bus_active);
+
+        float duck_target = voice_bus_active ? audio->config.duck_level : 1.0f;
+        if (duck_target != audio->duck.target) {
+            unsigned ms = voice_bus_active ? AUDIO_DUCK_ATTACK_MS : audio->config.duck_release_ms;
+            ramp_to(&audio->duck, duck_target, ms_to_frames(audio, ms));
+        }
+
+        float *out = out_frames + done * AUDIO_CHANNELS;
+        for (size_t i = 0; i < n; ++i) {
+            float master = ramp_next(&audio->buses[FURRY_AUDIO_BUS_MASTER]);
+            float music = ramp_next(&audio->buses[FURRY_AUDIO_BUS_MUSIC]) * ramp_next(&audio->duck);
+            float sfx = ramp_next(&audio->buses[FURRY_AUDIO_BUS_SFX]);
+            float voice = ramp_next(&audio->buses[FURRY_AUDIO_BUS_VOICE]);
+            for (int c = 0; c < AUDIO_CHANNELS; ++c) {
+                size_t k = i * AUDIO_CHANNELS + (size_t)c;
+                float sample = master * (audio->mix[FURRY_AUDIO_BUS_MUSIC][k] * music + audio->mix[FURRY_AUDIO_BUS_SFX][k] * sfx +
+                                         audio->mix[FURRY_AUDIO_BUS_VOICE][k] * voice);
+                out[k] = sample > 1.0f ? 1.0f : (sample < -1.0f ? -1.0f : sample);
+            }
+        }
+        done += n;
+    }
+
+    atomic_store_explicit(&audio->active_voices, active, memory_order_relaxed);
+    atomic_store_explicit(&audio->music_position, audio->music_frame, memory_order_relaxed);
+    atomic_fetch_add_explicit(&audio->frames_rendered, frame_count, memory_order_relaxed);
+    return frame_count;
+}
+
+/* ---- game thread ---- */
+
+static int push_command(FurryAudio *audio, const AudioCommand *cmd) {
+    if (furry_spsc_write(&audio->commands, cmd, 1) != 1) {
+        audio->commands_dropped++;
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_audio_create(const FurryAudioConfig *config, FurryAudio **out_audio) {
+    if (out_audio == NULL) {
+        return FURRY_ERR;
+    }
+    *out_audio = NULL;
+    FurryAudio *audio = furry_calloc(FURRY_MEM_AUDIO, 1, sizeof(FurryAudio));
+    if (audio == NULL) {
+        return FURRY_ERR;
+    }
+    if (config != NULL) {
+        audio->config = *config;
+    } else {
+        furry_audio_default_config(&audio->config);
+    }
+    FurryAudioConfig defaults;
+    furry_audio_default_config(&defaults);
+    if (audio->config.sample_rate == 0) {
+        audio->config.sample_rate = defaults.sample_rate;
+    }
+    if (audio->config.max_sfx_voices == 0 || audio->config.max_sfx_voices > AUDIO_MAX_VOICES) {
+        audio->config.max_sfx_voices = audio->config.max_sfx_voices == 0 ? defaults.max_sfx_voices : AUDIO_MAX_VOICES;
+    }
+    if (audio->config.decode_ahead_frames < AUDIO_BLOCK_FRAMES * 4) {
+        audio->config.decode_ahead_frames = AUDIO_BLOCK_FRAMES * 4;
+    }
+    if (audio->config.asset_root != NULL) {
+        snprintf(audio->asset_root, sizeof(audio->asset_root), "%s", audio->config.asset_root);
+    }
+    audio->config.asset_root = audio->asset_root;
+
+    for (int b = 0; b < FURRY_AUDIO_BUS_COUNT; ++b) {
+        audio->buses[b].value = 1.0f;
+        audio->buses[b].target = 1.0f;
+    }
+    audio->duck.value = 1.0f;
+    audio->duck.target = 1.0f;
+    atomic_init(&audio->stop, 0);
+    atomic_init(&audio->frames_rendered, 0);
+    atomic_init(&audio->underruns, 0);
+    atomic_init(&audio->voices_stolen, 0);
+    atomic_init(&audio->active_voices, 0);
+    atomic_init(&audio->music_position, 0);
+
+    if (furry_spsc_init(&audio->commands, FURRY_MEM_AUDIO, sizeof(AudioCommand), AUDIO_COMMAND_CAPACITY) != FURRY_OK) {
+        furry_free(audio);
+        return FURRY_ERR;
+    }
+    if (mtx_init(&audio->decode_lock, mtx_plain) != thrd_success) {
+        furry_spsc_free(&audio->commands);
+        furry_free(audio);
+        return FURRY_ERR;
+    }
+    if (!audio->config.offline) {
+        if (thrd_create(&audio->decode_thread, decode_main, audio) != thrd_success) {
+            furry_audio_destroy(audio);
+            return FURRY_ERR;
+        }
+        audio->decode_thread_started = 1;
+        if (furry_audio_device_start(audio, audio->config.sample_rate, &audio->device) != FURRY_OK) {
+            furry_audio_destroy(audio);
+            return FURRY_ERR;
+        }
+    }
+    *out_audio = audio;
+    return FURRY_OK;
+}
+
+void furry_audio_destroy(FurryAudio *audio) {
+    if (audio == NULL) {
+        return;
+    }
+    if (audio->device != NULL) {
+        furry_audio_device_stop(audio->device);
+    }
+    atomic_store_explicit(&audio->stop, 1, memory_order_release);
+    if (audio->decode_thread_started) {
+        thrd_join(audio->decode_thread, NULL);
+    }
+    AudioStream *stream = audio->streams;
+    while (stream != NULL) {
+        AudioStream *next = stream->next;
+        free_stream(stream);
+        stream = next;
+    }
+    for (size_t i = 0; i < audio->sample_count; ++i) {
+        furry_free(audio->samples[i]->frames);
+        furry_free(audio->samples[i]);
+    }
+    furry_free(audio->samples);
+    mtx_destroy(&audio->decode_lock);
+    furry_spsc_free(&audio->commands);
+    furry_free(audio);
+}
+
+void furry_audio_update(FurryAudio *audio) {
+    if (audio == NULL) {
+        return;
+    }
+    AudioStream *retired = NULL;
+    mtx_lock(&audio->decode_lock);
+    AudioStream **link = &audio->streams;
+    while (*link != NULL) {
+        AudioStream *stream = *link;
+        if (atomic_load_explicit(&stream->retired, memory_order_acquire)) {
+            *link = stream->next;
+            stream->next = retired;
+            retired = stream;
+        } else {
+            link = &stream->next;
+        }
+    }
+    mtx_unlock(&audio->decode_lock);
+    while (retired != NULL) {
+        AudioStream *next = retired->next;
+        free_stream(retired);
+        retired = next;
+    }
+}
+
+static AudioSample *find_sample(FurryAudio *audio, const char *name) {
+    for (size_t i = 0; i < audio->sample_count; ++i) {
+        if (strcmp(audio->samples[i]->name, name) == 0) {
+            return audio->samples[i];
+        }
+    }
+    return NULL;
+}
+
+static AudioSample *load_sample(FurryAudio *audio, const char *name) {
+    AudioSample *sample = find_sample(audio, name);
+    if (sample != NULL) {
+        return sample;
+    }
+    if (audio->sample_count == audio->sample_capacity) {
+        size_t next = audio->sample_capacity == 0 ? 16 : audio->sample_capacity * 2;
+        AudioSample **resized = furry_realloc(FURRY_MEM_AUDIO, audio->samples, next * sizeof(AudioSample *));
+        if (resized == NULL) {
+            return NULL;
+        }
+        audio->samples = resized;
+        audio->sample_capacity = next;
+    }
+
+    FurryAudioDecoder decoder;
+    AudioConverter *conv = furry_alloc(FURRY_MEM_AUDIO, sizeof(AudioConverter));
+    sample = furry_calloc(FURRY_MEM_AUDIO, 1, sizeof(AudioSample));
+    if (conv == NULL || sample == NULL || open_asset(audio, name, &decoder) != FURRY_OK) {
+        furry_free(conv);
+        furry_free(sample);
+        return NULL;
+    }
+    if (converter_init(conv, &decoder, audio->config.sample_rate, 0) != FURRY_OK) {
+        if (decoder.close != NULL) {
+            decoder.close(decoder.state);
+        }
+        furry_free(conv);
+        furry_free(sample);
+        return NULL;
+    }
+    snprintf(sample->name, sizeof(sample->name), "%s", name);
+    size_t capacity = 0;
+    for (;;) {
+        if (sample->frame_count + AUDIO_BLOCK_FRAMES > capacity) {
+            size_t next = capacity == 0 ? AUDIO_BLOCK_FRAMES * 16 : capacity * 2;
+            float *resized = furry_realloc(FURRY_MEM_AUDIO, sample->frames, next * AUDIO_CHANNELS * sizeof(float));
+            if (resized == NULL) {
+                break;
+            }
+            sample->frames = resized;
+            capacity = next;
+        }
+        size_t got = converter_read(conv, sample->frames + sample->frame_count * AUDIO_CHANNELS, AUDIO_BLOCK_FRAMES);
+        sample->frame_count += got;
+        if (got < AUDIO_BLOCK_FRAMES) {
+            break;
+        }
+    }
+    converter_close(conv);
+    furry_free(conv);
+    if (sample->frame_count == 0) {
+        furry_free(sample->frames);
+        furry_free(sample);
+        return NULL;
+    }
+    audio->samples[audio->sample_count++] = sample;
+    return sample;
+}
+
+int furry_audio_preload_sfx(FurryAudio *audio, const char *name) {
+    if (audio == NULL || name == NULL) {
+        return FURRY_ERR;
+    }
+    return load_sample(audio, name) != NULL ? FURRY_OK : FURRY_ERR;
+}
+
+int furry_audio_play_music(FurryAudio *audio, const char *track, int loop) {
+    return furry_audio_play_music_at(audio, track, loop, 0);
+}
+
+int furry_audio_play_music_at(FurryAudio *audio, const char *track, int loop, size_t start_frame) {
+    if (audio == NULL || track == NULL) {
+        return FURRY_ERR;
+    }
+    furry_audio_update(audio);
+
+    FurryAudioDecoder decoder;
+    AudioStream *stream = furry_calloc(FURRY_MEM_AUDIO, 1, sizeof(AudioStream));
+    if (stream == NULL || open_asset(audio, track, &decoder) != FURRY_OK) {
+        furry_free(stream);
+        return FURRY_ERR;
+    }
+    if (converter_init(&stream->conv, &decoder, audio->config.sample_rate, loop) != FURRY_OK ||
+        furry_spsc_init(&stream->ring, FURRY_MEM_AUDIO, sizeof(float) * AUDIO_CHANNELS, audio->config.decode_ahead_frames) != FURRY_OK) {
+        if (decoder.close != NULL) {
+            decoder.close(decoder.state);
+        }
+        furry_free(stream);
+        return FURRY_ERR;
+    }
+    /* The decoder seeks in its own frames; a failed seek (or one past the end) starts the track over. */
+    if (start_frame > 0 && (decoder.seek == NULL || decoder.seek(decoder.state, (size_t)((double)start_frame * stream->conv.step)) != FURRY_OK)) {
+        start_frame = 0;
+    }
+    atomic_init(&stream->eof, 0);
+    atomic_init(&stream->retired, 0);
+
+    mtx_lock(&audio->decode_lock);
+    stream->next = audio->streams;
+    audio->streams = stream;
+    mtx_unlock(&audio->decode_lock);
+
+    AudioCommand cmd = {AUDIO_CMD_PLAY_MUSIC, FURRY_AUDIO_BUS_MUSIC, 1.0f, ms_to_frames(audio, audio->config.crossfade_ms), stream, start_frame};
+    if (push_command(audio, &cmd) != FURRY_OK) {
+        atomic_store_explicit(&stream->retired, 1, memory_order_release);
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_audio_stop_music(FurryAudio *audio, unsigned fade_ms) {
+    if (audio == NULL) {
+        return FURRY_ERR;
+    }
+    AudioCommand cmd = {AUDIO_CMD_STOP_MUSIC, FURRY_AUDIO_BUS_MUSIC, 0.0f, ms_to_frames(audio, fade_ms), NULL, 0};
+    return push_command(audio, &cmd);
+}
+
+int furry_audio_play_sfx(FurryAudio *audio, const char *name, FurryAudioBus bus, float gain) {
+    if (audio == NULL || name == NULL || bus <= FURRY_AUDIO_BUS_MUSIC || bus >= FURRY_AUDIO_BUS_COUNT) {
+        return FURRY_ERR;
+    }
+    AudioSample *sample = load_sample(audio, name);
+    if (sample == NULL) {
+        return FURRY_ERR;
+    }
+    AudioCommand cmd = {AUDIO_CMD_PLAY_SFX, (int)bus, gain, 0, sample, 0};
+    return push_command(audio, &cmd);
+}
+
+int furry_audio_set_bus_volume(FurryAudio *audio, FurryAudioBus bus, float volume, unsigned fade_ms) {
+    if (audio == NULL || bus < 0 || bus >= FURRY_AUDIO_BUS_COUNT || volume < 0.0f) {
+        return FURRY_ERR;
+    }
+    AudioCommand cmd = {AUDIO_CMD_BUS_VOLUME, (int)bus, volume, ms_to_frames(audio, fade_ms), NULL, 0};
+    return push_command(audio, &cmd);
+}
+
+size_t furry_audio_music_position(FurryAudio *audio) {
+    return audio != NULL ? atomic_load_explicit(&audio->music_position, memory_order_relaxed) : 0;
+}
+
+void furry_audio_stats(FurryAudio *audio, FurryAudioStats *out_stats) {
+    if (audio == NULL || out_stats == NULL) {
+        return;
+    }
+    memset(out_stats, 0, sizeof(*out_stats));
+    out_stats->frames_rendered = atomic_load_explicit(&audio->frames_rendered, memory_order_relaxed);
+    out_stats->underruns = atomic_load_explicit(&audio->underruns, memory_order_relaxed);
+    out_stats->voices_stolen = atomic_load_explicit(&audio->voices_stolen, memory_order_relaxed);
+    out_stats->active_voices = atomic_load_explicit(&audio->active_voices, memory_order_relaxed);
+    out_stats->commands_dropped = audio->commands_dropped;
+    mtx_lock(&audio->decode_lock);
+    for (AudioStream *stream = audio->streams; stream != NULL; stream = stream->next) {
+        if (!atomic_load_explicit(&stream->retired, memory_order_acquire)) {
+            out_stats->active_streams++;
+        }
+    }
+    mtx_unlock(&audio->decode_lock);
+}
+
+/* ---- built-in WAV decoder ---- */
+
+typedef struct WavState {
+    FILE *file;
+    unsigned channels;
+    unsigned bits;
+    int is_float;
+    long data_offset;
+    size_t frame_count;
+    size_t frame_pos;
+} WavState;
+
+static size_t wav_read(void *state, float *out_frames, size_t frame_count) {
+    WavState *wav = state;
+    size_t remaining = wav->frame_count - wav->frame_pos;
+    if (frame_count > remaining) {
+        frame_count = remaining;
+    }
+    size_t samples = frame_count * wav->channels;
+    size_t done = 0;
+    while (done < samples) {
+        unsigned char raw[1024];
+        size_t bytes_per_sample = wav->bits / 8;
+        size_t batch = sizeof(raw) / bytes_per_sample;
+        if (batch > samples - done) {
+            batch = samples - done;
+        }
+        size_t got = fread(raw, bytes_per_sample, batch, wav->file);
+        for (size_t i = 0; i < got; ++i) {
+            const unsigned char *p = raw + i * bytes_per_sample;
+            if (wav->is_float) {
+                float value;
+                memcpy(&value, p, sizeof(value));
+                out_frames[done + i] = value;
+            } else {
+                int16_t value = (int16_t)(p[0] | (p[1] << 8));
+                out_frames[done + i] = (float)value / 32768.0f;
+            }
+        }
+        done += got;
+        if (got < batch) {
+            break;
+        }
+    }
+    size_t frames = done / wav->channels;
+    wav->frame_pos += frames;
+    return frames;
+}
+
+static int wav_seek(void *state, size_t frame) {
+    WavState *wav = state;
+    if (frame > wav->frame_count ||
+        fseek(wav->file, wav->data_offset + (long)(frame * wav->channels * (wav->bits / 8)), SEEK_SET) != 0) {
+        return FURRY_ERR;
+    }
+    wav->frame_pos = frame;
+    return FURRY_OK;
+}
+
+static void wav_close(void *state) {
+    WavState *wav = state;
+    fclose(wav->file);
+    furry_free(wav);
+}
+
+int furry_audio_open_wav(const char *path, FurryAudioDecoder *out_decoder, void *user_data) {
+    (void)user_data;
+    if (path == NULL || out_decoder == NULL) {
+        return FURRY_ERR;
+    }
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    unsigned char riff[12];
+    if (fread(riff, 1, sizeof(riff), file) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        fclose(file);
+        return FURRY_ERR;
+    }
+    unsigned format = 0;
+    unsigned channels = 0;
+    unsigned sample_rate = 0;
+    unsigned bits = 0;
+    for (;;) {
+        unsigned char chunk[8];
+        if (fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk)) {
+            fclose(file);
+            return FURRY_ERR;
+        }
+        uint32_t size = (uint32_t)chunk[4] | ((uint32_t)chunk[5] << 8) | ((uint32_t)chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            unsigned char fmt[16];
+            if (fread(fmt, 1, sizeof(fmt), file) != sizeof(fmt) || fseek(file, (long)(size - 16 + (size & 1)), SEEK_CUR) != 0) {
+                fclose(file);
+                return FURRY_ERR;
+            }
+            format = fmt[0] | (fmt[1] << 8);
+            channels = fmt[2] | (fmt[3] << 8);
+            sample_rate = (unsigned)(fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((unsigned)fmt[7] << 24));
+            bits = fmt[14] | (fmt[15] << 8);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            int pcm16 = format == 1 && bits == 16;
+            int float32 = format == 3 && bits == 32;
+            WavState *wav = (pcm16 || float32) && channels >= 1 && channels <= 2 && sample_rate > 0 ? furry_calloc(FURRY_MEM_AUDIO, 1, sizeof(WavState)) : NULL;
+            if (wav == NULL) {
+                fclose(file);
+                return FURRY_ERR;
+            }
+            wav->file = file;
+            wav->channels = channels;
+            wav->bits = bits;
+            wav->is_float = float32;
+            wav->data_offset = ftell(file);
+            wav->frame_count = size / (channels * (bits / 8));
+            out_decoder->state = wav;
+            out_decoder->channels = channels;
+            out_decoder->sample_rate = sample_rate;
+            out_decoder->read = wav_read;
+            out_decoder->seek = wav_seek;
+            out_decoder->close = wav_close;
+            return FURRY_OK;
+        } else if (fseek(file, (long)(size + (size & 1)), SEEK_CUR) != 0) {
+            fclose(file);
+            return FURRY_ERR;
+        }
+    }
+}
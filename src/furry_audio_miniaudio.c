@@ -1,9 +1,108 @@
-#include "furry.h"
+#include "furry_internal.h"
+
+#include <stdlib.h>
+
+#if defined(FURRY_HAVE_MINIAUDIO)
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+#endif
 
 const char *furry_audio_backend_name(void) {
-#if defined(FURRY_ENABLE_MINIAUDIO)
+#if defined(FURRY_HAVE_MINIAUDIO)
     return "miniaudio";
 #else
     return "none";
 #endif
 }
+
+#if defined(FURRY_HAVE_MINIAUDIO)
+
+static void device_callback(ma_device *device, void *output, const void *input, ma_uint32 frame_count) {
+    (void)input;
+    furry_audio_render(device->pUserData, output, frame_count);
+}
+
+int furry_audio_device_start(FurryAudio *audio, unsigned sample_rate, void **out_device) {
+    ma_device *device = furry_alloc(FURRY_MEM_AUDIO, sizeof(ma_device));
+    if (device == NULL) {
+        return FURRY_ERR;
+    }
+    ma_device_config config = ma_device_config_init(ma_device_type_playback);
+    config.playback.format = ma_format_f32;
+    config.playback.channels = 2;
+    config.sampleRate = sample_rate;
+    config.dataCallback = device_callback;
+    config.pUserData = audio;
+    if (ma_device_init(NULL, &config, device) != MA_SUCCESS) {
+        furry_free(device);
+        return FURRY_ERR;
+    }
+    if (ma_device_start(device) != MA_SUCCESS) {
+        ma_device_uninit(device);
+        furry_free(device);
+        return FURRY_ERR;
+    }
+    *out_device = device;
+    return FURRY_OK;
+}
+
+void furry_audio_device_stop(void *device) {
+    ma_device_uninit(device);
+    furry_free(device);
+}
+
+static size_t decoder_read(void *state, float *out_frames, size_t frame_count) {
+    ma_uint64 read = 0;
+    if (ma_decoder_read_pcm_frames(state, out_frames, frame_count, &read) != MA_SUCCESS) {
+        return 0;
+    }
+    return (size_t)read;
+}
+
+static int decoder_seek(void *state, size_t frame) {
+    return ma_decoder_seek_to_pcm_frame(state, frame) == MA_SUCCESS ? FURRY_OK : FURRY_ERR;
+}
+
+static void decoder_close(void *state) {
+    ma_decoder_uninit(state);
+    furry_free(state);
+}
+
+int furry_audio_open_default(const char *path, FurryAudioDecoder *out_decoder) {
+    ma_decoder *decoder = furry_alloc(FURRY_MEM_AUDIO, sizeof(ma_decoder));
+    if (decoder == NULL) {
+        return FURRY_ERR;
+    }
+    /* Native rate; the mixer resamples. Channels are folded to stereo by miniaudio. */
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 2, 0);
+    if (ma_decoder_init_file(path, &config, decoder) != MA_SUCCESS) {
+        furry_free(decoder);
+        return FURRY_ERR;
+    }
+    out_decoder->state = decoder;
+    out_decoder->channels = decoder->outputChannels;
+    out_decoder->sample_rate = decoder->outputSampleRate;
+    out_decoder->read = decoder_read;
+    out_decoder->seek = decoder_seek;
+    out_decoder->close = decoder_close;
+    return FURRY_OK;
+}
+
+#else
+
+int furry_audio_device_start(FurryAudio *audio, unsigned sample_rate, void **out_device) {
+    (void)audio;
+    (void)sample_rate;
+    *out_device = NULL;
+    return FURRY_ERR;
+}
+
+void furry_audio_device_stop(void *device) {
+    (void)device;
+}
+
+int furry_audio_open_default(const char *path, FurryAudioDecoder *out_decoder) {
+    return furry_audio_open_wav(path, out_decoder, NULL);
+}
+
+#endif
@@ -0,0 +1,293 @@
+#include "furry_batch.h"
+#include "furry_internal.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BATCH_SEQ_BITS 28
+#define BATCH_SEQ_MASK ((1ull << BATCH_SEQ_BITS) - 1)
+
+struct FurryBatch {
+    FurryBatchResolveFn resolve;
+    void *user_data;
+    float viewport_width;
+    float viewport_height;
+
+    /* Submission order: instance data plus its sort key (layer | texture | blend | sequence). */
+    FurrySpriteInstance *pending;
+    uint64_t *keys;
+    uint64_t *scratch;
+    size_t count;
+    size_t capacity;
+
+    FurrySpriteInstance *instances;
+    size_t instance_count;
+    FurryDrawCall *draws;
+    size_t draw_count;
+    size_t draw_capacity;
+
+    size_t submitted;
+    size_t culled;
+    FurryBatchStats stats;
+};
+
+static int reserve(FurryBatch *batch, size_t capacity) {
+    if (capacity <= batch->capacity) {
+        return FURRY_OK;
+    }
+    if (capacity > BATCH_SEQ_MASK + 1) {
+        return FURRY_ERR;
+    }
+    FurrySpriteInstance *pending = furry_realloc(FURRY_MEM_RENDER, batch->pending, sizeof(FurrySpriteInstance) * capacity);
+    if (pending == NULL) {
+        return FURRY_ERR;
+    }
+    batch->pending = pending;
+    FurrySpriteInstance *instances = furry_realloc(FURRY_MEM_RENDER, batch->instances, sizeof(FurrySpriteInstance) * capacity);
+    if (instances == NULL) {
+        return FURRY_ERR;
+    }
+    batch->instances = instances;
+    uint64_t *keys = furry_realloc(FURRY_MEM_RENDER, batch->keys, sizeof(uint64_t) * capacity);
+    if (keys == NULL) {
+        return FURRY_ERR;
+    }
+    batch->keys = keys;
+    uint64_t *scratch = furry_realloc(FURRY_MEM_RENDER, batch->scratch, sizeof(uint64_t) * capacity);
+    if (scratch == NULL) {
+        return FURRY_ERR;
+    }
+    batch->scratch = scratch;
+    batch->capacity = capacity;
+    return FURRY_OK;
+}
+
+int furry_batch_create(const FurryBatchConfig *config, FurryBatch **out_batch) {
+    if (out_batch == NULL) {
+        return FURRY_ERR;
+    }
+    *out_batch = NULL;
+    FurryBatch *batch = furry_calloc(FURRY_MEM_RENDER, 1, sizeof(FurryBatch));
+    if (batch == NULL) {
+        return FURRY_ERR;
+    }
+    size_t hint = config != NULL && config->capacity_hint > 0 ? config->capacity_hint : 256;
+    if (reserve(batch, hint) != FURRY_OK) {
+        furry_batch_destroy(batch);
+        return FURRY_ERR;
+    }
+    if (config != NULL) {
+        batch->resolve = config->resolve;
+        batch->user_data = config->user_data;
+    }
+    *out_batch = batch;
+    return FURRY_OK;
+}
+
+void furry_batch_destroy(FurryBatch *batch) {
+    if (batch == NULL) {
+        return;
+    }
+    furry_free(batch->pending);
+    furry_free(batch->keys);
+    furry_free(batch->scratch);
+    furry_free(batch->instances);
+    furry_free(batch->draws);
+    furry_free(batch);
+}
+
+void furry_batch_begin(FurryBatch *batch, float viewport_width, float viewport_height) {
+    if (batch == NULL) {
+        return;
+    }
+    batch->viewport_width = viewport_width;
+    batch->viewport_height = viewport_height;
+    batch->count = 0;
+    batch->submitted = 0;
+    batch->culled = 0;
+}
+
+int furry_batch_add(FurryBatch *batch, const FurrySprite *sprite) {
+    if (batch == NULL || sprite == NULL || sprite->layer < 0 || sprite->layer > FURRY_BATCH_MAX_LAYER ||
+        sprite->texture > FURRY_BATCH_MAX_TEXTURE || (unsigned)sprite->blend > FURRY_BLEND_ADDITIVE) {
+        return FURRY_ERR;
+    }
+    batch->submitted++;
+    float radians = sprite->rotation_deg * 3.14159265358979f / 180.0f;
+    float c = cosf(radians);
+    float s = sinf(radians);
+    float t[6] = {c * sprite->w, -s * sprite->h, s * sprite->w, c * sprite->h, 0.0f, 0.0f};
+    t[4] = sprite->x - (t[0] * sprite->pivot_x + t[1] * sprite->pivot_y);
+    t[5] = sprite->y - (t[2] * sprite->pivot_x + t[3] * sprite->pivot_y);
+    float min_x = t[4] + (t[0] < 0.0f ? t[0] : 0.0f) + (t[1] < 0.0f ? t[1] : 0.0f);
+    float max_x = t[4] + (t[0] > 0.0f ? t[0] : 0.0f) + (t[1] > 0.0f ? t[1] : 0.0f);
+    float min_y = t[5] + (t[2] < 0.0f ? t[2] : 0.0f) + (t[3] < 0.0f ? t[3] : 0.0f);
+    float max_y = t[5] + (t[2] > 0.0f ? t[2] : 0.0f) + (t[3] > 0.0f ? t[3] : 0.0f);
+    if (max_x <= 0.0f || max_y <= 0.0f || min_x >= batch->viewport_width || min_y >= batch->viewport_height || (sprite->tint & 0xffu) == 0) {
+        batch->culled++;
+        return FURRY_OK;
+    }
+    if (batch->count == batch->capacity && reserve(batch, batch->capacity * 2) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    FurrySpriteInstance *instance = &batch->pending[batch->count];
+    memcpy(instance->transform, t, sizeof(t));
+    memcpy(instance->uv, sprite->uv, sizeof(instance->uv));
+    instance->tint = sprite->tint;
+    batch->keys[batch->count] = ((uint64_t)sprite->layer << 56) | ((uint64_t)sprite->texture << 32) | ((uint64_t)sprite->blend << BATCH_SEQ_BITS) |
+                                (uint64_t)batch->count;
+    batch->count++;
+    return FURRY_OK;
+}
+
+/* LSD radix sort on bytes; passes where every key shares the byte are skipped, which is most of them. */
+static void sort_keys(FurryBatch *batch) {
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < batch->count; ++i) {
+        uint64_t key = batch->keys[i];
+        for (int pass = 0; pass < 8; ++pass) {
+            counts[pass][(key >> (pass * 8)) & 0xffu]++;
+        }
+    }
+    uint64_t *src = batch->keys;
+    uint64_t *dst = batch->scratch;
+    for (int pass = 0; pass < 8; ++pass) {
+        size_t *count = counts[pass];
+        if (count[(src[0] >> (pass * 8)) & 0xffu] == batch->count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int b = 0; b < 256; ++b) {
+            size_t n = count[b];
+            count[b] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < batch->count; ++i) {
+            dst[count[(src[i] >> (pass * 8)) & 0xffu]++] = src[i];
+        }
+        uint64_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    batch->keys = src;
+    batch->scratch = dst;
+}
+
+static int push_draw(FurryBatch *batch, unsigned texture, FurryBlendMode blend, size_t first) {
+    if (batch->draw_count == batch->draw_capacity) {
+        size_t capacity = batch->draw_capacity == 0 ? 32 : batch->draw_capacity * 2;
+        FurryDrawCall *draws = furry_realloc(FURRY_MEM_RENDER, batch->draws, sizeof(FurryDrawCall) * capacity);
+        if (draws == NULL) {
+            return FURRY_ERR;
+        }
+        batch->draws = draws;
+        batch->draw_capacity = capacity;
+    }
+    FurryDrawCall *draw = &batch->draws[batch->draw_count++];
+    draw->texture = texture;
+    draw->blend = blend;
+    draw->first_instance = first;
+    draw->instance_count = 0;
+    return FURRY_OK;
+}
+
+int furry_batch_end(FurryBatch *batch) {
+    if (batch == NULL) {
+        return FURRY_ERR;
+    }
+    memset(&batch->stats, 0, sizeof(batch->stats));
+    batch->stats.submitted = batch->submitted;
+    batch->stats.culled = batch->culled;
+    batch->draw_count = 0;
+    batch->instance_count = 0;
+    if (batch->count == 0) {
+        return FURRY_OK;
+    }
+    sort_keys(batch);
+    for (size_t i = 0; i < batch->count; ++i) {
+        uint64_t key = batch->keys[i];
+        unsigned texture = (unsigned)((key >> 32) & FURRY_BATCH_MAX_TEXTURE);
+        FurryBlendMode blend = (FurryBlendMode)((key >> BATCH_SEQ_BITS) & 0xfu);
+        FurryDrawCall *last = batch->draw_count > 0 ? &batch->draws[batch->draw_count - 1] : NULL;
+        if (last == NULL || last->texture != texture || last->blend != blend) {
+            if (last != NULL) {
+                batch->stats.texture_changes += last->texture != texture;
+                batch->stats.blend_changes += last->blend != blend;
+            }
+            if (push_draw(batch, texture, blend, i) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+        }
+        batch->draws[batch->draw_count - 1].instance_count++;
+        batch->instances[i] = batch->pending[key & BATCH_SEQ_MASK];
+    }
+    batch->instance_count = batch->count;
+    batch->stats.draws = batch->draw_count;
+    return FURRY_OK;
+}
+
+const FurrySpriteInstance *furry_batch_instances(const FurryBatch *batch, size_t *out_count) {
+    if (batch == NULL) {
+        return NULL;
+    }
+    if (out_count != NULL) {
+        *out_count = batch->instance_count;
+    }
+    return batch->instances;
+}
+
+const FurryDrawCall *furry_batch_draws(const FurryBatch *batch, size_t *out_count) {
+    if (batch == NULL) {
+        return NULL;
+    }
+    if (out_count != NULL) {
+        *out_count = batch->draw_count;
+    }
+    return batch->draws;
+}
+
+void furry_batch_stats(const FurryBatch *batch, FurryBatchStats *out_stats) {
+    if (batch != NULL && out_stats != NULL) {
+        *out_stats = batch->stats;
+    }
+}
+
+int furry_batch_host_command(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)snapshot;
+    FurryBatch *batch = user_data;
+    if (batch == NULL || ins == NULL) {
+        return FURRY_ERR;
+    }
+    if ((op != FURRY_OP_BG && op != FURRY_OP_FG) || batch->resolve == NULL) {
+        return FURRY_OK;
+    }
+    FurryBatchTexture texture;
+    if (batch->resolve(ins->a, &texture, batch->user_data) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    FurrySprite sprite;
+    memset(&sprite, 0, sizeof(sprite));
+    sprite.texture = texture.texture;
+    memcpy(sprite.uv, texture.uv, sizeof(sprite.uv));
+    sprite.tint = 0xffffffffu;
+    if (op == FURRY_OP_BG) {
+        sprite.layer = FURRY_BATCH_LAYER_BG;
+        sprite.blend = FURRY_BLEND_OPAQUE;
+        sprite.w = batch->viewport_width;
+        sprite.h = batch->viewport_height;
+    } else {
+        sprite.layer = FURRY_BATCH_LAYER_FG;
+        sprite.blend = FURRY_BLEND_ALPHA;
+        sprite.x = strtof(ins->b, NULL) * batch->viewport_width;
+        sprite.y = strtof(ins->c, NULL) * batch->viewport_height;
+        sprite.w = texture.width;
+        sprite.h = texture.height;
+        sprite.pivot_x = 0.5f;
+        sprite.pivot_y = 1.0f;
+        sprite.rotation_deg = strtof(ins->choices[0].text, NULL);
+    }
+    return furry_batch_add(batch, &sprite);
+}
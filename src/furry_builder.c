@@ -0,0 +1,306 @@
+#include "furry_builder.h"
+#include "furry_internal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct FurryProgramBuilder {
+    FurryProgram program;
+    /* Reused for every emit; an instruction is too large for the caller's stack on small threads. */
+    FurryInstruction ins;
+    int emitted;
+    int failed;
+    FurryCompileError error;
+};
+
+int furry_builder_create(FurryProgramBuilder **out_builder) {
+    if (out_builder == NULL) {
+        return FURRY_ERR;
+    }
+    *out_builder = furry_calloc(FURRY_MEM_COMPILER, 1, sizeof(FurryProgramBuilder));
+    return *out_builder != NULL ? FURRY_OK : FURRY_ERR;
+}
+
+void furry_builder_destroy(FurryProgramBuilder *builder) {
+    if (builder == NULL) {
+        return;
+    }
+    furry_free_program(&builder->program);
+    furry_free(builder);
+}
+
+static void reset(FurryProgramBuilder *builder) {
+    furry_free_program(&builder->program);
+    builder->emitted = 0;
+    builder->failed = 0;
+    memset(&builder->error, 0, sizeof(builder->error));
+}
+
+const FurryCompileError *furry_builder_error(const FurryProgramBuilder *builder) {
+    return builder != NULL && builder->failed ? &builder->error : NULL;
+}
+
+int furry_builder_finish(FurryProgramBuilder *builder, FurryProgram *out_program, FurryCompileError *out_error) {
+    if (builder == NULL || out_program == NULL) {
+        return FURRY_ERR;
+    }
+    memset(out_program, 0, sizeof(*out_program));
+    int rc = FURRY_ERR;
+    if (builder->failed) {
+        if (out_error != NULL) {
+            *out_error = builder->error;
+        }
+    } else if (furry_validate_program(&builder->program, out_error) == FURRY_OK) {
+        *out_program = builder->program;
+        memset(&builder->program, 0, sizeof(builder->program));
+        rc = FURRY_OK;
+    }
+    reset(builder);
+    return rc;
+}
+
+static int fail(FurryProgramBuilder *builder, const char *message) {
+    builder->failed = 1;
+    builder->error.line = builder->emitted;
+    snprintf(builder->error.message, sizeof(builder->error.message), "%s", message);
+    return FURRY_ERR;
+}
+
+/* Starts an instruction; NULL once the builder has failed. */
+static FurryInstruction *begin(FurryProgramBuilder *builder, FurryOpCode op) {
+    if (builder == NULL || builder->failed) {
+        return NULL;
+    }
+    builder->emitted++;
+    memset(&builder->ins, 0, sizeof(builder->ins));
+    builder->ins.op = op;
+    return &builder->ins;
+}
+
+static int copy_arg(FurryProgramBuilder *builder, char *dst, size_t dst_size, const char *src) {
+    if (src == NULL) {
+        return fail(builder, "missing argument");
+    }
+    size_t n = strlen(src);
+    if (n >= dst_size) {
+        return fail(builder, "argument too long");
+    }
+    memcpy(dst, src, n + 1);
+    return FURRY_OK;
+}
+
+static int copy_number(FurryProgramBuilder *builder, char *dst, size_t dst_size, double value) {
+    int n = snprintf(dst, dst_size, "%g", value);
+    return n < 0 || (size_t)n >= dst_size ? fail(builder, "argument too long") : FURRY_OK;
+}
+
+static int commit(FurryProgramBuilder *builder) {
+    char err[FURRY_MAX_ERROR_TEXT];
+    FurryInstruction *ins = &builder->ins;
+    if (furry_compile_instruction(&builder->program, ins, err, sizeof(err)) == FURRY_OK) {
+        return FURRY_OK;
+    }
+    if (err[0] == '\0') {
+        int media = ins->op == FURRY_OP_UI_IMAGE || ins->op == FURRY_OP_UI_ANIM || ins->op == FURRY_OP_UI_VIDEO;
+        snprintf(err, sizeof(err), "%s", media ? "unsupported media extension" : "out of memory");
+    }
+    return fail(builder, err);
+}
+
+static int emit_a(FurryProgramBuilder *builder, FurryOpCode op, const char *a) {
+    FurryInstruction *ins = begin(builder, op);
+    if (ins == NULL || copy_arg(builder, ins->a, sizeof(ins->a), a) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return commit(builder);
+}
+
+static int emit_ab(FurryProgramBuilder *builder, FurryOpCode op, const char *a, const char *b) {
+    FurryInstruction *ins = begin(builder, op);
+    if (ins == NULL || copy_arg(builder, ins->a, sizeof(ins->a), a) != FURRY_OK || copy_arg(builder, ins->b, sizeof(ins->b), b) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return commit(builder);
+}
+
+static int emit_abc(FurryProgramBuilder *builder, FurryOpCode op, const char *a, const char *b, const char *c) {
+    FurryInstruction *ins = begin(builder, op);
+    if (ins == NULL || copy_arg(builder, ins->a, sizeof(ins->a), a) != FURRY_OK || copy_arg(builder, ins->b, sizeof(ins->b), b) != FURRY_OK ||
+        copy_arg(builder, ins->c, sizeof(ins->c), c) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return commit(builder);
+}
+
+static int emit_none(FurryProgramBuilder *builder, FurryOpCode op) {
+    return begin(builder, op) != NULL ? commit(builder) : FURRY_ERR;
+}
+
+int furry_emit_label(FurryProgramBuilder *builder, const char *name) {
+    return emit_a(builder, FURRY_OP_LABEL, name);
+}
+
+int furry_emit_say(FurryProgramBuilder *builder, const char *speaker, const char *text) {
+    return emit_ab(builder, FURRY_OP_SAY, speaker, text);
+}
+
+int furry_emit_goto(FurryProgramBuilder *builder, const char *label) {
+    return emit_a(builder, FURRY_OP_GOTO, label);
+}
+
+int furry_emit_call(FurryProgramBuilder *builder, const char *label) {
+    return emit_a(builder, FURRY_OP_CALL, label);
+}
+
+int furry_emit_return(FurryProgramBuilder *builder) {
+    return emit_none(builder, FURRY_OP_RETURN);
+}
+
+int furry_emit_set(FurryProgramBuilder *builder, const char *key, const char *value) {
+    return emit_ab(builder, FURRY_OP_SET, key, value);
+}
+
+int furry_emit_set_expr(FurryProgramBuilder *builder, const char *key, const char *expr) {
+    return emit_ab(builder, FURRY_OP_SET_EXPR, key, expr);
+}
+
+int furry_emit_add(FurryProgramBuilder *builder, const char *key, int amount) {
+    FurryInstruction *ins = begin(builder, FURRY_OP_ADD);
+    if (ins == NULL || copy_arg(builder, ins->a, sizeof(ins->a), key) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    ins->i = amount;
+    return commit(builder);
+}
+
+int furry_emit_if_eq(FurryProgramBuilder *builder, const char *key, const char *value, const char *label) {
+    return emit_abc(builder, FURRY_OP_IF_EQ, key, value, label);
+}
+
+int furry_emit_if(FurryProgramBuilder *builder, const char *expr, const char *label) {
+    FurryInstruction *ins = begin(builder, FURRY_OP_IF);
+    if (ins == NULL || copy_arg(builder, ins->b, sizeof(ins->b), expr) != FURRY_OK || copy_arg(builder, ins->c, sizeof(ins->c), label) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return commit(builder);
+}
+
+int furry_emit_choice(FurryProgramBuilder *builder, const char *prompt, const FurryBuilderOption *options, size_t count) {
+    FurryInstruction *ins = begin(builder, FURRY_OP_CHOICE);
+    if (ins == NULL || copy_arg(builder, ins->a, sizeof(ins->a), prompt) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    if (options == NULL || count == 0 || count > FURRY_MAX_CHOICES) {
+        return fail(builder, "choice needs 1 to FURRY_MAX_CHOICES options");
+    }
+    for (size_t c = 0; c < count; ++c) {
+        if (copy_arg(builder, ins->choices[c].text, sizeof(ins->choices[c].text), options[c].text) != FURRY_OK ||
+            copy_arg(builder, ins->choices[c].target, sizeof(ins->choices[c].target), options[c].target) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    ins->choice_count = count;
+    return commit(builder);
+}
+
+int furry_emit_save(FurryProgramBuilder *builder, const char *slot) {
+    return emit_a(builder, FURRY_OP_SAVE, slot);
+}
+
+int furry_emit_load(FurryProgramBuilder *builder, const char *slot) {
+    return emit_a(builder, FURRY_OP_LOAD, slot);
+}
+
+int furry_emit_end(FurryProgramBuilder *builder) {
+    return emit_none(builder, FURRY_OP_END);
+}
+
+int furry_emit_spawn(FurryProgramBuilder *builder, const char *label) {
+    return emit_a(builder, FURRY_OP_SPAWN, label);
+}
+
+int furry_emit_wait(FurryProgramBuilder *builder, int ms) {
+    FurryInstruction *ins = begin(builder, FURRY_OP_WAIT);
+    if (ins == NULL) {
+        return FURRY_ERR;
+    }
+    if (ms < 0) {
+        return fail(builder, "wait needs a non-negative time");
+    }
+    ins->i = ms;
+    return commit(builder);
+}
+
+int furry_emit_wait_event(FurryProgramBuilder *builder, const char *event) {
+    return emit_a(builder, FURRY_OP_WAIT_EVENT, event);
+}
+
+int furry_emit_signal(FurryProgramBuilder *builder, const char *event) {
+    return emit_a(builder, FURRY_OP_SIGNAL, event);
+}
+
+int furry_emit_bg(FurryProgramBuilder *builder, const char *asset) {
+    return emit_a(builder, FURRY_OP_BG, asset);
+}
+
+int furry_emit_fg(FurryProgramBuilder *builder, const char *asset, double x, double y, double rotation, const char *animation) {
+    FurryInstruction *ins = begin(builder, FURRY_OP_FG);
+    if (ins == NULL || copy_arg(builder, ins->a, sizeof(ins->a), asset) != FURRY_OK || copy_number(builder, ins->b, sizeof(ins->b), x) != FURRY_OK ||
+        copy_number(builder, ins->c, sizeof(ins->c), y) != FURRY_OK ||
+        copy_number(builder, ins->choices[0].text, sizeof(ins->choices[0].text), rotation) != FURRY_OK ||
+        copy_arg(builder, ins->choices[0].target, sizeof(ins->choices[0].target), animation) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return commit(builder);
+}
+
+int furry_emit_music(FurryProgramBuilder *builder, const char *asset) {
+    return emit_a(builder, FURRY_OP_MUSIC, asset);
+}
+
+int furry_emit_sfx(FurryProgramBuilder *builder, const char *asset) {
+    return emit_a(builder, FURRY_OP_SFX, asset);
+}
+
+int furry_emit_ui_begin(FurryProgramBuilder *builder, const char *layer) {
+    return emit_a(builder, FURRY_OP_UI_BEGIN, layer);
+}
+
+int furry_emit_ui_end(FurryProgramBuilder *builder) {
+    return emit_none(builder, FURRY_OP_UI_END);
+}
+
+int furry_emit_ui_panel(FurryProgramBuilder *builder, const char *id, double x, double y, double w, double h) {
+    FurryInstruction *ins = begin(builder, FURRY_OP_UI_PANEL);
+    if (ins == NULL || copy_arg(builder, ins->a, sizeof(ins->a), id) != FURRY_OK || copy_number(builder, ins->b, sizeof(ins->b), x) != FURRY_OK ||
+        copy_number(builder, ins->c, sizeof(ins->c), y) != FURRY_OK ||
+        copy_number(builder, ins->choices[0].text, sizeof(ins->choices[0].text), w) != FURRY_OK ||
+        copy_number(builder, ins->choices[0].target, sizeof(ins->choices[0].target), h) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return commit(builder);
+}
+
+int furry_emit_ui_text(FurryProgramBuilder *builder, const char *id, const char *text) {
+    return emit_ab(builder, FURRY_OP_UI_TEXT, id, text);
+}
+
+int furry_emit_ui_image(FurryProgramBuilder *builder, const char *id, const char *asset) {
+    return emit_ab(builder, FURRY_OP_UI_IMAGE, id, asset);
+}
+
+int furry_emit_ui_anim(FurryProgramBuilder *builder, const char *id, const char *asset, const char *play_mode) {
+    return emit_abc(builder, FURRY_OP_UI_ANIM, id, asset, play_mode);
+}
+
+int furry_emit_ui_video(FurryProgramBuilder *builder, const char *id, const char *asset, int loop) {
+    return emit_abc(builder, FURRY_OP_UI_VIDEO, id, asset, loop ? "1" : "0");
+}
+
+int furry_emit_ui_bind(FurryProgramBuilder *builder, const char *id, const char *key) {
+    return emit_ab(builder, FURRY_OP_UI_BIND, id, key);
+}
+
+int furry_emit_button(FurryProgramBuilder *builder, const char *id, const char *label, const char *target) {
+    return emit_abc(builder, FURRY_OP_BUTTON, id, label, target);
+}
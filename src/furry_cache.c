@@ -0,0 +1,429 @@
+#include "furry_cache.h"
+#include "furry_internal.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CACHE_MAGIC "FYCC"
+#define CACHE_VERSION 2u
+#define CACHE_SUFFIX ".fyc"
+#define CACHE_DEFAULT_MAX_BYTES (64u * 1024u * 1024u)
+/* Temporaries this old belong to a process that died mid-write. */
+#define CACHE_STALE_TEMP_SECONDS 3600
+
+typedef struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t source_size;
+    uint32_t source_crc;
+    uint32_t payload_crc;
+    uint64_t payload_size;
+} CacheHeader;
+
+struct FurryCompileCache {
+    char *dir;
+    size_t max_bytes;
+    atomic_size_t hits;
+    atomic_size_t misses;
+    atomic_size_t stores;
+    atomic_size_t evictions;
+    atomic_uint temp_counter;
+};
+
+typedef struct ByteBuffer {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    int failed;
+} ByteBuffer;
+
+typedef struct ByteReader {
+    const unsigned char *data;
+    size_t size;
+    size_t pos;
+    int failed;
+} ByteReader;
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/* Anything that changes what the compiler produces, or how it is stored, is part of the key. */
+static uint64_t cache_key(const char *script, size_t size) {
+    const uint32_t layout[] = {CACHE_VERSION, (uint32_t)sizeof(FurryInstruction), (uint32_t)sizeof(FurryExprOp), FURRY_MAX_TEXT,
+                               FURRY_MAX_LABEL, FURRY_MAX_KEY, FURRY_MAX_CHOICES, FURRY_MAX_VARS, FURRY_OP_END};
+    const char *version = furry_version();
+    uint64_t hash = 14695981039346656037ull;
+    hash = hash_bytes(hash, version, strlen(version) + 1);
+    hash = hash_bytes(hash, layout, sizeof(layout));
+    return hash_bytes(hash, script, size);
+}
+
+static void put_bytes(ByteBuffer *buf, const void *data, size_t size) {
+    if (buf->failed || size == 0) {
+        return;
+    }
+    if (buf->size + size > buf->capacity) {
+        size_t capacity = buf->capacity == 0 ? 4096 : buf->capacity;
+        while (capacity < buf->size + size) {
+            capacity *= 2;
+        }
+        unsigned char *grown = furry_realloc(FURRY_MEM_COMPILER, buf->data, capacity);
+        if (grown == NULL) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->size, data, size);
+    buf->size += size;
+}
+
+static void put_u32(ByteBuffer *buf, uint32_t value) {
+    unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+    put_bytes(buf, bytes, sizeof(bytes));
+}
+
+static void put_str(ByteBuffer *buf, const char *text) {
+    size_t size = strlen(text);
+    put_u32(buf, (uint32_t)size);
+    put_bytes(buf, text, size);
+}
+
+static uint32_t get_u32(ByteReader *in) {
+    if (in->failed || in->size - in->pos < 4) {
+        in->failed = 1;
+        return 0;
+    }
+    const unsigned char *p = in->data + in->pos;
+    in->pos += 4;
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void get_bytes(ByteReader *in, void *out, size_t size) {
+    if (in->failed || in->size - in->pos < size) {
+        in->failed = 1;
+        return;
+    }
+    memcpy(out, in->data + in->pos, size);
+    in->pos += size;
+}
+
+static void get_str(ByteReader *in, char *out, size_t out_size) {
+    uint32_t size = get_u32(in);
+    if (size >= out_size) {
+        in->failed = 1;
+        return;
+    }
+    get_bytes(in, out, size);
+    out[in->failed ? 0 : size] = '\0';
+}
+
+/* Strings are stored by length rather than as fixed arrays, so an entry is a few percent of the in-memory program. */
+static void encode_program(ByteBuffer *buf, const FurryProgram *program) {
+    put_u32(buf, (uint32_t)program->count);
+    for (size_t n = 0; n < program->count; ++n) {
+        const FurryInstruction *ins = &program->code[n];
+        put_u32(buf, (uint32_t)ins->op);
+        put_u32(buf, (uint32_t)ins->i);
+        put_u32(buf, (uint32_t)ins->target);
+        put_u32(buf, (uint32_t)ins->slot);
+        put_u32(buf, ins->name_id);
+        put_u32(buf, ins->text_id);
+        put_str(buf, ins->a);
+        put_str(buf, ins->b);
+        put_str(buf, ins->c);
+        /* fg and ui_panel keep extra arguments in choices[0] without a choice count. */
+        size_t stored_choices = ins->choice_count > 0 ? ins->choice_count : 1;
+        put_u32(buf, (uint32_t)ins->choice_count);
+        for (size_t c = 0; c < stored_choices; ++c) {
+            put_str(buf, ins->choices[c].text);
+            put_str(buf, ins->choices[c].target);
+            put_u32(buf, (uint32_t)ins->choices[c].target_index);
+            put_u32(buf, ins->choices[c].text_id);
+        }
+    }
+    put_u32(buf, (uint32_t)program->expr_count);
+    for (size_t n = 0; n < program->expr_count; ++n) {
+        put_bytes(buf, &program->expr_code[n].op, 1);
+        put_u32(buf, (uint32_t)program->expr_code[n].arg);
+    }
+    put_u32(buf, (uint32_t)program->expr_strings_size);
+    put_bytes(buf, program->expr_strings, program->expr_strings_size);
+    put_u32(buf, (uint32_t)program->var_name_count);
+    for (size_t n = 0; n < program->var_name_count; ++n) {
+        put_str(buf, program->var_names[n]);
+    }
+}
+
+static int decode_program(ByteReader *in, FurryProgram *out_program) {
+    memset(out_program, 0, sizeof(*out_program));
+    size_t count = get_u32(in);
+    if (in->failed || count > in->size / 32) {
+        return FURRY_ERR;
+    }
+    out_program->code = furry_calloc(FURRY_MEM_COMPILER, count > 0 ? count : 1, sizeof(FurryInstruction));
+    if (out_program->code == NULL) {
+        return FURRY_ERR;
+    }
+    out_program->count = count;
+    for (size_t n = 0; n < count && !in->failed; ++n) {
+        FurryInstruction *ins = &out_program->code[n];
+        ins->op = (FurryOpCode)get_u32(in);
+        ins->i = (int)get_u32(in);
+        ins->target = (int)get_u32(in);
+        ins->slot = (int)get_u32(in);
+        ins->name_id = get_u32(in);
+        ins->text_id = get_u32(in);
+        get_str(in, ins->a, sizeof(ins->a));
+        get_str(in, ins->b, sizeof(ins->b));
+        get_str(in, ins->c, sizeof(ins->c));
+        ins->choice_count = get_u32(in);
+        if (ins->choice_count > FURRY_MAX_CHOICES) {
+            in->failed = 1;
+            break;
+        }
+        size_t stored_choices = ins->choice_count > 0 ? ins->choice_count : 1;
+        for (size_t c = 0; c < stored_choices; ++c) {
+            get_str(in, ins->choices[c].text, sizeof(ins->choices[c].text));
+            get_str(in, ins->choices[c].target, sizeof(ins->choices[c].target));
+            ins->choices[c].target_index = (int)get_u32(in);
+            ins->choices[c].text_id = get_u32(in);
+        }
+    }
+
+    size_t expr_count = get_u32(in);
+    if (!in->failed && expr_count > 0) {
+        out_program->expr_code = furry_alloc(FURRY_MEM_COMPILER, expr_count * sizeof(FurryExprOp));
+        in->failed = out_program->expr_code == NULL || expr_count > in->size;
+        out_program->expr_count = in->failed ? 0 : expr_count;
+        for (size_t n = 0; n < out_program->expr_count && !in->failed; ++n) {
+            get_bytes(in, &out_program->expr_code[n].op, 1);
+            out_program->expr_code[n].arg = (int)get_u32(in);
+        }
+    }
+    size_t strings_size = get_u32(in);
+    if (!in->failed && strings_size > 0) {
+        out_program->expr_strings = strings_size <= in->size ? furry_alloc(FURRY_MEM_COMPILER, strings_size) : NULL;
+        in->failed = out_program->expr_strings == NULL;
+        out_program->expr_strings_size = in->failed ? 0 : strings_size;
+        get_bytes(in, out_program->expr_strings, out_program->expr_strings_size);
+    }
+    size_t var_count = get_u32(in);
+    if (!in->failed && var_count > 0) {
+        out_program->var_names = var_count <= in->size ? furry_alloc(FURRY_MEM_COMPILER, var_count * sizeof(*out_program->var_names)) : NULL;
+        in->failed = out_program->var_names == NULL;
+        out_program->var_name_count = in->failed ? 0 : var_count;
+        for (size_t n = 0; n < out_program->var_name_count; ++n) {
+            get_str(in, out_program->var_names[n], sizeof(out_program->var_names[n]));
+        }
+    }
+    if (in->failed || in->pos != in->size) {
+        furry_free_program(out_program);
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_compile_cache_open(const char *dir, const FurryCompileCacheConfig *config, FurryCompileCache **out_cache) {
+    if (dir == NULL || out_cache == NULL) {
+        return FURRY_ERR;
+    }
+    *out_cache = NULL;
+    if (furry_dir_create(dir) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    FurryCompileCache *cache = furry_calloc(FURRY_MEM_COMPILER, 1, sizeof(FurryCompileCache));
+    if (cache == NULL) {
+        return FURRY_ERR;
+    }
+    cache->dir = furry_alloc(FURRY_MEM_COMPILER, strlen(dir) + 1);
+    if (cache->dir == NULL) {
+        furry_free(cache);
+        return FURRY_ERR;
+    }
+    strcpy(cache->dir, dir);
+    cache->max_bytes = config != NULL && config->max_bytes > 0 ? config->max_bytes : CACHE_DEFAULT_MAX_BYTES;
+    *out_cache = cache;
+    return FURRY_OK;
+}
+
+void furry_compile_cache_close(FurryCompileCache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    furry_free(cache->dir);
+    furry_free(cache);
+}
+
+static int load_entry(const char *path, uint64_t key, size_t size, uint32_t crc, FurryProgram *out_program) {
+    FurryMappedFile file;
+    if (furry_map_file(path, &file) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    CacheHeader header;
+    int rc = FURRY_ERR;
+    if (file.size >= sizeof(header)) {
+        memcpy(&header, file.data, sizeof(header));
+        ByteReader in = {file.data + sizeof(header), file.size - sizeof(header), 0, 0};
+        if (memcmp(header.magic, CACHE_MAGIC, 4) == 0 && header.version == CACHE_VERSION && header.key == key &&
+            header.source_size == size && header.source_crc == crc && header.payload_size == in.size &&
+            furry_crc32(0, in.data, in.size) == header.payload_crc) {
+            rc = decode_program(&in, out_program);
+        }
+    }
+    furry_unmap_file(&file);
+    return rc;
+}
+
+typedef struct CacheFile {
+    char name[64];
+    size_t size;
+    long long mtime;
+} CacheFile;
+
+typedef struct CacheListing {
+    CacheFile *files;
+    size_t count;
+    size_t capacity;
+    size_t total;
+    const char *dir;
+    long long now;
+} CacheListing;
+
+static int has_suffix(const char *name, const char *suffix) {
+    size_t n = strlen(name);
+    size_t s = strlen(suffix);
+    return n >= s && strcmp(name + n - s, suffix) == 0;
+}
+
+static void collect_file(const char *name, size_t size, long long mtime, void *user_data) {
+    CacheListing *listing = user_data;
+    char path[1024];
+    if (has_suffix(name, ".tmp") && listing->now - mtime > CACHE_STALE_TEMP_SECONDS &&
+        snprintf(path, sizeof(path), "%s/%s", listing->dir, name) < (int)sizeof(path)) {
+        remove(path);
+        return;
+    }
+    if (!has_suffix(name, CACHE_SUFFIX) || strlen(name) >= sizeof(listing->files[0].name)) {
+        return;
+    }
+    if (listing->count == listing->capacity) {
+        size_t capacity = listing->capacity == 0 ? 64 : listing->capacity * 2;
+        CacheFile *files = furry_realloc(FURRY_MEM_COMPILER, listing->files, capacity * sizeof(CacheFile));
+        if (files == NULL) {
+            return;
+        }
+        listing->files = files;
+        listing->capacity = capacity;
+    }
+    CacheFile *file = &listing->files[listing->count++];
+    strcpy(file->name, name);
+    file->size = size;
+    file->mtime = mtime;
+    listing->total += size;
+}
+
+static int compare_mtime(const void *lhs, const void *rhs) {
+    const CacheFile *a = lhs;
+    const CacheFile *b = rhs;
+    return (a->mtime > b->mtime) - (a->mtime < b->mtime);
+}
+
+/* Deletes least recently used entries until the directory fits max_bytes. */
+static void evict(FurryCompileCache *cache) {
+    CacheListing listing = {NULL, 0, 0, 0, cache->dir, (long long)time(NULL)};
+    if (furry_dir_list(cache->dir, collect_file, &listing) != FURRY_OK || listing.total <= cache->max_bytes) {
+        furry_free(listing.files);
+        return;
+    }
+    qsort(listing.files, listing.count, sizeof(CacheFile), compare_mtime);
+    for (size_t i = 0; i < listing.count && listing.total > cache->max_bytes; ++i) {
+        char path[1024];
+        if (snprintf(path, sizeof(path), "%s/%s", cache->dir, listing.files[i].name) < (int)sizeof(path) && remove(path) == 0) {
+            listing.total -= listing.files[i].size;
+            atomic_fetch_add_explicit(&cache->evictions, 1, memory_order_relaxed);
+        }
+    }
+    furry_free(listing.files);
+}
+
+static void store_entry(FurryCompileCache *cache, const char *path, uint64_t key, size_t size, uint32_t crc, const FurryProgram *program) {
+    ByteBuffer buf = {NULL, 0, 0, 0};
+    encode_program(&buf, program);
+    char temp_path[1024];
+    unsigned counter = atomic_fetch_add_explicit(&cache->temp_counter, 1, memory_order_relaxed);
+    int written = snprintf(temp_path, sizeof(temp_path), "%s.%lu.%u.tmp", path, furry_process_id(), counter);
+    if (buf.failed || written < 0 || (size_t)written >= sizeof(temp_path)) {
+        furry_free(buf.data);
+        return;
+    }
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.source_size = size;
+    header.source_crc = crc;
+    header.payload_crc = (uint32_t)furry_crc32(0, buf.data, buf.size);
+    header.payload_size = buf.size;
+    FILE *file = fopen(temp_path, "wb");
+    int ok = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(buf.data, 1, buf.size, file) == buf.size;
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    }
+    furry_free(buf.data);
+    /* Entries are content-addressed: if another process got there first, its entry is identical. */
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return;
+    }
+    atomic_fetch_add_explicit(&cache->stores, 1, memory_order_relaxed);
+    evict(cache);
+}
+
+int furry_compile_cached(FurryCompileCache *cache, const char *script, FurryProgram *out_program, FurryCompileError *out_error) {
+    if (cache == NULL || script == NULL || out_program == NULL) {
+        return furry_compile_script_ex(script, out_program, out_error);
+    }
+    size_t size = strlen(script);
+    uint64_t key = cache_key(script, size);
+    uint32_t crc = (uint32_t)furry_crc32(0, script, size);
+    char path[1024];
+    int written = snprintf(path, sizeof(path), "%s/%016llx" CACHE_SUFFIX, cache->dir, (unsigned long long)key);
+    if (written < 0 || (size_t)written >= sizeof(path)) {
+        return furry_compile_script_ex(script, out_program, out_error);
+    }
+    if (load_entry(path, key, size, crc, out_program) == FURRY_OK) {
+        furry_file_touch(path);
+        atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+        return FURRY_OK;
+    }
+    atomic_fetch_add_explicit(&cache->misses, 1, memory_order_relaxed);
+    if (furry_compile_script_ex(script, out_program, out_error) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    store_entry(cache, path, key, size, crc, out_program);
+    return FURRY_OK;
+}
+
+void furry_compile_cache_stats(const FurryCompileCache *cache, FurryCompileCacheStats *out_stats) {
+    if (cache == NULL || out_stats == NULL) {
+        return;
+    }
+    out_stats->hits = atomic_load_explicit(&cache->hits, memory_order_relaxed);
+    out_stats->misses = atomic_load_explicit(&cache->misses, memory_order_relaxed);
+    out_stats->stores = atomic_load_explicit(&cache->stores, memory_order_relaxed);
+    out_stats->evictions = atomic_load_explicit(&cache->evictions, memory_order_relaxed);
+}
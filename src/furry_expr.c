@@ -0,0 +1,485 @@
+#include "furry_internal.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ExprParser {
+    FurryProgram *program;
+    const char *cur;
+    int depth;
+    int max_depth;
+    char *err;
+    size_t err_size;
+    int failed;
+} ExprParser;
+
+static int parse_or(ExprParser *p);
+
+static void parser_fail(ExprParser *p, const char *message) {
+    if (!p->failed && p->err != NULL && p->err_size > 0) {
+        snprintf(p->err, p->err_size, "%s", message);
+    }
+    p->failed = 1;
+}
+
+static void skip_space(ExprParser *p) {
+    while (*p->cur != '\0' && isspace((unsigned char)*p->cur)) {
+        p->cur++;
+    }
+}
+
+static int accept(ExprParser *p, const char *token) {
+    skip_space(p);
+    size_t n = strlen(token);
+    if (strncmp(p->cur, token, n) != 0) {
+        return 0;
+    }
+    p->cur += n;
+    return 1;
+}
+
+static int emit(ExprParser *p, FurryExprOpCode op, int arg, int stack_delta) {
+    FurryProgram *program = p->program;
+    FurryExprOp *resized = furry_realloc(FURRY_MEM_COMPILER, program->expr_code, (program->expr_count + 1) * sizeof(FurryExprOp));
+    if (resized == NULL) {
+        parser_fail(p, "out of memory");
+        return -1;
+    }
+    program->expr_code = resized;
+    program->expr_code[program->expr_count].op = (unsigned char)op;
+    program->expr_code[program->expr_count].arg = arg;
+
+    p->depth += stack_delta;
+    if (p->depth > p->max_depth) {
+        p->max_depth = p->depth;
+    }
+    if (p->max_depth > FURRY_MAX_EXPR_STACK) {
+        parser_fail(p, "expression too deep");
+        return -1;
+    }
+    return (int)program->expr_count++;
+}
+
+static int intern_string(ExprParser *p, const char *text, size_t len) {
+    FurryProgram *program = p->program;
+    char *resized = furry_realloc(FURRY_MEM_COMPILER, program->expr_strings, program->expr_strings_size + len + 1);
+    if (resized == NULL) {
+        parser_fail(p, "out of memory");
+        return -1;
+    }
+    program->expr_strings = resized;
+    int offset = (int)program->expr_strings_size;
+    memcpy(program->expr_strings + offset, text, len);
+    program->expr_strings[offset + (int)len] = '\0';
+    program->expr_strings_size += len + 1;
+    return offset;
+}
+
+int furry_program_intern_var(FurryProgram *program, const char *key) {
+    for (size_t i = 0; i < program->var_name_count; ++i) {
+        if (strcmp(program->var_names[i], key) == 0) {
+            return (int)i;
+        }
+    }
+    if (program->var_name_count >= INT_MAX || strlen(key) >= FURRY_MAX_KEY) {
+        return -1;
+    }
+    char (*resized)[FURRY_MAX_KEY] = furry_realloc(FURRY_MEM_COMPILER, program->var_names, (program->var_name_count + 1) * sizeof(*program->var_names));
+    if (resized == NULL) {
+        return -1;
+    }
+    program->var_names = resized;
+    strcpy(program->var_names[program->var_name_count], key);
+    return (int)program->var_name_count++;
+}
+
+static int parse_primary(ExprParser *p) {
+    skip_space(p);
+    const char *start = p->cur;
+
+    if (accept(p, "(")) {
+        if (parse_or(p) != 0) {
+            return -1;
+        }
+        if (!accept(p, ")")) {
+            parser_fail(p, "expected ')'");
+            return -1;
+        }
+        return 0;
+    }
+
+    if (isdigit((unsigned char)*start)) {
+        char *end = NULL;
+        /* long long even where long is 32 bits, so an overflowing literal saturates above INT_MAX instead of onto it. */
+        long long value = strtoll(start, &end, 10);
+        if (value > INT_MAX) {
+            parser_fail(p, "integer literal out of range");
+            return -1;
+        }
+        p->cur = end;
+        return emit(p, FURRY_EXPR_PUSH_INT, (int)value, 1) < 0 ? -1 : 0;
+    }
+
+    if (*start == '"' || *start == '\'') {
+        const char *close = strchr(start + 1, *start);
+        if (close == NULL) {
+            parser_fail(p, "unterminated string literal");
+            return -1;
+        }
+        int offset = intern_string(p, start + 1, (size_t)(close - start - 1));
+        p->cur = close + 1;
+        if (offset < 0) {
+            return -1;
+        }
+        return emit(p, FURRY_EXPR_PUSH_STR, offset, 1) < 0 ? -1 : 0;
+    }
+
+    if (isalpha((unsigned char)*start) || *start == '_') {
+        const char *end = start;
+        while (isalnum((unsigned char)*end) || *end == '_' || *end == '.') {
+            end++;
+        }
+        char name[FURRY_MAX_KEY];
+        size_t len = (size_t)(end - start);
+        if (len >= sizeof(name)) {
+            parser_fail(p, "variable name too long");
+            return -1;
+        }
+        memcpy(name, start, len);
+        name[len] = '\0';
+        p->cur = end;
+        if (strcmp(name, "true") == 0 || strcmp(name, "false") == 0) {
+            return emit(p, FURRY_EXPR_PUSH_INT, name[0] == 't', 1) < 0 ? -1 : 0;
+        }
+        int slot = furry_program_intern_var(p->program, name);
+        if (slot < 0) {
+            parser_fail(p, "variable name too long");
+            return -1;
+        }
+        return emit(p, FURRY_EXPR_LOAD_VAR, slot, 1) < 0 ? -1 : 0;
+    }
+
+    parser_fail(p, "expected number, string, variable or '('");
+    return -1;
+}
+
+static int parse_unary(ExprParser *p) {
+    skip_space(p);
+    if (p->cur[0] == '!' && p->cur[1] != '=') {
+        p->cur++;
+        if (parse_unary(p) != 0) {
+            return -1;
+        }
+        return emit(p, FURRY_EXPR_NOT, 0, 0) < 0 ? -1 : 0;
+    }
+    if (accept(p, "-")) {
+        if (parse_unary(p) != 0) {
+            return -1;
+        }
+        return emit(p, FURRY_EXPR_NEG, 0, 0) < 0 ? -1 : 0;
+    }
+    return parse_primary(p);
+}
+
+static int parse_term(ExprParser *p) {
+    if (parse_unary(p) != 0) {
+        return -1;
+    }
+    for (;;) {
+        FurryExprOpCode op;
+        if (accept(p, "*")) {
+            op = FURRY_EXPR_MUL;
+        } else if (accept(p, "/")) {
+            op = FURRY_EXPR_DIV;
+        } else if (accept(p, "%")) {
+            op = FURRY_EXPR_MOD;
+        } else {
+            return 0;
+        }
+        if (parse_unary(p) != 0 || emit(p, op, 0, -1) < 0) {
+            return -1;
+        }
+    }
+}
+
+static int parse_additive(ExprParser *p) {
+    if (parse_term(p) != 0) {
+        return -1;
+    }
+    for (;;) {
+        FurryExprOpCode op;
+        if (accept(p, "+")) {
+            op = FURRY_EXPR_ADD;
+        } else if (accept(p, "-")) {
+            op = FURRY_EXPR_SUB;
+        } else {
+            return 0;
+        }
+        if (parse_term(p) != 0 || emit(p, op, 0, -1) < 0) {
+            return -1;
+        }
+    }
+}
+
+static int parse_compare(ExprParser *p) {
+    if (parse_additive(p) != 0) {
+        return -1;
+    }
+    for (;;) {
+        FurryExprOpCode op;
+        if (accept(p, "==")) {
+            op = FURRY_EXPR_EQ;
+        } else if (accept(p, "!=")) {
+            op = FURRY_EXPR_NE;
+        } else if (accept(p, "<=")) {
+            op = FURRY_EXPR_LE;
+        } else if (accept(p, ">=")) {
+            op = FURRY_EXPR_GE;
+        } else if (accept(p, "<")) {
+            op = FURRY_EXPR_LT;
+        } else if (accept(p, ">")) {
+            op = FURRY_EXPR_GT;
+        } else {
+            return 0;
+        }
+        if (parse_additive(p) != 0 || emit(p, op, 0, -1) < 0) {
+            return -1;
+        }
+    }
+}
+
+/* a && b compiles to: a AND_JUMP(end) b TO_BOOL end: -- the jump leaves 0 on the stack. */
+static int parse_and(ExprParser *p) {
+    if (parse_compare(p) != 0) {
+        return -1;
+    }
+    while (accept(p, "&&")) {
+        int jump = emit(p, FURRY_EXPR_AND_JUMP, 0, -1);
+        if (jump < 0 || parse_compare(p) != 0 || emit(p, FURRY_EXPR_TO_BOOL, 0, 0) < 0) {
+            return -1;
+        }
+        p->program->expr_code[jump].arg = (int)p->program->expr_count;
+    }
+    return 0;
+}
+
+static int parse_or(ExprParser *p) {
+    if (parse_and(p) != 0) {
+        return -1;
+    }
+    while (accept(p, "||")) {
+        int jump = emit(p, FURRY_EXPR_OR_JUMP, 0, -1);
+        if (jump < 0 || parse_and(p) != 0 || emit(p, FURRY_EXPR_TO_BOOL, 0, 0) < 0) {
+            return -1;
+        }
+        p->program->expr_code[jump].arg = (int)p->program->expr_count;
+    }
+    return 0;
+}
+
+int furry_expr_compile(FurryProgram *program, const char *source, int *out_offset, char *err, size_t err_size) {
+    ExprParser p;
+    memset(&p, 0, sizeof(p));
+    p.program = program;
+    p.cur = source;
+    p.err = err;
+    p.err_size = err_size;
+
+    size_t start = program->expr_count;
+    if (parse_or(&p) != 0 || p.failed) {
+        return FURRY_ERR;
+    }
+    skip_space(&p);
+    if (*p.cur != '\0') {
+        parser_fail(&p, "unexpected trailing characters in expression");
+        return FURRY_ERR;
+    }
+    if (emit(&p, FURRY_EXPR_END, 0, 0) < 0) {
+        return FURRY_ERR;
+    }
+    *out_offset = (int)start;
+    return FURRY_OK;
+}
+
+static int parse_int_text(const char *text, long long *out) {
+    const char *cur = text;
+    if (*cur == '-' || *cur == '+') {
+        cur++;
+    }
+    if (!isdigit((unsigned char)*cur)) {
+        return 0;
+    }
+    char *end = NULL;
+    long long value = strtoll(text, &end, 10);
+    if (*end != '\0') {
+        return 0;
+    }
+    *out = value;
+    return 1;
+}
+
+static long long as_int(const FurryExprValue *value) {
+    if (value->is_int) {
+        return value->i;
+    }
+    return atoll(value->s);
+}
+
+/* Unset variables read as "", which compares equal to 0 against integers, matching `add`. */
+static int compare_values(const FurryExprValue *a, const FurryExprValue *b) {
+    if ((a->is_int || a->s[0] == '\0') && (b->is_int || b->s[0] == '\0')) {
+        long long lhs = a->is_int ? a->i : 0;
+        long long rhs = b->is_int ? b->i : 0;
+        if (a->is_int || b->is_int) {
+            return (lhs > rhs) - (lhs < rhs);
+        }
+    }
+    char ta[32];
+    char tb[32];
+    const char *sa = a->s;
+    const char *sb = b->s;
+    if (a->is_int) {
+        snprintf(ta, sizeof(ta), "%lld", a->i);
+        sa = ta;
+    }
+    if (b->is_int) {
+        snprintf(tb, sizeof(tb), "%lld", b->i);
+        sb = tb;
+    }
+    int cmp = strcmp(sa, sb);
+    return (cmp > 0) - (cmp < 0);
+}
+
+int furry_expr_truthy(const FurryExprValue *value) {
+    if (value->is_int) {
+        return value->i != 0;
+    }
+    return value->s[0] != '\0';
+}
+
+int furry_expr_format(const FurryExprValue *value, char *out, size_t out_size) {
+    int written = value->is_int ? snprintf(out, out_size, "%lld", value->i) : snprintf(out, out_size, "%s", value->s);
+    if (written < 0 || (size_t)written >= out_size) {
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+/* Integer arithmetic wraps around in 64 bits, like Lua's, instead of overflowing. */
+static long long wrap_int(unsigned long long value) {
+    return value <= (unsigned long long)LLONG_MAX ? (long long)value : -(long long)(~value) - 1;
+}
+
+int furry_expr_eval(const FurryProgram *program, int offset, FurryExprLoadFn load, void *user_data, FurryExprValue *out) {
+    FurryExprValue stack[FURRY_MAX_EXPR_STACK];
+    int sp = 0;
+    size_t pc = (size_t)offset;
+
+    for (;;) {
+        const FurryExprOp *op = &program->expr_code[pc++];
+        switch ((FurryExprOpCode)op->op) {
+            case FURRY_EXPR_PUSH_INT:
+                stack[sp].is_int = 1;
+                stack[sp].i = op->arg;
+                stack[sp].s = NULL;
+                sp++;
+                break;
+            case FURRY_EXPR_PUSH_STR:
+                stack[sp].is_int = 0;
+                stack[sp].i = 0;
+                stack[sp].s = program->expr_strings + op->arg;
+                sp++;
+                break;
+            case FURRY_EXPR_LOAD_VAR: {
+                const char *text = load(op->arg, user_data);
+                stack[sp].s = text;
+                stack[sp].is_int = parse_int_text(text, &stack[sp].i);
+                sp++;
+                break;
+            }
+            case FURRY_EXPR_NEG:
+                stack[sp - 1].i = wrap_int(0ull - (unsigned long long)as_int(&stack[sp - 1]));
+                stack[sp - 1].is_int = 1;
+                break;
+            case FURRY_EXPR_NOT:
+                stack[sp - 1].i = !furry_expr_truthy(&stack[sp - 1]);
+                stack[sp - 1].is_int = 1;
+                break;
+            case FURRY_EXPR_ADD:
+            case FURRY_EXPR_SUB:
+            case FURRY_EXPR_MUL:
+            case FURRY_EXPR_DIV:
+            case FURRY_EXPR_MOD: {
+                long long lhs = as_int(&stack[sp - 2]);
+                long long rhs = as_int(&stack[sp - 1]);
+                long long result = 0;
+                if (op->op == FURRY_EXPR_ADD) {
+                    result = wrap_int((unsigned long long)lhs + (unsigned long long)rhs);
+                } else if (op->op == FURRY_EXPR_SUB) {
+                    result = wrap_int((unsigned long long)lhs - (unsigned long long)rhs);
+                } else if (op->op == FURRY_EXPR_MUL) {
+                    result = wrap_int((unsigned long long)lhs * (unsigned long long)rhs);
+                } else if (rhs == 0) {
+                    return FURRY_ERR;
+                } else if (rhs == -1) {
+                    /* LLONG_MIN / -1 traps; the quotient wraps like the other operators and the remainder is 0. */
+                    result = op->op == FURRY_EXPR_DIV ? wrap_int(0ull - (unsigned long long)lhs) : 0;
+                } else {
+                    result = op->op == FURRY_EXPR_DIV ? lhs / rhs : lhs % rhs;
+                }
+                sp--;
+                stack[sp - 1].is_int = 1;
+                stack[sp - 1].i = result;
+                break;
+            }
+            case FURRY_EXPR_EQ:
+            case FURRY_EXPR_NE:
+            case FURRY_EXPR_LT:
+            case FURRY_EXPR_LE:
+            case FURRY_EXPR_GT:
+            case FURRY_EXPR_GE: {
+                int cmp = compare_values(&stack[sp - 2], &stack[sp - 1]);
+                int result = 0;
+                switch ((FurryExprOpCode)op->op) {
+                    case FURRY_EXPR_EQ: result = cmp == 0; break;
+                    case FURRY_EXPR_NE: result = cmp != 0; break;
+                    case FURRY_EXPR_LT: result = cmp < 0; break;
+                    case FURRY_EXPR_LE: result = cmp <= 0; break;
+                    case FURRY_EXPR_GT: result = cmp > 0; break;
+                    default: result = cmp >= 0; break;
+                }
+                sp--;
+                stack[sp - 1].is_int = 1;
+                stack[sp - 1].i = result;
+                break;
+            }
+            case FURRY_EXPR_AND_JUMP:
+            case FURRY_EXPR_OR_JUMP: {
+                int truthy = furry_expr_truthy(&stack[sp - 1]);
+                if ((op->op == FURRY_EXPR_AND_JUMP) != truthy) {
+                    stack[sp - 1].is_int = 1;
+                    stack[sp - 1].i = truthy;
+                    pc = (size_t)op->arg;
+                } else {
+                    sp--;
+                }
+                break;
+            }
+            case FURRY_EXPR_TO_BOOL:
+                stack[sp - 1].i = furry_expr_truthy(&stack[sp - 1]);
+                stack[sp - 1].is_int = 1;
+                break;
+            case FURRY_EXPR_END:
+                if (sp != 1) {
+                    return FURRY_ERR;
+                }
+                *out = stack[0];
+                return FURRY_OK;
+            default:
+                return FURRY_ERR;
+        }
+    }
+}
@@ -0,0 +1,216 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "furry_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#include <sys/utime.h>
+
+static int read_whole_file(const char *path, FurryMappedFile *out_file) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    if (fseek(file, 0, SEEK_END) != 0) {
+        fclose(file);
+        return FURRY_ERR;
+    }
+    long size = ftell(file);
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return FURRY_ERR;
+    }
+    unsigned char *data = furry_alloc(FURRY_MEM_ASSETS, size > 0 ? (size_t)size : 1);
+    if (data == NULL || fread(data, 1, (size_t)size, file) != (size_t)size) {
+        furry_free(data);
+        fclose(file);
+        return FURRY_ERR;
+    }
+    fclose(file);
+    out_file->data = data;
+    out_file->size = (size_t)size;
+    out_file->mapped = 0;
+    return FURRY_OK;
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+int furry_map_file(const char *path, FurryMappedFile *out_file) {
+    if (path == NULL || out_file == NULL) {
+        return FURRY_ERR;
+    }
+    memset(out_file, 0, sizeof(*out_file));
+#if defined(_WIN32)
+    return read_whole_file(path, out_file);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return FURRY_ERR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return FURRY_ERR;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return FURRY_ERR;
+    }
+    out_file->data = data;
+    out_file->size = (size_t)st.st_size;
+    out_file->mapped = 1;
+    return FURRY_OK;
+#endif
+}
+
+void furry_unmap_file(FurryMappedFile *file) {
+    if (file == NULL || file->data == NULL) {
+        return;
+    }
+#if defined(_WIN32)
+    furry_free((void *)file->data);
+#else
+    munmap((void *)file->data, file->size);
+#endif
+    memset(file, 0, sizeof(*file));
+}
+
+int furry_file_sync(FILE *file) {
+    if (file == NULL || fflush(file) != 0) {
+        return FURRY_ERR;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0 ? FURRY_OK : FURRY_ERR;
+#else
+    return fsync(fileno(file)) == 0 ? FURRY_OK : FURRY_ERR;
+#endif
+}
+
+int furry_file_truncate(const char *path, size_t size) {
+#if defined(_WIN32)
+    FILE *file = fopen(path, "r+b");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    int rc = _chsize_s(_fileno(file), (long long)size) == 0 ? FURRY_OK : FURRY_ERR;
+    fclose(file);
+    return rc;
+#else
+    return truncate(path, (off_t)size) == 0 ? FURRY_OK : FURRY_ERR;
+#endif
+}
+
+int furry_dir_create(const char *path) {
+#if defined(_WIN32)
+    struct _stat st;
+    return _mkdir(path) == 0 || (_stat(path, &st) == 0 && (st.st_mode & _S_IFDIR) != 0) ? FURRY_OK : FURRY_ERR;
+#else
+    struct stat st;
+    return mkdir(path, 0777) == 0 || (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) ? FURRY_OK : FURRY_ERR;
+#endif
+}
+
+int furry_dir_list(const char *dir, FurryDirEntryFn fn, void *user_data) {
+    char path[1024];
+#if defined(_WIN32)
+    if (snprintf(path, sizeof(path), "%s/*", dir) >= (int)sizeof(path)) {
+        return FURRY_ERR;
+    }
+    struct _finddata64i32_t found;
+    intptr_t handle = _findfirst64i32(path, &found);
+    if (handle == -1) {
+        return FURRY_ERR;
+    }
+    do {
+        if ((found.attrib & _A_SUBDIR) == 0) {
+            fn(found.name, (size_t)found.size, (long long)found.time_write, user_data);
+        }
+    } while (_findnext64i32(handle, &found) == 0);
+    _findclose(handle);
+    return FURRY_OK;
+#else
+    DIR *handle = opendir(dir);
+    if (handle == NULL) {
+        return FURRY_ERR;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != NULL) {
+        struct stat st;
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) < (int)sizeof(path) && stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            fn(entry->d_name, (size_t)st.st_size, (long long)st.st_mtime, user_data);
+        }
+    }
+    closedir(handle);
+    return FURRY_OK;
+#endif
+}
+
+int furry_file_touch(const char *path) {
+#if defined(_WIN32)
+    return _utime(path, NULL) == 0 ? FURRY_OK : FURRY_ERR;
+#else
+    return utime(path, NULL) == 0 ? FURRY_OK : FURRY_ERR;
+#endif
+}
+
+unsigned long furry_process_id(void) {
+#if defined(_WIN32)
+    return (unsigned long)_getpid();
+#else
+    return (unsigned long)getpid();
+#endif
+}
+
+/* Slice-by-8 CRC-32 (IEEE); tables are built once on first use. */
+static uint32_t crc_tables[8][256];
+static once_flag crc_once = ONCE_FLAG_INIT;
+
+static void build_crc_tables(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1u) != 0 ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+        }
+        crc_tables[0][i] = crc;
+    }
+    for (int slice = 1; slice < 8; ++slice) {
+        for (int i = 0; i < 256; ++i) {
+            uint32_t prev = crc_tables[slice - 1][i];
+            crc_tables[slice][i] = (prev >> 8) ^ crc_tables[0][prev & 0xffu];
+        }
+    }
+}
+
+unsigned long furry_crc32(unsigned long crc, const void *data, size_t size) {
+    call_once(&crc_once, build_crc_tables);
+    const unsigned char *bytes = data;
+    uint32_t c = ~(uint32_t)crc;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint32_t lo = c ^ ((uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24);
+        uint32_t hi = (uint32_t)bytes[4] | (uint32_t)bytes[5] << 8 | (uint32_t)bytes[6] << 16 | (uint32_t)bytes[7] << 24;
+        c = crc_tables[7][lo & 0xffu] ^ crc_tables[6][(lo >> 8) & 0xffu] ^ crc_tables[5][(lo >> 16) & 0xffu] ^ crc_tables[4][lo >> 24] ^
+            crc_tables[3][hi & 0xffu] ^ crc_tables[2][(hi >> 8) & 0xffu] ^ crc_tables[1][(hi >> 16) & 0xffu] ^ crc_tables[0][hi >> 24];
+    }
+    for (; size > 0; --size, ++bytes) {
+        c = (c >> 8) ^ crc_tables[0][(c ^ *bytes) & 0xffu];
+    }
+    return ~c & 0xffffffffUL;
+}
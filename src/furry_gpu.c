@@ -0,0 +1,135 @@
+#include "furry_gpu.h"
+#include "furry_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define GPU_CACHE_MAGIC "FYPC"
+#define GPU_CACHE_VERSION 1u
+
+typedef struct GpuCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+    uint32_t crc;
+    uint32_t reserved;
+} GpuCacheHeader;
+
+void furry_staging_init(FurryStagingRing *ring, size_t capacity) {
+    memset(ring, 0, sizeof(*ring));
+    ring->capacity = capacity;
+}
+
+int furry_staging_alloc(FurryStagingRing *ring, size_t size, size_t alignment, size_t *out_offset) {
+    if (size == 0 || size > ring->capacity || alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return FURRY_ERR;
+    }
+    unsigned long long head = (ring->head + alignment - 1) & ~(unsigned long long)(alignment - 1);
+    size_t offset = (size_t)(head % ring->capacity);
+    if (offset + size > ring->capacity) {
+        head += ring->capacity - offset;
+        offset = 0;
+    }
+    if (head + size - ring->tail > ring->capacity) {
+        return FURRY_ERR;
+    }
+    ring->skipped += (size_t)(head - ring->head);
+    ring->allocated += size;
+    ring->head = head + size;
+    *out_offset = offset;
+    return FURRY_OK;
+}
+
+void furry_staging_close_frame(FurryStagingRing *ring, unsigned frame) {
+    if (frame < FURRY_GPU_MAX_FRAMES) {
+        ring->frame_end[frame] = ring->head;
+    }
+}
+
+void furry_staging_retire(FurryStagingRing *ring, unsigned frame) {
+    /* Frames retire in submission order, so the tail only ever moves forward. */
+    if (frame < FURRY_GPU_MAX_FRAMES && ring->frame_end[frame] > ring->tail) {
+        ring->tail = ring->frame_end[frame];
+    }
+}
+
+size_t furry_staging_used(const FurryStagingRing *ring) {
+    return (size_t)(ring->head - ring->tail);
+}
+
+unsigned long long furry_gpu_cache_key(unsigned long long hash, const void *data, size_t size) {
+    if (hash == 0) {
+        hash = 14695981039346656037ull;
+    }
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+int furry_gpu_cache_save(const char *path, unsigned long long key, const void *data, size_t size) {
+    if (path == NULL || (data == NULL && size > 0)) {
+        return FURRY_ERR;
+    }
+    char temp_path[1024];
+    int written = snprintf(temp_path, sizeof(temp_path), "%s.%lu.tmp", path, furry_process_id());
+    if (written < 0 || (size_t)written >= sizeof(temp_path)) {
+        return FURRY_ERR;
+    }
+    GpuCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GPU_CACHE_MAGIC, 4);
+    header.version = GPU_CACHE_VERSION;
+    header.key = key;
+    header.size = size;
+    header.crc = (uint32_t)furry_crc32(0, data, size);
+    FILE *file = fopen(temp_path, "wb");
+    int ok = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data, 1, size, file) == size;
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    }
+    /* Windows will not rename over an existing file; the window without one only costs a cold cache. */
+    if (ok && rename(temp_path, path) != 0) {
+        remove(path);
+        ok = rename(temp_path, path) == 0;
+    }
+    if (!ok) {
+        remove(temp_path);
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_gpu_cache_load(const char *path, unsigned long long key, void *out_data, size_t out_capacity, size_t *out_size) {
+    if (path == NULL || out_size == NULL) {
+        return FURRY_ERR;
+    }
+    *out_size = 0;
+    FurryMappedFile file;
+    if (furry_map_file(path, &file) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    GpuCacheHeader header;
+    int rc = FURRY_ERR;
+    if (file.size >= sizeof(header)) {
+        memcpy(&header, file.data, sizeof(header));
+        const unsigned char *payload = file.data + sizeof(header);
+        size_t size = file.size - sizeof(header);
+        if (memcmp(header.magic, GPU_CACHE_MAGIC, 4) == 0 && header.version == GPU_CACHE_VERSION && header.key == key &&
+            header.size == size && furry_crc32(0, payload, size) == header.crc) {
+            *out_size = size;
+            if (out_data == NULL) {
+                rc = FURRY_OK;
+            } else if (out_capacity >= size) {
+                memcpy(out_data, payload, size);
+                rc = FURRY_OK;
+            }
+        }
+    }
+    furry_unmap_file(&file);
+    return rc;
+}
@@ -0,0 +1,137 @@
+#ifndef FURRY_INTERNAL_H
+#define FURRY_INTERNAL_H
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "furry.h"
+#include "furry_alloc.h"
+#include "furry_audio.h"
+#include "furry_soft.h"
+#include "furry_trace.h"
+
+#define FURRY_OK 0
+#define FURRY_ERR 1
+
+/* Tagged heap blocks through the installed FurryAllocator; furry_free accepts any of them, and NULL. */
+void *furry_alloc(FurryMemTag tag, size_t size);
+void *furry_calloc(FurryMemTag tag, size_t count, size_t size);
+void *furry_realloc(FurryMemTag tag, void *ptr, size_t size);
+void furry_free(void *ptr);
+
+/* Bump allocator for short-lived temporaries; reset drops everything but keeps the newest chunk. */
+typedef struct FurryScratch {
+    struct FurryScratchChunk *chunks;
+    size_t used;
+    size_t chunk_size;
+} FurryScratch;
+
+void furry_scratch_init(FurryScratch *scratch, size_t chunk_size);
+void *furry_scratch_alloc(FurryScratch *scratch, size_t size);
+void furry_scratch_reset(FurryScratch *scratch);
+void furry_scratch_free(FurryScratch *scratch);
+
+/* Trace points test this first, so a disabled trace costs one load and branch. */
+extern atomic_int furry_trace_current_level;
+static inline int furry_trace_on(int level) {
+    return atomic_load_explicit(&furry_trace_current_level, memory_order_relaxed) >= level;
+}
+unsigned long long furry_trace_now(void);
+void furry_trace_record(FurryTraceKind kind, unsigned long long start_ns, unsigned long long duration_ns, unsigned arg,
+                        const char *detail);
+
+typedef struct FurryExprValue {
+    int is_int;
+    long long i;
+    const char *s;
+} FurryExprValue;
+
+typedef const char *(*FurryExprLoadFn)(int slot, void *user_data);
+
+typedef struct FurryMappedFile {
+    const unsigned char *data;
+    size_t size;
+    int mapped;
+} FurryMappedFile;
+
+int furry_map_file(const char *path, FurryMappedFile *out_file);
+void furry_unmap_file(FurryMappedFile *file);
+int furry_file_sync(FILE *file);
+int furry_file_truncate(const char *path, size_t size);
+unsigned long furry_crc32(unsigned long crc, const void *data, size_t size);
+
+/* Directory helpers for on-disk caches; furry_dir_create succeeds if the directory already exists. */
+typedef void (*FurryDirEntryFn)(const char *name, size_t size, long long mtime, void *user_data);
+int furry_dir_create(const char *path);
+/* Calls fn for each regular file in dir, in no particular order. */
+int furry_dir_list(const char *dir, FurryDirEntryFn fn, void *user_data);
+/* Sets a file's modification time to now. */
+int furry_file_touch(const char *path);
+unsigned long furry_process_id(void);
+
+int furry_snapshot_encode(const FurryRuntimeSnapshot *snapshot, unsigned char *out, size_t out_size, size_t *out_len);
+size_t furry_snapshot_encoded_size(const FurryRuntimeSnapshot *snapshot);
+int furry_snapshot_decode(const unsigned char *data, size_t size, FurryRuntimeSnapshot *out_snapshot);
+
+/* Bounded single-producer/single-consumer ring of fixed-size items; capacity is rounded to a power of two. */
+typedef struct FurrySpscRing {
+    unsigned char *items;
+    size_t item_size;
+    size_t mask;
+    char pad_head[64];
+    atomic_size_t head;
+    char pad_tail[64];
+    atomic_size_t tail;
+    char pad_end[64];
+} FurrySpscRing;
+
+int furry_spsc_init(FurrySpscRing *ring, FurryMemTag tag, size_t item_size, size_t capacity);
+void furry_spsc_free(FurrySpscRing *ring);
+size_t furry_spsc_write(FurrySpscRing *ring, const void *items, size_t count);
+size_t furry_spsc_read(FurrySpscRing *ring, void *out_items, size_t max_count);
+size_t furry_spsc_readable(FurrySpscRing *ring);
+size_t furry_spsc_writable(FurrySpscRing *ring);
+
+/* Audio backend glue (furry_audio_miniaudio.c); without miniaudio there is no device and only WAV decoding. */
+int furry_audio_open_default(const char *path, FurryAudioDecoder *out_decoder);
+int furry_audio_device_start(FurryAudio *audio, unsigned sample_rate, void **out_device);
+void furry_audio_device_stop(void *device);
+
+/* Asset images as furry_soft draws them (furry_soft.c): root/name through load (NULL reads PPM), a placeholder when that fails, premultiplied. */
+int furry_soft_load_asset(const char *asset_root, const char *name, FurrySoftImageFn load, void *user_data, FurrySoftImage *out_image);
+
+/* Shared 5x7 ASCII bitmap font for 0x20..0x7E: five columns left to right, bit 0 = top row. */
+extern const unsigned char furry_font5x7[95][5];
+
+/* Unique per open and switch across all locales, so cached localized output can be invalidated; 0 without a locale. */
+unsigned furry_locale_generation(const FurryLocale *locale);
+/* Bracket a run using locale; tables switched away from meanwhile stay mapped until no run is left. */
+void furry_locale_begin_run(const FurryLocale *locale);
+void furry_locale_end_run(const FurryLocale *locale);
+/* Fails when two different texts in program hash to the same furry_locale_string_id (furry_locale.c). */
+int furry_check_string_ids(const FurryProgram *program, FurryCompileError *out_error);
+
+/* Compiler stages shared by furry_compile_script_ex, FurryProgramBuilder and the lazy compiler (furry.c). */
+int furry_parse_line(FurryScratch *scratch, char *line, FurryInstruction *ins);
+int furry_prepare_instruction(FurryProgram *program, FurryInstruction *ins, char *err, size_t err_size);
+/* furry_prepare_instruction, then appended to program. */
+int furry_compile_instruction(FurryProgram *program, FurryInstruction *ins, char *err, size_t err_size);
+/* Resolves a label to its instruction index, or -1. */
+typedef int (*FurryLabelLookup)(const FurryProgram *program, const char *label, void *user_data);
+/* Checks ui nesting and jump targets in [start, end) and marks static ui blocks; a NULL lookup scans the program. */
+int furry_validate_range(FurryProgram *program, size_t start, size_t end, FurryLabelLookup lookup, void *lookup_data,
+                         FurryCompileError *out_error);
+/* furry_validate_range over the whole program, plus furry_check_string_ids. */
+int furry_validate_program(FurryProgram *program, FurryCompileError *out_error);
+/* furry_lazy_ensure for the VM, which then runs [*out_begin, *out_end) without asking again. */
+int furry_lazy_enter(FurryLazyProgram *lazy, size_t ip, size_t *out_begin, size_t *out_end);
+/* Hash of everything that drives control flow; replays and seen sets are refused against an edited script. */
+unsigned long long furry_program_fingerprint(const FurryProgram *program);
+
+int furry_program_intern_var(FurryProgram *program, const char *key);
+int furry_expr_compile(FurryProgram *program, const char *source, int *out_offset, char *err, size_t err_size);
+int furry_expr_eval(const FurryProgram *program, int offset, FurryExprLoadFn load, void *user_data, FurryExprValue *out);
+int furry_expr_truthy(const FurryExprValue *value);
+int furry_expr_format(const FurryExprValue *value, char *out, size_t out_size);
+
+#endif
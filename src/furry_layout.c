@@ -0,0 +1,336 @@
+#include "furry_layout.h"
+#include "furry_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LAYOUT_UNIT_BITS 2
+#define LAYOUT_UNIT_MASK 3u
+
+/* Structure-of-arrays node storage; every array is indexed by node id. */
+struct FurryLayout {
+    size_t count;
+    size_t capacity;
+
+    /* Spec, split by field so the solver streams only what it reads. */
+    float *x;
+    float *y;
+    float *w;
+    float *h;
+    float *anchor_x;
+    float *anchor_y;
+    float *pivot_x;
+    float *pivot_y;
+    unsigned char *units;
+
+    /* Hierarchy. Parents always have lower ids than their children. */
+    int *parent;
+    int *first_child;
+    int *last_child;
+    int *next_sibling;
+
+    unsigned char *dirty;
+    unsigned *stamp;
+    int *dirty_list;
+    size_t dirty_count;
+    unsigned epoch;
+
+    FurryRect *rects;
+    float viewport_w;
+    float viewport_h;
+    int viewport_dirty;
+};
+
+static int grow(void **array, size_t elem_size, size_t capacity) {
+    void *resized = furry_realloc(FURRY_MEM_UI, *array, elem_size * capacity);
+    if (resized == NULL) {
+        return FURRY_ERR;
+    }
+    *array = resized;
+    return FURRY_OK;
+}
+
+static int reserve(FurryLayout *layout, size_t capacity) {
+    if (capacity <= layout->capacity) {
+        return FURRY_OK;
+    }
+    if (grow((void **)&layout->x, sizeof(float), capacity) != FURRY_OK || grow((void **)&layout->y, sizeof(float), capacity) != FURRY_OK ||
+        grow((void **)&layout->w, sizeof(float), capacity) != FURRY_OK || grow((void **)&layout->h, sizeof(float), capacity) != FURRY_OK ||
+        grow((void **)&layout->anchor_x, sizeof(float), capacity) != FURRY_OK ||
+        grow((void **)&layout->anchor_y, sizeof(float), capacity) != FURRY_OK ||
+        grow((void **)&layout->pivot_x, sizeof(float), capacity) != FURRY_OK ||
+        grow((void **)&layout->pivot_y, sizeof(float), capacity) != FURRY_OK ||
+        grow((void **)&layout->units, sizeof(unsigned char), capacity) != FURRY_OK ||
+        grow((void **)&layout->parent, sizeof(int), capacity) != FURRY_OK ||
+        grow((void **)&layout->first_child, sizeof(int), capacity) != FURRY_OK ||
+        grow((void **)&layout->last_child, sizeof(int), capacity) != FURRY_OK ||
+        grow((void **)&layout->next_sibling, sizeof(int), capacity) != FURRY_OK ||
+        grow((void **)&layout->dirty, sizeof(unsigned char), capacity) != FURRY_OK ||
+        grow((void **)&layout->stamp, sizeof(unsigned), capacity) != FURRY_OK ||
+        grow((void **)&layout->dirty_list, sizeof(int), capacity) != FURRY_OK ||
+        grow((void **)&layout->rects, sizeof(FurryRect), capacity) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    layout->capacity = capacity;
+    return FURRY_OK;
+}
+
+int furry_layout_create(size_t capacity_hint, FurryLayout **out_layout) {
+    if (out_layout == NULL) {
+        return FURRY_ERR;
+    }
+    *out_layout = NULL;
+    FurryLayout *layout = furry_calloc(FURRY_MEM_UI, 1, sizeof(FurryLayout));
+    if (layout == NULL) {
+        return FURRY_ERR;
+    }
+    if (reserve(layout, capacity_hint < 16 ? 16 : capacity_hint) != FURRY_OK) {
+        furry_layout_destroy(layout);
+        return FURRY_ERR;
+    }
+    layout->viewport_w = 1.0f;
+    layout->viewport_h = 1.0f;
+    *out_layout = layout;
+    return FURRY_OK;
+}
+
+void furry_layout_destroy(FurryLayout *layout) {
+    if (layout == NULL) {
+        return;
+    }
+    furry_free(layout->x);
+    furry_free(layout->y);
+    furry_free(layout->w);
+    furry_free(layout->h);
+    furry_free(layout->anchor_x);
+    furry_free(layout->anchor_y);
+    furry_free(layout->pivot_x);
+    furry_free(layout->pivot_y);
+    furry_free(layout->units);
+    furry_free(layout->parent);
+    furry_free(layout->first_child);
+    furry_free(layout->last_child);
+    furry_free(layout->next_sibling);
+    furry_free(layout->dirty);
+    furry_free(layout->stamp);
+    furry_free(layout->dirty_list);
+    furry_free(layout->rects);
+    furry_free(layout);
+}
+
+void furry_layout_clear(FurryLayout *layout) {
+    if (layout != NULL) {
+        layout->count = 0;
+        layout->dirty_count = 0;
+    }
+}
+
+static void mark_dirty(FurryLayout *layout, int node) {
+    if (!layout->dirty[node]) {
+        layout->dirty[node] = 1;
+        layout->dirty_list[layout->dirty_count++] = node;
+    }
+}
+
+void furry_layout_set_viewport(FurryLayout *layout, float width, float height) {
+    if (layout == NULL || (layout->viewport_w == width && layout->viewport_h == height)) {
+        return;
+    }
+    layout->viewport_w = width;
+    layout->viewport_h = height;
+    layout->viewport_dirty = 1;
+}
+
+static void store_spec(FurryLayout *layout, int node, const FurryLayoutSpec *spec) {
+    layout->x[node] = spec->x.value;
+    layout->y[node] = spec->y.value;
+    layout->w[node] = spec->w.value;
+    layout->h[node] = spec->h.value;
+    layout->anchor_x[node] = spec->anchor_x;
+    layout->anchor_y[node] = spec->anchor_y;
+    layout->pivot_x[node] = spec->pivot_x;
+    layout->pivot_y[node] = spec->pivot_y;
+    layout->units[node] = (unsigned char)(((unsigned)spec->x.unit & LAYOUT_UNIT_MASK) |
+                                          (((unsigned)spec->y.unit & LAYOUT_UNIT_MASK) << LAYOUT_UNIT_BITS) |
+                                          (((unsigned)spec->w.unit & LAYOUT_UNIT_MASK) << (LAYOUT_UNIT_BITS * 2)) |
+                                          (((unsigned)spec->h.unit & LAYOUT_UNIT_MASK) << (LAYOUT_UNIT_BITS * 3)));
+}
+
+int furry_layout_add(FurryLayout *layout, int parent, const FurryLayoutSpec *spec, int *out_node) {
+    if (layout == NULL || spec == NULL || parent >= (int)layout->count) {
+        return FURRY_ERR;
+    }
+    if (layout->count == layout->capacity && reserve(layout, layout->capacity * 2) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    int node = (int)layout->count++;
+    store_spec(layout, node, spec);
+    layout->parent[node] = parent < 0 ? -1 : parent;
+    layout->first_child[node] = -1;
+    layout->last_child[node] = -1;
+    layout->next_sibling[node] = -1;
+    layout->stamp[node] = 0;
+    layout->dirty[node] = 0;
+    if (parent >= 0) {
+        if (layout->last_child[parent] < 0) {
+            layout->first_child[parent] = node;
+        } else {
+            layout->next_sibling[layout->last_child[parent]] = node;
+        }
+        layout->last_child[parent] = node;
+    }
+    mark_dirty(layout, node);
+    if (out_node != NULL) {
+        *out_node = node;
+    }
+    return FURRY_OK;
+}
+
+int furry_layout_set_spec(FurryLayout *layout, int node, const FurryLayoutSpec *spec) {
+    if (layout == NULL || spec == NULL || node < 0 || node >= (int)layout->count) {
+        return FURRY_ERR;
+    }
+    store_spec(layout, node, spec);
+    mark_dirty(layout, node);
+    return FURRY_OK;
+}
+
+static float resolve(float value, unsigned unit, float parent_extent, float viewport_extent) {
+    switch (unit) {
+        case FURRY_LAYOUT_PARENT:
+            return value * parent_extent;
+        case FURRY_LAYOUT_VIEWPORT:
+            return value * viewport_extent;
+        default:
+            return value;
+    }
+}
+
+static void solve_node(FurryLayout *layout, int node) {
+    FurryRect parent_rect = {0.0f, 0.0f, layout->viewport_w, layout->viewport_h};
+    if (layout->parent[node] >= 0) {
+        parent_rect = layout->rects[layout->parent[node]];
+    }
+    unsigned units = layout->units[node];
+    float w = resolve(layout->w[node], (units >> (LAYOUT_UNIT_BITS * 2)) & LAYOUT_UNIT_MASK, parent_rect.w, layout->viewport_w);
+    float h = resolve(layout->h[node], (units >> (LAYOUT_UNIT_BITS * 3)) & LAYOUT_UNIT_MASK, parent_rect.h, layout->viewport_h);
+    FurryRect *rect = &layout->rects[node];
+    rect->x = parent_rect.x + layout->anchor_x[node] * parent_rect.w +
+              resolve(layout->x[node], units & LAYOUT_UNIT_MASK, parent_rect.w, layout->viewport_w) - layout->pivot_x[node] * w;
+    rect->y = parent_rect.y + layout->anchor_y[node] * parent_rect.h +
+              resolve(layout->y[node], (units >> LAYOUT_UNIT_BITS) & LAYOUT_UNIT_MASK, parent_rect.h, layout->viewport_h) -
+              layout->pivot_y[node] * h;
+    rect->w = w;
+    rect->h = h;
+}
+
+/* Pre-order walk of one subtree via the sibling links; no stack needed. */
+static size_t solve_subtree(FurryLayout *layout, int root) {
+    size_t solved = 0;
+    int node = root;
+    while (node >= 0) {
+        solve_node(layout, node);
+        layout->stamp[node] = layout->epoch;
+        layout->dirty[node] = 0;
+        solved++;
+        if (layout->first_child[node] >= 0) {
+            node = layout->first_child[node];
+            continue;
+        }
+        while (node != root && layout->next_sibling[node] < 0) {
+            node = layout->parent[node];
+        }
+        node = node == root ? -1 : layout->next_sibling[node];
+    }
+    return solved;
+}
+
+static int compare_nodes(const void *lhs, const void *rhs) {
+    int a = *(const int *)lhs;
+    int b = *(const int *)rhs;
+    return (a > b) - (a < b);
+}
+
+size_t furry_layout_update(FurryLayout *layout) {
+    if (layout == NULL) {
+        return 0;
+    }
+    layout->epoch++;
+    if (layout->epoch == 0) {
+        memset(layout->stamp, 0, layout->count * sizeof(unsigned));
+        layout->epoch = 1;
+    }
+
+    size_t solved = 0;
+    if (layout->viewport_dirty) {
+        /* Everything hangs off the viewport; one ordered pass re-solves it all. */
+        for (size_t i = 0; i < layout->count; ++i) {
+            solve_node(layout, (int)i);
+            layout->dirty[i] = 0;
+        }
+        solved = layout->count;
+        layout->viewport_dirty = 0;
+        layout->dirty_count = 0;
+        return solved;
+    }
+
+    /* Ascending ids visit ancestors before descendants, so a dirty node already covered by a dirty ancestor is skipped. */
+    if (layout->dirty_count > 1) {
+        qsort(layout->dirty_list, layout->dirty_count, sizeof(int), compare_nodes);
+    }
+    for (size_t d = 0; d < layout->dirty_count; ++d) {
+        int node = layout->dirty_list[d];
+        if (layout->stamp[node] != layout->epoch) {
+            solved += solve_subtree(layout, node);
+        }
+    }
+    layout->dirty_count = 0;
+    return solved;
+}
+
+const FurryRect *furry_layout_rects(const FurryLayout *layout, size_t *out_count) {
+    if (out_count != NULL) {
+        *out_count = layout == NULL ? 0 : layout->count;
+    }
+    return layout == NULL ? NULL : layout->rects;
+}
+
+size_t furry_layout_node_count(const FurryLayout *layout) {
+    return layout == NULL ? 0 : layout->count;
+}
+
+int furry_layout_parse_length(const char *text, FurryLayoutLength *out_length) {
+    if (text == NULL || out_length == NULL) {
+        return FURRY_ERR;
+    }
+    char *end = NULL;
+    float value = strtof(text, &end);
+    if (end == text) {
+        return FURRY_ERR;
+    }
+    FurryLayoutUnit unit = FURRY_LAYOUT_PARENT;
+    if (strcmp(end, "px") == 0) {
+        unit = FURRY_LAYOUT_PX;
+    } else if (strcmp(end, "%") == 0) {
+        value /= 100.0f;
+    } else if (strcmp(end, "vp") == 0) {
+        unit = FURRY_LAYOUT_VIEWPORT;
+    } else if (*end != '\0') {
+        return FURRY_ERR;
+    }
+    out_length->value = value;
+    out_length->unit = unit;
+    return FURRY_OK;
+}
+
+int furry_layout_spec_from_panel(const char *x, const char *y, const char *w, const char *h, FurryLayoutSpec *out_spec) {
+    if (out_spec == NULL) {
+        return FURRY_ERR;
+    }
+    memset(out_spec, 0, sizeof(*out_spec));
+    if (furry_layout_parse_length(x, &out_spec->x) != FURRY_OK || furry_layout_parse_length(y, &out_spec->y) != FURRY_OK ||
+        furry_layout_parse_length(w, &out_spec->w) != FURRY_OK || furry_layout_parse_length(h, &out_spec->h) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
@@ -0,0 +1,498 @@
+#include "furry_lazy.h"
+#include "furry_internal.h"
+
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#define LAZY_SCRATCH_CHUNK (16 * 1024)
+#define LAZY_SYNTAX_ERROR "invalid syntax, malformed command, or unsupported media extension"
+
+enum {
+    BLOCK_PENDING = 0,
+    BLOCK_PARSING,
+    BLOCK_PARSED,
+    BLOCK_FAILED,
+    BLOCK_INSTALLED
+};
+
+/* A run of script starting at a top-level label; parsed by any thread, installed only by the owner. */
+typedef struct LazyBlock {
+    size_t begin;
+    size_t end;
+    size_t first;
+    size_t count;
+    /* Lines before the block, counted the way furry_compile_script_ex numbers them. */
+    int line_base;
+    atomic_int state;
+    FurryInstruction *parsed;
+    int *lines;
+    FurryCompileError error;
+} LazyBlock;
+
+typedef struct LazyLabel {
+    const char *name;
+    int index;
+} LazyLabel;
+
+struct FurryLazyProgram {
+    FurryProgram program;
+    char *script;
+    LazyBlock *blocks;
+    size_t block_count;
+    LazyLabel *labels;
+    size_t label_count;
+    size_t installed;
+
+    mtx_t lock;
+    cnd_t parsed;
+    thrd_t thread;
+    int has_thread;
+    atomic_int stop;
+    atomic_size_t background_blocks;
+};
+
+static void set_error(FurryCompileError *out_error, int line, const char *message) {
+    if (out_error != NULL) {
+        out_error->line = line;
+        snprintf(out_error->message, sizeof(out_error->message), "%s", message);
+    }
+}
+
+/* Next non-empty line of script[*pos, end) with surrounding space dropped; strtok's view of the script. */
+static int next_line(const char *script, size_t *pos, size_t end, size_t *out_begin, size_t *out_end) {
+    while (*pos < end && script[*pos] == '\n') {
+        (*pos)++;
+    }
+    if (*pos >= end) {
+        return 0;
+    }
+    const char *nl = memchr(script + *pos, '\n', end - *pos);
+    size_t line_end = nl != NULL ? (size_t)(nl - script) : end;
+    size_t a = *pos;
+    size_t b = line_end;
+    while (a < b && isspace((unsigned char)script[a])) {
+        a++;
+    }
+    while (b > a && isspace((unsigned char)script[b - 1])) {
+        b--;
+    }
+    *pos = nl != NULL ? line_end + 1 : end;
+    *out_begin = a;
+    *out_end = b;
+    return 1;
+}
+
+static int is_instruction_line(const char *script, size_t begin, size_t end) {
+    return end > begin && script[begin] != '#';
+}
+
+static int parse_block(const FurryLazyProgram *lazy, LazyBlock *block) {
+    unsigned long long trace_start = furry_trace_on(FURRY_TRACE_HOST) ? furry_trace_now() : 0;
+    size_t size = block->end - block->begin;
+    char *text = furry_alloc(FURRY_MEM_COMPILER, size + 1);
+    block->parsed = furry_calloc(FURRY_MEM_COMPILER, block->count + 1, sizeof(FurryInstruction));
+    block->lines = furry_calloc(FURRY_MEM_COMPILER, block->count + 1, sizeof(int));
+    if (text == NULL || block->parsed == NULL || block->lines == NULL) {
+        furry_free(text);
+        set_error(&block->error, block->line_base + 1, "out of memory");
+        return FURRY_ERR;
+    }
+    memcpy(text, lazy->script + block->begin, size);
+    text[size] = '\0';
+
+    FurryScratch scratch;
+    furry_scratch_init(&scratch, LAZY_SCRATCH_CHUNK);
+    int rc = FURRY_OK;
+    int line_number = block->line_base;
+    size_t n = 0;
+    size_t pos = 0;
+    size_t begin = 0;
+    size_t end = 0;
+    while (rc == FURRY_OK && next_line(text, &pos, size, &begin, &end)) {
+        line_number++;
+        if (!is_instruction_line(text, begin, end)) {
+            continue;
+        }
+        text[end] = '\0';
+        furry_scratch_reset(&scratch);
+        if (n >= block->count || furry_parse_line(&scratch, text + begin, &block->parsed[n]) != FURRY_OK) {
+            set_error(&block->error, line_number, LAZY_SYNTAX_ERROR);
+            rc = FURRY_ERR;
+            break;
+        }
+        block->lines[n++] = line_number;
+    }
+    furry_scratch_free(&scratch);
+    furry_free(text);
+    if (trace_start != 0) {
+        furry_trace_record(FURRY_TRACE_LAZY_PARSE, trace_start, furry_trace_now() - trace_start, (unsigned)block->count, NULL);
+    }
+    return rc;
+}
+
+static int claim_block(LazyBlock *block) {
+    int expected = BLOCK_PENDING;
+    return atomic_compare_exchange_strong_explicit(&block->state, &expected, BLOCK_PARSING, memory_order_acq_rel, memory_order_acquire);
+}
+
+static void publish_block(FurryLazyProgram *lazy, LazyBlock *block, int rc) {
+    mtx_lock(&lazy->lock);
+    atomic_store_explicit(&block->state, rc == FURRY_OK ? BLOCK_PARSED : BLOCK_FAILED, memory_order_release);
+    cnd_broadcast(&lazy->parsed);
+    mtx_unlock(&lazy->lock);
+}
+
+static int background_main(void *arg) {
+    FurryLazyProgram *lazy = arg;
+    furry_trace_thread_name("furry lazy parse");
+    for (size_t i = 0; i < lazy->block_count && !atomic_load_explicit(&lazy->stop, memory_order_acquire); ++i) {
+        LazyBlock *block = &lazy->blocks[i];
+        if (claim_block(block)) {
+            publish_block(lazy, block, parse_block(lazy, block));
+            atomic_fetch_add_explicit(&lazy->background_blocks, 1, memory_order_relaxed);
+        }
+    }
+    return 0;
+}
+
+static int compare_labels(const void *a, const void *b) {
+    const LazyLabel *la = a;
+    const LazyLabel *lb = b;
+    int order = strcmp(la->name, lb->name);
+    return order != 0 ? order : (la->index > lb->index) - (la->index < lb->index);
+}
+
+/* First definition wins, as with find_label. */
+static int lookup_label(const FurryProgram *program, const char *label, void *user_data) {
+    (void)program;
+    const FurryLazyProgram *lazy = user_data;
+    size_t lo = 0;
+    size_t hi = lazy->label_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(lazy->labels[mid].name, label) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < lazy->label_count && strcmp(lazy->labels[lo].name, label) == 0 ? lazy->labels[lo].index : -1;
+}
+
+static int fail_block(LazyBlock *block, FurryCompileError *out_error) {
+    atomic_store_explicit(&block->state, BLOCK_FAILED, memory_order_release);
+    if (out_error != NULL) {
+        *out_error = block->error;
+    }
+    return FURRY_ERR;
+}
+
+/* Runs on the owning thread only: expressions, string ids and slots go into the shared program here. */
+static int install_block(FurryLazyProgram *lazy, LazyBlock *block, FurryCompileError *out_error) {
+    if (atomic_load_explicit(&block->state, memory_order_acquire) == BLOCK_FAILED) {
+        return fail_block(block, out_error);
+    }
+    unsigned long long trace_start = furry_trace_on(FURRY_TRACE_HOST) ? furry_trace_now() : 0;
+    char err[FURRY_MAX_ERROR_TEXT];
+    for (size_t i = 0; i < block->count; ++i) {
+        if (furry_prepare_instruction(&lazy->program, &block->parsed[i], err, sizeof(err)) != FURRY_OK) {
+            set_error(&block->error, block->lines[i], err[0] != '\0' ? err : LAZY_SYNTAX_ERROR);
+            return fail_block(block, out_error);
+        }
+    }
+    FurryInstruction *code = &lazy->program.code[block->first];
+    memcpy(code, block->parsed, block->count * sizeof(FurryInstruction));
+    if (furry_validate_range(&lazy->program, block->first, block->first + block->count, lookup_label, lazy, &block->error) != FURRY_OK) {
+        /* Labels stay in place for the rest of the program; the block goes back to blank. */
+        for (size_t i = 0; i < block->count; ++i) {
+            if (code[i].op != FURRY_OP_LABEL) {
+                memset(&code[i], 0, sizeof(code[i]));
+            }
+        }
+        return fail_block(block, out_error);
+    }
+    furry_free(block->parsed);
+    furry_free(block->lines);
+    block->parsed = NULL;
+    block->lines = NULL;
+    lazy->installed++;
+    atomic_store_explicit(&block->state, BLOCK_INSTALLED, memory_order_release);
+    if (trace_start != 0) {
+        furry_trace_record(FURRY_TRACE_LAZY_INSTALL, trace_start, furry_trace_now() - trace_start, (unsigned)block->count, NULL);
+    }
+    return FURRY_OK;
+}
+
+static int ensure_block(FurryLazyProgram *lazy, LazyBlock *block, FurryCompileError *out_error) {
+    if (atomic_load_explicit(&block->state, memory_order_acquire) == BLOCK_INSTALLED) {
+        return FURRY_OK;
+    }
+    if (claim_block(block)) {
+        publish_block(lazy, block, parse_block(lazy, block));
+    } else {
+        mtx_lock(&lazy->lock);
+        while (atomic_load_explicit(&block->state, memory_order_acquire) == BLOCK_PARSING) {
+            cnd_wait(&lazy->parsed, &lazy->lock);
+        }
+        mtx_unlock(&lazy->lock);
+    }
+    return install_block(lazy, block, out_error);
+}
+
+/* Splits the script at top-level labels and puts every label in place; nothing else is parsed. */
+static int prepass(FurryLazyProgram *lazy, FurryCompileError *out_error) {
+    const char *script = lazy->script;
+    size_t size = strlen(script);
+    size_t block_capacity = 0;
+    size_t label_capacity = 0;
+    size_t count = 0;
+    int depth = 0;
+    int line_number = 0;
+    size_t pos = 0;
+    size_t line_start = 0;
+    size_t begin = 0;
+    size_t end = 0;
+    for (;;) {
+        while (pos < size && script[pos] == '\n') {
+            pos++;
+        }
+        line_start = pos;
+        if (!next_line(script, &pos, size, &begin, &end)) {
+            break;
+        }
+        line_number++;
+        if (!is_instruction_line(script, begin, end)) {
+            continue;
+        }
+        int is_label = script[end - 1] == ':';
+        if (count == 0 || (is_label && depth == 0)) {
+            if (lazy->block_count == block_capacity) {
+                block_capacity = block_capacity == 0 ? 16 : block_capacity * 2;
+                LazyBlock *blocks = furry_realloc(FURRY_MEM_COMPILER, lazy->blocks, block_capacity * sizeof(LazyBlock));
+                if (blocks == NULL) {
+                    return FURRY_ERR;
+                }
+                lazy->blocks = blocks;
+            }
+            if (lazy->block_count > 0) {
+                LazyBlock *prev = &lazy->blocks[lazy->block_count - 1];
+                prev->end = line_start;
+                prev->count = count - prev->first;
+            }
+            LazyBlock *block = &lazy->blocks[lazy->block_count++];
+            memset(block, 0, sizeof(*block));
+            block->begin = line_start;
+            block->first = count;
+            block->line_base = line_number - 1;
+            atomic_init(&block->state, BLOCK_PENDING);
+        }
+        if (is_label) {
+            size_t name_end = end - 1;
+            while (name_end > begin && isspace((unsigned char)script[name_end - 1])) {
+                name_end--;
+            }
+            if (name_end - begin >= FURRY_MAX_LABEL) {
+                set_error(out_error, line_number, LAZY_SYNTAX_ERROR);
+                return FURRY_ERR;
+            }
+            if (lazy->label_count == label_capacity) {
+                label_capacity = label_capacity == 0 ? 64 : label_capacity * 2;
+                LazyLabel *labels = furry_realloc(FURRY_MEM_COMPILER, lazy->labels, label_capacity * sizeof(LazyLabel));
+                if (labels == NULL) {
+                    return FURRY_ERR;
+                }
+                lazy->labels = labels;
+            }
+            /* Offsets into the script until the instruction array exists. */
+            lazy->labels[lazy->label_count].name = script + begin;
+            lazy->labels[lazy->label_count++].index = (int)(name_end - begin);
+        } else if (end - begin > 9 && strncmp(script + begin, "ui_begin ", 9) == 0) {
+            depth++;
+        } else if (end - begin == 6 && strncmp(script + begin, "ui_end", 6) == 0) {
+            depth--;
+        }
+        count++;
+    }
+    if (lazy->block_count > 0) {
+        LazyBlock *last = &lazy->blocks[lazy->block_count - 1];
+        last->end = size;
+        last->count = count - last->first;
+    }
+
+    lazy->program.code = furry_calloc(FURRY_MEM_COMPILER, count + 1, sizeof(FurryInstruction));
+    if (lazy->program.code == NULL) {
+        return FURRY_ERR;
+    }
+    /* Left untouched: at several KB per instruction, even marking each one would cost a page fault apiece. */
+    lazy->program.count = count;
+
+    /* Second walk over the labels only: find each one's instruction index. */
+    size_t next_label = 0;
+    size_t index = 0;
+    pos = 0;
+    while (next_label < lazy->label_count && next_line(script, &pos, size, &begin, &end)) {
+        if (!is_instruction_line(script, begin, end)) {
+            continue;
+        }
+        if (script + begin == lazy->labels[next_label].name) {
+            FurryInstruction *ins = &lazy->program.code[index];
+            size_t length = (size_t)lazy->labels[next_label].index;
+            ins->op = FURRY_OP_LABEL;
+            memcpy(ins->a, script + begin, length);
+            ins->a[length] = '\0';
+            lazy->labels[next_label].name = ins->a;
+            lazy->labels[next_label++].index = (int)index;
+        }
+        index++;
+    }
+    qsort(lazy->labels, lazy->label_count, sizeof(LazyLabel), compare_labels);
+    return FURRY_OK;
+}
+
+int furry_lazy_open(const char *script, const FurryLazyConfig *config, FurryLazyProgram **out_lazy, FurryCompileError *out_error) {
+    set_error(out_error, 0, "");
+    if (script == NULL || out_lazy == NULL) {
+        set_error(out_error, 0, "script or output program is null");
+        return FURRY_ERR;
+    }
+    *out_lazy = NULL;
+    FurryLazyProgram *lazy = furry_calloc(FURRY_MEM_COMPILER, 1, sizeof(FurryLazyProgram));
+    if (lazy == NULL) {
+        return FURRY_ERR;
+    }
+    size_t size = strlen(script);
+    lazy->script = furry_alloc(FURRY_MEM_COMPILER, size + 1);
+    if (lazy->script == NULL || mtx_init(&lazy->lock, mtx_plain) != thrd_success) {
+        furry_free(lazy->script);
+        furry_free(lazy);
+        return FURRY_ERR;
+    }
+    if (cnd_init(&lazy->parsed) != thrd_success) {
+        mtx_destroy(&lazy->lock);
+        furry_free(lazy->script);
+        furry_free(lazy);
+        return FURRY_ERR;
+    }
+    memcpy(lazy->script, script, size + 1);
+    atomic_init(&lazy->stop, 0);
+    atomic_init(&lazy->background_blocks, 0);
+
+    unsigned long long trace_start = furry_trace_on(FURRY_TRACE_HOST) ? furry_trace_now() : 0;
+    if (prepass(lazy, out_error) != FURRY_OK) {
+        furry_lazy_close(lazy);
+        return FURRY_ERR;
+    }
+    if (trace_start != 0) {
+        furry_trace_record(FURRY_TRACE_LAZY_PREPASS, trace_start, furry_trace_now() - trace_start, (unsigned)lazy->program.count, NULL);
+    }
+    if ((lazy->block_count > 0 && ensure_block(lazy, &lazy->blocks[0], out_error) != FURRY_OK)) {
+        furry_lazy_close(lazy);
+        return FURRY_ERR;
+    }
+    if (config != NULL && config->background && lazy->block_count > 1) {
+        lazy->has_thread = thrd_create(&lazy->thread, background_main, lazy) == thrd_success;
+    }
+    *out_lazy = lazy;
+    return FURRY_OK;
+}
+
+void furry_lazy_close(FurryLazyProgram *lazy) {
+    if (lazy == NULL) {
+        return;
+    }
+    atomic_store_explicit(&lazy->stop, 1, memory_order_release);
+    if (lazy->has_thread) {
+        thrd_join(lazy->thread, NULL);
+    }
+    for (size_t i = 0; i < lazy->block_count; ++i) {
+        furry_free(lazy->blocks[i].parsed);
+        furry_free(lazy->blocks[i].lines);
+    }
+    cnd_destroy(&lazy->parsed);
+    mtx_destroy(&lazy->lock);
+    furry_free_program(&lazy->program);
+    furry_free(lazy->blocks);
+    furry_free(lazy->labels);
+    furry_free(lazy->script);
+    furry_free(lazy);
+}
+
+const FurryProgram *furry_lazy_program(const FurryLazyProgram *lazy) {
+    return lazy != NULL ? &lazy->program : NULL;
+}
+
+static LazyBlock *find_block(FurryLazyProgram *lazy, size_t ip) {
+    size_t lo = 0;
+    size_t hi = lazy->block_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lazy->blocks[mid].first <= ip) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return &lazy->blocks[lo];
+}
+
+int furry_lazy_ensure(FurryLazyProgram *lazy, size_t ip, FurryCompileError *out_error) {
+    if (lazy == NULL || ip >= lazy->program.count) {
+        return FURRY_ERR;
+    }
+    return ensure_block(lazy, find_block(lazy, ip), out_error);
+}
+
+int furry_lazy_enter(FurryLazyProgram *lazy, size_t ip, size_t *out_begin, size_t *out_end) {
+    if (lazy == NULL || ip >= lazy->program.count) {
+        return FURRY_ERR;
+    }
+    LazyBlock *block = find_block(lazy, ip);
+    if (ensure_block(lazy, block, NULL) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    *out_begin = block->first;
+    *out_end = block->first + block->count;
+    return FURRY_OK;
+}
+
+int furry_lazy_poll(FurryLazyProgram *lazy, FurryCompileError *out_error) {
+    if (lazy == NULL) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < lazy->block_count; ++i) {
+        LazyBlock *block = &lazy->blocks[i];
+        int state = atomic_load_explicit(&block->state, memory_order_acquire);
+        if (state == BLOCK_PARSED && install_block(lazy, block, out_error) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    return FURRY_OK;
+}
+
+int furry_lazy_finish(FurryLazyProgram *lazy, FurryCompileError *out_error) {
+    if (lazy == NULL) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < lazy->block_count; ++i) {
+        if (ensure_block(lazy, &lazy->blocks[i], out_error) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    return furry_check_string_ids(&lazy->program, out_error);
+}
+
+void furry_lazy_stats(const FurryLazyProgram *lazy, FurryLazyStats *out_stats) {
+    if (out_stats == NULL) {
+        return;
+    }
+    memset(out_stats, 0, sizeof(*out_stats));
+    if (lazy != NULL) {
+        out_stats->blocks = lazy->block_count;
+        out_stats->installed_blocks = lazy->installed;
+        out_stats->background_blocks = atomic_load_explicit(&lazy->background_blocks, memory_order_relaxed);
+    }
+}
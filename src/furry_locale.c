@@ -0,0 +1,429 @@
+#include "furry_locale.h"
+#include "furry_internal.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOCALE_MAGIC "FYLT"
+#define LOCALE_VERSION 1u
+
+/* On-disk table: header, `count` entries sorted by id, then a blob of NUL-terminated strings. */
+typedef struct LocaleHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t blob_size;
+} LocaleHeader;
+
+typedef struct LocaleEntry {
+    uint32_t id;
+    uint32_t offset;
+} LocaleEntry;
+
+typedef struct LocaleTable {
+    FurryMappedFile file;
+    const LocaleEntry *entries;
+    uint32_t count;
+    const char *blob;
+    struct LocaleTable *next_retired;
+} LocaleTable;
+
+/*
+ * Programs running on other threads may be inside a lookup of the current table while
+ * furry_locale_switch installs the next one, so replaced tables stay mapped on the retired
+ * list until a switch or close sees no program running.
+ */
+struct FurryLocale {
+    _Atomic(LocaleTable *) table;
+    LocaleTable *retired;
+    atomic_uint generation;
+    atomic_int runs;
+};
+
+/* Generations are unique across locales, so a locale reopened at a freed one's address never matches its output. */
+static atomic_uint next_generation = 1;
+
+typedef struct LocaleString {
+    unsigned id;
+    const char *text;
+    size_t index;
+} LocaleString;
+
+unsigned furry_locale_string_id(const char *text) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *cur = (const unsigned char *)text; *cur != '\0'; ++cur) {
+        hash ^= *cur;
+        hash *= 16777619u;
+    }
+    return hash == 0 ? 1u : (unsigned)hash;
+}
+
+static int compare_strings_by_id(const void *lhs, const void *rhs) {
+    const LocaleString *a = lhs;
+    const LocaleString *b = rhs;
+    if (a->id != b->id) {
+        return (a->id > b->id) - (a->id < b->id);
+    }
+    return (a->index > b->index) - (a->index < b->index);
+}
+
+static int compare_entries_by_id(const void *lhs, const void *rhs) {
+    const LocaleEntry *a = lhs;
+    const LocaleEntry *b = rhs;
+    return (a->id > b->id) - (a->id < b->id);
+}
+
+static int push_string(LocaleString **items, size_t *count, size_t *capacity, unsigned id, const char *text, size_t index) {
+    if (id == 0) {
+        return FURRY_OK;
+    }
+    if (*count == *capacity) {
+        size_t next = *capacity == 0 ? 64 : *capacity * 2;
+        LocaleString *resized = furry_realloc(FURRY_MEM_LOCALE, *items, next * sizeof(LocaleString));
+        if (resized == NULL) {
+            return FURRY_ERR;
+        }
+        *items = resized;
+        *capacity = next;
+    }
+    (*items)[*count].id = id;
+    (*items)[*count].text = text;
+    (*items)[*count].index = index;
+    (*count)++;
+    return FURRY_OK;
+}
+
+/*
+ * Gathers every localizable program string, sorted and de-duplicated by id. Two different texts
+ * hashing to the same id fail with both instruction numbers in out_error.
+ */
+static int collect_program_strings(const FurryProgram *program, LocaleString **out_items, size_t *out_count,
+                                   FurryCompileError *out_error) {
+    LocaleString *items = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    for (size_t i = 0; i < program->count; ++i) {
+        const FurryInstruction *ins = &program->code[i];
+        const char *text = ins->op == FURRY_OP_CHOICE ? ins->a : ins->b;
+        if (push_string(&items, &count, &capacity, ins->name_id, ins->a, i) != FURRY_OK ||
+            push_string(&items, &count, &capacity, ins->text_id, text, i) != FURRY_OK) {
+            furry_free(items);
+            return FURRY_ERR;
+        }
+        if (ins->op != FURRY_OP_CHOICE) {
+            continue;
+        }
+        for (size_t c = 0; c < ins->choice_count; ++c) {
+            if (push_string(&items, &count, &capacity, ins->choices[c].text_id, ins->choices[c].text, i) != FURRY_OK) {
+                furry_free(items);
+                return FURRY_ERR;
+            }
+        }
+    }
+
+    if (count > 0) {
+        qsort(items, count, sizeof(LocaleString), compare_strings_by_id);
+    }
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (unique > 0 && items[unique - 1].id == items[i].id) {
+            if (strcmp(items[unique - 1].text, items[i].text) != 0) {
+                if (out_error != NULL) {
+                    out_error->line = (int)items[i].index + 1;
+                    snprintf(out_error->message, sizeof(out_error->message), "text on lines %zu and %zu shares string id %08x",
+                             items[unique - 1].index + 1, items[i].index + 1, items[i].id);
+                }
+                furry_free(items);
+                return FURRY_ERR;
+            }
+            continue;
+        }
+        items[unique++] = items[i];
+    }
+
+    *out_items = items;
+    *out_count = unique;
+    return FURRY_OK;
+}
+
+int furry_check_string_ids(const FurryProgram *program, FurryCompileError *out_error) {
+    LocaleString *items = NULL;
+    size_t count = 0;
+    if (collect_program_strings(program, &items, &count, out_error) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    furry_free(items);
+    return FURRY_OK;
+}
+
+int furry_locale_export_template(const FurryProgram *program, const char *path) {
+    if (program == NULL || path == NULL) {
+        return FURRY_ERR;
+    }
+    LocaleString *items = NULL;
+    size_t count = 0;
+    if (collect_program_strings(program, &items, &count, NULL) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        furry_free(items);
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(file, "%08x\t%s\n", items[i].id, items[i].text);
+    }
+    furry_free(items);
+    return fclose(file) == 0 ? FURRY_OK : FURRY_ERR;
+}
+
+int furry_locale_build_table(const char *source_path, const char *table_path) {
+    if (source_path == NULL || table_path == NULL) {
+        return FURRY_ERR;
+    }
+    FILE *source = fopen(source_path, "r");
+    if (source == NULL) {
+        return FURRY_ERR;
+    }
+
+    LocaleEntry *entries = NULL;
+    char *blob = NULL;
+    size_t count = 0;
+    size_t blob_size = 0;
+    int rc = FURRY_OK;
+    char line[FURRY_MAX_TEXT + 32];
+    while (rc == FURRY_OK && fgets(line, sizeof(line), source) != NULL) {
+        size_t len = strcspn(line, "\r\n");
+        if (line[len] == '\0' && !feof(source)) {
+            rc = FURRY_ERR;
+            break;
+        }
+        line[len] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        char *tab = strchr(line, '\t');
+        char *end = NULL;
+        unsigned long id = tab == NULL ? 0 : strtoul(line, &end, 16);
+        if (tab == NULL || end != tab || id == 0 || id > 0xffffffffUL) {
+            rc = FURRY_ERR;
+            break;
+        }
+        size_t text_len = strlen(tab + 1);
+        LocaleEntry *grown_entries = furry_realloc(FURRY_MEM_LOCALE, entries, (count + 1) * sizeof(LocaleEntry));
+        char *grown_blob = grown_entries == NULL ? NULL : furry_realloc(FURRY_MEM_LOCALE, blob, blob_size + text_len + 1);
+        if (grown_entries != NULL) {
+            entries = grown_entries;
+        }
+        if (grown_blob == NULL) {
+            rc = FURRY_ERR;
+            break;
+        }
+        blob = grown_blob;
+        entries[count].id = (uint32_t)id;
+        entries[count].offset = (uint32_t)blob_size;
+        memcpy(blob + blob_size, tab + 1, text_len + 1);
+        blob_size += text_len + 1;
+        count++;
+    }
+    fclose(source);
+
+    if (rc == FURRY_OK && count > 0) {
+        qsort(entries, count, sizeof(LocaleEntry), compare_entries_by_id);
+    }
+    for (size_t i = 1; rc == FURRY_OK && i < count; ++i) {
+        if (entries[i].id == entries[i - 1].id) {
+            rc = FURRY_ERR;
+        }
+    }
+
+    FILE *table = rc == FURRY_OK ? fopen(table_path, "wb") : NULL;
+    if (table != NULL) {
+        LocaleHeader header;
+        memcpy(header.magic, LOCALE_MAGIC, 4);
+        header.version = LOCALE_VERSION;
+        header.count = (uint32_t)count;
+        header.blob_size = (uint32_t)blob_size;
+        if (fwrite(&header, sizeof(header), 1, table) != 1 ||
+            (count > 0 && fwrite(entries, sizeof(LocaleEntry), count, table) != count) ||
+            (blob_size > 0 && fwrite(blob, 1, blob_size, table) != blob_size)) {
+            rc = FURRY_ERR;
+        }
+        if (fclose(table) != 0) {
+            rc = FURRY_ERR;
+        }
+    } else {
+        rc = FURRY_ERR;
+    }
+
+    furry_free(entries);
+    furry_free(blob);
+    return rc;
+}
+
+static int map_table(const char *table_path, LocaleTable *out) {
+    FurryMappedFile file;
+    if (furry_map_file(table_path, &file) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    const LocaleHeader *header = (const LocaleHeader *)file.data;
+    if (file.size < sizeof(LocaleHeader) || memcmp(header->magic, LOCALE_MAGIC, 4) != 0 || header->version != LOCALE_VERSION) {
+        furry_unmap_file(&file);
+        return FURRY_ERR;
+    }
+    size_t entries_size = (size_t)header->count * sizeof(LocaleEntry);
+    if (file.size != sizeof(LocaleHeader) + entries_size + header->blob_size ||
+        (header->blob_size > 0 && file.data[file.size - 1] != '\0')) {
+        furry_unmap_file(&file);
+        return FURRY_ERR;
+    }
+    const LocaleEntry *entries = (const LocaleEntry *)(file.data + sizeof(LocaleHeader));
+    for (uint32_t i = 0; i < header->count; ++i) {
+        if (entries[i].offset >= header->blob_size) {
+            furry_unmap_file(&file);
+            return FURRY_ERR;
+        }
+    }
+
+    out->file = file;
+    out->entries = entries;
+    out->count = header->count;
+    out->blob = (const char *)(file.data + sizeof(LocaleHeader) + entries_size);
+    return FURRY_OK;
+}
+
+static LocaleTable *open_table(const char *table_path) {
+    LocaleTable *table = furry_calloc(FURRY_MEM_LOCALE, 1, sizeof(LocaleTable));
+    if (table != NULL && map_table(table_path, table) != FURRY_OK) {
+        furry_free(table);
+        table = NULL;
+    }
+    return table;
+}
+
+static void close_table(LocaleTable *table) {
+    furry_unmap_file(&table->file);
+    furry_free(table);
+}
+
+static void close_retired(FurryLocale *locale) {
+    while (locale->retired != NULL) {
+        LocaleTable *next = locale->retired->next_retired;
+        close_table(locale->retired);
+        locale->retired = next;
+    }
+}
+
+int furry_locale_open(const char *table_path, FurryLocale **out_locale) {
+    if (out_locale == NULL) {
+        return FURRY_ERR;
+    }
+    *out_locale = NULL;
+    FurryLocale *locale = furry_calloc(FURRY_MEM_LOCALE, 1, sizeof(FurryLocale));
+    if (locale == NULL) {
+        return FURRY_ERR;
+    }
+    LocaleTable *table = open_table(table_path);
+    if (table == NULL) {
+        furry_free(locale);
+        return FURRY_ERR;
+    }
+    atomic_init(&locale->table, table);
+    atomic_init(&locale->generation, atomic_fetch_add(&next_generation, 1u));
+    atomic_init(&locale->runs, 0);
+    *out_locale = locale;
+    return FURRY_OK;
+}
+
+int furry_locale_switch(FurryLocale *locale, const char *table_path) {
+    if (locale == NULL) {
+        return FURRY_ERR;
+    }
+    LocaleTable *next = open_table(table_path);
+    if (next == NULL) {
+        return FURRY_ERR;
+    }
+    LocaleTable *previous = atomic_exchange(&locale->table, next);
+    atomic_store(&locale->generation, atomic_fetch_add(&next_generation, 1u));
+    previous->next_retired = locale->retired;
+    locale->retired = previous;
+    /* A run that starts after this load already sees the new table. */
+    if (atomic_load(&locale->runs) == 0) {
+        close_retired(locale);
+    }
+    return FURRY_OK;
+}
+
+void furry_locale_close(FurryLocale *locale) {
+    if (locale == NULL) {
+        return;
+    }
+    close_retired(locale);
+    close_table(atomic_load(&locale->table));
+    furry_free(locale);
+}
+
+void furry_locale_begin_run(const FurryLocale *locale) {
+    if (locale != NULL) {
+        atomic_fetch_add(&((FurryLocale *)locale)->runs, 1);
+    }
+}
+
+void furry_locale_end_run(const FurryLocale *locale) {
+    if (locale != NULL) {
+        atomic_fetch_sub(&((FurryLocale *)locale)->runs, 1);
+    }
+}
+
+const char *furry_locale_lookup(const FurryLocale *locale, unsigned id) {
+    if (locale == NULL || id == 0) {
+        return NULL;
+    }
+    const LocaleTable *table = atomic_load_explicit(&((FurryLocale *)locale)->table, memory_order_acquire);
+    size_t lo = 0;
+    size_t hi = table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table->entries[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < table->count && table->entries[lo].id == id) {
+        return table->blob + table->entries[lo].offset;
+    }
+    return NULL;
+}
+
+unsigned furry_locale_generation(const FurryLocale *locale) {
+    return locale == NULL ? 0 : atomic_load_explicit(&((FurryLocale *)locale)->generation, memory_order_acquire);
+}
+
+size_t furry_locale_string_count(const FurryLocale *locale) {
+    return locale == NULL ? 0 : atomic_load_explicit(&((FurryLocale *)locale)->table, memory_order_acquire)->count;
+}
+
+size_t furry_locale_report_missing(const FurryLocale *locale, const FurryProgram *program, FILE *out) {
+    if (program == NULL) {
+        return 0;
+    }
+    LocaleString *items = NULL;
+    size_t count = 0;
+    if (collect_program_strings(program, &items, &count, NULL) != FURRY_OK) {
+        return 0;
+    }
+    size_t missing = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (furry_locale_lookup(locale, items[i].id) == NULL) {
+            missing++;
+            if (out != NULL) {
+                fprintf(out, "%08x\t%s\n", items[i].id, items[i].text);
+            }
+        }
+    }
+    furry_free(items);
+    return missing;
+}
@@ -0,0 +1,298 @@
+#include "furry_lua.h"
+#include "furry_internal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+
+#define BUILDER_META "furry.builder"
+
+typedef struct LuaBuilder {
+    FurryProgramBuilder *builder;
+    /* Lua line of the first failing call, for furry_lua_build_file. */
+    int error_line;
+} LuaBuilder;
+
+static LuaBuilder *check_builder(lua_State *L) {
+    LuaBuilder *ud = luaL_checkudata(L, 1, BUILDER_META);
+    if (ud->builder == NULL) {
+        luaL_error(L, "furry: builder is closed");
+    }
+    return ud;
+}
+
+FurryProgramBuilder *furry_lua_check_builder(lua_State *L, int index) {
+    LuaBuilder *ud = luaL_checkudata(L, index, BUILDER_META);
+    return ud->builder;
+}
+
+/* Turns a failed emit into a Lua error at the caller's line. */
+static int check_emit(lua_State *L, LuaBuilder *ud, int rc) {
+    if (rc == FURRY_OK) {
+        return 0;
+    }
+    const FurryCompileError *error = furry_builder_error(ud->builder);
+    lua_Debug ar;
+    if (ud->error_line == 0 && lua_getstack(L, 1, &ar) && lua_getinfo(L, "l", &ar)) {
+        ud->error_line = ar.currentline;
+    }
+    return luaL_error(L, "furry: %s", error != NULL ? error->message : "emit failed");
+}
+
+static int l_label(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_label(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_say(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_say(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3)));
+}
+
+static int l_jump(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_goto(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_call(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_call(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_ret(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_return(ud->builder));
+}
+
+static int l_set(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_set(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3)));
+}
+
+static int l_set_expr(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_set_expr(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3)));
+}
+
+static int l_add(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_add(ud->builder, luaL_checkstring(L, 2), (int)luaL_checkinteger(L, 3)));
+}
+
+static int l_if_eq(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_if_eq(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3), luaL_checkstring(L, 4)));
+}
+
+static int l_when(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_if(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3)));
+}
+
+/* Options are {text, target} pairs or {text = ..., target = ...} tables. */
+static int l_choice(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    const char *prompt = luaL_checkstring(L, 2);
+    luaL_checktype(L, 3, LUA_TTABLE);
+    FurryBuilderOption options[FURRY_MAX_CHOICES];
+    size_t count = (size_t)lua_rawlen(L, 3);
+    luaL_argcheck(L, count > 0 && count <= FURRY_MAX_CHOICES, 3, "expected 1 to FURRY_MAX_CHOICES options");
+    for (size_t c = 0; c < count; ++c) {
+        lua_rawgeti(L, 3, (lua_Integer)c + 1);
+        luaL_argcheck(L, lua_istable(L, -1), 3, "each option must be a table");
+        if (lua_getfield(L, -1, "text") == LUA_TNIL) {
+            lua_pop(L, 1);
+            lua_rawgeti(L, -1, 1);
+        }
+        if (lua_getfield(L, -2, "target") == LUA_TNIL) {
+            lua_pop(L, 1);
+            lua_rawgeti(L, -2, 2);
+        }
+        luaL_argcheck(L, lua_type(L, -2) == LUA_TSTRING && lua_type(L, -1) == LUA_TSTRING, 3, "option needs text and target strings");
+        /* The strings stay referenced by the option table, which stays referenced by argument 3. */
+        options[c].text = lua_tostring(L, -2);
+        options[c].target = lua_tostring(L, -1);
+        lua_pop(L, 3);
+    }
+    return check_emit(L, ud, furry_emit_choice(ud->builder, prompt, options, count));
+}
+
+static int l_save(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_save(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_load(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_load(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_stop(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_end(ud->builder));
+}
+
+static int l_spawn(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_spawn(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_wait(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_wait(ud->builder, (int)luaL_checkinteger(L, 2)));
+}
+
+static int l_wait_event(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_wait_event(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_signal(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_signal(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_bg(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_bg(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_fg(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_fg(ud->builder, luaL_checkstring(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4),
+                                           luaL_optnumber(L, 5, 0.0), luaL_optstring(L, 6, "none")));
+}
+
+static int l_music(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_music(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_sfx(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_sfx(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_ui_begin(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_begin(ud->builder, luaL_checkstring(L, 2)));
+}
+
+static int l_ui_end(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_end(ud->builder));
+}
+
+static int l_ui_panel(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_panel(ud->builder, luaL_checkstring(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4),
+                                                 luaL_checknumber(L, 5), luaL_checknumber(L, 6)));
+}
+
+static int l_ui_text(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_text(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3)));
+}
+
+static int l_ui_image(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_image(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3)));
+}
+
+static int l_ui_anim(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_anim(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3), luaL_optstring(L, 4, "loop")));
+}
+
+static int l_ui_video(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_video(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3), lua_toboolean(L, 4)));
+}
+
+static int l_ui_bind(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_ui_bind(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3)));
+}
+
+static int l_button(lua_State *L) {
+    LuaBuilder *ud = check_builder(L);
+    return check_emit(L, ud, furry_emit_button(ud->builder, luaL_checkstring(L, 2), luaL_checkstring(L, 3), luaL_checkstring(L, 4)));
+}
+
+static int l_gc(lua_State *L) {
+    LuaBuilder *ud = luaL_checkudata(L, 1, BUILDER_META);
+    furry_builder_destroy(ud->builder);
+    ud->builder = NULL;
+    return 0;
+}
+
+static const luaL_Reg builder_methods[] = {
+    {"label", l_label},       {"say", l_say},           {"jump", l_jump},         {"call", l_call},       {"ret", l_ret},
+    {"set", l_set},           {"set_expr", l_set_expr}, {"add", l_add},           {"if_eq", l_if_eq},     {"when", l_when},
+    {"choice", l_choice},     {"save", l_save},         {"load", l_load},         {"stop", l_stop},       {"bg", l_bg},
+    {"fg", l_fg},             {"music", l_music},       {"sfx", l_sfx},           {"ui_begin", l_ui_begin}, {"ui_end", l_ui_end},
+    {"ui_panel", l_ui_panel}, {"ui_text", l_ui_text},   {"ui_image", l_ui_image}, {"ui_anim", l_ui_anim}, {"ui_video", l_ui_video},
+    {"ui_bind", l_ui_bind},   {"button", l_button},     {"spawn", l_spawn},       {"wait", l_wait},       {"wait_event", l_wait_event},
+    {"signal", l_signal},     {NULL, NULL}};
+
+static int l_builder(lua_State *L) {
+    LuaBuilder *ud = lua_newuserdata(L, sizeof(LuaBuilder));
+    ud->builder = NULL;
+    ud->error_line = 0;
+    luaL_setmetatable(L, BUILDER_META);
+    if (furry_builder_create(&ud->builder) != FURRY_OK) {
+        return luaL_error(L, "furry: out of memory");
+    }
+    return 1;
+}
+
+int luaopen_furry(lua_State *L) {
+    if (luaL_newmetatable(L, BUILDER_META)) {
+        luaL_newlib(L, builder_methods);
+        lua_setfield(L, -2, "__index");
+        lua_pushcfunction(L, l_gc);
+        lua_setfield(L, -2, "__gc");
+    }
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_pushcfunction(L, l_builder);
+    lua_setfield(L, -2, "builder");
+    return 1;
+}
+
+int furry_lua_build_file(const char *path, FurryProgram *out_program, FurryCompileError *out_error) {
+    if (path == NULL || out_program == NULL) {
+        return FURRY_ERR;
+    }
+    memset(out_program, 0, sizeof(*out_program));
+    lua_State *L = luaL_newstate();
+    if (L == NULL) {
+        return FURRY_ERR;
+    }
+    luaL_openlibs(L);
+    luaL_requiref(L, "furry", luaopen_furry, 1);
+    lua_pop(L, 1);
+    lua_pushcfunction(L, l_builder);
+    int rc = lua_pcall(L, 0, 1, 0) == LUA_OK ? FURRY_OK : FURRY_ERR;
+    LuaBuilder *ud = rc == FURRY_OK ? lua_touserdata(L, -1) : NULL;
+    if (ud != NULL) {
+        lua_setglobal(L, "program");
+        if (luaL_dofile(L, path) == LUA_OK) {
+            rc = furry_builder_finish(ud->builder, out_program, out_error);
+        } else {
+            rc = FURRY_ERR;
+            if (out_error != NULL) {
+                out_error->line = ud->error_line;
+                snprintf(out_error->message, sizeof(out_error->message), "%s", lua_tostring(L, -1) != NULL ? lua_tostring(L, -1) : "lua error");
+            }
+        }
+    } else if (out_error != NULL) {
+        out_error->line = 0;
+        snprintf(out_error->message, sizeof(out_error->message), "%s", "cannot create builder");
+    }
+    lua_close(L);
+    return rc;
+}
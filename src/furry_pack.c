@@ -0,0 +1,598 @@
+#include "furry_pack.h"
+#include "furry_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACK_MAGIC "FYPK"
+#define PACK_VERSION 1u
+#define PACK_DEFAULT_ALIGNMENT 64u
+#define PACK_FLAG_LZ 1u
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+/* Matches stop this far from the end, so a block always finishes with a literal-only sequence. */
+#define LZ_LAST_LITERALS 5
+
+typedef struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t alignment;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t data_offset;
+    /* Covers the index and the name blob. */
+    uint32_t index_crc;
+    uint32_t reserved;
+} PackHeader;
+
+typedef struct PackIndexEntry {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t stored_size;
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t crc;
+    uint32_t flags;
+} PackIndexEntry;
+
+typedef struct PackSource {
+    char *path;
+    uint64_t hash;
+    unsigned char *data;
+    size_t size;
+    size_t stored_size;
+    uint32_t crc;
+    uint32_t flags;
+} PackSource;
+
+struct FurryPackWriter {
+    size_t alignment;
+    int compress;
+    PackSource *sources;
+    size_t count;
+    size_t capacity;
+};
+
+struct FurryPack {
+    FurryMappedFile file;
+    const PackIndexEntry *index;
+    const char *names;
+    size_t count;
+};
+
+/* LZ codec: LZ4-style sequences of token, literal run, 16-bit offset and match length. */
+
+size_t furry_lz_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+static uint32_t read32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static unsigned char *put_length(unsigned char *op, const unsigned char *op_end, size_t length) {
+    while (length >= 255) {
+        if (op >= op_end) {
+            return NULL;
+        }
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= op_end) {
+        return NULL;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+/* Writes one sequence; match_length 0 marks the final literal-only one. */
+static unsigned char *put_sequence(unsigned char *op, const unsigned char *op_end, const unsigned char *literals, size_t literal_length,
+                                   size_t offset, size_t match_length) {
+    if (op >= op_end) {
+        return NULL;
+    }
+    unsigned char *token = op++;
+    size_t match_code = match_length > 0 ? match_length - LZ_MIN_MATCH : 0;
+    *token = (unsigned char)(((literal_length < 15 ? literal_length : 15) << 4) | (match_code < 15 ? match_code : 15));
+    if (literal_length >= 15 && (op = put_length(op, op_end, literal_length - 15)) == NULL) {
+        return NULL;
+    }
+    if ((size_t)(op_end - op) < literal_length) {
+        return NULL;
+    }
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (match_length == 0) {
+        return op;
+    }
+    if (op_end - op < 2) {
+        return NULL;
+    }
+    *op++ = (unsigned char)(offset & 0xffu);
+    *op++ = (unsigned char)(offset >> 8);
+    if (match_code >= 15) {
+        op = put_length(op, op_end, match_code - 15);
+    }
+    return op;
+}
+
+size_t furry_lz_compress(const void *src, size_t src_size, void *dst, size_t dst_capacity) {
+    const unsigned char *base = src;
+    const unsigned char *ip = base;
+    const unsigned char *anchor = base;
+    const unsigned char *end = base + src_size;
+    const unsigned char *match_limit = src_size > LZ_LAST_LITERALS ? end - LZ_LAST_LITERALS : base;
+    unsigned char *op = dst;
+    unsigned char *op_end = op + dst_capacity;
+    /* Positions are stored +1 so zero means empty. */
+    uint32_t table[1u << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    while (match_limit - ip >= LZ_MIN_MATCH) {
+        uint32_t sequence = read32(ip);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+        uint32_t candidate = table[hash];
+        table[hash] = (uint32_t)(ip - base) + 1;
+        const unsigned char *ref = base + candidate - 1;
+        if (candidate == 0 || ip - ref > LZ_MAX_OFFSET || read32(ref) != sequence) {
+            ip++;
+            continue;
+        }
+        size_t length = LZ_MIN_MATCH;
+        while (ip + length < match_limit && ref[length] == ip[length]) {
+            length++;
+        }
+        op = put_sequence(op, op_end, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), length);
+        if (op == NULL) {
+            return 0;
+        }
+        ip += length;
+        anchor = ip;
+    }
+    op = put_sequence(op, op_end, anchor, (size_t)(end - anchor), 0, 0);
+    return op == NULL ? 0 : (size_t)(op - (unsigned char *)dst);
+}
+
+static int get_length(const unsigned char **ip, const unsigned char *ip_end, size_t *length) {
+    unsigned char byte;
+    do {
+        if (*ip >= ip_end) {
+            return FURRY_ERR;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return FURRY_OK;
+}
+
+int furry_lz_decompress(const void *src, size_t src_size, void *dst, size_t dst_size) {
+    const unsigned char *ip = src;
+    const unsigned char *ip_end = ip + src_size;
+    unsigned char *op = dst;
+    unsigned char *op_end = op + dst_size;
+    while (ip < ip_end) {
+        unsigned token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && get_length(&ip, ip_end, &literal_length) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        if (literal_length > (size_t)(ip_end - ip) || literal_length > (size_t)(op_end - op)) {
+            return FURRY_ERR;
+        }
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == ip_end) {
+            break;
+        }
+        if (ip_end - ip < 2) {
+            return FURRY_ERR;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t match_length = token & 15u;
+        if (match_length == 15 && get_length(&ip, ip_end, &match_length) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - (unsigned char *)dst) || match_length > (size_t)(op_end - op)) {
+            return FURRY_ERR;
+        }
+        /* Overlapping matches repeat the last `offset` bytes; copy them a period at a time. */
+        while (match_length > 0) {
+            size_t chunk = offset < match_length ? offset : match_length;
+            memcpy(op, op - offset, chunk);
+            op += chunk;
+            match_length -= chunk;
+        }
+    }
+    return op == op_end ? FURRY_OK : FURRY_ERR;
+}
+
+/* Paths: '\' and '/' are the same separator and leading "./" is dropped, on both write and lookup. */
+
+static const char *skip_dot_slash(const char *path) {
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) {
+        path += 2;
+    }
+    return path;
+}
+
+static char fold_separator(char c) {
+    return c == '\\' ? '/' : c;
+}
+
+static uint64_t hash_path(const char *path) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char *p = skip_dot_slash(path); *p != '\0'; ++p) {
+        hash ^= (unsigned char)fold_separator(*p);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static int compare_paths(const char *stored, const char *query) {
+    query = skip_dot_slash(query);
+    while (*stored != '\0' && *stored == fold_separator(*query)) {
+        stored++;
+        query++;
+    }
+    return (unsigned char)*stored - (unsigned char)fold_separator(*query);
+}
+
+int furry_pack_writer_create(const FurryPackWriterConfig *config, FurryPackWriter **out_writer) {
+    if (out_writer == NULL) {
+        return FURRY_ERR;
+    }
+    *out_writer = NULL;
+    size_t alignment = config != NULL && config->alignment > 0 ? config->alignment : PACK_DEFAULT_ALIGNMENT;
+    if ((alignment & (alignment - 1)) != 0 || alignment > UINT32_MAX) {
+        return FURRY_ERR;
+    }
+    FurryPackWriter *writer = furry_calloc(FURRY_MEM_ASSETS, 1, sizeof(FurryPackWriter));
+    if (writer == NULL) {
+        return FURRY_ERR;
+    }
+    writer->alignment = alignment;
+    writer->compress = config != NULL && config->compress;
+    *out_writer = writer;
+    return FURRY_OK;
+}
+
+int furry_pack_writer_add(FurryPackWriter *writer, const char *path, const void *data, size_t size) {
+    if (writer == NULL || path == NULL || (data == NULL && size > 0)) {
+        return FURRY_ERR;
+    }
+    path = skip_dot_slash(path);
+    size_t path_size = strlen(path);
+    if (path_size == 0 || path_size > UINT32_MAX - 1) {
+        return FURRY_ERR;
+    }
+    if (writer->count == writer->capacity) {
+        size_t capacity = writer->capacity == 0 ? 64 : writer->capacity * 2;
+        PackSource *sources = furry_realloc(FURRY_MEM_ASSETS, writer->sources, capacity * sizeof(PackSource));
+        if (sources == NULL) {
+            return FURRY_ERR;
+        }
+        writer->sources = sources;
+        writer->capacity = capacity;
+    }
+    PackSource source;
+    memset(&source, 0, sizeof(source));
+    source.path = furry_alloc(FURRY_MEM_ASSETS, path_size + 1);
+    if (source.path == NULL) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i <= path_size; ++i) {
+        source.path[i] = fold_separator(path[i]);
+    }
+    source.hash = hash_path(source.path);
+    source.size = size;
+    source.crc = (uint32_t)furry_crc32(0, data, size);
+
+    /* Keep the compressed form only when it saves at least an eighth; stored entries are zero-copy. */
+    if (writer->compress && size >= 64) {
+        size_t bound = furry_lz_bound(size);
+        unsigned char *packed = furry_alloc(FURRY_MEM_ASSETS, bound);
+        size_t packed_size = packed != NULL ? furry_lz_compress(data, size, packed, bound) : 0;
+        if (packed_size > 0 && packed_size < size - size / 8) {
+            unsigned char *shrunk = furry_realloc(FURRY_MEM_ASSETS, packed, packed_size);
+            source.data = shrunk != NULL ? shrunk : packed;
+            source.stored_size = packed_size;
+            source.flags = PACK_FLAG_LZ;
+        } else {
+            furry_free(packed);
+        }
+    }
+    if (source.data == NULL) {
+        source.data = furry_alloc(FURRY_MEM_ASSETS, size > 0 ? size : 1);
+        if (source.data == NULL) {
+            furry_free(source.path);
+            return FURRY_ERR;
+        }
+        memcpy(source.data, data, size);
+        source.stored_size = size;
+    }
+    writer->sources[writer->count++] = source;
+    return FURRY_OK;
+}
+
+int furry_pack_writer_add_file(FurryPackWriter *writer, const char *path, const char *file_path) {
+    FurryMappedFile file;
+    if (writer == NULL || furry_map_file(file_path, &file) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    int rc = furry_pack_writer_add(writer, path, file.data, file.size);
+    furry_unmap_file(&file);
+    return rc;
+}
+
+static int compare_sources(const void *lhs, const void *rhs) {
+    const PackSource *a = lhs;
+    const PackSource *b = rhs;
+    if (a->hash != b->hash) {
+        return a->hash < b->hash ? -1 : 1;
+    }
+    return strcmp(a->path, b->path);
+}
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static int write_padding(FILE *file, size_t count) {
+    static const unsigned char zeros[256];
+    while (count > 0) {
+        size_t chunk = count < sizeof(zeros) ? count : sizeof(zeros);
+        if (fwrite(zeros, 1, chunk, file) != chunk) {
+            return FURRY_ERR;
+        }
+        count -= chunk;
+    }
+    return FURRY_OK;
+}
+
+int furry_pack_writer_finish(FurryPackWriter *writer, const char *out_path) {
+    if (writer == NULL || out_path == NULL || writer->count > UINT32_MAX) {
+        return FURRY_ERR;
+    }
+    qsort(writer->sources, writer->count, sizeof(PackSource), compare_sources);
+    size_t names_size = 0;
+    for (size_t i = 0; i < writer->count; ++i) {
+        if (i > 0 && compare_sources(&writer->sources[i - 1], &writer->sources[i]) == 0) {
+            return FURRY_ERR;
+        }
+        names_size += strlen(writer->sources[i].path) + 1;
+    }
+    if (names_size > UINT32_MAX) {
+        return FURRY_ERR;
+    }
+
+    PackIndexEntry *index = furry_calloc(FURRY_MEM_ASSETS, writer->count > 0 ? writer->count : 1, sizeof(PackIndexEntry));
+    char *names = furry_alloc(FURRY_MEM_ASSETS, names_size > 0 ? names_size : 1);
+    if (index == NULL || names == NULL) {
+        furry_free(index);
+        furry_free(names);
+        return FURRY_ERR;
+    }
+    PackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.count = (uint32_t)writer->count;
+    header.alignment = (uint32_t)writer->alignment;
+    header.names_offset = sizeof(PackHeader) + writer->count * sizeof(PackIndexEntry);
+    header.names_size = names_size;
+    header.data_offset = align_up((size_t)header.names_offset + names_size, writer->alignment);
+
+    size_t name_offset = 0;
+    size_t data_offset = (size_t)header.data_offset;
+    for (size_t i = 0; i < writer->count; ++i) {
+        const PackSource *source = &writer->sources[i];
+        size_t name_size = strlen(source->path);
+        memcpy(names + name_offset, source->path, name_size + 1);
+        index[i].hash = source->hash;
+        index[i].offset = data_offset;
+        index[i].size = source->size;
+        index[i].stored_size = source->stored_size;
+        index[i].name_offset = (uint32_t)name_offset;
+        index[i].name_size = (uint32_t)name_size;
+        index[i].crc = source->crc;
+        index[i].flags = source->flags;
+        name_offset += name_size + 1;
+        data_offset = align_up(data_offset + source->stored_size, writer->alignment);
+    }
+    unsigned long crc = furry_crc32(0, index, writer->count * sizeof(PackIndexEntry));
+    header.index_crc = (uint32_t)furry_crc32(crc, names, names_size);
+
+    FILE *file = fopen(out_path, "wb");
+    int ok = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 &&
+             (writer->count == 0 || fwrite(index, sizeof(PackIndexEntry), writer->count, file) == writer->count) &&
+             (names_size == 0 || fwrite(names, 1, names_size, file) == names_size) &&
+             write_padding(file, (size_t)header.data_offset - (size_t)header.names_offset - names_size) == FURRY_OK;
+    size_t written = (size_t)header.data_offset;
+    for (size_t i = 0; ok && i < writer->count; ++i) {
+        const PackSource *source = &writer->sources[i];
+        ok = write_padding(file, (size_t)index[i].offset - written) == FURRY_OK &&
+             (source->stored_size == 0 || fwrite(source->data, 1, source->stored_size, file) == source->stored_size);
+        written = (size_t)index[i].offset + source->stored_size;
+    }
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    }
+    furry_free(index);
+    furry_free(names);
+    return ok ? FURRY_OK : FURRY_ERR;
+}
+
+void furry_pack_writer_destroy(FurryPackWriter *writer) {
+    if (writer == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < writer->count; ++i) {
+        furry_free(writer->sources[i].path);
+        furry_free(writer->sources[i].data);
+    }
+    furry_free(writer->sources);
+    furry_free(writer);
+}
+
+/* Validates the whole index up front so lookups and reads never bounds-check. */
+static int validate_pack(const FurryMappedFile *file, const PackHeader *header) {
+    if (memcmp(header->magic, PACK_MAGIC, 4) != 0 || header->version != PACK_VERSION) {
+        return FURRY_ERR;
+    }
+    uint64_t index_end = sizeof(PackHeader) + (uint64_t)header->count * sizeof(PackIndexEntry);
+    /* Each size is compared against the room left after its offset, so the offsets are checked first to keep the subtraction from wrapping. */
+    if (header->names_offset != index_end || index_end > file->size || header->names_size > file->size - index_end ||
+        header->data_offset > file->size) {
+        return FURRY_ERR;
+    }
+    const unsigned char *base = file->data;
+    unsigned long crc = furry_crc32(0, base + sizeof(PackHeader), (size_t)(index_end - sizeof(PackHeader)));
+    if (furry_crc32(crc, base + index_end, (size_t)header->names_size) != header->index_crc) {
+        return FURRY_ERR;
+    }
+    const char *names = (const char *)base + index_end;
+    for (uint32_t i = 0; i < header->count; ++i) {
+        PackIndexEntry entry;
+        memcpy(&entry, base + sizeof(PackHeader) + (size_t)i * sizeof(PackIndexEntry), sizeof(entry));
+        if ((uint64_t)entry.name_offset + entry.name_size >= header->names_size || names[entry.name_offset + entry.name_size] != '\0' ||
+            entry.offset < header->data_offset || entry.offset > file->size || entry.stored_size > file->size - entry.offset || entry.size > SIZE_MAX ||
+            (entry.flags & ~PACK_FLAG_LZ) != 0 || (entry.flags == 0 && entry.stored_size != entry.size)) {
+            return FURRY_ERR;
+        }
+    }
+    return FURRY_OK;
+}
+
+int furry_pack_open(const char *path, FurryPack **out_pack) {
+    if (path == NULL || out_pack == NULL) {
+        return FURRY_ERR;
+    }
+    *out_pack = NULL;
+    FurryPack *pack = furry_calloc(FURRY_MEM_ASSETS, 1, sizeof(FurryPack));
+    if (pack == NULL) {
+        return FURRY_ERR;
+    }
+    if (furry_map_file(path, &pack->file) != FURRY_OK) {
+        furry_free(pack);
+        return FURRY_ERR;
+    }
+    PackHeader header;
+    if (pack->file.size < sizeof(header) || (memcpy(&header, pack->file.data, sizeof(header)), validate_pack(&pack->file, &header)) != FURRY_OK) {
+        furry_pack_close(pack);
+        return FURRY_ERR;
+    }
+    pack->index = (const PackIndexEntry *)(pack->file.data + sizeof(PackHeader));
+    pack->names = (const char *)pack->file.data + header.names_offset;
+    pack->count = header.count;
+    *out_pack = pack;
+    return FURRY_OK;
+}
+
+void furry_pack_close(FurryPack *pack) {
+    if (pack == NULL) {
+        return;
+    }
+    furry_unmap_file(&pack->file);
+    furry_free(pack);
+}
+
+size_t furry_pack_count(const FurryPack *pack) {
+    return pack != NULL ? pack->count : 0;
+}
+
+static void fill_entry(const FurryPack *pack, size_t position, FurryPackEntry *out_entry) {
+    const PackIndexEntry *index = &pack->index[position];
+    out_entry->index = position;
+    out_entry->path = pack->names + index->name_offset;
+    out_entry->compressed = (index->flags & PACK_FLAG_LZ) != 0;
+    out_entry->data = out_entry->compressed ? NULL : pack->file.data + index->offset;
+    out_entry->size = (size_t)index->size;
+    out_entry->stored_size = (size_t)index->stored_size;
+}
+
+int furry_pack_entry_at(const FurryPack *pack, size_t index, FurryPackEntry *out_entry) {
+    if (pack == NULL || out_entry == NULL || index >= pack->count) {
+        return FURRY_ERR;
+    }
+    fill_entry(pack, index, out_entry);
+    return FURRY_OK;
+}
+
+int furry_pack_find(const FurryPack *pack, const char *path, FurryPackEntry *out_entry) {
+    if (pack == NULL || path == NULL) {
+        return FURRY_ERR;
+    }
+    uint64_t hash = hash_path(path);
+    size_t lo = 0;
+    size_t hi = pack->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pack->index[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (size_t i = lo; i < pack->count && pack->index[i].hash == hash; ++i) {
+        if (compare_paths(pack->names + pack->index[i].name_offset, path) == 0) {
+            if (out_entry != NULL) {
+                fill_entry(pack, i, out_entry);
+            }
+            return FURRY_OK;
+        }
+    }
+    return FURRY_ERR;
+}
+
+int furry_pack_read(const FurryPack *pack, const FurryPackEntry *entry, void *out, size_t out_size) {
+    if (pack == NULL || entry == NULL || entry->index >= pack->count) {
+        return FURRY_ERR;
+    }
+    const PackIndexEntry *index = &pack->index[entry->index];
+    if ((out == NULL && index->size > 0) || out_size < index->size) {
+        return FURRY_ERR;
+    }
+    unsigned long long trace_start = furry_trace_on(FURRY_TRACE_HOST) ? furry_trace_now() : 0;
+    const unsigned char *stored = pack->file.data + index->offset;
+    int rc = FURRY_OK;
+    if ((index->flags & PACK_FLAG_LZ) != 0) {
+        rc = furry_lz_decompress(stored, (size_t)index->stored_size, out, (size_t)index->size);
+    } else if (index->size > 0) {
+        memcpy(out, stored, (size_t)index->size);
+    }
+    if (rc == FURRY_OK && furry_crc32(0, out, (size_t)index->size) != index->crc) {
+        rc = FURRY_ERR;
+    }
+    if (trace_start != 0) {
+        furry_trace_record(FURRY_TRACE_ASSET_LOAD, trace_start, furry_trace_now() - trace_start, (unsigned)index->size, entry->path);
+    }
+    return rc;
+}
+
+int furry_pack_check_program(const FurryPack *pack, const FurryProgram *program, FurryCompileError *out_error) {
+    if (pack == NULL || program == NULL) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < program->count; ++i) {
+        const char *asset = furry_instruction_asset(&program->code[i]);
+        if (asset != NULL && furry_pack_find(pack, asset, NULL) != FURRY_OK) {
+            if (out_error != NULL) {
+                out_error->line = (int)i + 1;
+                snprintf(out_error->message, sizeof(out_error->message), "asset '%.120s' is not in the pack", asset);
+            }
+            return FURRY_ERR;
+        }
+    }
+    return FURRY_OK;
+}
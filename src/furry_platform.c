@@ -0,0 +1,98 @@
+#include "furry_platform.h"
+#include "furry_internal.h"
+
+#include <string.h>
+
+void furry_pacer_init(FurryPacer *pacer, double target_hz) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->period_ns = target_hz > 0.0 ? (unsigned long long)(1e9 / target_hz) : 0;
+    /* The first frame is always drawn. */
+    pacer->dirty = 1;
+}
+
+void furry_pacer_invalidate(FurryPacer *pacer) {
+    pacer->dirty = 1;
+}
+
+void furry_pacer_input(FurryPacer *pacer, unsigned long long event_ns) {
+    pacer->dirty = 1;
+    pacer->stats.inputs++;
+    if (pacer->pending_input_ns == 0 || event_ns < pacer->pending_input_ns) {
+        pacer->pending_input_ns = event_ns;
+    }
+}
+
+int furry_pacer_due(const FurryPacer *pacer, unsigned long long now_ns, int animating) {
+    return (pacer->dirty || animating) && (pacer->period_ns == 0 || now_ns >= pacer->next_frame_ns);
+}
+
+long long furry_pacer_timeout(FurryPacer *pacer, unsigned long long now_ns, int animating) {
+    if (!pacer->dirty && !animating) {
+        pacer->stats.idle_waits++;
+        return FURRY_PACER_FOREVER;
+    }
+    /* A burst of input redraws at most once per period, like an animation. */
+    if (pacer->period_ns == 0 || now_ns >= pacer->next_frame_ns) {
+        return 0;
+    }
+    pacer->stats.timed_waits++;
+    return (long long)(pacer->next_frame_ns - now_ns);
+}
+
+void furry_pacer_frame_done(FurryPacer *pacer, unsigned long long now_ns) {
+    pacer->dirty = 0;
+    pacer->stats.frames++;
+    /* Deadlines advance by whole periods so the rate does not drift; a frame a period late (the first, or one after idling) restarts them from now rather than catching up. */
+    if (pacer->next_frame_ns == 0 || pacer->next_frame_ns + pacer->period_ns <= now_ns) {
+        pacer->next_frame_ns = now_ns + pacer->period_ns;
+    } else {
+        pacer->next_frame_ns += pacer->period_ns;
+    }
+    if (pacer->pending_input_ns != 0) {
+        unsigned long long latency = now_ns > pacer->pending_input_ns ? now_ns - pacer->pending_input_ns : 0;
+        pacer->stats.latency_samples++;
+        pacer->stats.latency_total_ns += latency;
+        if (latency > pacer->stats.latency_max_ns) {
+            pacer->stats.latency_max_ns = latency;
+        }
+        pacer->pending_input_ns = 0;
+    }
+}
+
+void furry_router_reset(FurryInputRouter *router) {
+    memset(router, 0, sizeof(*router));
+}
+
+void furry_router_command(FurryInputRouter *router, const FurryHostCommand *command) {
+    if (command->ui_patch || command->bind_update) {
+        return;
+    }
+    if (command->op == FURRY_OP_SAY) {
+        router->waiting = FURRY_ROUTER_SAY;
+    } else if (command->op == FURRY_OP_CHOICE) {
+        router->waiting = FURRY_ROUTER_CHOICE;
+        router->choice_count = command->choice_count;
+    } else if (command->op == FURRY_OP_END) {
+        router->waiting = FURRY_ROUTER_IDLE;
+    }
+}
+
+int furry_router_event(FurryInputRouter *router, const FurryPlatformEvent *event, FurryWorkerInput *out_input) {
+    if (router->waiting == FURRY_ROUTER_SAY) {
+        int advance = (event->type == FURRY_EVENT_KEY && !event->repeat && (event->key == FURRY_KEY_RETURN || event->key == FURRY_KEY_SPACE)) ||
+                      (event->type == FURRY_EVENT_POINTER && event->button == 1);
+        if (advance) {
+            out_input->type = FURRY_INPUT_ADVANCE;
+            out_input->value = 0;
+            router->waiting = FURRY_ROUTER_IDLE;
+            return 1;
+        }
+    } else if (router->waiting == FURRY_ROUTER_CHOICE && event->type == FURRY_EVENT_KEY && !event->repeat && event->key >= '1' &&
+               event->key <= '9' && (size_t)(event->key - '1') < router->choice_count) {
+        out_input->type = FURRY_INPUT_CHOICE;
+        out_input->value = event->key - '1';
+        router->waiting = FURRY_ROUTER_IDLE;
+        return 1;
+    }
+    return 0;
+}
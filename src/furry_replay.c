@@ -0,0 +1,529 @@
+#include "furry_replay.h"
+#include "furry_internal.h"
+#include "furry_save.h"
+#include "furry_ui_tree.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define REPLAY_MAGIC "FYRP"
+#define REPLAY_VERSION 1u
+
+#define REPLAY_HAS_SAVE 1u
+#define REPLAY_HAS_LOAD 2u
+#define REPLAY_HAS_UI_TREE 4u
+#define REPLAY_HAS_BIND 8u
+#define REPLAY_HAS_SCENE 16u
+
+typedef enum ReplayKind {
+    REPLAY_CHOICE = 1,
+    REPLAY_LOAD,
+    REPLAY_SAY_RC,
+    REPLAY_HOST_RC,
+    REPLAY_SAVE_RC,
+    REPLAY_PATCH_RC,
+    REPLAY_BIND_RC,
+    REPLAY_SCENE_RC
+} ReplayKind;
+
+typedef struct ReplayFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t program_hash;
+    uint64_t steps;
+    uint64_t log_size;
+    uint32_t flags;
+    int32_t max_steps;
+    int32_t result;
+    uint32_t crc;
+} ReplayFileHeader;
+
+/* One decoded record; snapshot bytes point into the log. */
+typedef struct ReplayRecord {
+    size_t step;
+    int kind;
+    int value;
+    const unsigned char *snapshot;
+    size_t snapshot_size;
+} ReplayRecord;
+
+struct FurryReplay {
+    uint64_t program_hash;
+    uint32_t flags;
+    int max_steps;
+    int result;
+    size_t steps;
+
+    /* Log: per record varint(step delta), kind byte, zigzag varint(value), then for loads varint(size) + encoded snapshot. */
+    unsigned char *log;
+    size_t log_size;
+    size_t log_capacity;
+    size_t last_step;
+    size_t records;
+    size_t choices;
+    size_t loads;
+
+    /* Recording. */
+    FurryRuntimeConfig host;
+    FurryRuntimeSnapshot scratch;
+
+    /* Replay. */
+    size_t cursor;
+    size_t replay_step;
+    size_t diverged_at;
+    ReplayRecord next;
+    int has_next;
+};
+
+static int reserve_log(FurryReplay *replay, size_t extra) {
+    if (replay->log_size + extra <= replay->log_capacity) {
+        return FURRY_OK;
+    }
+    size_t capacity = replay->log_capacity == 0 ? 256 : replay->log_capacity;
+    while (capacity < replay->log_size + extra) {
+        capacity *= 2;
+    }
+    unsigned char *log = furry_realloc(FURRY_MEM_REPLAY, replay->log, capacity);
+    if (log == NULL) {
+        return FURRY_ERR;
+    }
+    replay->log = log;
+    replay->log_capacity = capacity;
+    return FURRY_OK;
+}
+
+static void put_varint(FurryReplay *replay, uint64_t value) {
+    do {
+        unsigned char byte = (unsigned char)(value & 0x7fu);
+        value >>= 7;
+        replay->log[replay->log_size++] = byte | (value != 0 ? 0x80u : 0u);
+    } while (value != 0);
+}
+
+static int get_varint(const FurryReplay *replay, size_t *cursor, uint64_t *out_value) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*cursor >= replay->log_size) {
+            return FURRY_ERR;
+        }
+        unsigned char byte = replay->log[(*cursor)++];
+        value |= (uint64_t)(byte & 0x7fu) << shift;
+        if ((byte & 0x80u) == 0) {
+            *out_value = value;
+            return FURRY_OK;
+        }
+    }
+    return FURRY_ERR;
+}
+
+/* Appends a record at the current step; failure to log ends the run, since the recording would be unusable. */
+static int put_record(FurryReplay *replay, ReplayKind kind, int value, const FurryRuntimeSnapshot *snapshot) {
+    size_t snapshot_size = snapshot != NULL ? furry_snapshot_encoded_size(snapshot) : 0;
+    if (reserve_log(replay, 10 + 1 + 10 + 10 + snapshot_size) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    put_varint(replay, replay->steps - replay->last_step);
+    replay->log[replay->log_size++] = (unsigned char)kind;
+    put_varint(replay, ((uint64_t)(int64_t)value << 1) ^ (uint64_t)((int64_t)value >> 63));
+    if (snapshot != NULL) {
+        size_t written = 0;
+        put_varint(replay, snapshot_size);
+        if (furry_snapshot_encode(snapshot, replay->log + replay->log_size, snapshot_size, &written) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        replay->log_size += written;
+        replay->loads++;
+    }
+    replay->last_step = replay->steps;
+    replay->records++;
+    replay->choices += kind == REPLAY_CHOICE;
+    return FURRY_OK;
+}
+
+static int get_record(const FurryReplay *replay, size_t *cursor, size_t base_step, ReplayRecord *out_record) {
+    uint64_t delta = 0;
+    uint64_t zigzag = 0;
+    if (get_varint(replay, cursor, &delta) != FURRY_OK || *cursor >= replay->log_size) {
+        return FURRY_ERR;
+    }
+    out_record->step = base_step + (size_t)delta;
+    out_record->kind = replay->log[(*cursor)++];
+    if (out_record->kind < REPLAY_CHOICE || out_record->kind > REPLAY_BIND_RC || get_varint(replay, cursor, &zigzag) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    out_record->value = (int)(int64_t)((zigzag >> 1) ^ (~(zigzag & 1u) + 1u));
+    out_record->snapshot = NULL;
+    out_record->snapshot_size = 0;
+    if (out_record->kind == REPLAY_LOAD && out_record->value == FURRY_OK) {
+        uint64_t size = 0;
+        if (get_varint(replay, cursor, &size) != FURRY_OK || size > replay->log_size - *cursor) {
+            return FURRY_ERR;
+        }
+        out_record->snapshot = replay->log + *cursor;
+        out_record->snapshot_size = (size_t)size;
+        *cursor += (size_t)size;
+    }
+    return FURRY_OK;
+}
+
+static int rec_choose(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    FurryReplay *replay = user_data;
+    replay->steps++;
+    int selected = replay->host.choose_option != NULL ? replay->host.choose_option(prompt, choices, count, replay->host.user_data) : 0;
+    return put_record(replay, REPLAY_CHOICE, selected, NULL) == FURRY_OK ? selected : -1;
+}
+
+static int rec_result(FurryReplay *replay, ReplayKind kind, int rc) {
+    if (rc != FURRY_OK && put_record(replay, kind, rc, NULL) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return rc;
+}
+
+static int rec_say(const char *speaker, const char *text, void *user_data) {
+    FurryReplay *replay = user_data;
+    replay->steps++;
+    int rc = replay->host.on_say != NULL ? replay->host.on_say(speaker, text, replay->host.user_data) : FURRY_OK;
+    return rec_result(replay, REPLAY_SAY_RC, rc);
+}
+
+static int rec_host(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    FurryReplay *replay = user_data;
+    replay->steps++;
+    int rc = replay->host.on_host_command != NULL ? replay->host.on_host_command(op, ins, snapshot, replay->host.user_data) : FURRY_OK;
+    return rec_result(replay, REPLAY_HOST_RC, rc);
+}
+
+static int rec_save(const char *slot, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    FurryReplay *replay = user_data;
+    replay->steps++;
+    int rc = FURRY_OK;
+    if (replay->host.save_slot != NULL) {
+        rc = replay->host.save_slot(slot, snapshot, replay->host.user_data);
+    } else {
+        /* Same resume point as the VM's own save_store path: the instruction after `save`. */
+        replay->scratch = *snapshot;
+        replay->scratch.ip++;
+        rc = furry_save_store_put(replay->host.save_store, slot, &replay->scratch);
+    }
+    return rec_result(replay, REPLAY_SAVE_RC, rc);
+}
+
+static int rec_load(const char *slot, FurryRuntimeSnapshot *snapshot, void *user_data) {
+    FurryReplay *replay = user_data;
+    replay->steps++;
+    int rc = replay->host.load_slot != NULL ? replay->host.load_slot(slot, snapshot, replay->host.user_data)
+                                            : furry_save_store_get(replay->host.save_store, slot, snapshot);
+    if (put_record(replay, REPLAY_LOAD, rc, rc == FURRY_OK ? snapshot : NULL) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    return rc;
+}
+
+static int rec_patch(const FurryUiPatch *patch, void *user_data) {
+    FurryReplay *replay = user_data;
+    int rc = replay->host.on_ui_patch != NULL ? replay->host.on_ui_patch(patch, replay->host.user_data) : FURRY_OK;
+    return rec_result(replay, REPLAY_PATCH_RC, rc);
+}
+
+static int rec_bind(const FurryBindUpdate *updates, size_t count, void *user_data) {
+    FurryReplay *replay = user_data;
+    return rec_result(replay, REPLAY_BIND_RC, replay->host.on_bind_update(updates, count, replay->host.user_data));
+}
+
+static int rec_scene(const FurrySceneState *scene, void *user_data) {
+    FurryReplay *replay = user_data;
+    replay->steps++;
+    return rec_result(replay, REPLAY_SCENE_RC, replay->host.on_scene_restore(scene, replay->host.user_data));
+}
+
+int furry_replay_record_begin(const FurryProgram *program, const FurryRuntimeConfig *host_config, FurryReplay **out_replay,
+                              FurryRuntimeConfig *out_config) {
+    if (program == NULL || out_replay == NULL || out_config == NULL) {
+        return FURRY_ERR;
+    }
+    *out_replay = NULL;
+    FurryReplay *replay = furry_calloc(FURRY_MEM_REPLAY, 1, sizeof(FurryReplay));
+    if (replay == NULL) {
+        return FURRY_ERR;
+    }
+    if (host_config != NULL) {
+        replay->host = *host_config;
+    }
+    replay->program_hash = furry_program_fingerprint(program);
+    replay->max_steps = replay->host.max_steps;
+    replay->result = FURRY_ERR;
+
+    FurryRuntimeConfig config = replay->host;
+    config.choose_option = rec_choose;
+    config.on_say = rec_say;
+    config.on_host_command = rec_host;
+    config.save_slot = NULL;
+    config.load_slot = NULL;
+    /* What a skip suppresses depends on the seen set, which replay does not carry. */
+    config.skip_mode = FURRY_SKIP_OFF;
+    config.on_skip_stop = NULL;
+    if (replay->host.save_slot != NULL || replay->host.save_store != NULL) {
+        config.save_slot = rec_save;
+        replay->flags |= REPLAY_HAS_SAVE;
+    }
+    if (replay->host.load_slot != NULL || replay->host.save_store != NULL) {
+        config.load_slot = rec_load;
+        replay->flags |= REPLAY_HAS_LOAD;
+    }
+    if (replay->host.ui_tree != NULL) {
+        config.on_ui_patch = rec_patch;
+        replay->flags |= REPLAY_HAS_UI_TREE;
+    }
+    if (replay->host.on_bind_update != NULL) {
+        config.on_bind_update = rec_bind;
+        replay->flags |= REPLAY_HAS_BIND;
+    }
+    if (replay->host.on_scene_restore != NULL) {
+        config.on_scene_restore = rec_scene;
+        replay->flags |= REPLAY_HAS_SCENE;
+    }
+    config.user_data = replay;
+    *out_config = config;
+    *out_replay = replay;
+    return FURRY_OK;
+}
+
+void furry_replay_record_end(FurryReplay *replay, int run_result) {
+    if (replay != NULL) {
+        replay->result = run_result;
+    }
+}
+
+int furry_replay_save(const FurryReplay *replay, const char *path) {
+    if (replay == NULL || path == NULL) {
+        return FURRY_ERR;
+    }
+    ReplayFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REPLAY_MAGIC, 4);
+    header.version = REPLAY_VERSION;
+    header.program_hash = replay->program_hash;
+    header.steps = replay->steps;
+    header.log_size = replay->log_size;
+    header.flags = replay->flags;
+    header.max_steps = replay->max_steps;
+    header.result = replay->result;
+    header.crc = (uint32_t)furry_crc32(0, replay->log, replay->log_size);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             (replay->log_size == 0 || fwrite(replay->log, replay->log_size, 1, file) == 1);
+    ok = fclose(file) == 0 && ok;
+    return ok ? FURRY_OK : FURRY_ERR;
+}
+
+int furry_replay_load(const char *path, FurryReplay **out_replay) {
+    if (path == NULL || out_replay == NULL) {
+        return FURRY_ERR;
+    }
+    *out_replay = NULL;
+    FurryMappedFile file;
+    if (furry_map_file(path, &file) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    ReplayFileHeader header;
+    int valid = file.size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, file.data, sizeof(header));
+        valid = memcmp(header.magic, REPLAY_MAGIC, 4) == 0 && header.version == REPLAY_VERSION &&
+                header.log_size == file.size - sizeof(header) &&
+                furry_crc32(0, file.data + sizeof(header), (size_t)header.log_size) == header.crc;
+    }
+    FurryReplay *replay = valid ? furry_calloc(FURRY_MEM_REPLAY, 1, sizeof(FurryReplay)) : NULL;
+    if (replay == NULL || (header.log_size > 0 && reserve_log(replay, (size_t)header.log_size) != FURRY_OK)) {
+        furry_replay_destroy(replay);
+        furry_unmap_file(&file);
+        return FURRY_ERR;
+    }
+    memcpy(replay->log, file.data + sizeof(header), (size_t)header.log_size);
+    furry_unmap_file(&file);
+    replay->log_size = (size_t)header.log_size;
+    replay->program_hash = header.program_hash;
+    replay->steps = (size_t)header.steps;
+    replay->flags = header.flags;
+    replay->max_steps = header.max_steps;
+    replay->result = header.result;
+
+    /* Validates every record once so replay never has to. */
+    size_t cursor = 0;
+    size_t step = 0;
+    while (cursor < replay->log_size) {
+        ReplayRecord record;
+        if (get_record(replay, &cursor, step, &record) != FURRY_OK || record.step > replay->steps) {
+            furry_replay_destroy(replay);
+            return FURRY_ERR;
+        }
+        step = record.step;
+        replay->records++;
+        replay->choices += record.kind == REPLAY_CHOICE;
+        replay->loads += record.snapshot != NULL;
+    }
+    replay->last_step = step;
+    *out_replay = replay;
+    return FURRY_OK;
+}
+
+void furry_replay_destroy(FurryReplay *replay) {
+    if (replay == NULL) {
+        return;
+    }
+    furry_free(replay->log);
+    furry_free(replay);
+}
+
+static void advance(FurryReplay *replay) {
+    size_t base = replay->has_next ? replay->next.step : 0;
+    replay->has_next = replay->cursor < replay->log_size && get_record(replay, &replay->cursor, base, &replay->next) == FURRY_OK;
+}
+
+static void diverge(FurryReplay *replay) {
+    if (replay->diverged_at == 0) {
+        replay->diverged_at = replay->replay_step > 0 ? replay->replay_step : 1;
+    }
+}
+
+/* Consumes the next record if it belongs to this step and kind. */
+static int take(FurryReplay *replay, ReplayKind kind, ReplayRecord *out_record) {
+    if (!replay->has_next || replay->next.step != replay->replay_step || replay->next.kind != (int)kind) {
+        return 0;
+    }
+    *out_record = replay->next;
+    advance(replay);
+    return 1;
+}
+
+static int play_result(FurryReplay *replay, ReplayKind kind) {
+    ReplayRecord record;
+    return take(replay, kind, &record) ? record.value : FURRY_OK;
+}
+
+static int play_choose(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    (void)prompt;
+    (void)choices;
+    (void)count;
+    FurryReplay *replay = user_data;
+    replay->replay_step++;
+    ReplayRecord record;
+    if (!take(replay, REPLAY_CHOICE, &record)) {
+        diverge(replay);
+        return -1;
+    }
+    return record.value;
+}
+
+static int play_say(const char *speaker, const char *text, void *user_data) {
+    (void)speaker;
+    (void)text;
+    FurryReplay *replay = user_data;
+    replay->replay_step++;
+    return play_result(replay, REPLAY_SAY_RC);
+}
+
+static int play_host(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)op;
+    (void)ins;
+    (void)snapshot;
+    FurryReplay *replay = user_data;
+    replay->replay_step++;
+    return play_result(replay, REPLAY_HOST_RC);
+}
+
+static int play_save(const char *slot, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)slot;
+    (void)snapshot;
+    FurryReplay *replay = user_data;
+    replay->replay_step++;
+    return play_result(replay, REPLAY_SAVE_RC);
+}
+
+static int play_load(const char *slot, FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)slot;
+    FurryReplay *replay = user_data;
+    replay->replay_step++;
+    ReplayRecord record;
+    if (!take(replay, REPLAY_LOAD, &record)) {
+        diverge(replay);
+        return FURRY_ERR;
+    }
+    if (record.value == FURRY_OK && furry_snapshot_decode(record.snapshot, record.snapshot_size, snapshot) != FURRY_OK) {
+        diverge(replay);
+        return FURRY_ERR;
+    }
+    return record.value;
+}
+
+static int play_patch(const FurryUiPatch *patch, void *user_data) {
+    (void)patch;
+    return play_result(user_data, REPLAY_PATCH_RC);
+}
+
+static int play_bind(const FurryBindUpdate *updates, size_t count, void *user_data) {
+    (void)updates;
+    (void)count;
+    return play_result(user_data, REPLAY_BIND_RC);
+}
+
+static int play_scene(const FurrySceneState *scene, void *user_data) {
+    (void)scene;
+    FurryReplay *replay = user_data;
+    replay->replay_step++;
+    return play_result(replay, REPLAY_SCENE_RC);
+}
+
+int furry_replay_run(const FurryProgram *program, FurryReplay *replay) {
+    if (program == NULL || replay == NULL || furry_program_fingerprint(program) != replay->program_hash) {
+        return FURRY_ERR;
+    }
+    replay->cursor = 0;
+    replay->replay_step = 0;
+    replay->diverged_at = 0;
+    replay->has_next = 0;
+    advance(replay);
+
+    FurryUiTree *ui_tree = NULL;
+    if ((replay->flags & REPLAY_HAS_UI_TREE) != 0 && furry_ui_tree_create(&ui_tree) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    FurryRuntimeConfig config;
+    memset(&config, 0, sizeof(config));
+    config.max_steps = replay->max_steps;
+    config.choose_option = play_choose;
+    config.on_say = play_say;
+    config.on_host_command = play_host;
+    config.save_slot = (replay->flags & REPLAY_HAS_SAVE) != 0 ? play_save : NULL;
+    config.load_slot = (replay->flags & REPLAY_HAS_LOAD) != 0 ? play_load : NULL;
+    config.ui_tree = ui_tree;
+    config.on_ui_patch = play_patch;
+    config.on_bind_update = (replay->flags & REPLAY_HAS_BIND) != 0 ? play_bind : NULL;
+    config.on_scene_restore = (replay->flags & REPLAY_HAS_SCENE) != 0 ? play_scene : NULL;
+    config.user_data = replay;
+    int result = furry_run_program(program, &config);
+    furry_ui_tree_destroy(ui_tree);
+
+    if (replay->has_next || replay->replay_step != replay->steps || result != replay->result) {
+        diverge(replay);
+    }
+    return replay->diverged_at == 0 ? FURRY_OK : FURRY_ERR;
+}
+
+void furry_replay_stats(const FurryReplay *replay, FurryReplayStats *out_stats) {
+    if (replay == NULL || out_stats == NULL) {
+        return;
+    }
+    out_stats->steps = replay->steps;
+    out_stats->records = replay->records;
+    out_stats->choices = replay->choices;
+    out_stats->loads = replay->loads;
+    out_stats->log_bytes = replay->log_size;
+    out_stats->result = replay->result;
+    out_stats->diverged_at = replay->diverged_at;
+}
@@ -0,0 +1,941 @@
+#include "furry_save.h"
+#include "furry_internal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#define SAVE_LOG_MAGIC "FYSV"
+#define SAVE_INDEX_MAGIC "FYSI"
+#define SAVE_VERSION 1u
+#define SAVE_RECORD_MAGIC 0x52565346u
+#define SAVE_MAX_PAYLOAD (1u << 20)
+#define SAVE_DEFAULT_COMPACT_MIN (64u * 1024u)
+
+typedef struct SaveLogHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t generation;
+} SaveLogHeader;
+
+/* The checksum covers everything after `crc`, then the slot name, then the payload. */
+typedef struct SaveRecordHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint64_t sequence;
+    uint32_t payload_size;
+    uint16_t slot_size;
+    uint16_t reserved;
+} SaveRecordHeader;
+
+typedef struct SaveIndexEntry {
+    char slot[FURRY_MAX_NAME];
+    uint64_t offset;
+    uint64_t sequence;
+    uint32_t record_size;
+    uint32_t payload_size;
+} SaveIndexEntry;
+
+typedef struct SaveIndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t generation;
+    uint64_t log_size;
+    uint64_t next_sequence;
+    uint32_t count;
+    uint32_t crc;
+} SaveIndexHeader;
+
+typedef struct PendingSave {
+    char slot[FURRY_MAX_NAME];
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} PendingSave;
+
+typedef struct SaveBatch {
+    PendingSave *items;
+    size_t count;
+    size_t capacity;
+} SaveBatch;
+
+struct FurrySaveStore {
+    char path[FURRY_MAX_ASSET];
+    char index_path[FURRY_MAX_ASSET + 8];
+    char temp_path[FURRY_MAX_ASSET + 8];
+    size_t compact_min_bytes;
+
+    mtx_t lock;
+    cnd_t wake;
+    cnd_t drained;
+    thrd_t writer;
+    int stop;
+    int writing;
+    int failed;
+
+    /* Callers fill batches[front]; the writer swaps and drains the other one without holding the lock. */
+    SaveBatch batches[2];
+    int front;
+
+    SaveIndexEntry *index;
+    size_t index_count;
+    size_t index_capacity;
+    uint64_t generation;
+    uint64_t next_sequence;
+    size_t log_size;
+    size_t live_bytes;
+
+    FurryMappedFile map;
+    int map_stale;
+
+    FILE *log;
+    FurrySaveStoreStats stats;
+};
+
+static void put_u32(unsigned char *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static void put_u64(unsigned char *out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint32_t get_u32(const unsigned char *in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const unsigned char *in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static int scene_is_empty(const FurrySceneState *scene) {
+    return scene->bg[0] == '\0' && scene->music[0] == '\0' && scene->sprite_count == 0 && scene->layer_count == 0;
+}
+
+size_t furry_snapshot_encoded_size(const FurryRuntimeSnapshot *snapshot) {
+    size_t size = 8 + 4 + snapshot->callstack_depth * 8 + 4;
+    for (size_t i = 0; i < snapshot->var_count; ++i) {
+        size += 2 + strlen(snapshot->vars[i].key) + strlen(snapshot->vars[i].value);
+    }
+    const FurrySceneState *scene = &snapshot->scene;
+    if (scene_is_empty(scene)) {
+        return size;
+    }
+    size += 2 + strlen(scene->bg) + 2 + strlen(scene->music) + 8 + 1 + 1;
+    for (size_t i = 0; i < scene->sprite_count; ++i) {
+        size += 2 + strlen(scene->sprites[i].asset) + 12 + 1 + strlen(scene->sprites[i].animation);
+    }
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        size += 1 + strlen(scene->layers[i].name) + 4;
+    }
+    return size;
+}
+
+static unsigned char *put_string(unsigned char *cur, const char *text, size_t width) {
+    size_t len = strlen(text);
+    if (width == 2) {
+        *cur++ = (unsigned char)len;
+        *cur++ = (unsigned char)(len >> 8);
+    } else {
+        *cur++ = (unsigned char)len;
+    }
+    memcpy(cur, text, len);
+    return cur + len;
+}
+
+static unsigned char *put_float(unsigned char *cur, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u32(cur, bits);
+    return cur + 4;
+}
+
+/*
+ * Little-endian: ip, depth, callstack, var count, then (key len, key, value len, value) pairs.
+ * A non-empty scene follows: bg, music (u16 length + text), music frame (u64),
+ * sprite count, per sprite asset (u16 length), x/y/rotation (f32) and
+ * animation (u8 length), then layer count and per layer name (u8 length) and ip (u32).
+ * Snapshots without a scene end after the variables, as before.
+ */
+int furry_snapshot_encode(const FurryRuntimeSnapshot *snapshot, unsigned char *out, size_t out_size, size_t *out_len) {
+    if (snapshot == NULL || out == NULL || snapshot->callstack_depth > FURRY_MAX_CALLSTACK || snapshot->var_count > FURRY_MAX_VARS ||
+        snapshot->scene.sprite_count > FURRY_MAX_SCENE_SPRITES || snapshot->scene.layer_count > FURRY_MAX_SCENE_LAYERS) {
+        return FURRY_ERR;
+    }
+    size_t needed = furry_snapshot_encoded_size(snapshot);
+    if (needed > out_size) {
+        return FURRY_ERR;
+    }
+    unsigned char *cur = out;
+    put_u64(cur, (uint64_t)snapshot->ip);
+    cur += 8;
+    put_u32(cur, (uint32_t)snapshot->callstack_depth);
+    cur += 4;
+    for (size_t i = 0; i < snapshot->callstack_depth; ++i) {
+        put_u64(cur, (uint64_t)snapshot->callstack[i]);
+        cur += 8;
+    }
+    put_u32(cur, (uint32_t)snapshot->var_count);
+    cur += 4;
+    for (size_t i = 0; i < snapshot->var_count; ++i) {
+        size_t key_len = strlen(snapshot->vars[i].key);
+        size_t value_len = strlen(snapshot->vars[i].value);
+        *cur++ = (unsigned char)key_len;
+        memcpy(cur, snapshot->vars[i].key, key_len);
+        cur += key_len;
+        *cur++ = (unsigned char)value_len;
+        memcpy(cur, snapshot->vars[i].value, value_len);
+        cur += value_len;
+    }
+    const FurrySceneState *scene = &snapshot->scene;
+    if (!scene_is_empty(scene)) {
+        cur = put_string(cur, scene->bg, 2);
+        cur = put_string(cur, scene->music, 2);
+        put_u64(cur, (uint64_t)scene->music_frame);
+        cur += 8;
+        *cur++ = (unsigned char)scene->sprite_count;
+        for (size_t i = 0; i < scene->sprite_count; ++i) {
+            const FurrySceneSprite *sprite = &scene->sprites[i];
+            cur = put_string(cur, sprite->asset, 2);
+            cur = put_float(cur, sprite->x);
+            cur = put_float(cur, sprite->y);
+            cur = put_float(cur, sprite->rotation);
+            cur = put_string(cur, sprite->animation, 1);
+        }
+        *cur++ = (unsigned char)scene->layer_count;
+        for (size_t i = 0; i < scene->layer_count; ++i) {
+            cur = put_string(cur, scene->layers[i].name, 1);
+            put_u32(cur, (uint32_t)scene->layers[i].ip);
+            cur += 4;
+        }
+    }
+    if (out_len != NULL) {
+        *out_len = needed;
+    }
+    return FURRY_OK;
+}
+
+static const unsigned char *get_string(const unsigned char *cur, const unsigned char *end, size_t width, char *out, size_t out_size) {
+    if (cur == NULL || (size_t)(end - cur) < width) {
+        return NULL;
+    }
+    size_t len = width == 2 ? (size_t)cur[0] | (size_t)cur[1] << 8 : cur[0];
+    cur += width;
+    if (len >= out_size || (size_t)(end - cur) < len) {
+        return NULL;
+    }
+    memcpy(out, cur, len);
+    out[len] = '\0';
+    return cur + len;
+}
+
+static const unsigned char *get_float(const unsigned char *cur, const unsigned char *end, float *out) {
+    if (cur == NULL || end - cur < 4) {
+        return NULL;
+    }
+    uint32_t bits = get_u32(cur);
+    memcpy(out, &bits, sizeof(*out));
+    return cur + 4;
+}
+
+static int decode_scene(const unsigned char *cur, const unsigned char *end, FurrySceneState *scene) {
+    cur = get_string(cur, end, 2, scene->bg, sizeof(scene->bg));
+    cur = get_string(cur, end, 2, scene->music, sizeof(scene->music));
+    if (cur == NULL || end - cur < 9) {
+        return FURRY_ERR;
+    }
+    scene->music_frame = (size_t)get_u64(cur);
+    cur += 8;
+    scene->sprite_count = *cur++;
+    if (scene->sprite_count > FURRY_MAX_SCENE_SPRITES) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < scene->sprite_count; ++i) {
+        FurrySceneSprite *sprite = &scene->sprites[i];
+        cur = get_string(cur, end, 2, sprite->asset, sizeof(sprite->asset));
+        cur = get_float(cur, end, &sprite->x);
+        cur = get_float(cur, end, &sprite->y);
+        cur = get_float(cur, end, &sprite->rotation);
+        cur = get_string(cur, end, 1, sprite->animation, sizeof(sprite->animation));
+    }
+    if (cur == NULL || cur == end) {
+        return FURRY_ERR;
+    }
+    scene->layer_count = *cur++;
+    if (scene->layer_count > FURRY_MAX_SCENE_LAYERS) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        cur = get_string(cur, end, 1, scene->layers[i].name, sizeof(scene->layers[i].name));
+        if (cur == NULL || end - cur < 4) {
+            return FURRY_ERR;
+        }
+        scene->layers[i].ip = get_u32(cur);
+        cur += 4;
+    }
+    return cur == end ? FURRY_OK : FURRY_ERR;
+}
+
+int furry_snapshot_decode(const unsigned char *data, size_t size, FurryRuntimeSnapshot *out_snapshot) {
+    if (data == NULL || out_snapshot == NULL || size < 16) {
+        return FURRY_ERR;
+    }
+    memset(out_snapshot, 0, sizeof(*out_snapshot));
+    const unsigned char *cur = data;
+    const unsigned char *end = data + size;
+    out_snapshot->ip = (size_t)get_u64(cur);
+    cur += 8;
+    uint32_t depth = get_u32(cur);
+    cur += 4;
+    if (depth > FURRY_MAX_CALLSTACK || (size_t)(end - cur) < (size_t)depth * 8 + 4) {
+        return FURRY_ERR;
+    }
+    out_snapshot->callstack_depth = depth;
+    for (uint32_t i = 0; i < depth; ++i) {
+        out_snapshot->callstack[i] = (size_t)get_u64(cur);
+        cur += 8;
+    }
+    uint32_t var_count = get_u32(cur);
+    cur += 4;
+    if (var_count > FURRY_MAX_VARS) {
+        return FURRY_ERR;
+    }
+    for (uint32_t i = 0; i < var_count; ++i) {
+        FurryVar *var = &out_snapshot->vars[i];
+        if (cur >= end || *cur >= sizeof(var->key) || (size_t)(end - cur) < 1u + *cur + 1u) {
+            return FURRY_ERR;
+        }
+        size_t key_len = *cur++;
+        memcpy(var->key, cur, key_len);
+        cur += key_len;
+        if (*cur >= sizeof(var->value) || (size_t)(end - cur) < 1u + *cur) {
+            return FURRY_ERR;
+        }
+        size_t value_len = *cur++;
+        memcpy(var->value, cur, value_len);
+        cur += value_len;
+    }
+    out_snapshot->var_count = var_count;
+    return cur == end ? FURRY_OK : decode_scene(cur, end, &out_snapshot->scene);
+}
+
+static uint32_t record_crc(const SaveRecordHeader *header, const char *slot, const unsigned char *payload) {
+    const unsigned char *covered = (const unsigned char *)header + offsetof(SaveRecordHeader, sequence);
+    unsigned long crc = furry_crc32(0, covered, sizeof(SaveRecordHeader) - offsetof(SaveRecordHeader, sequence));
+    crc = furry_crc32(crc, slot, header->slot_size);
+    return (uint32_t)furry_crc32(crc, payload, header->payload_size);
+}
+
+static SaveIndexEntry *find_entry(SaveIndexEntry *entries, size_t count, const char *slot) {
+    for (size_t i = 0; i < count; ++i) {
+        if (strcmp(entries[i].slot, slot) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static int upsert_entry(FurrySaveStore *store, const SaveIndexEntry *entry) {
+    SaveIndexEntry *existing = find_entry(store->index, store->index_count, entry->slot);
+    if (existing != NULL) {
+        store->live_bytes -= existing->record_size;
+        *existing = *entry;
+        store->live_bytes += entry->record_size;
+        return FURRY_OK;
+    }
+    if (store->index_count == store->index_capacity) {
+        size_t next = store->index_capacity == 0 ? 16 : store->index_capacity * 2;
+        SaveIndexEntry *resized = furry_realloc(FURRY_MEM_SAVE, store->index, next * sizeof(SaveIndexEntry));
+        if (resized == NULL) {
+            return FURRY_ERR;
+        }
+        store->index = resized;
+        store->index_capacity = next;
+    }
+    store->index[store->index_count++] = *entry;
+    store->live_bytes += entry->record_size;
+    return FURRY_OK;
+}
+
+static PendingSave *find_pending(SaveBatch *batch, const char *slot) {
+    for (size_t i = 0; i < batch->count; ++i) {
+        if (strcmp(batch->items[i].slot, slot) == 0) {
+            return &batch->items[i];
+        }
+    }
+    return NULL;
+}
+
+static int create_log(const char *path, uint64_t generation) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    SaveLogHeader header;
+    memcpy(header.magic, SAVE_LOG_MAGIC, 4);
+    header.version = SAVE_VERSION;
+    header.generation = generation;
+    int rc = fwrite(&header, sizeof(header), 1, file) == 1 && furry_file_sync(file) == FURRY_OK ? FURRY_OK : FURRY_ERR;
+    return fclose(file) == 0 ? rc : FURRY_ERR;
+}
+
+static void load_index_checkpoint(FurrySaveStore *store, size_t file_size) {
+    FILE *file = fopen(store->index_path, "rb");
+    if (file == NULL) {
+        return;
+    }
+    SaveIndexHeader header;
+    SaveIndexEntry *entries = NULL;
+    if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, SAVE_INDEX_MAGIC, 4) == 0 &&
+        header.version == SAVE_VERSION && header.generation == store->generation && header.log_size <= file_size &&
+        header.count <= 1u << 20) {
+        entries = furry_alloc(FURRY_MEM_SAVE, header.count > 0 ? header.count * sizeof(SaveIndexEntry) : 1);
+        if (entries != NULL && fread(entries, sizeof(SaveIndexEntry), header.count, file) == header.count) {
+            uint32_t crc = header.crc;
+            header.crc = 0;
+            unsigned long actual = furry_crc32(0, &header, sizeof(header));
+            actual = furry_crc32(actual, entries, header.count * sizeof(SaveIndexEntry));
+            if (actual == crc) {
+                store->index = entries;
+                store->index_count = header.count;
+                store->index_capacity = header.count;
+                store->next_sequence = header.next_sequence;
+                store->log_size = (size_t)header.log_size;
+                entries = NULL;
+                for (size_t i = 0; i < store->index_count; ++i) {
+                    store->index[i].slot[FURRY_MAX_NAME - 1] = '\0';
+                    store->live_bytes += store->index[i].record_size;
+                }
+            }
+        }
+    }
+    furry_free(entries);
+    fclose(file);
+}
+
+static int write_index_checkpoint(FurrySaveStore *store) {
+    FILE *file = fopen(store->temp_path, "wb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    SaveIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SAVE_INDEX_MAGIC, 4);
+    header.version = SAVE_VERSION;
+    header.generation = store->generation;
+    header.log_size = store->log_size;
+    header.next_sequence = store->next_sequence;
+    header.count = (uint32_t)store->index_count;
+    unsigned long crc = furry_crc32(0, &header, sizeof(header));
+    header.crc = (uint32_t)furry_crc32(crc, store->index, store->index_count * sizeof(SaveIndexEntry));
+    int rc = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(store->index, sizeof(SaveIndexEntry), store->index_count, file) == store->index_count &&
+             furry_file_sync(file) == FURRY_OK ? FURRY_OK : FURRY_ERR;
+    if (fclose(file) != 0 || rc != FURRY_OK) {
+        remove(store->temp_path);
+        return FURRY_ERR;
+    }
+#if defined(_WIN32)
+    remove(store->index_path);
+#endif
+    return rename(store->temp_path, store->index_path) == 0 ? FURRY_OK : FURRY_ERR;
+}
+
+/* Replays records after the checkpoint; the first torn or corrupt record marks the end of the log. */
+static int scan_log(FurrySaveStore *store, FILE *file, size_t file_size) {
+    size_t offset = store->log_size;
+    unsigned char *buffer = NULL;
+    size_t buffer_size = 0;
+    int rc = FURRY_OK;
+    while (offset + sizeof(SaveRecordHeader) <= file_size) {
+        SaveRecordHeader header;
+        if (fseek(file, (long)offset, SEEK_SET) != 0 || fread(&header, sizeof(header), 1, file) != 1 ||
+            header.magic != SAVE_RECORD_MAGIC || header.slot_size == 0 || header.slot_size >= FURRY_MAX_NAME ||
+            header.payload_size > SAVE_MAX_PAYLOAD) {
+            break;
+        }
+        size_t body = (size_t)header.slot_size + header.payload_size;
+        if (offset + sizeof(header) + body > file_size) {
+            break;
+        }
+        if (body > buffer_size) {
+            unsigned char *resized = furry_realloc(FURRY_MEM_SAVE, buffer, body);
+            if (resized == NULL) {
+                rc = FURRY_ERR;
+                break;
+            }
+            buffer = resized;
+            buffer_size = body;
+        }
+        if (fread(buffer, 1, body, file) != body ||
+            record_crc(&header, (const char *)buffer, buffer + header.slot_size) != header.crc) {
+            break;
+        }
+        SaveIndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.slot, buffer, header.slot_size);
+        entry.offset = offset;
+        entry.sequence = header.sequence;
+        entry.record_size = (uint32_t)(sizeof(header) + body);
+        entry.payload_size = header.payload_size;
+        if (upsert_entry(store, &entry) != FURRY_OK) {
+            rc = FURRY_ERR;
+            break;
+        }
+        if (header.sequence >= store->next_sequence) {
+            store->next_sequence = header.sequence + 1;
+        }
+        offset += entry.record_size;
+    }
+    furry_free(buffer);
+    store->log_size = offset;
+    return rc;
+}
+
+static int open_log(FurrySaveStore *store) {
+    FILE *file = fopen(store->path, "rb");
+    if (file == NULL) {
+        store->generation = 1;
+        if (create_log(store->path, store->generation) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        file = fopen(store->path, "rb");
+        if (file == NULL) {
+            return FURRY_ERR;
+        }
+    }
+
+    SaveLogHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, SAVE_LOG_MAGIC, 4) != 0 ||
+        header.version != SAVE_VERSION || fseek(file, 0, SEEK_END) != 0) {
+        fclose(file);
+        return FURRY_ERR;
+    }
+    long end = ftell(file);
+    if (end < 0) {
+        fclose(file);
+        return FURRY_ERR;
+    }
+    size_t file_size = (size_t)end;
+    store->generation = header.generation;
+    store->log_size = sizeof(SaveLogHeader);
+    load_index_checkpoint(store, file_size);
+    int rc = scan_log(store, file, file_size);
+    fclose(file);
+    if (rc != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    if (store->log_size < file_size && furry_file_truncate(store->path, store->log_size) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+
+    store->log = fopen(store->path, "ab");
+    store->map_stale = 1;
+    return store->log == NULL ? FURRY_ERR : FURRY_OK;
+}
+
+static int append_batch(FurrySaveStore *store, const SaveBatch *batch, uint64_t first_sequence) {
+    for (size_t i = 0; i < batch->count; ++i) {
+        const PendingSave *item = &batch->items[i];
+        SaveRecordHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = SAVE_RECORD_MAGIC;
+        header.sequence = first_sequence + i;
+        header.payload_size = (uint32_t)item->size;
+        header.slot_size = (uint16_t)strlen(item->slot);
+        header.crc = record_crc(&header, item->slot, item->data);
+        if (fwrite(&header, sizeof(header), 1, store->log) != 1 ||
+            fwrite(item->slot, 1, header.slot_size, store->log) != header.slot_size ||
+            fwrite(item->data, 1, item->size, store->log) != item->size) {
+            return FURRY_ERR;
+        }
+    }
+    return furry_file_sync(store->log);
+}
+
+/* Rewrites live records into a fresh log generation; only the writer thread calls this. */
+static int compact_log(FurrySaveStore *store) {
+    SaveIndexEntry *entries = furry_alloc(FURRY_MEM_SAVE, (store->index_count > 0 ? store->index_count : 1) * sizeof(SaveIndexEntry));
+    FILE *source = fopen(store->path, "rb");
+    if (entries == NULL || source == NULL || create_log(store->temp_path, store->generation + 1) != FURRY_OK) {
+        furry_free(entries);
+        if (source != NULL) {
+            fclose(source);
+        }
+        return FURRY_ERR;
+    }
+    FILE *target = fopen(store->temp_path, "ab");
+    unsigned char *buffer = NULL;
+    size_t buffer_size = 0;
+    size_t offset = sizeof(SaveLogHeader);
+    int rc = target == NULL ? FURRY_ERR : FURRY_OK;
+    for (size_t i = 0; rc == FURRY_OK && i < store->index_count; ++i) {
+        entries[i] = store->index[i];
+        if (entries[i].record_size > buffer_size) {
+            unsigned char *resized = furry_realloc(FURRY_MEM_SAVE, buffer, entries[i].record_size);
+            if (resized == NULL) {
+                rc = FURRY_ERR;
+                break;
+            }
+            buffer = resized;
+            buffer_size = entries[i].record_size;
+        }
+        if (fseek(source, (long)entries[i].offset, SEEK_SET) != 0 ||
+            fread(buffer, 1, entries[i].record_size, source) != entries[i].record_size ||
+            fwrite(buffer, 1, entries[i].record_size, target) != entries[i].record_size) {
+            rc = FURRY_ERR;
+            break;
+        }
+        entries[i].offset = offset;
+        offset += entries[i].record_size;
+    }
+    furry_free(buffer);
+    fclose(source);
+    if (target != NULL && (furry_file_sync(target) != FURRY_OK || fclose(target) != 0)) {
+        rc = FURRY_ERR;
+    }
+    if (rc != FURRY_OK) {
+        furry_free(entries);
+        remove(store->temp_path);
+        return FURRY_ERR;
+    }
+
+    mtx_lock(&store->lock);
+    fclose(store->log);
+    store->log = NULL;
+#if defined(_WIN32)
+    remove(store->path);
+#endif
+    if (rename(store->temp_path, store->path) == 0) {
+        furry_free(store->index);
+        store->index = entries;
+        store->index_capacity = store->index_count;
+        store->generation++;
+        store->log_size = offset;
+        store->live_bytes = offset - sizeof(SaveLogHeader);
+        store->map_stale = 1;
+        store->stats.compactions++;
+    } else {
+        furry_free(entries);
+        rc = FURRY_ERR;
+    }
+    store->log = fopen(store->path, "ab");
+    if (store->log == NULL) {
+        rc = FURRY_ERR;
+    }
+    mtx_unlock(&store->lock);
+    return rc == FURRY_OK ? write_index_checkpoint(store) : FURRY_ERR;
+}
+
+static int writer_main(void *arg) {
+    FurrySaveStore *store = arg;
+    furry_trace_thread_name("furry save writer");
+    mtx_lock(&store->lock);
+    for (;;) {
+        while (store->batches[store->front].count == 0 && !store->stop) {
+            cnd_wait(&store->wake, &store->lock);
+        }
+        SaveBatch *batch = &store->batches[store->front];
+        if (batch->count == 0) {
+            break;
+        }
+        store->front ^= 1;
+        store->writing = 1;
+        uint64_t first_sequence = store->next_sequence;
+        size_t base = store->log_size;
+        mtx_unlock(&store->lock);
+
+        int rc = store->log == NULL ? FURRY_ERR : append_batch(store, batch, first_sequence);
+
+        mtx_lock(&store->lock);
+        for (size_t i = 0; rc == FURRY_OK && i < batch->count; ++i) {
+            SaveIndexEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            memcpy(entry.slot, batch->items[i].slot, sizeof(entry.slot));
+            entry.offset = base;
+            entry.sequence = first_sequence + i;
+            entry.payload_size = (uint32_t)batch->items[i].size;
+            entry.record_size = (uint32_t)(sizeof(SaveRecordHeader) + strlen(entry.slot) + entry.payload_size);
+            base += entry.record_size;
+            rc = upsert_entry(store, &entry);
+        }
+        if (rc == FURRY_OK) {
+            store->next_sequence = first_sequence + batch->count;
+            store->log_size = base;
+            store->stats.records_written += batch->count;
+            store->stats.batches++;
+            store->stats.fsyncs++;
+        } else {
+            store->failed = 1;
+        }
+        batch->count = 0;
+        int compact = rc == FURRY_OK && store->log_size >= store->compact_min_bytes &&
+                      store->log_size - sizeof(SaveLogHeader) - store->live_bytes > store->live_bytes;
+        if (compact) {
+            mtx_unlock(&store->lock);
+            rc = compact_log(store);
+            mtx_lock(&store->lock);
+            if (rc != FURRY_OK) {
+                store->failed = 1;
+            }
+        }
+        store->writing = 0;
+        cnd_broadcast(&store->drained);
+    }
+    mtx_unlock(&store->lock);
+    return 0;
+}
+
+static void free_batches(FurrySaveStore *store) {
+    for (int b = 0; b < 2; ++b) {
+        for (size_t i = 0; i < store->batches[b].capacity; ++i) {
+            furry_free(store->batches[b].items[i].data);
+        }
+        furry_free(store->batches[b].items);
+    }
+}
+
+int furry_save_store_open(const char *path, const FurrySaveStoreConfig *config, FurrySaveStore **out_store) {
+    if (path == NULL || out_store == NULL) {
+        return FURRY_ERR;
+    }
+    *out_store = NULL;
+    FurrySaveStore *store = furry_calloc(FURRY_MEM_SAVE, 1, sizeof(FurrySaveStore));
+    if (store == NULL) {
+        return FURRY_ERR;
+    }
+    if (snprintf(store->path, sizeof(store->path), "%s", path) >= (int)sizeof(store->path)) {
+        furry_free(store);
+        return FURRY_ERR;
+    }
+    snprintf(store->index_path, sizeof(store->index_path), "%s.idx", path);
+    snprintf(store->temp_path, sizeof(store->temp_path), "%s.tmp", path);
+    store->compact_min_bytes = config != NULL && config->compact_min_bytes > 0 ? config->compact_min_bytes : SAVE_DEFAULT_COMPACT_MIN;
+
+    if (open_log(store) != FURRY_OK) {
+        if (store->log != NULL) {
+            fclose(store->log);
+        }
+        furry_free(store->index);
+        furry_free(store);
+        return FURRY_ERR;
+    }
+
+    if (mtx_init(&store->lock, mtx_plain) != thrd_success) {
+        fclose(store->log);
+        furry_free(store->index);
+        furry_free(store);
+        return FURRY_ERR;
+    }
+    cnd_init(&store->wake);
+    cnd_init(&store->drained);
+    if (thrd_create(&store->writer, writer_main, store) != thrd_success) {
+        cnd_destroy(&store->wake);
+        cnd_destroy(&store->drained);
+        mtx_destroy(&store->lock);
+        fclose(store->log);
+        furry_free(store->index);
+        furry_free(store);
+        return FURRY_ERR;
+    }
+    *out_store = store;
+    return FURRY_OK;
+}
+
+void furry_save_store_close(FurrySaveStore *store) {
+    if (store == NULL) {
+        return;
+    }
+    mtx_lock(&store->lock);
+    store->stop = 1;
+    cnd_signal(&store->wake);
+    mtx_unlock(&store->lock);
+    thrd_join(store->writer, NULL);
+
+    if (!store->failed) {
+        write_index_checkpoint(store);
+    }
+    if (store->log != NULL) {
+        fclose(store->log);
+    }
+    furry_unmap_file(&store->map);
+    free_batches(store);
+    furry_free(store->index);
+    cnd_destroy(&store->wake);
+    cnd_destroy(&store->drained);
+    mtx_destroy(&store->lock);
+    furry_free(store);
+}
+
+int furry_save_store_put(FurrySaveStore *store, const char *slot, const FurryRuntimeSnapshot *snapshot) {
+    if (store == NULL || slot == NULL || snapshot == NULL || slot[0] == '\0' || strlen(slot) >= FURRY_MAX_NAME) {
+        return FURRY_ERR;
+    }
+    size_t size = furry_snapshot_encoded_size(snapshot);
+
+    mtx_lock(&store->lock);
+    SaveBatch *batch = &store->batches[store->front];
+    PendingSave *item = find_pending(batch, slot);
+    int rc = store->failed ? FURRY_ERR : FURRY_OK;
+    if (rc == FURRY_OK && item == NULL) {
+        if (batch->count == batch->capacity) {
+            size_t next = batch->capacity == 0 ? 4 : batch->capacity * 2;
+            PendingSave *resized = furry_realloc(FURRY_MEM_SAVE, batch->items, next * sizeof(PendingSave));
+            if (resized == NULL) {
+                rc = FURRY_ERR;
+            } else {
+                memset(resized + batch->capacity, 0, (next - batch->capacity) * sizeof(PendingSave));
+                batch->items = resized;
+                batch->capacity = next;
+            }
+        }
+        if (rc == FURRY_OK) {
+            item = &batch->items[batch->count++];
+            snprintf(item->slot, sizeof(item->slot), "%s", slot);
+            item->size = 0;
+        }
+    }
+    if (rc == FURRY_OK && item->capacity < size) {
+        unsigned char *resized = furry_realloc(FURRY_MEM_SAVE, item->data, size);
+        if (resized == NULL) {
+            rc = FURRY_ERR;
+        } else {
+            item->data = resized;
+            item->capacity = size;
+        }
+    }
+    if (rc == FURRY_OK) {
+        rc = furry_snapshot_encode(snapshot, item->data, item->capacity, &item->size);
+    }
+    if (rc != FURRY_OK && item != NULL && item->size == 0) {
+        batch->count--;
+    }
+    cnd_signal(&store->wake);
+    mtx_unlock(&store->lock);
+    return rc;
+}
+
+static int read_mapped_record(FurrySaveStore *store, const SaveIndexEntry *entry, FurryRuntimeSnapshot *out_snapshot) {
+    size_t end = (size_t)entry->offset + entry->record_size;
+    if (store->map_stale || store->map.size < end) {
+        furry_unmap_file(&store->map);
+        if (furry_map_file(store->path, &store->map) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        store->map_stale = 0;
+        if (store->map.size < end) {
+            return FURRY_ERR;
+        }
+    }
+    SaveRecordHeader header;
+    memcpy(&header, store->map.data + entry->offset, sizeof(header));
+    const char *slot = (const char *)store->map.data + entry->offset + sizeof(header);
+    const unsigned char *payload = (const unsigned char *)slot + header.slot_size;
+    if (header.magic != SAVE_RECORD_MAGIC || record_crc(&header, slot, payload) != header.crc) {
+        return FURRY_ERR;
+    }
+    return furry_snapshot_decode(payload, header.payload_size, out_snapshot);
+}
+
+int furry_save_store_get(FurrySaveStore *store, const char *slot, FurryRuntimeSnapshot *out_snapshot) {
+    if (store == NULL || slot == NULL || out_snapshot == NULL) {
+        return FURRY_ERR;
+    }
+    mtx_lock(&store->lock);
+    int rc = FURRY_ERR;
+    PendingSave *pending = find_pending(&store->batches[store->front], slot);
+    if (pending == NULL) {
+        pending = find_pending(&store->batches[store->front ^ 1], slot);
+    }
+    if (pending != NULL) {
+        rc = furry_snapshot_decode(pending->data, pending->size, out_snapshot);
+    } else {
+        const SaveIndexEntry *entry = find_entry(store->index, store->index_count, slot);
+        if (entry != NULL) {
+            rc = read_mapped_record(store, entry, out_snapshot);
+        }
+    }
+    mtx_unlock(&store->lock);
+    return rc;
+}
+
+static size_t add_slot_info(FurrySaveSlotInfo *out_slots, size_t count, size_t max_slots, const char *slot,
+                            unsigned long long sequence, size_t size) {
+    for (size_t i = 0; i < count && i < max_slots; ++i) {
+        if (strcmp(out_slots[i].slot, slot) == 0) {
+            out_slots[i].sequence = sequence;
+            out_slots[i].size = size;
+            return count;
+        }
+    }
+    if (count < max_slots) {
+        snprintf(out_slots[count].slot, sizeof(out_slots[count].slot), "%s", slot);
+        out_slots[count].sequence = sequence;
+        out_slots[count].size = size;
+    }
+    return count + 1;
+}
+
+size_t furry_save_store_list(FurrySaveStore *store, FurrySaveSlotInfo *out_slots, size_t max_slots) {
+    if (store == NULL) {
+        return 0;
+    }
+    if (out_slots == NULL) {
+        max_slots = 0;
+    }
+    mtx_lock(&store->lock);
+    size_t count = 0;
+    for (size_t i = 0; i < store->index_count; ++i) {
+        count = add_slot_info(out_slots, count, max_slots, store->index[i].slot, store->index[i].sequence, store->index[i].payload_size);
+    }
+    /* Pending saves are newer than anything indexed; they get sequence numbers once written. */
+    unsigned long long pending_sequence = store->next_sequence;
+    for (int b = 0; b < 2; ++b) {
+        const SaveBatch *batch = &store->batches[b == 0 ? store->front ^ 1 : store->front];
+        for (size_t i = 0; i < batch->count; ++i) {
+            count = add_slot_info(out_slots, count, max_slots, batch->items[i].slot, pending_sequence++, batch->items[i].size);
+        }
+    }
+    mtx_unlock(&store->lock);
+    return count;
+}
+
+int furry_save_store_flush(FurrySaveStore *store) {
+    if (store == NULL) {
+        return FURRY_ERR;
+    }
+    mtx_lock(&store->lock);
+    while (!store->failed && (store->batches[store->front].count > 0 || store->writing)) {
+        cnd_signal(&store->wake);
+        cnd_wait(&store->drained, &store->lock);
+    }
+    int rc = store->failed ? FURRY_ERR : FURRY_OK;
+    mtx_unlock(&store->lock);
+    return rc;
+}
+
+void furry_save_store_stats(FurrySaveStore *store, FurrySaveStoreStats *out_stats) {
+    if (store == NULL || out_stats == NULL) {
+        return;
+    }
+    mtx_lock(&store->lock);
+    *out_stats = store->stats;
+    out_stats->log_bytes = store->log_size;
+    out_stats->live_bytes = store->live_bytes;
+    mtx_unlock(&store->lock);
+}
@@ -0,0 +1,315 @@
+#include "furry_sdl.h"
+#include "furry_internal.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <SDL3/SDL.h>
+
+#define SDL_COMMAND_BATCH 16
+#define SDL_DEFAULT_HZ 60.0
+
+struct FurrySdlPlatform {
+    FurrySdlConfig config;
+    SDL_Window *window;
+    Uint32 wake_event;
+    /* Set by furry_sdl_wake until the loop drains, so a chatty VM queues one wake event, not one per record. */
+    atomic_int wake_pending;
+    FurryWorker *worker;
+    FurryPacer pacer;
+    FurryInputRouter router;
+    int animating;
+    int quit;
+    int failed;
+    FurryHostCommand commands[SDL_COMMAND_BATCH];
+    unsigned long long created_ns;
+    clock_t created_cpu;
+    FurrySdlStats stats;
+};
+
+unsigned long long furry_sdl_now(void) {
+    return (unsigned long long)SDL_GetTicksNS();
+}
+
+int furry_sdl_create(const FurrySdlConfig *config, FurrySdlPlatform **out_platform) {
+    if (config == NULL || out_platform == NULL || config->width <= 0 || config->height <= 0) {
+        return FURRY_ERR;
+    }
+    *out_platform = NULL;
+    FurrySdlPlatform *platform = furry_calloc(FURRY_MEM_RENDER, 1, sizeof(FurrySdlPlatform));
+    if (platform == NULL) {
+        return FURRY_ERR;
+    }
+    platform->config = *config;
+    atomic_init(&platform->wake_pending, 0);
+    if (config->video_driver != NULL) {
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, config->video_driver);
+    }
+    if (!SDL_InitSubSystem(SDL_INIT_VIDEO)) {
+        furry_free(platform);
+        return FURRY_ERR;
+    }
+    SDL_WindowFlags flags = 0;
+    if (config->resizable) {
+        flags |= SDL_WINDOW_RESIZABLE;
+    }
+    if (config->hidden) {
+        flags |= SDL_WINDOW_HIDDEN;
+    }
+    if (config->vulkan) {
+        flags |= SDL_WINDOW_VULKAN;
+    }
+    platform->window = SDL_CreateWindow(config->title != NULL ? config->title : "FURRY", config->width, config->height, flags);
+    platform->wake_event = SDL_RegisterEvents(1);
+    if (platform->window == NULL || platform->wake_event == 0) {
+        furry_sdl_destroy(platform);
+        return FURRY_ERR;
+    }
+    SDL_StartTextInput(platform->window);
+    double hz = config->target_hz > 0.0 ? config->target_hz : (config->vsync ? 0.0 : SDL_DEFAULT_HZ);
+    furry_pacer_init(&platform->pacer, hz);
+    furry_router_reset(&platform->router);
+    platform->created_ns = furry_sdl_now();
+    platform->created_cpu = clock();
+    *out_platform = platform;
+    return FURRY_OK;
+}
+
+void furry_sdl_destroy(FurrySdlPlatform *platform) {
+    if (platform == NULL) {
+        return;
+    }
+    if (platform->window != NULL) {
+        SDL_StopTextInput(platform->window);
+        SDL_DestroyWindow(platform->window);
+    }
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    furry_free(platform);
+}
+
+void furry_sdl_attach_worker(FurrySdlPlatform *platform, FurryWorker *worker) {
+    if (platform == NULL) {
+        return;
+    }
+    platform->worker = worker;
+    furry_router_reset(&platform->router);
+    /* Records published before the attach did not wake anyone. */
+    furry_sdl_wake(platform);
+}
+
+void furry_sdl_wake(void *user_data) {
+    FurrySdlPlatform *platform = user_data;
+    if (platform == NULL || atomic_exchange_explicit(&platform->wake_pending, 1, memory_order_acq_rel)) {
+        return;
+    }
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = platform->wake_event;
+    SDL_PushEvent(&event);
+}
+
+void furry_sdl_quit(FurrySdlPlatform *platform) {
+    if (platform != NULL) {
+        platform->quit = 1;
+    }
+}
+
+void furry_sdl_invalidate(FurrySdlPlatform *platform) {
+    if (platform != NULL) {
+        furry_pacer_invalidate(&platform->pacer);
+    }
+}
+
+void furry_sdl_set_text_area(FurrySdlPlatform *platform, int x, int y, int w, int h, int cursor) {
+    if (platform == NULL) {
+        return;
+    }
+    SDL_Rect rect = {x, y, w, h};
+    SDL_SetTextInputArea(platform->window, &rect, cursor);
+}
+
+void *furry_sdl_window(FurrySdlPlatform *platform) {
+    return platform != NULL ? platform->window : NULL;
+}
+
+/* Fills out_event from an SDL event; returns 0 for events the loop does not pass on. */
+static int translate_event(const SDL_Event *event, FurryPlatformEvent *out_event) {
+    memset(out_event, 0, sizeof(*out_event));
+    out_event->timestamp_ns = event->common.timestamp;
+    switch (event->type) {
+        case SDL_EVENT_QUIT:
+        case SDL_EVENT_WINDOW_CLOSE_REQUESTED:
+            out_event->type = FURRY_EVENT_QUIT;
+            return 1;
+        case SDL_EVENT_KEY_DOWN:
+            out_event->type = FURRY_EVENT_KEY;
+            out_event->key = event->key.key == SDLK_KP_ENTER ? FURRY_KEY_RETURN : (int)event->key.key;
+            out_event->repeat = event->key.repeat;
+            return 1;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            out_event->type = FURRY_EVENT_POINTER;
+            out_event->button = event->button.button;
+            out_event->x = event->button.x;
+            out_event->y = event->button.y;
+            return 1;
+        case SDL_EVENT_MOUSE_MOTION:
+            /* button 0: hover only, so it neither redraws nor counts as input unless on_event invalidates. */
+            out_event->type = FURRY_EVENT_POINTER;
+            out_event->x = event->motion.x;
+            out_event->y = event->motion.y;
+            return 1;
+        case SDL_EVENT_TEXT_INPUT:
+            out_event->type = FURRY_EVENT_TEXT;
+            snprintf(out_event->text, sizeof(out_event->text), "%s", event->text.text != NULL ? event->text.text : "");
+            return 1;
+        case SDL_EVENT_TEXT_EDITING:
+            out_event->type = FURRY_EVENT_COMPOSE;
+            snprintf(out_event->text, sizeof(out_event->text), "%s", event->edit.text != NULL ? event->edit.text : "");
+            out_event->cursor = event->edit.start;
+            out_event->selection = event->edit.length;
+            return 1;
+        case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+            out_event->type = FURRY_EVENT_RESIZE;
+            out_event->width = event->window.data1;
+            out_event->height = event->window.data2;
+            return 1;
+        case SDL_EVENT_WINDOW_EXPOSED:
+            out_event->type = FURRY_EVENT_EXPOSE;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void handle_event(FurrySdlPlatform *platform, const SDL_Event *event) {
+    platform->stats.events++;
+    if (event->type == platform->wake_event) {
+        platform->stats.wakes++;
+        return;
+    }
+    FurryPlatformEvent translated;
+    if (!translate_event(event, &translated)) {
+        return;
+    }
+    switch (translated.type) {
+        case FURRY_EVENT_QUIT:
+            platform->quit = 1;
+            break;
+        case FURRY_EVENT_RESIZE:
+        case FURRY_EVENT_EXPOSE:
+            furry_pacer_invalidate(&platform->pacer);
+            break;
+        case FURRY_EVENT_POINTER:
+            if (translated.button != 0) {
+                furry_pacer_input(&platform->pacer, translated.timestamp_ns);
+            }
+            break;
+        default:
+            furry_pacer_input(&platform->pacer, translated.timestamp_ns);
+            break;
+    }
+    FurryWorkerInput input;
+    if (platform->worker != NULL && furry_router_event(&platform->router, &translated, &input)) {
+        furry_worker_send(platform->worker, &input);
+    }
+    if (platform->config.on_event != NULL && platform->config.on_event(&translated, platform->config.user_data) != FURRY_OK) {
+        platform->failed = 1;
+    }
+}
+
+static void drain_worker(FurrySdlPlatform *platform) {
+    if (platform->worker == NULL) {
+        return;
+    }
+    /* Cleared before polling: a record published after the last poll below sees 0 and wakes the loop again. */
+    atomic_store_explicit(&platform->wake_pending, 0, memory_order_release);
+    size_t count;
+    while ((count = furry_worker_poll(platform->worker, platform->commands, SDL_COMMAND_BATCH)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            const FurryHostCommand *command = &platform->commands[i];
+            platform->stats.commands++;
+            furry_router_command(&platform->router, command);
+            furry_pacer_invalidate(&platform->pacer);
+            if (platform->config.on_command != NULL && platform->config.on_command(command, platform->config.user_data) != FURRY_OK) {
+                platform->failed = 1;
+            }
+            if (command->op == FURRY_OP_END && !command->ui_patch && !command->bind_update) {
+                platform->quit = 1;
+            }
+        }
+    }
+}
+
+/* SDL_WaitEventTimeout counts milliseconds; the rest of a frame deadline is slept precisely. */
+static int wait_event(long long timeout_ns, SDL_Event *out_event) {
+    if (timeout_ns < 0) {
+        return SDL_WaitEvent(out_event);
+    }
+    unsigned long long deadline = furry_sdl_now() + (unsigned long long)timeout_ns;
+    Sint32 ms = (Sint32)(timeout_ns / 1000000);
+    if (ms > 0 && SDL_WaitEventTimeout(out_event, ms)) {
+        return 1;
+    }
+    unsigned long long now = furry_sdl_now();
+    if (now < deadline) {
+        SDL_DelayPrecise(deadline - now);
+    }
+    return SDL_PollEvent(out_event);
+}
+
+int furry_sdl_step(FurrySdlPlatform *platform, long long max_wait_ns) {
+    if (platform == NULL) {
+        return -1;
+    }
+    if (platform->quit || platform->failed) {
+        return platform->failed ? -1 : 0;
+    }
+    long long timeout = furry_pacer_timeout(&platform->pacer, furry_sdl_now(), platform->animating);
+    if (max_wait_ns >= 0 && (timeout < 0 || timeout > max_wait_ns)) {
+        timeout = max_wait_ns;
+    }
+    SDL_Event event;
+    int have = timeout != 0 ? wait_event(timeout, &event) : SDL_PollEvent(&event);
+    while (have) {
+        handle_event(platform, &event);
+        have = SDL_PollEvent(&event);
+    }
+    drain_worker(platform);
+    if (platform->failed) {
+        return -1;
+    }
+    unsigned long long now = furry_sdl_now();
+    if (!platform->quit && furry_pacer_due(&platform->pacer, now, platform->animating)) {
+        int animating = 0;
+        if (platform->config.on_frame != NULL) {
+            animating = platform->config.on_frame(now, platform->config.user_data);
+            if (animating < 0) {
+                platform->failed = 1;
+                return -1;
+            }
+        }
+        platform->animating = animating;
+        furry_pacer_frame_done(&platform->pacer, furry_sdl_now());
+    }
+    return platform->quit ? 0 : 1;
+}
+
+int furry_sdl_run(FurrySdlPlatform *platform) {
+    int rc;
+    while ((rc = furry_sdl_step(platform, -1)) == 1) {
+        continue;
+    }
+    return rc == 0 ? FURRY_OK : FURRY_ERR;
+}
+
+void furry_sdl_stats(const FurrySdlPlatform *platform, FurrySdlStats *out_stats) {
+    if (platform == NULL || out_stats == NULL) {
+        return;
+    }
+    *out_stats = platform->stats;
+    out_stats->pacing = platform->pacer.stats;
+    out_stats->wall_ns = furry_sdl_now() - platform->created_ns;
+    out_stats->cpu_ns = (unsigned long long)((double)(clock() - platform->created_cpu) * 1e9 / CLOCKS_PER_SEC);
+}
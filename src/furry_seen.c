@@ -0,0 +1,135 @@
+#include "furry_seen.h"
+#include "furry_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SEEN_MAGIC "FYSN"
+#define SEEN_VERSION 1u
+
+typedef struct SeenFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t fingerprint;
+    uint32_t count;
+    uint32_t crc;
+} SeenFileHeader;
+
+struct FurrySeenSet {
+    unsigned long long fingerprint;
+    size_t count;
+    size_t marked;
+    unsigned char *bits;
+};
+
+static size_t bitset_bytes(size_t count) {
+    return (count + 7) / 8;
+}
+
+int furry_seen_create(const FurryProgram *program, FurrySeenSet **out_seen) {
+    if (program == NULL || out_seen == NULL || program->count > UINT32_MAX) {
+        return FURRY_ERR;
+    }
+    *out_seen = NULL;
+    FurrySeenSet *seen = furry_calloc(FURRY_MEM_VM, 1, sizeof(FurrySeenSet));
+    if (seen == NULL) {
+        return FURRY_ERR;
+    }
+    seen->bits = furry_calloc(FURRY_MEM_VM, bitset_bytes(program->count) + 1, 1);
+    if (seen->bits == NULL) {
+        furry_free(seen);
+        return FURRY_ERR;
+    }
+    seen->fingerprint = furry_program_fingerprint(program);
+    seen->count = program->count;
+    *out_seen = seen;
+    return FURRY_OK;
+}
+
+void furry_seen_destroy(FurrySeenSet *seen) {
+    if (seen == NULL) {
+        return;
+    }
+    furry_free(seen->bits);
+    furry_free(seen);
+}
+
+int furry_seen_contains(const FurrySeenSet *seen, size_t ip) {
+    return seen != NULL && ip < seen->count && (seen->bits[ip >> 3] & (1u << (ip & 7))) != 0;
+}
+
+void furry_seen_mark(FurrySeenSet *seen, size_t ip) {
+    if (seen == NULL || ip >= seen->count) {
+        return;
+    }
+    unsigned char bit = (unsigned char)(1u << (ip & 7));
+    if ((seen->bits[ip >> 3] & bit) == 0) {
+        seen->bits[ip >> 3] |= bit;
+        seen->marked++;
+    }
+}
+
+size_t furry_seen_count(const FurrySeenSet *seen) {
+    return seen != NULL ? seen->marked : 0;
+}
+
+int furry_seen_save(const FurrySeenSet *seen, const char *path) {
+    if (seen == NULL || path == NULL) {
+        return FURRY_ERR;
+    }
+    char temp_path[FURRY_MAX_ASSET + 8];
+    int written = snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    if (written < 0 || (size_t)written >= sizeof(temp_path)) {
+        return FURRY_ERR;
+    }
+    size_t size = bitset_bytes(seen->count);
+    SeenFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEEN_MAGIC, 4);
+    header.version = SEEN_VERSION;
+    header.fingerprint = seen->fingerprint;
+    header.count = (uint32_t)seen->count;
+    header.crc = (uint32_t)furry_crc32(0, seen->bits, size);
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 && (size == 0 || fwrite(seen->bits, size, 1, file) == 1);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_seen_load(FurrySeenSet *seen, const char *path) {
+    if (seen == NULL || path == NULL) {
+        return FURRY_ERR;
+    }
+    FurryMappedFile file;
+    if (furry_map_file(path, &file) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    size_t size = bitset_bytes(seen->count);
+    SeenFileHeader header;
+    int valid = file.size == sizeof(header) + size;
+    if (valid) {
+        memcpy(&header, file.data, sizeof(header));
+        valid = memcmp(header.magic, SEEN_MAGIC, 4) == 0 && header.version == SEEN_VERSION && header.fingerprint == seen->fingerprint &&
+                header.count == seen->count && furry_crc32(0, file.data + sizeof(header), size) == header.crc;
+    }
+    if (valid) {
+        const unsigned char *bits = file.data + sizeof(header);
+        seen->marked = 0;
+        for (size_t i = 0; i < size; ++i) {
+            seen->bits[i] |= bits[i];
+            for (unsigned char byte = seen->bits[i]; byte != 0; byte &= (unsigned char)(byte - 1)) {
+                seen->marked++;
+            }
+        }
+    }
+    furry_unmap_file(&file);
+    return valid ? FURRY_OK : FURRY_ERR;
+}
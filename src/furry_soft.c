@@ -0,0 +1,762 @@
+#include "furry_soft.h"
+#include "furry_internal.h"
+#include "furry_layout.h"
+#include "furry_text.h"
+#include "furry_ui.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FURRY_SOFT_SSE2 1
+#endif
+
+#define SOFT_GLYPH_H 7
+#define SOFT_GLYPH_ADVANCE 6
+#define SOFT_LINE_HEIGHT 9
+#define SOFT_ATLAS_SIZE 256
+#define SOFT_PLACEHOLDER_W 48
+#define SOFT_PLACEHOLDER_H 96
+#define SOFT_MAX_IMAGES 64
+
+typedef struct SoftCachedImage {
+    char name[FURRY_MAX_ASSET];
+    FurrySoftImage image;
+} SoftCachedImage;
+
+struct FurrySoftRenderer {
+    int width;
+    int height;
+    unsigned char *pixels;
+    unsigned char *row;
+    char asset_root[FURRY_MAX_ASSET];
+    FurrySoftImageFn load_image;
+    void *user_data;
+    SoftCachedImage images[SOFT_MAX_IMAGES];
+    size_t image_count;
+    FurryLayout *layout;
+    FurryTextCache *text;
+    FurryTextLayout text_layout;
+    FurryMainMenuTheme theme;
+
+    /* UI column that ui_text/button/ui_image lines flow down. */
+    int column_x;
+    int column_w;
+    int cursor_y;
+    int ui_scale;
+
+    FurrySoftStats stats;
+};
+
+static unsigned div255(unsigned t) {
+    t += 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+/* Premultiplied src over opaque dst. The SSE2 and scalar paths do identical integer math, so output is bit-exact. */
+static void blend_span(unsigned char *dst, const unsigned char *src, size_t count) {
+    size_t i = 0;
+#if defined(FURRY_SOFT_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i c128 = _mm_set1_epi16(128);
+    const __m128i opaque = _mm_set1_epi32((int)0xff000000u);
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+        __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+        __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+        __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+        __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+        __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i t_lo = _mm_add_epi16(_mm_mullo_epi16(d_lo, _mm_sub_epi16(c255, a_lo)), c128);
+        __m128i t_hi = _mm_add_epi16(_mm_mullo_epi16(d_hi, _mm_sub_epi16(c255, a_hi)), c128);
+        t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+        t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+        __m128i out = _mm_packus_epi16(_mm_add_epi16(s_lo, t_lo), _mm_add_epi16(s_hi, t_hi));
+        _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(out, opaque));
+    }
+#endif
+    for (; i < count; ++i) {
+        const unsigned char *s = src + i * 4;
+        unsigned char *d = dst + i * 4;
+        unsigned inv = 255u - s[3];
+        d[0] = (unsigned char)(s[0] + div255(d[0] * inv));
+        d[1] = (unsigned char)(s[1] + div255(d[1] * inv));
+        d[2] = (unsigned char)(s[2] + div255(d[2] * inv));
+        d[3] = 255;
+    }
+}
+
+static void premultiply(unsigned char *pixels, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char *p = pixels + i * 4;
+        p[0] = (unsigned char)div255(p[0] * p[3]);
+        p[1] = (unsigned char)div255(p[1] * p[3]);
+        p[2] = (unsigned char)div255(p[2] * p[3]);
+    }
+}
+
+static void premultiplied_color(unsigned rgba, unsigned char out[4]) {
+    unsigned a = rgba & 0xffu;
+    out[0] = (unsigned char)div255(((rgba >> 24) & 0xffu) * a);
+    out[1] = (unsigned char)div255(((rgba >> 16) & 0xffu) * a);
+    out[2] = (unsigned char)div255(((rgba >> 8) & 0xffu) * a);
+    out[3] = (unsigned char)a;
+}
+
+static void fill_rect(FurrySoftRenderer *renderer, int x, int y, int w, int h, unsigned rgba) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > renderer->width ? renderer->width : x + w;
+    int y1 = y + h > renderer->height ? renderer->height : y + h;
+    if (x0 >= x1 || y0 >= y1 || (rgba & 0xffu) == 0) {
+        return;
+    }
+    unsigned char color[4];
+    premultiplied_color(rgba, color);
+    size_t span = (size_t)(x1 - x0);
+    for (size_t i = 0; i < span; ++i) {
+        memcpy(renderer->row + i * 4, color, 4);
+    }
+    for (int row = y0; row < y1; ++row) {
+        blend_span(renderer->pixels + ((size_t)row * (size_t)renderer->width + (size_t)x0) * 4, renderer->row, span);
+    }
+    renderer->stats.pixels_blended += span * (size_t)(y1 - y0);
+}
+
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *cur = (const unsigned char *)name; *cur != '\0'; ++cur) {
+        hash ^= *cur;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Banded capsule tinted by the asset name, so missing art still renders distinctly and deterministically. */
+static int make_placeholder(const char *name, FurrySoftImage *out_image) {
+    uint32_t hash = hash_name(name);
+    out_image->width = SOFT_PLACEHOLDER_W;
+    out_image->height = SOFT_PLACEHOLDER_H;
+    out_image->pixels = malloc((size_t)SOFT_PLACEHOLDER_W * SOFT_PLACEHOLDER_H * 4);
+    if (out_image->pixels == NULL) {
+        return FURRY_ERR;
+    }
+    int half_w = SOFT_PLACEHOLDER_W / 2;
+    for (int y = 0; y < SOFT_PLACEHOLDER_H; ++y) {
+        for (int x = 0; x < SOFT_PLACEHOLDER_W; ++x) {
+            unsigned char *p = out_image->pixels + ((size_t)y * SOFT_PLACEHOLDER_W + (size_t)x) * 4;
+            int dx = x - half_w;
+            int cy = y < half_w ? half_w : (y > SOFT_PLACEHOLDER_H - half_w ? SOFT_PLACEHOLDER_H - half_w : y);
+            int dy = y - cy;
+            int inside = dx * dx + dy * dy < half_w * half_w;
+            int band = (y / 8) & 1;
+            p[0] = (unsigned char)((hash & 0xffu) | (band ? 0x40u : 0u));
+            p[1] = (unsigned char)(((hash >> 8) & 0xffu) | (band ? 0x40u : 0u));
+            p[2] = (unsigned char)(((hash >> 16) & 0xffu) | (band ? 0x40u : 0u));
+            p[3] = inside ? 255 : 0;
+        }
+    }
+    return FURRY_OK;
+}
+
+int furry_soft_load_asset(const char *asset_root, const char *name, FurrySoftImageFn load, void *user_data, FurrySoftImage *out_image) {
+    char path[FURRY_MAX_ASSET * 2];
+    if (asset_root != NULL && asset_root[0] != '\0') {
+        snprintf(path, sizeof(path), "%s/%s", asset_root, name);
+    } else {
+        snprintf(path, sizeof(path), "%s", name);
+    }
+    memset(out_image, 0, sizeof(*out_image));
+    if (load == NULL) {
+        load = furry_soft_load_ppm;
+    }
+    if (load(path, out_image, user_data) != FURRY_OK || out_image->width <= 0 || out_image->height <= 0) {
+        free(out_image->pixels);
+        if (make_placeholder(name, out_image) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    premultiply(out_image->pixels, (size_t)out_image->width * (size_t)out_image->height);
+    return FURRY_OK;
+}
+
+static const FurrySoftImage *get_image(FurrySoftRenderer *renderer, const char *name) {
+    for (size_t i = 0; i < renderer->image_count; ++i) {
+        if (strcmp(renderer->images[i].name, name) == 0) {
+            return &renderer->images[i].image;
+        }
+    }
+    if (renderer->image_count == SOFT_MAX_IMAGES) {
+        free(renderer->images[0].image.pixels);
+        memmove(&renderer->images[0], &renderer->images[1], sizeof(SoftCachedImage) * (SOFT_MAX_IMAGES - 1));
+        renderer->image_count--;
+    }
+    SoftCachedImage *slot = &renderer->images[renderer->image_count];
+    if (furry_soft_load_asset(renderer->asset_root, name, renderer->load_image, renderer->user_data, &slot->image) != FURRY_OK) {
+        return NULL;
+    }
+    snprintf(slot->name, sizeof(slot->name), "%s", name);
+    renderer->image_count++;
+    return &slot->image;
+}
+
+static void sample_bilinear(const FurrySoftImage *image, int32_t u, int32_t v, unsigned char out[4]) {
+    int32_t fu = u & 0xffff;
+    int32_t fv = v & 0xffff;
+    int x0 = (int)((u - fu) / 65536);
+    int y0 = (int)((v - fv) / 65536);
+    unsigned fx = (unsigned)fu >> 8;
+    unsigned fy = (unsigned)fv >> 8;
+    const unsigned char *taps[4];
+    size_t stride = (size_t)image->width * 4;
+    if (x0 >= 0 && y0 >= 0 && x0 + 1 < image->width && y0 + 1 < image->height) {
+        taps[0] = image->pixels + (size_t)y0 * stride + (size_t)x0 * 4;
+        taps[1] = taps[0] + 4;
+        taps[2] = taps[0] + stride;
+        taps[3] = taps[2] + 4;
+    } else {
+        static const unsigned char transparent[4] = {0, 0, 0, 0};
+        for (int t = 0; t < 4; ++t) {
+            int tx = x0 + (t & 1);
+            int ty = y0 + (t >> 1);
+            taps[t] = tx < 0 || ty < 0 || tx >= image->width || ty >= image->height ? transparent : image->pixels + (size_t)ty * stride + (size_t)tx * 4;
+        }
+    }
+    for (int c = 0; c < 4; ++c) {
+        unsigned top = taps[0][c] * (256u - fx) + taps[1][c] * fx;
+        unsigned bottom = taps[2][c] * (256u - fx) + taps[3][c] * fx;
+        out[c] = (unsigned char)((top * (256u - fy) + bottom * fy + 32768u) >> 16);
+    }
+}
+
+/* Narrows [*lo, *hi) to the steps t where start + step * t lies in (-1, limit) texels; conservative by one pixel. */
+static void clip_axis(float start, float step, float limit, int *lo, int *hi) {
+    if (step == 0.0f) {
+        if (start <= -1.0f || start >= limit) {
+            *hi = *lo;
+        }
+        return;
+    }
+    float t0 = (-1.0f - start) / step;
+    float t1 = (limit - start) / step;
+    if (t0 > t1) {
+        float swap = t0;
+        t0 = t1;
+        t1 = swap;
+    }
+    /* Near-zero steps give huge t; the bounds only matter within one framebuffer row. */
+    t0 = t0 < -1048576.0f ? -1048576.0f : (t0 > 1048576.0f ? 1048576.0f : t0);
+    t1 = t1 < -1048576.0f ? -1048576.0f : (t1 > 1048576.0f ? 1048576.0f : t1);
+    int a = (int)floorf(t0) - 1;
+    int b = (int)ceilf(t1) + 1;
+    *lo = a > *lo ? a : *lo;
+    *hi = b < *hi ? b : *hi;
+}
+
+/*
+ * Draws image with its (anchor_x, anchor_y) texel point at screen (px, py),
+ * scaled then rotated clockwise. Inverse-maps each covered pixel in 16.16
+ * fixed point and blends one row at a time.
+ */
+static void draw_image(FurrySoftRenderer *renderer, const FurrySoftImage *image, float px, float py, float anchor_x, float anchor_y,
+                       float rotation_deg, float scale_x, float scale_y) {
+    if (scale_x <= 0.0f || scale_y <= 0.0f) {
+        return;
+    }
+    float radians = rotation_deg * 3.14159265358979f / 180.0f;
+    float c = cosf(radians);
+    float s = sinf(radians);
+    float min_x = px;
+    float max_x = px;
+    float min_y = py;
+    float max_y = py;
+    for (int k = 0; k < 4; ++k) {
+        float ox = ((k & 1) ? (float)image->width - anchor_x : -anchor_x) * scale_x;
+        float oy = ((k >> 1) ? (float)image->height - anchor_y : -anchor_y) * scale_y;
+        float sx = px + c * ox - s * oy;
+        float sy = py + s * ox + c * oy;
+        min_x = sx < min_x ? sx : min_x;
+        max_x = sx > max_x ? sx : max_x;
+        min_y = sy < min_y ? sy : min_y;
+        max_y = sy > max_y ? sy : max_y;
+    }
+    int x0 = (int)floorf(min_x) - 1;
+    int x1 = (int)ceilf(max_x) + 1;
+    int y0 = (int)floorf(min_y) - 1;
+    int y1 = (int)ceilf(max_y) + 1;
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > renderer->width ? renderer->width : x1;
+    y1 = y1 > renderer->height ? renderer->height : y1;
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    int32_t du = (int32_t)lroundf(c / scale_x * 65536.0f);
+    int32_t dv = (int32_t)lroundf(-s / scale_y * 65536.0f);
+    float step_u = c / scale_x;
+    float step_v = -s / scale_y;
+    for (int y = y0; y < y1; ++y) {
+        float dx = (float)x0 + 0.5f - px;
+        float dy = (float)y + 0.5f - py;
+        float start_u = anchor_x + (c * dx + s * dy) / scale_x - 0.5f;
+        float start_v = anchor_y + (-s * dx + c * dy) / scale_y - 0.5f;
+        int lo = 0;
+        int hi = x1 - x0;
+        clip_axis(start_u, step_u, (float)image->width, &lo, &hi);
+        clip_axis(start_v, step_v, (float)image->height, &lo, &hi);
+        if (lo >= hi) {
+            continue;
+        }
+        int32_t u = (int32_t)floorf((start_u + step_u * (float)lo) * 65536.0f);
+        int32_t v = (int32_t)floorf((start_v + step_v * (float)lo) * 65536.0f);
+        size_t span = (size_t)(hi - lo);
+        for (size_t i = 0; i < span; ++i) {
+            sample_bilinear(image, u, v, renderer->row + i * 4);
+            u += du;
+            v += dv;
+        }
+        blend_span(renderer->pixels + ((size_t)y * (size_t)renderer->width + (size_t)(x0 + lo)) * 4, renderer->row, span);
+        renderer->stats.pixels_blended += span;
+    }
+}
+
+int furry_soft_create(const FurrySoftConfig *config, FurrySoftRenderer **out_renderer) {
+    if (config == NULL || out_renderer == NULL || config->width <= 0 || config->height <= 0) {
+        return FURRY_ERR;
+    }
+    *out_renderer = NULL;
+    FurrySoftRenderer *renderer = furry_calloc(FURRY_MEM_RENDER, 1, sizeof(FurrySoftRenderer));
+    if (renderer == NULL) {
+        return FURRY_ERR;
+    }
+    renderer->width = config->width;
+    renderer->height = config->height;
+    renderer->pixels = furry_alloc(FURRY_MEM_RENDER, (size_t)config->width * (size_t)config->height * 4);
+    renderer->row = furry_alloc(FURRY_MEM_RENDER, (size_t)config->width * 4);
+    FurryTextConfig text_config = {SOFT_ATLAS_SIZE, SOFT_ATLAS_SIZE, NULL, NULL};
+    if (renderer->pixels == NULL || renderer->row == NULL || furry_layout_create(1, &renderer->layout) != FURRY_OK ||
+        furry_text_create(&text_config, &renderer->text) != FURRY_OK) {
+        furry_soft_destroy(renderer);
+        return FURRY_ERR;
+    }
+    if (config->asset_root != NULL) {
+        snprintf(renderer->asset_root, sizeof(renderer->asset_root), "%s", config->asset_root);
+    }
+    renderer->load_image = config->load_image;
+    renderer->user_data = config->user_data;
+    renderer->ui_scale = config->height >= 480 ? config->height / 240 : 1;
+    furry_layout_set_viewport(renderer->layout, (float)config->width, (float)config->height);
+    furry_ui_default_main_menu(&renderer->theme);
+    furry_soft_clear(renderer, 0x000000ffu);
+    *out_renderer = renderer;
+    return FURRY_OK;
+}
+
+void furry_soft_destroy(FurrySoftRenderer *renderer) {
+    if (renderer == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < renderer->image_count; ++i) {
+        free(renderer->images[i].image.pixels);
+    }
+    furry_layout_destroy(renderer->layout);
+    furry_text_layout_free(&renderer->text_layout);
+    furry_text_destroy(renderer->text);
+    furry_free(renderer->pixels);
+    furry_free(renderer->row);
+    furry_free(renderer);
+}
+
+void furry_soft_clear(FurrySoftRenderer *renderer, unsigned rgba) {
+    if (renderer == NULL) {
+        return;
+    }
+    unsigned char color[4];
+    premultiplied_color(rgba | 0xffu, color);
+    size_t count = (size_t)renderer->width * (size_t)renderer->height;
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(renderer->pixels + i * 4, color, 4);
+    }
+    renderer->column_x = 0;
+    renderer->column_w = renderer->width;
+    renderer->cursor_y = 0;
+}
+
+int furry_soft_draw_sprite(FurrySoftRenderer *renderer, const char *asset, float x, float y, float rotation_deg) {
+    if (renderer == NULL || asset == NULL) {
+        return FURRY_ERR;
+    }
+    const FurrySoftImage *image = get_image(renderer, asset);
+    if (image == NULL) {
+        return FURRY_ERR;
+    }
+    draw_image(renderer, image, x * (float)renderer->width, y * (float)renderer->height, (float)image->width * 0.5f, (float)image->height,
+               rotation_deg, 1.0f, 1.0f);
+    renderer->stats.sprites++;
+    return FURRY_OK;
+}
+
+int furry_soft_text_width(const char *text, int scale) {
+    size_t length = text == NULL ? 0 : strlen(text);
+    int count = 0;
+    for (size_t pos = 0; pos < length; ++count) {
+        unsigned codepoint = 0;
+        pos += furry_utf8_decode(text + pos, length - pos, &codepoint);
+    }
+    return count == 0 ? 0 : (count * SOFT_GLYPH_ADVANCE - 1) * scale;
+}
+
+/* Blits laid-out glyph coverage from the text atlas, tinted with the premultiplied color. */
+static int draw_text_wrapped(FurrySoftRenderer *renderer, int x, int y, int scale, unsigned rgba, const char *text, int max_width,
+                             int *out_height) {
+    FurryTextStyle style = {8 * scale, (float)max_width, (float)(SOFT_LINE_HEIGHT * scale)};
+    FurryTextLayout *layout = &renderer->text_layout;
+    if (furry_text_layout(renderer->text, text, &style, layout) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    int atlas_width = 0;
+    const unsigned char *atlas = furry_text_atlas(renderer->text, &atlas_width, NULL, NULL);
+    unsigned char color[4];
+    premultiplied_color(rgba, color);
+    for (size_t i = 0; i < layout->quad_count; ++i) {
+        const FurryGlyphQuad *quad = &layout->quads[i];
+        int qx = x + (int)quad->x;
+        int qy = y + (int)quad->y;
+        int u = (int)quad->u;
+        int v = (int)quad->v;
+        int x0 = qx < 0 ? 0 : qx;
+        int x1 = qx + (int)quad->w > renderer->width ? renderer->width : qx + (int)quad->w;
+        int y0 = qy < 0 ? 0 : qy;
+        int y1 = qy + (int)quad->h > renderer->height ? renderer->height : qy + (int)quad->h;
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+        size_t span = (size_t)(x1 - x0);
+        for (int row = y0; row < y1; ++row) {
+            const unsigned char *coverage = atlas + (size_t)(v + row - qy) * (size_t)atlas_width + (size_t)(u + x0 - qx);
+            for (size_t col = 0; col < span; ++col) {
+                unsigned char *out = renderer->row + col * 4;
+                out[0] = (unsigned char)div255(color[0] * coverage[col]);
+                out[1] = (unsigned char)div255(color[1] * coverage[col]);
+                out[2] = (unsigned char)div255(color[2] * coverage[col]);
+                out[3] = (unsigned char)div255(color[3] * coverage[col]);
+            }
+            blend_span(renderer->pixels + ((size_t)row * (size_t)renderer->width + (size_t)x0) * 4, renderer->row, span);
+        }
+        renderer->stats.pixels_blended += span * (size_t)(y1 - y0);
+    }
+    renderer->stats.glyphs += layout->quad_count;
+    if (out_height != NULL) {
+        *out_height = (int)layout->height;
+    }
+    return FURRY_OK;
+}
+
+void furry_soft_draw_text(FurrySoftRenderer *renderer, int x, int y, int scale, unsigned rgba, const char *text) {
+    if (renderer == NULL || text == NULL || scale <= 0) {
+        return;
+    }
+    draw_text_wrapped(renderer, x, y, scale, rgba, text, 0, NULL);
+}
+
+static unsigned theme_color(FurryColor color, unsigned alpha) {
+    return ((unsigned)color.r << 24) | ((unsigned)color.g << 16) | ((unsigned)color.b << 8) | alpha;
+}
+
+static int draw_panel(FurrySoftRenderer *renderer, const FurryInstruction *ins) {
+    FurryLayoutSpec spec;
+    if (furry_layout_spec_from_panel(ins->b, ins->c, ins->choices[0].text, ins->choices[0].target, &spec) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    furry_layout_clear(renderer->layout);
+    if (furry_layout_add(renderer->layout, -1, &spec, NULL) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    furry_layout_update(renderer->layout);
+    const FurryRect *rect = furry_layout_rects(renderer->layout, NULL);
+    int x = (int)lroundf(rect->x);
+    int y = (int)lroundf(rect->y);
+    int w = (int)lroundf(rect->w);
+    int h = (int)lroundf(rect->h);
+    fill_rect(renderer, x, y, w, h, theme_color(renderer->theme.gradient_top, 220));
+    unsigned border = theme_color(renderer->theme.accent, 255);
+    fill_rect(renderer, x, y, w, 1, border);
+    fill_rect(renderer, x, y + h - 1, w, 1, border);
+    fill_rect(renderer, x, y, 1, h, border);
+    fill_rect(renderer, x + w - 1, y, 1, h, border);
+    int pad = 4 * renderer->ui_scale;
+    renderer->column_x = x + pad;
+    renderer->column_w = w - pad * 2;
+    renderer->cursor_y = y + pad;
+    return FURRY_OK;
+}
+
+static int draw_ui_image(FurrySoftRenderer *renderer, const char *asset) {
+    const FurrySoftImage *image = get_image(renderer, asset);
+    if (image == NULL) {
+        return FURRY_ERR;
+    }
+    float box = 32.0f * (float)renderer->ui_scale;
+    float scale = box / (float)image->height;
+    draw_image(renderer, image, (float)renderer->column_x, (float)renderer->cursor_y, 0.0f, 0.0f, 0.0f, scale, scale);
+    renderer->stats.sprites++;
+    renderer->cursor_y += (int)box + 2 * renderer->ui_scale;
+    return FURRY_OK;
+}
+
+int furry_soft_host_command(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)snapshot;
+    FurrySoftRenderer *renderer = user_data;
+    if (renderer == NULL || ins == NULL) {
+        return FURRY_ERR;
+    }
+    int scale = renderer->ui_scale;
+    switch (op) {
+        case FURRY_OP_BG: {
+            const FurrySoftImage *image = get_image(renderer, ins->a);
+            if (image == NULL) {
+                return FURRY_ERR;
+            }
+            furry_soft_clear(renderer, 0x000000ffu);
+            draw_image(renderer, image, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, (float)renderer->width / (float)image->width,
+                       (float)renderer->height / (float)image->height);
+            return FURRY_OK;
+        }
+        case FURRY_OP_FG:
+            return furry_soft_draw_sprite(renderer, ins->a, strtof(ins->b, NULL), strtof(ins->c, NULL), strtof(ins->choices[0].text, NULL));
+        case FURRY_OP_UI_BEGIN:
+            renderer->column_x = 8 * scale;
+            renderer->column_w = renderer->width - 16 * scale;
+            renderer->cursor_y = 8 * scale;
+            return FURRY_OK;
+        case FURRY_OP_UI_PANEL:
+            return draw_panel(renderer, ins);
+        case FURRY_OP_UI_TEXT: {
+            int height = 0;
+            if (draw_text_wrapped(renderer, renderer->column_x, renderer->cursor_y, scale, 0xf0f0f0ffu, ins->b, renderer->column_w, &height) !=
+                FURRY_OK) {
+                return FURRY_ERR;
+            }
+            renderer->cursor_y += height;
+            return FURRY_OK;
+        }
+        case FURRY_OP_BUTTON: {
+            int w = furry_soft_text_width(ins->b, scale) + 6 * scale;
+            int h = (SOFT_GLYPH_H + 4) * scale;
+            fill_rect(renderer, renderer->column_x, renderer->cursor_y, w, h, theme_color(renderer->theme.accent, 96));
+            furry_soft_draw_text(renderer, renderer->column_x + 3 * scale, renderer->cursor_y + 2 * scale, scale, 0xffffffffu, ins->b);
+            renderer->cursor_y += h + 2 * scale;
+            return FURRY_OK;
+        }
+        case FURRY_OP_UI_IMAGE:
+        case FURRY_OP_UI_ANIM:
+        case FURRY_OP_UI_VIDEO:
+            return draw_ui_image(renderer, ins->b);
+        default:
+            return FURRY_OK;
+    }
+}
+
+const unsigned char *furry_soft_pixels(const FurrySoftRenderer *renderer, int *out_width, int *out_height) {
+    if (renderer == NULL) {
+        return NULL;
+    }
+    if (out_width != NULL) {
+        *out_width = renderer->width;
+    }
+    if (out_height != NULL) {
+        *out_height = renderer->height;
+    }
+    return renderer->pixels;
+}
+
+unsigned furry_soft_hash(const FurrySoftRenderer *renderer) {
+    if (renderer == NULL) {
+        return 0;
+    }
+    uint32_t hash = 2166136261u;
+    size_t size = (size_t)renderer->width * (size_t)renderer->height * 4;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= renderer->pixels[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void furry_soft_stats(const FurrySoftRenderer *renderer, FurrySoftStats *out_stats) {
+    if (renderer != NULL && out_stats != NULL) {
+        *out_stats = renderer->stats;
+    }
+}
+
+int furry_soft_write_ppm(const FurrySoftRenderer *renderer, const char *path) {
+    if (renderer == NULL || path == NULL) {
+        return FURRY_ERR;
+    }
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    int rc = fprintf(file, "P6\n%d %d\n255\n", renderer->width, renderer->height) > 0 ? FURRY_OK : FURRY_ERR;
+    size_t count = (size_t)renderer->width * (size_t)renderer->height;
+    for (size_t i = 0; rc == FURRY_OK && i < count; ++i) {
+        if (fwrite(renderer->pixels + i * 4, 1, 3, file) != 3) {
+            rc = FURRY_ERR;
+        }
+    }
+    if (fclose(file) != 0) {
+        rc = FURRY_ERR;
+    }
+    return rc;
+}
+
+static void put_be32(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+static int write_chunk(FILE *file, const char *type, const unsigned char *data, size_t size) {
+    unsigned char header[8];
+    unsigned char crc_bytes[4];
+    put_be32(header, (uint32_t)size);
+    memcpy(header + 4, type, 4);
+    unsigned long crc = furry_crc32(0, type, 4);
+    crc = furry_crc32(crc, data, size);
+    put_be32(crc_bytes, (uint32_t)crc);
+    return fwrite(header, 1, 8, file) == 8 && (size == 0 || fwrite(data, 1, size, file) == size) && fwrite(crc_bytes, 1, 4, file) == 4
+               ? FURRY_OK
+               : FURRY_ERR;
+}
+
+/* RGBA8 PNG with stored (uncompressed) deflate blocks: byte-exact and dependency-free. */
+int furry_soft_write_png(const FurrySoftRenderer *renderer, const char *path) {
+    if (renderer == NULL || path == NULL) {
+        return FURRY_ERR;
+    }
+    size_t stride = (size_t)renderer->width * 4 + 1;
+    size_t raw_size = stride * (size_t)renderer->height;
+    size_t blocks = (raw_size + 65534) / 65535;
+    size_t idat_size = 2 + raw_size + blocks * 5 + 4;
+    unsigned char *idat = furry_alloc(FURRY_MEM_RENDER, idat_size);
+    if (idat == NULL) {
+        return FURRY_ERR;
+    }
+    unsigned char *out = idat;
+    *out++ = 0x78;
+    *out++ = 0x01;
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+    size_t remaining = raw_size;
+    size_t pos = 0;
+    while (remaining > 0) {
+        size_t len = remaining > 65535 ? 65535 : remaining;
+        *out++ = remaining == len ? 1 : 0;
+        *out++ = (unsigned char)(len & 0xff);
+        *out++ = (unsigned char)(len >> 8);
+        *out++ = (unsigned char)(~len & 0xff);
+        *out++ = (unsigned char)((~len >> 8) & 0xff);
+        for (size_t i = 0; i < len; ++i, ++pos) {
+            size_t row = pos / stride;
+            size_t col = pos % stride;
+            unsigned char byte = col == 0 ? 0 : renderer->pixels[row * (size_t)renderer->width * 4 + col - 1];
+            *out++ = byte;
+            adler_a = (adler_a + byte) % 65521u;
+            adler_b = (adler_b + adler_a) % 65521u;
+        }
+        remaining -= len;
+    }
+    put_be32(out, (adler_b << 16) | adler_a);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        furry_free(idat);
+        return FURRY_ERR;
+    }
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    unsigned char ihdr[13];
+    put_be32(ihdr, (uint32_t)renderer->width);
+    put_be32(ihdr + 4, (uint32_t)renderer->height);
+    ihdr[8] = 8;
+    ihdr[9] = 6;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    int rc = fwrite(signature, 1, 8, file) == 8 && write_chunk(file, "IHDR", ihdr, sizeof(ihdr)) == FURRY_OK &&
+                     write_chunk(file, "IDAT", idat, idat_size) == FURRY_OK && write_chunk(file, "IEND", NULL, 0) == FURRY_OK
+                 ? FURRY_OK
+                 : FURRY_ERR;
+    furry_free(idat);
+    if (fclose(file) != 0) {
+        rc = FURRY_ERR;
+    }
+    return rc;
+}
+
+static int read_ppm_number(FILE *file, int *out) {
+    int ch = fgetc(file);
+    while (ch == '#' || ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+        if (ch == '#') {
+            while (ch != '\n' && ch != EOF) {
+                ch = fgetc(file);
+            }
+        }
+        ch = fgetc(file);
+    }
+    int value = 0;
+    int digits = 0;
+    while (ch >= '0' && ch <= '9' && value < 1000000) {
+        value = value * 10 + (ch - '0');
+        digits++;
+        ch = fgetc(file);
+    }
+    *out = value;
+    return digits > 0 ? FURRY_OK : FURRY_ERR;
+}
+
+int furry_soft_load_ppm(const char *path, FurrySoftImage *out_image, void *user_data) {
+    (void)user_data;
+    if (path == NULL || out_image == NULL) {
+        return FURRY_ERR;
+    }
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    int width = 0;
+    int height = 0;
+    int maxval = 0;
+    if (fgetc(file) != 'P' || fgetc(file) != '6' || read_ppm_number(file, &width) != FURRY_OK || read_ppm_number(file, &height) != FURRY_OK ||
+        read_ppm_number(file, &maxval) != FURRY_OK || width <= 0 || height <= 0 || maxval != 255) {
+        fclose(file);
+        return FURRY_ERR;
+    }
+    size_t count = (size_t)width * (size_t)height;
+    unsigned char *pixels = malloc(count * 4);
+    if (pixels == NULL) {
+        fclose(file);
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (fread(pixels + i * 4, 1, 3, file) != 3) {
+            free(pixels);
+            fclose(file);
+            return FURRY_ERR;
+        }
+        pixels[i * 4 + 3] = 255;
+    }
+    fclose(file);
+    out_image->width = width;
+    out_image->height = height;
+    out_image->pixels = pixels;
+    return FURRY_OK;
+}
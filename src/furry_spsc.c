@@ -0,0 +1,79 @@
+#include "furry_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int furry_spsc_init(FurrySpscRing *ring, FurryMemTag tag, size_t item_size, size_t capacity) {
+    if (ring == NULL || item_size == 0 || capacity == 0) {
+        return FURRY_ERR;
+    }
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    ring->items = furry_alloc(tag, rounded * item_size);
+    if (ring->items == NULL) {
+        return FURRY_ERR;
+    }
+    ring->item_size = item_size;
+    ring->mask = rounded - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return FURRY_OK;
+}
+
+void furry_spsc_free(FurrySpscRing *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    furry_free(ring->items);
+    ring->items = NULL;
+}
+
+/* Producer side: copies up to `count` items and publishes them with one release store. */
+size_t furry_spsc_write(FurrySpscRing *ring, const void *items, size_t count) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t free_items = ring->mask + 1 - (tail - head);
+    if (count > free_items) {
+        count = free_items;
+    }
+    const unsigned char *src = items;
+    size_t start = tail & ring->mask;
+    size_t first = ring->mask + 1 - start;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(ring->items + start * ring->item_size, src, first * ring->item_size);
+    memcpy(ring->items, src + first * ring->item_size, (count - first) * ring->item_size);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+/* Consumer side: copies up to `max_count` items and frees their slots with one release store. */
+size_t furry_spsc_read(FurrySpscRing *ring, void *out_items, size_t max_count) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t count = tail - head;
+    if (count > max_count) {
+        count = max_count;
+    }
+    unsigned char *dst = out_items;
+    size_t start = head & ring->mask;
+    size_t first = ring->mask + 1 - start;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(dst, ring->items + start * ring->item_size, first * ring->item_size);
+    memcpy(dst + first * ring->item_size, ring->items, (count - first) * ring->item_size);
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+size_t furry_spsc_readable(FurrySpscRing *ring) {
+    return atomic_load_explicit(&ring->tail, memory_order_acquire) - atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+size_t furry_spsc_writable(FurrySpscRing *ring) {
+    return ring->mask + 1 - furry_spsc_readable(ring);
+}
@@ -0,0 +1,566 @@
+#include "furry_text.h"
+#include "furry_internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXT_DEFAULT_ATLAS 512
+#define TEXT_BUILTIN_MAX_SCALE 16
+#define TEXT_NONE ((size_t)-1)
+
+/* Classic 5x7 ASCII font, columns left to right, bit 0 = top row. */
+const unsigned char furry_font5x7[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5f, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7f, 0x14, 0x7f, 0x14},
+    {0x24, 0x2a, 0x7f, 0x2a, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+    {0x00, 0x1c, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1c, 0x00}, {0x08, 0x2a, 0x1c, 0x2a, 0x08}, {0x08, 0x08, 0x3e, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+    {0x3e, 0x51, 0x49, 0x45, 0x3e}, {0x00, 0x42, 0x7f, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4b, 0x31},
+    {0x18, 0x14, 0x12, 0x7f, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3c, 0x4a, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1e}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+    {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+    {0x32, 0x49, 0x79, 0x41, 0x3e}, {0x7e, 0x11, 0x11, 0x11, 0x7e}, {0x7f, 0x49, 0x49, 0x49, 0x36}, {0x3e, 0x41, 0x41, 0x41, 0x22},
+    {0x7f, 0x41, 0x41, 0x22, 0x1c}, {0x7f, 0x49, 0x49, 0x49, 0x41}, {0x7f, 0x09, 0x09, 0x01, 0x01}, {0x3e, 0x41, 0x41, 0x51, 0x32},
+    {0x7f, 0x08, 0x08, 0x08, 0x7f}, {0x00, 0x41, 0x7f, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3f, 0x01}, {0x7f, 0x08, 0x14, 0x22, 0x41},
+    {0x7f, 0x40, 0x40, 0x40, 0x40}, {0x7f, 0x02, 0x04, 0x02, 0x7f}, {0x7f, 0x04, 0x08, 0x10, 0x7f}, {0x3e, 0x41, 0x41, 0x41, 0x3e},
+    {0x7f, 0x09, 0x09, 0x09, 0x06}, {0x3e, 0x41, 0x51, 0x21, 0x5e}, {0x7f, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+    {0x01, 0x01, 0x7f, 0x01, 0x01}, {0x3f, 0x40, 0x40, 0x40, 0x3f}, {0x1f, 0x20, 0x40, 0x20, 0x1f}, {0x7f, 0x20, 0x18, 0x20, 0x7f},
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7f, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7f, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+    {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, {0x7f, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20},
+    {0x38, 0x44, 0x44, 0x48, 0x7f}, {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7e, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3c},
+    {0x7f, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7d, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3d, 0x00}, {0x00, 0x7f, 0x10, 0x28, 0x44},
+    {0x00, 0x41, 0x7f, 0x40, 0x00}, {0x7c, 0x04, 0x18, 0x04, 0x78}, {0x7c, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38},
+    {0x7c, 0x14, 0x14, 0x14, 0x08}, {0x08, 0x14, 0x14, 0x18, 0x7c}, {0x7c, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3f, 0x44, 0x40, 0x20}, {0x3c, 0x40, 0x40, 0x20, 0x7c}, {0x1c, 0x20, 0x40, 0x20, 0x1c}, {0x3c, 0x40, 0x30, 0x40, 0x3c},
+    {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0c, 0x50, 0x50, 0x50, 0x3c}, {0x44, 0x64, 0x54, 0x4c, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00},
+    {0x00, 0x00, 0x7f, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02}};
+
+typedef struct TextGlyph {
+    unsigned codepoint;
+    int pixel_size;
+    int x;
+    int y;
+    int w;
+    int h;
+    int bearing_x;
+    int bearing_y;
+    int advance;
+    int shelf;
+    int next; /* next glyph on the same shelf, or next free entry */
+} TextGlyph;
+
+/* Atlas rows of fixed height filled left to right; eviction clears a whole shelf. */
+typedef struct TextShelf {
+    int y;
+    int height;
+    int cursor;
+    int first_glyph;
+    unsigned last_used;
+} TextShelf;
+
+struct FurryTextCache {
+    int atlas_width;
+    int atlas_height;
+    unsigned char *atlas;
+    unsigned generation;
+    FurryGlyphRasterFn rasterize;
+    void *user_data;
+
+    TextGlyph *glyphs;
+    size_t glyph_count;
+    size_t glyph_capacity;
+    int free_glyph;
+
+    /* Open-addressed (codepoint, size) -> glyph index, -1 for empty. */
+    int *slots;
+    size_t slot_mask;
+
+    TextShelf *shelves;
+    size_t shelf_count;
+    size_t shelf_capacity;
+    int shelf_bottom;
+
+    unsigned tick;
+    int dirty_x0;
+    int dirty_y0;
+    int dirty_x1;
+    int dirty_y1;
+    FurryTextStats stats;
+};
+
+size_t furry_utf8_decode(const char *text, size_t length, unsigned *out_codepoint) {
+    const unsigned char *s = (const unsigned char *)text;
+    *out_codepoint = 0xfffdu;
+    if (length == 0) {
+        return 0;
+    }
+    if (s[0] < 0x80) {
+        *out_codepoint = s[0];
+        return 1;
+    }
+    size_t need;
+    unsigned cp;
+    unsigned min;
+    if ((s[0] & 0xe0u) == 0xc0u) {
+        need = 2;
+        cp = s[0] & 0x1fu;
+        min = 0x80u;
+    } else if ((s[0] & 0xf0u) == 0xe0u) {
+        need = 3;
+        cp = s[0] & 0x0fu;
+        min = 0x800u;
+    } else if ((s[0] & 0xf8u) == 0xf0u) {
+        need = 4;
+        cp = s[0] & 0x07u;
+        min = 0x10000u;
+    } else {
+        return 1;
+    }
+    for (size_t i = 1; i < need; ++i) {
+        if (i >= length || (s[i] & 0xc0u) != 0x80u) {
+            return i;
+        }
+        cp = (cp << 6) | (s[i] & 0x3fu);
+    }
+    if (cp < min || cp > 0x10ffffu || (cp >= 0xd800u && cp <= 0xdfffu)) {
+        return need;
+    }
+    *out_codepoint = cp;
+    return need;
+}
+
+int furry_text_builtin_raster(unsigned codepoint, int pixel_size, FurryGlyphBitmap *out_bitmap, void *user_data) {
+    static _Thread_local unsigned char coverage[5 * TEXT_BUILTIN_MAX_SCALE * 7 * TEXT_BUILTIN_MAX_SCALE];
+    (void)user_data;
+    if (out_bitmap == NULL || pixel_size <= 0) {
+        return FURRY_ERR;
+    }
+    int scale = pixel_size / 8;
+    scale = scale < 1 ? 1 : (scale > TEXT_BUILTIN_MAX_SCALE ? TEXT_BUILTIN_MAX_SCALE : scale);
+    memset(out_bitmap, 0, sizeof(*out_bitmap));
+    out_bitmap->advance = 6 * scale;
+    if (codepoint == ' ') {
+        return FURRY_OK;
+    }
+    const unsigned char *glyph = furry_font5x7[(codepoint > ' ' && codepoint < 127 ? codepoint : '?') - ' '];
+    out_bitmap->width = 5 * scale;
+    out_bitmap->height = 7 * scale;
+    out_bitmap->stride = out_bitmap->width;
+    out_bitmap->coverage = coverage;
+    for (int y = 0; y < out_bitmap->height; ++y) {
+        for (int x = 0; x < out_bitmap->width; ++x) {
+            coverage[y * out_bitmap->stride + x] = (glyph[x / scale] >> (y / scale)) & 1u ? 255 : 0;
+        }
+    }
+    return FURRY_OK;
+}
+
+static size_t glyph_hash(unsigned codepoint, int pixel_size) {
+    uint32_t h = codepoint * 2654435761u ^ (uint32_t)pixel_size * 40503u;
+    return (size_t)(h ^ (h >> 15));
+}
+
+static int find_slot(const FurryTextCache *cache, unsigned codepoint, int pixel_size, size_t *out_slot) {
+    size_t slot = glyph_hash(codepoint, pixel_size) & cache->slot_mask;
+    while (cache->slots[slot] >= 0) {
+        const TextGlyph *glyph = &cache->glyphs[cache->slots[slot]];
+        if (glyph->codepoint == codepoint && glyph->pixel_size == pixel_size) {
+            *out_slot = slot;
+            return 1;
+        }
+        slot = (slot + 1) & cache->slot_mask;
+    }
+    *out_slot = slot;
+    return 0;
+}
+
+static int grow_slots(FurryTextCache *cache, size_t slot_count) {
+    int *slots = furry_alloc(FURRY_MEM_TEXT, sizeof(int) * slot_count);
+    if (slots == NULL) {
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < slot_count; ++i) {
+        slots[i] = -1;
+    }
+    int *old = cache->slots;
+    size_t old_count = old == NULL ? 0 : cache->slot_mask + 1;
+    cache->slots = slots;
+    cache->slot_mask = slot_count - 1;
+    for (size_t i = 0; i < old_count; ++i) {
+        if (old[i] >= 0) {
+            size_t slot = 0;
+            find_slot(cache, cache->glyphs[old[i]].codepoint, cache->glyphs[old[i]].pixel_size, &slot);
+            slots[slot] = old[i];
+        }
+    }
+    furry_free(old);
+    return FURRY_OK;
+}
+
+/* Linear-probing delete with backward shift, so lookups never need tombstones. */
+static void remove_slot(FurryTextCache *cache, size_t slot) {
+    size_t hole = slot;
+    size_t next = (hole + 1) & cache->slot_mask;
+    while (cache->slots[next] >= 0) {
+        const TextGlyph *glyph = &cache->glyphs[cache->slots[next]];
+        size_t home = glyph_hash(glyph->codepoint, glyph->pixel_size) & cache->slot_mask;
+        if (((next - home) & cache->slot_mask) >= ((next - hole) & cache->slot_mask)) {
+            cache->slots[hole] = cache->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & cache->slot_mask;
+    }
+    cache->slots[hole] = -1;
+}
+
+static void evict_shelf(FurryTextCache *cache, TextShelf *shelf) {
+    int index = shelf->first_glyph;
+    while (index >= 0) {
+        TextGlyph *glyph = &cache->glyphs[index];
+        int next = glyph->next;
+        size_t slot = 0;
+        if (find_slot(cache, glyph->codepoint, glyph->pixel_size, &slot)) {
+            remove_slot(cache, slot);
+        }
+        glyph->shelf = -1;
+        glyph->next = cache->free_glyph;
+        cache->free_glyph = index;
+        cache->stats.cached_glyphs--;
+        cache->stats.evictions++;
+        index = next;
+    }
+    shelf->first_glyph = -1;
+    shelf->cursor = 0;
+    /* Clear stale coverage so padding around the next glyphs stays transparent. */
+    memset(cache->atlas + (size_t)shelf->y * (size_t)cache->atlas_width, 0, (size_t)shelf->height * (size_t)cache->atlas_width);
+    cache->dirty_x0 = 0;
+    cache->dirty_x1 = cache->atlas_width;
+    cache->dirty_y0 = shelf->y < cache->dirty_y0 ? shelf->y : cache->dirty_y0;
+    cache->dirty_y1 = shelf->y + shelf->height > cache->dirty_y1 ? shelf->y + shelf->height : cache->dirty_y1;
+    cache->generation++;
+}
+
+/* Best-fitting shelf with room, else a new shelf, else the least recently used shelf not touched by this layout. */
+static int alloc_rect(FurryTextCache *cache, int w, int h, int *out_shelf) {
+    int best = -1;
+    for (size_t i = 0; i < cache->shelf_count; ++i) {
+        const TextShelf *shelf = &cache->shelves[i];
+        if (shelf->height >= h && shelf->height <= h + h / 2 + 1 && shelf->cursor + w <= cache->atlas_width &&
+            (best < 0 || shelf->height < cache->shelves[best].height)) {
+            best = (int)i;
+        }
+    }
+    if (best >= 0) {
+        *out_shelf = best;
+        return FURRY_OK;
+    }
+    if (w <= cache->atlas_width && cache->shelf_bottom + h <= cache->atlas_height) {
+        if (cache->shelf_count == cache->shelf_capacity) {
+            size_t capacity = cache->shelf_capacity == 0 ? 16 : cache->shelf_capacity * 2;
+            TextShelf *shelves = furry_realloc(FURRY_MEM_TEXT, cache->shelves, sizeof(TextShelf) * capacity);
+            if (shelves == NULL) {
+                return FURRY_ERR;
+            }
+            cache->shelves = shelves;
+            cache->shelf_capacity = capacity;
+        }
+        TextShelf *shelf = &cache->shelves[cache->shelf_count];
+        shelf->y = cache->shelf_bottom;
+        shelf->height = h;
+        shelf->cursor = 0;
+        shelf->first_glyph = -1;
+        shelf->last_used = cache->tick;
+        cache->shelf_bottom += h;
+        *out_shelf = (int)cache->shelf_count++;
+        return FURRY_OK;
+    }
+    int victim = -1;
+    for (size_t i = 0; i < cache->shelf_count; ++i) {
+        const TextShelf *shelf = &cache->shelves[i];
+        if (shelf->height >= h && w <= cache->atlas_width && shelf->last_used != cache->tick &&
+            (victim < 0 || shelf->last_used < cache->shelves[victim].last_used)) {
+            victim = (int)i;
+        }
+    }
+    if (victim < 0) {
+        return FURRY_ERR;
+    }
+    evict_shelf(cache, &cache->shelves[victim]);
+    *out_shelf = victim;
+    return FURRY_OK;
+}
+
+static int new_glyph(FurryTextCache *cache) {
+    if (cache->free_glyph >= 0) {
+        int index = cache->free_glyph;
+        cache->free_glyph = cache->glyphs[index].next;
+        return index;
+    }
+    if (cache->glyph_count == cache->glyph_capacity) {
+        size_t capacity = cache->glyph_capacity == 0 ? 128 : cache->glyph_capacity * 2;
+        TextGlyph *glyphs = furry_realloc(FURRY_MEM_TEXT, cache->glyphs, sizeof(TextGlyph) * capacity);
+        if (glyphs == NULL) {
+            return -1;
+        }
+        cache->glyphs = glyphs;
+        cache->glyph_capacity = capacity;
+        if (grow_slots(cache, capacity * 2) != FURRY_OK) {
+            return -1;
+        }
+    }
+    return (int)cache->glyph_count++;
+}
+
+static int get_glyph(FurryTextCache *cache, unsigned codepoint, int pixel_size, int *out_index) {
+    size_t slot = 0;
+    if (find_slot(cache, codepoint, pixel_size, &slot)) {
+        int index = cache->slots[slot];
+        if (cache->glyphs[index].shelf >= 0) {
+            cache->shelves[cache->glyphs[index].shelf].last_used = cache->tick;
+        }
+        cache->stats.glyph_hits++;
+        *out_index = index;
+        return FURRY_OK;
+    }
+    cache->stats.glyph_misses++;
+    FurryGlyphBitmap bitmap;
+    if (cache->rasterize(codepoint, pixel_size, &bitmap, cache->user_data) != FURRY_OK || bitmap.width < 0 || bitmap.height < 0) {
+        return FURRY_ERR;
+    }
+    int shelf_index = -1;
+    int has_pixels = bitmap.width > 0 && bitmap.height > 0 && bitmap.coverage != NULL;
+    /* One pixel of padding keeps bilinear sampling from bleeding into neighbours. */
+    if (has_pixels && alloc_rect(cache, bitmap.width + 1, bitmap.height + 1, &shelf_index) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    int index = new_glyph(cache);
+    if (index < 0) {
+        return FURRY_ERR;
+    }
+    TextGlyph *glyph = &cache->glyphs[index];
+    memset(glyph, 0, sizeof(*glyph));
+    glyph->codepoint = codepoint;
+    glyph->pixel_size = pixel_size;
+    glyph->bearing_x = bitmap.bearing_x;
+    glyph->bearing_y = bitmap.bearing_y;
+    glyph->advance = bitmap.advance;
+    glyph->shelf = shelf_index;
+    glyph->next = -1;
+    if (has_pixels) {
+        TextShelf *shelf = &cache->shelves[shelf_index];
+        glyph->x = shelf->cursor;
+        glyph->y = shelf->y;
+        glyph->w = bitmap.width;
+        glyph->h = bitmap.height;
+        glyph->next = shelf->first_glyph;
+        shelf->first_glyph = index;
+        shelf->cursor += bitmap.width + 1;
+        shelf->last_used = cache->tick;
+        for (int row = 0; row < bitmap.height; ++row) {
+            memcpy(cache->atlas + (size_t)(glyph->y + row) * (size_t)cache->atlas_width + (size_t)glyph->x,
+                   bitmap.coverage + (size_t)row * (size_t)bitmap.stride, (size_t)bitmap.width);
+        }
+        cache->dirty_x0 = glyph->x < cache->dirty_x0 ? glyph->x : cache->dirty_x0;
+        cache->dirty_y0 = glyph->y < cache->dirty_y0 ? glyph->y : cache->dirty_y0;
+        cache->dirty_x1 = glyph->x + glyph->w > cache->dirty_x1 ? glyph->x + glyph->w : cache->dirty_x1;
+        cache->dirty_y1 = glyph->y + glyph->h > cache->dirty_y1 ? glyph->y + glyph->h : cache->dirty_y1;
+    }
+    find_slot(cache, codepoint, pixel_size, &slot);
+    cache->slots[slot] = index;
+    cache->stats.cached_glyphs++;
+    *out_index = index;
+    return FURRY_OK;
+}
+
+static void reset_dirty(FurryTextCache *cache) {
+    cache->dirty_x0 = cache->atlas_width;
+    cache->dirty_y0 = cache->atlas_height;
+    cache->dirty_x1 = 0;
+    cache->dirty_y1 = 0;
+}
+
+int furry_text_create(const FurryTextConfig *config, FurryTextCache **out_cache) {
+    if (out_cache == NULL) {
+        return FURRY_ERR;
+    }
+    *out_cache = NULL;
+    FurryTextCache *cache = furry_calloc(FURRY_MEM_TEXT, 1, sizeof(FurryTextCache));
+    if (cache == NULL) {
+        return FURRY_ERR;
+    }
+    cache->atlas_width = config != NULL && config->atlas_width > 0 ? config->atlas_width : TEXT_DEFAULT_ATLAS;
+    cache->atlas_height = config != NULL && config->atlas_height > 0 ? config->atlas_height : TEXT_DEFAULT_ATLAS;
+    cache->rasterize = config != NULL && config->rasterize != NULL ? config->rasterize : furry_text_builtin_raster;
+    cache->user_data = config != NULL ? config->user_data : NULL;
+    cache->free_glyph = -1;
+    cache->atlas = furry_calloc(FURRY_MEM_TEXT, (size_t)cache->atlas_width * (size_t)cache->atlas_height, 1);
+    if (cache->atlas == NULL || grow_slots(cache, 64) != FURRY_OK) {
+        furry_text_destroy(cache);
+        return FURRY_ERR;
+    }
+    reset_dirty(cache);
+    *out_cache = cache;
+    return FURRY_OK;
+}
+
+void furry_text_destroy(FurryTextCache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    furry_free(cache->atlas);
+    furry_free(cache->glyphs);
+    furry_free(cache->slots);
+    furry_free(cache->shelves);
+    furry_free(cache);
+}
+
+static int is_cjk(unsigned cp) {
+    return (cp >= 0x2e80u && cp <= 0x9fffu) || (cp >= 0xf900u && cp <= 0xfaffu) || (cp >= 0xff00u && cp <= 0xffefu) ||
+           (cp >= 0x20000u && cp <= 0x2ffffu);
+}
+
+static int push_quad(FurryTextLayout *layout, const FurryGlyphQuad *quad) {
+    if (layout->quad_count == layout->quad_capacity) {
+        size_t capacity = layout->quad_capacity == 0 ? 64 : layout->quad_capacity * 2;
+        FurryGlyphQuad *quads = furry_realloc(FURRY_MEM_TEXT, layout->quads, sizeof(FurryGlyphQuad) * capacity);
+        if (quads == NULL) {
+            return FURRY_ERR;
+        }
+        layout->quads = quads;
+        layout->quad_capacity = capacity;
+    }
+    layout->quads[layout->quad_count++] = *quad;
+    return FURRY_OK;
+}
+
+int furry_text_layout(FurryTextCache *cache, const char *text, const FurryTextStyle *style, FurryTextLayout *out_layout) {
+    if (cache == NULL || text == NULL || style == NULL || out_layout == NULL || style->pixel_size <= 0) {
+        return FURRY_ERR;
+    }
+    cache->tick++;
+    float line_height = style->line_height > 0.0f ? style->line_height : (float)(style->pixel_size * 9 / 8);
+    out_layout->quad_count = 0;
+    out_layout->line_count = 1;
+    out_layout->width = 0.0f;
+
+    float pen = 0.0f;
+    float line_top = 0.0f;
+    size_t line_start = 0;
+    /* Soft break: quads from break_quad on move to the next line, shifted left by break_pen. */
+    size_t break_quad = TEXT_NONE;
+    float break_pen = 0.0f;
+    size_t length = strlen(text);
+    size_t pos = 0;
+    while (pos < length) {
+        unsigned cp = 0;
+        pos += furry_utf8_decode(text + pos, length - pos, &cp);
+        if (cp == '\r') {
+            continue;
+        }
+        if (cp == '\n') {
+            line_top += line_height;
+            out_layout->line_count++;
+            pen = 0.0f;
+            line_start = out_layout->quad_count;
+            break_quad = TEXT_NONE;
+            continue;
+        }
+        if (cp == '\t') {
+            cp = ' ';
+        }
+        int index = 0;
+        if (get_glyph(cache, cp, style->pixel_size, &index) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        const TextGlyph *glyph = &cache->glyphs[index];
+        if (cp == ' ') {
+            pen += (float)glyph->advance;
+            break_quad = out_layout->quad_count;
+            break_pen = pen;
+            continue;
+        }
+        if (is_cjk(cp) && out_layout->quad_count > line_start) {
+            break_quad = out_layout->quad_count;
+            break_pen = pen;
+        }
+        if (style->max_width > 0.0f && pen + (float)(glyph->bearing_x + glyph->w) > style->max_width &&
+            out_layout->quad_count > line_start) {
+            size_t move_from = out_layout->quad_count;
+            float shift = pen;
+            if (break_quad != TEXT_NONE && break_quad > line_start) {
+                move_from = break_quad;
+                shift = break_pen;
+            }
+            line_top += line_height;
+            out_layout->line_count++;
+            for (size_t i = move_from; i < out_layout->quad_count; ++i) {
+                out_layout->quads[i].x -= shift;
+                out_layout->quads[i].y += line_height;
+            }
+            pen -= shift;
+            line_start = move_from;
+            break_quad = TEXT_NONE;
+        }
+        if (glyph->w > 0) {
+            FurryGlyphQuad quad = {pen + (float)glyph->bearing_x, line_top + (float)glyph->bearing_y, (float)glyph->w, (float)glyph->h,
+                                   (float)glyph->x, (float)glyph->y, cp};
+            if (push_quad(out_layout, &quad) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+        }
+        pen += (float)glyph->advance;
+        if (cp == '-') {
+            break_quad = out_layout->quad_count;
+            break_pen = pen;
+        }
+    }
+    for (size_t i = 0; i < out_layout->quad_count; ++i) {
+        float right = out_layout->quads[i].x + out_layout->quads[i].w;
+        out_layout->width = right > out_layout->width ? right : out_layout->width;
+    }
+    out_layout->height = line_height * (float)out_layout->line_count;
+    return FURRY_OK;
+}
+
+void furry_text_layout_free(FurryTextLayout *layout) {
+    if (layout == NULL) {
+        return;
+    }
+    furry_free(layout->quads);
+    memset(layout, 0, sizeof(*layout));
+}
+
+const unsigned char *furry_text_atlas(const FurryTextCache *cache, int *out_width, int *out_height, unsigned *out_generation) {
+    if (cache == NULL) {
+        return NULL;
+    }
+    if (out_width != NULL) {
+        *out_width = cache->atlas_width;
+    }
+    if (out_height != NULL) {
+        *out_height = cache->atlas_height;
+    }
+    if (out_generation != NULL) {
+        *out_generation = cache->generation;
+    }
+    return cache->atlas;
+}
+
+int furry_text_atlas_take_dirty(FurryTextCache *cache, int *out_x, int *out_y, int *out_w, int *out_h) {
+    if (cache == NULL || cache->dirty_x0 >= cache->dirty_x1) {
+        return 0;
+    }
+    *out_x = cache->dirty_x0;
+    *out_y = cache->dirty_y0;
+    *out_w = cache->dirty_x1 - cache->dirty_x0;
+    *out_h = cache->dirty_y1 - cache->dirty_y0;
+    reset_dirty(cache);
+    return 1;
+}
+
+void furry_text_stats(const FurryTextCache *cache, FurryTextStats *out_stats) {
+    if (cache != NULL && out_stats != NULL) {
+        *out_stats = cache->stats;
+    }
+}
@@ -0,0 +1,245 @@
+#include "furry_trace.h"
+#include "furry_internal.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#define TRACE_DEFAULT_EVENTS 65536u
+#define TRACE_NAME_SIZE 32
+#define TRACE_EXPORT_CHUNK 256
+
+/* One per recording thread; only that thread writes the ring, drains read it. */
+typedef struct TraceBuffer {
+    struct TraceBuffer *next;
+    FurrySpscRing ring;
+    unsigned thread;
+    char name[TRACE_NAME_SIZE];
+    atomic_size_t recorded;
+    atomic_size_t dropped;
+} TraceBuffer;
+
+typedef struct TraceKindInfo {
+    const char *name;
+    const char *category;
+    /* Label of FurryTraceEvent.arg in exports, or NULL to leave it out. */
+    const char *arg;
+} TraceKindInfo;
+
+static const TraceKindInfo kinds[FURRY_TRACE_KIND_COUNT] = {
+    {"vm batch", "vm", "instructions"},
+    {"on_host_command", "host", "op"},
+    {"on_say", "host", NULL},
+    {"choose_option", "host", "choices"},
+    {"save_slot", "host", NULL},
+    {"load_slot", "host", NULL},
+    {"on_scene_restore", "host", NULL},
+    {"on_bind_update", "host", "updates"},
+    {"compile", "compile", "instructions"},
+    {"validate", "compile", "instructions"},
+    {"lazy prepass", "compile", "instructions"},
+    {"lazy parse", "compile", "instructions"},
+    {"lazy install", "compile", "instructions"},
+    {"asset load", "asset", "bytes"},
+};
+
+atomic_int furry_trace_current_level;
+static _Atomic(TraceBuffer *) buffers;
+static atomic_uint generation;
+static atomic_uint thread_count;
+static size_t capacity;
+static unsigned long long begin_ns;
+
+static thread_local TraceBuffer *local_buffer;
+static thread_local unsigned local_generation;
+static thread_local char local_name[TRACE_NAME_SIZE];
+
+unsigned long long furry_trace_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+static void free_buffers(void) {
+    TraceBuffer *buffer = atomic_exchange_explicit(&buffers, NULL, memory_order_acq_rel);
+    while (buffer != NULL) {
+        TraceBuffer *next = buffer->next;
+        furry_spsc_free(&buffer->ring);
+        furry_free(buffer);
+        buffer = next;
+    }
+    atomic_store_explicit(&thread_count, 0, memory_order_relaxed);
+}
+
+int furry_trace_begin(FurryTraceLevel level, const FurryTraceConfig *config) {
+    atomic_store_explicit(&furry_trace_current_level, FURRY_TRACE_OFF, memory_order_relaxed);
+    free_buffers();
+    capacity = config != NULL && config->events_per_thread > 0 ? config->events_per_thread : TRACE_DEFAULT_EVENTS;
+    begin_ns = furry_trace_now();
+    /* Threads still holding a ring from an earlier capture register again on their next event. */
+    atomic_fetch_add_explicit(&generation, 1, memory_order_release);
+    atomic_store_explicit(&furry_trace_current_level, (int)level, memory_order_release);
+    return FURRY_OK;
+}
+
+void furry_trace_set_level(FurryTraceLevel level) {
+    atomic_store_explicit(&furry_trace_current_level, capacity > 0 ? (int)level : FURRY_TRACE_OFF, memory_order_release);
+}
+
+FurryTraceLevel furry_trace_level(void) {
+    return (FurryTraceLevel)atomic_load_explicit(&furry_trace_current_level, memory_order_relaxed);
+}
+
+void furry_trace_end(void) {
+    atomic_store_explicit(&furry_trace_current_level, FURRY_TRACE_OFF, memory_order_relaxed);
+    free_buffers();
+    capacity = 0;
+    atomic_fetch_add_explicit(&generation, 1, memory_order_release);
+}
+
+void furry_trace_thread_name(const char *name) {
+    snprintf(local_name, sizeof(local_name), "%s", name != NULL ? name : "");
+}
+
+static TraceBuffer *register_thread(unsigned current) {
+    if (capacity == 0) {
+        return NULL;
+    }
+    TraceBuffer *buffer = furry_calloc(FURRY_MEM_TRACE, 1, sizeof(TraceBuffer));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    if (furry_spsc_init(&buffer->ring, FURRY_MEM_TRACE, sizeof(FurryTraceEvent), capacity) != FURRY_OK) {
+        furry_free(buffer);
+        return NULL;
+    }
+    buffer->thread = atomic_fetch_add_explicit(&thread_count, 1, memory_order_relaxed) + 1;
+    if (local_name[0] != '\0') {
+        memcpy(buffer->name, local_name, sizeof(buffer->name));
+    } else {
+        snprintf(buffer->name, sizeof(buffer->name), "thread %u", buffer->thread);
+    }
+    buffer->next = atomic_load_explicit(&buffers, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&buffers, &buffer->next, buffer, memory_order_release, memory_order_relaxed)) {
+        continue;
+    }
+    local_buffer = buffer;
+    local_generation = current;
+    return buffer;
+}
+
+void furry_trace_record(FurryTraceKind kind, unsigned long long start_ns, unsigned long long duration_ns, unsigned arg, const char *detail) {
+    unsigned current = atomic_load_explicit(&generation, memory_order_acquire);
+    TraceBuffer *buffer = local_buffer;
+    if (buffer == NULL || local_generation != current) {
+        buffer = register_thread(current);
+        if (buffer == NULL) {
+            return;
+        }
+    }
+    FurryTraceEvent event;
+    event.start_ns = start_ns;
+    event.duration_ns = duration_ns;
+    event.kind = kind;
+    event.arg = arg;
+    event.thread = buffer->thread;
+    size_t length = 0;
+    if (detail != NULL) {
+        while (length + 1 < sizeof(event.detail) && detail[length] != '\0') {
+            event.detail[length] = detail[length];
+            length++;
+        }
+    }
+    event.detail[length] = '\0';
+    if (furry_spsc_write(&buffer->ring, &event, 1) == 1) {
+        atomic_fetch_add_explicit(&buffer->recorded, 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+    }
+}
+
+size_t furry_trace_drain(FurryTraceEvent *out_events, size_t max_events) {
+    if (out_events == NULL) {
+        return 0;
+    }
+    size_t count = 0;
+    for (TraceBuffer *buffer = atomic_load_explicit(&buffers, memory_order_acquire); buffer != NULL && count < max_events;
+         buffer = buffer->next) {
+        count += furry_spsc_read(&buffer->ring, out_events + count, max_events - count);
+    }
+    return count;
+}
+
+static void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+int furry_trace_export_chrome(const char *path) {
+    if (path == NULL) {
+        return FURRY_ERR;
+    }
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return FURRY_ERR;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"engine\":\"FURRY %s\",\"start_utc_ns\":\"%llu\"},\"traceEvents\":[\n",
+            furry_version(), begin_ns);
+    int first = 1;
+    FurryTraceEvent events[TRACE_EXPORT_CHUNK];
+    for (TraceBuffer *buffer = atomic_load_explicit(&buffers, memory_order_acquire); buffer != NULL; buffer = buffer->next) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->thread);
+        write_json_string(file, buffer->name);
+        fputs("}}", file);
+        first = 0;
+        size_t count;
+        while ((count = furry_spsc_read(&buffer->ring, events, TRACE_EXPORT_CHUNK)) > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                const FurryTraceEvent *event = &events[i];
+                const TraceKindInfo *info = &kinds[event->kind];
+                long long start = (long long)(event->start_ns - begin_ns);
+                fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                        info->name, info->category, event->thread, (double)start / 1e3, (double)event->duration_ns / 1e3);
+                const char *sep = "";
+                if (info->arg != NULL) {
+                    fprintf(file, "\"%s\":%u", info->arg, event->arg);
+                    sep = ",";
+                }
+                if (event->detail[0] != '\0') {
+                    fprintf(file, "%s\"detail\":", sep);
+                    write_json_string(file, event->detail);
+                }
+                fputs("}}", file);
+            }
+        }
+    }
+    fputs("\n]}\n", file);
+    return fclose(file) == 0 ? FURRY_OK : FURRY_ERR;
+}
+
+void furry_trace_stats(FurryTraceStats *out_stats) {
+    if (out_stats == NULL) {
+        return;
+    }
+    memset(out_stats, 0, sizeof(*out_stats));
+    for (TraceBuffer *buffer = atomic_load_explicit(&buffers, memory_order_acquire); buffer != NULL; buffer = buffer->next) {
+        out_stats->threads++;
+        out_stats->recorded += atomic_load_explicit(&buffer->recorded, memory_order_relaxed);
+        out_stats->dropped += atomic_load_explicit(&buffer->dropped, memory_order_relaxed);
+    }
+}
+
+const char *furry_trace_kind_name(FurryTraceKind kind) {
+    return (unsigned)kind < FURRY_TRACE_KIND_COUNT ? kinds[kind].name : "unknown";
+}
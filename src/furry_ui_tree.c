@@ -0,0 +1,330 @@
+#include "furry_ui_tree.h"
+#include "furry_internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct UiNode {
+    char id[FURRY_MAX_NAME];
+    uint32_t hash;
+    FurryOpCode kind;
+    int matched;
+    char values[FURRY_UI_NODE_VALUES][FURRY_MAX_TEXT];
+} UiNode;
+
+/* Nodes in declaration order plus an open-addressed id -> index table. */
+typedef struct UiLayer {
+    char name[FURRY_MAX_NAME];
+    unsigned long long source;
+    UiNode *nodes;
+    size_t count;
+    size_t capacity;
+    int *table;
+    size_t table_size;
+} UiLayer;
+
+struct FurryUiTree {
+    UiLayer **layers;
+    size_t layer_count;
+    size_t layer_capacity;
+    UiLayer pending[FURRY_UI_MAX_DEPTH];
+    size_t depth;
+    FurryUiTreeStats stats;
+};
+
+static uint32_t hash_id(const char *id) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *cur = (const unsigned char *)id; *cur != '\0'; ++cur) {
+        hash ^= *cur;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int copy_string(char *dst, size_t dst_size, const char *src) {
+    size_t len = strlen(src);
+    if (len >= dst_size) {
+        return FURRY_ERR;
+    }
+    memcpy(dst, src, len + 1);
+    return FURRY_OK;
+}
+
+static void free_layer(UiLayer *layer) {
+    furry_free(layer->nodes);
+    furry_free(layer->table);
+    memset(layer, 0, sizeof(*layer));
+}
+
+static int find_node(const UiLayer *layer, const char *id, uint32_t hash) {
+    if (layer->table_size == 0) {
+        return -1;
+    }
+    size_t mask = layer->table_size - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        int idx = layer->table[slot];
+        if (idx < 0) {
+            return -1;
+        }
+        if (layer->nodes[idx].hash == hash && strcmp(layer->nodes[idx].id, id) == 0) {
+            return idx;
+        }
+    }
+}
+
+/* Rebuilds the id table for the declared nodes; duplicate ids are an error. */
+static int index_layer(UiLayer *layer) {
+    size_t want = 16;
+    while (want < layer->count * 2) {
+        want *= 2;
+    }
+    if (want != layer->table_size) {
+        int *table = furry_realloc(FURRY_MEM_UI, layer->table, want * sizeof(int));
+        if (table == NULL) {
+            return FURRY_ERR;
+        }
+        layer->table = table;
+        layer->table_size = want;
+    }
+    memset(layer->table, 0xff, layer->table_size * sizeof(int));
+    size_t mask = layer->table_size - 1;
+    for (size_t i = 0; i < layer->count; ++i) {
+        const UiNode *node = &layer->nodes[i];
+        size_t slot = node->hash & mask;
+        while (layer->table[slot] >= 0) {
+            const UiNode *other = &layer->nodes[layer->table[slot]];
+            if (other->hash == node->hash && strcmp(other->id, node->id) == 0) {
+                return FURRY_ERR;
+            }
+            slot = (slot + 1) & mask;
+        }
+        layer->table[slot] = (int)i;
+    }
+    return FURRY_OK;
+}
+
+static UiLayer *find_layer(const FurryUiTree *tree, const char *name, size_t *out_index) {
+    for (size_t i = 0; i < tree->layer_count; ++i) {
+        if (strcmp(tree->layers[i]->name, name) == 0) {
+            if (out_index != NULL) {
+                *out_index = i;
+            }
+            return tree->layers[i];
+        }
+    }
+    return NULL;
+}
+
+static UiLayer *add_layer(FurryUiTree *tree, const char *name) {
+    if (tree->layer_count == tree->layer_capacity) {
+        size_t next = tree->layer_capacity == 0 ? 8 : tree->layer_capacity * 2;
+        UiLayer **resized = furry_realloc(FURRY_MEM_UI, tree->layers, next * sizeof(UiLayer *));
+        if (resized == NULL) {
+            return NULL;
+        }
+        tree->layers = resized;
+        tree->layer_capacity = next;
+    }
+    UiLayer *layer = furry_calloc(FURRY_MEM_UI, 1, sizeof(UiLayer));
+    if (layer == NULL) {
+        return NULL;
+    }
+    memcpy(layer->name, name, strlen(name) + 1);
+    tree->layers[tree->layer_count++] = layer;
+    return layer;
+}
+
+static int emit_patch(FurryUiTree *tree, FurryUiPatchFn emit, void *user_data, FurryUiPatchType type, const UiLayer *layer,
+                      const UiNode *node, size_t index, int field) {
+    FurryUiPatch patch;
+    patch.type = type;
+    patch.layer = layer->name;
+    patch.id = node->id;
+    patch.kind = node->kind;
+    patch.index = index;
+    patch.field = field;
+    for (int v = 0; v < FURRY_UI_NODE_VALUES; ++v) {
+        patch.values[v] = node->values[v];
+    }
+    tree->stats.patches++;
+    return emit != NULL ? emit(&patch, user_data) : FURRY_OK;
+}
+
+int furry_ui_tree_create(FurryUiTree **out_tree) {
+    if (out_tree == NULL) {
+        return FURRY_ERR;
+    }
+    *out_tree = furry_calloc(FURRY_MEM_UI, 1, sizeof(FurryUiTree));
+    return *out_tree != NULL ? FURRY_OK : FURRY_ERR;
+}
+
+void furry_ui_tree_destroy(FurryUiTree *tree) {
+    if (tree == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < tree->layer_count; ++i) {
+        free_layer(tree->layers[i]);
+        furry_free(tree->layers[i]);
+    }
+    for (size_t d = 0; d < FURRY_UI_MAX_DEPTH; ++d) {
+        free_layer(&tree->pending[d]);
+    }
+    furry_free(tree->layers);
+    furry_free(tree);
+}
+
+int furry_ui_tree_try_skip(FurryUiTree *tree, const char *layer, unsigned long long source) {
+    if (tree == NULL || layer == NULL || source == 0 || tree->depth > 0) {
+        return 0;
+    }
+    const UiLayer *found = find_layer(tree, layer, NULL);
+    if (found == NULL || found->source != source) {
+        return 0;
+    }
+    tree->stats.skipped++;
+    return 1;
+}
+
+int furry_ui_tree_begin(FurryUiTree *tree, const char *layer, unsigned long long source) {
+    if (tree == NULL || layer == NULL || tree->depth >= FURRY_UI_MAX_DEPTH) {
+        return FURRY_ERR;
+    }
+    UiLayer *pending = &tree->pending[tree->depth];
+    if (copy_string(pending->name, sizeof(pending->name), layer) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    pending->count = 0;
+    pending->source = source;
+    tree->depth++;
+    return FURRY_OK;
+}
+
+int furry_ui_tree_node(FurryUiTree *tree, FurryOpCode kind, const char *id, const char *const values[FURRY_UI_NODE_VALUES]) {
+    if (tree == NULL || id == NULL || tree->depth == 0) {
+        return FURRY_ERR;
+    }
+    UiLayer *pending = &tree->pending[tree->depth - 1];
+    if (pending->count == pending->capacity) {
+        size_t next = pending->capacity == 0 ? 16 : pending->capacity * 2;
+        UiNode *resized = furry_realloc(FURRY_MEM_UI, pending->nodes, next * sizeof(UiNode));
+        if (resized == NULL) {
+            return FURRY_ERR;
+        }
+        pending->nodes = resized;
+        pending->capacity = next;
+    }
+    UiNode *node = &pending->nodes[pending->count];
+    if (copy_string(node->id, sizeof(node->id), id) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    for (int v = 0; v < FURRY_UI_NODE_VALUES; ++v) {
+        if (copy_string(node->values[v], sizeof(node->values[v]), values != NULL && values[v] != NULL ? values[v] : "") != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    node->hash = hash_id(id);
+    node->kind = kind;
+    node->matched = 0;
+    pending->count++;
+    tree->stats.nodes_declared++;
+    return FURRY_OK;
+}
+
+int furry_ui_tree_end(FurryUiTree *tree, FurryUiPatchFn emit, void *user_data) {
+    if (tree == NULL || tree->depth == 0) {
+        return FURRY_ERR;
+    }
+    UiLayer *next = &tree->pending[--tree->depth];
+    if (index_layer(next) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    UiLayer *prev = find_layer(tree, next->name, NULL);
+    if (prev == NULL && (prev = add_layer(tree, next->name)) == NULL) {
+        return FURRY_ERR;
+    }
+    tree->stats.declarations++;
+
+    /* Match by id; a survivor that moved before an earlier survivor is recreated instead of reordered. */
+    for (size_t i = 0; i < prev->count; ++i) {
+        prev->nodes[i].matched = 0;
+    }
+    int last_old = -1;
+    for (size_t i = 0; i < next->count; ++i) {
+        UiNode *node = &next->nodes[i];
+        int old = find_node(prev, node->id, node->hash);
+        if (old >= 0 && prev->nodes[old].kind == node->kind && old > last_old) {
+            prev->nodes[old].matched = 1;
+            node->matched = old + 1;
+            last_old = old;
+        } else {
+            node->matched = 0;
+        }
+    }
+
+    int rc = FURRY_OK;
+    for (size_t i = prev->count; rc == FURRY_OK && i > 0; --i) {
+        if (!prev->nodes[i - 1].matched) {
+            rc = emit_patch(tree, emit, user_data, FURRY_UI_PATCH_REMOVE, prev, &prev->nodes[i - 1], i - 1, -1);
+        }
+    }
+    for (size_t i = 0; rc == FURRY_OK && i < next->count; ++i) {
+        const UiNode *node = &next->nodes[i];
+        if (node->matched == 0) {
+            rc = emit_patch(tree, emit, user_data, FURRY_UI_PATCH_CREATE, next, node, i, -1);
+            continue;
+        }
+        const UiNode *old = &prev->nodes[node->matched - 1];
+        for (int v = 0; rc == FURRY_OK && v < FURRY_UI_NODE_VALUES; ++v) {
+            if (strcmp(old->values[v], node->values[v]) != 0) {
+                rc = emit_patch(tree, emit, user_data, FURRY_UI_PATCH_UPDATE, next, node, i, v);
+            }
+        }
+    }
+
+    /* The new declaration becomes the retained layer; the old buffers are reused for the next pass. */
+    UiLayer swap = *prev;
+    prev->source = next->source;
+    prev->nodes = next->nodes;
+    prev->count = next->count;
+    prev->capacity = next->capacity;
+    prev->table = next->table;
+    prev->table_size = next->table_size;
+    next->nodes = swap.nodes;
+    next->capacity = swap.capacity;
+    next->table = swap.table;
+    next->table_size = swap.table_size;
+    next->count = 0;
+    return rc;
+}
+
+int furry_ui_tree_clear(FurryUiTree *tree, const char *layer, FurryUiPatchFn emit, void *user_data) {
+    if (tree == NULL || layer == NULL) {
+        return FURRY_ERR;
+    }
+    size_t index = 0;
+    UiLayer *found = find_layer(tree, layer, &index);
+    if (found == NULL) {
+        return FURRY_OK;
+    }
+    int rc = FURRY_OK;
+    for (size_t i = found->count; rc == FURRY_OK && i > 0; --i) {
+        rc = emit_patch(tree, emit, user_data, FURRY_UI_PATCH_REMOVE, found, &found->nodes[i - 1], i - 1, -1);
+    }
+    free_layer(found);
+    furry_free(found);
+    tree->layers[index] = tree->layers[--tree->layer_count];
+    return rc;
+}
+
+size_t furry_ui_tree_node_count(const FurryUiTree *tree, const char *layer) {
+    const UiLayer *found = tree == NULL || layer == NULL ? NULL : find_layer(tree, layer, NULL);
+    return found == NULL ? 0 : found->count;
+}
+
+void furry_ui_tree_stats(const FurryUiTree *tree, FurryUiTreeStats *out_stats) {
+    if (tree == NULL || out_stats == NULL) {
+        return;
+    }
+    *out_stats = tree->stats;
+}
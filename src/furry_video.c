@@ -0,0 +1,346 @@
+#include "furry_video.h"
+#include "furry_internal.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#define VIDEO_DEFAULT_QUEUE 4
+#define VIDEO_DECODE_INTERVAL_NS 1000000L
+#define VIDEO_NO_SLOT ((size_t)-1)
+
+typedef struct VideoSlot {
+    unsigned char *pixels;
+    double pts;
+    size_t frame;
+} VideoSlot;
+
+struct FurryVideo {
+    FurryVideoDecoder decoder;
+    int loop;
+    int offline;
+    size_t frame_bytes;
+    double frame_duration;
+
+    /* Pool of queue_frames + 2 buffers: the queue, plus the presenter's current and next frame. */
+    unsigned char *pixels;
+    VideoSlot *slots;
+    size_t slot_count;
+    size_t queue_frames;
+    FurrySpscRing decoded;
+    FurrySpscRing recycled;
+
+    /* Decode side. */
+    size_t decode_frame;
+    double loop_offset;
+    double last_pts;
+    atomic_int eof;
+    atomic_int stop;
+    atomic_size_t frames_decoded;
+    atomic_size_t loops;
+    thrd_t thread;
+    int thread_started;
+
+    /* Present side. */
+    size_t current;
+    size_t next;
+    FurryVideoStats stats;
+};
+
+void furry_video_default_config(FurryVideoConfig *config) {
+    if (config == NULL) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->queue_frames = VIDEO_DEFAULT_QUEUE;
+}
+
+/* Decodes into recycled slots until the queue is full or the stream ends; runs on the decode thread, or inline when offline. */
+static void fill_queue(FurryVideo *video) {
+    while (!atomic_load_explicit(&video->eof, memory_order_relaxed)) {
+        size_t slot = 0;
+        if (furry_spsc_readable(&video->recycled) == 0 || furry_spsc_readable(&video->decoded) >= video->queue_frames) {
+            return;
+        }
+        furry_spsc_read(&video->recycled, &slot, 1);
+        VideoSlot *frame = &video->slots[slot];
+        int end = 0;
+        double pts = 0.0;
+        int rc = video->decoder.read_frame(video->decoder.state, frame->pixels, &pts, &end);
+        if (rc == FURRY_OK && end && video->loop && video->decode_frame > 0 && video->decoder.rewind != NULL &&
+            video->decoder.rewind(video->decoder.state) == FURRY_OK) {
+            /* Seamless loop: the next pass continues one frame after the last one shown. */
+            video->loop_offset = video->last_pts + video->frame_duration;
+            video->decode_frame = 0;
+            atomic_fetch_add_explicit(&video->loops, 1, memory_order_relaxed);
+            rc = video->decoder.read_frame(video->decoder.state, frame->pixels, &pts, &end);
+        }
+        if (rc != FURRY_OK || end) {
+            furry_spsc_write(&video->recycled, &slot, 1);
+            atomic_store_explicit(&video->eof, 1, memory_order_release);
+            return;
+        }
+        frame->pts = video->loop_offset + pts;
+        frame->frame = video->decode_frame++;
+        video->last_pts = frame->pts;
+        atomic_fetch_add_explicit(&video->frames_decoded, 1, memory_order_relaxed);
+        furry_spsc_write(&video->decoded, &slot, 1);
+    }
+}
+
+static int decode_main(void *arg) {
+    FurryVideo *video = arg;
+    furry_trace_thread_name("furry video decode");
+    struct timespec interval = {0, VIDEO_DECODE_INTERVAL_NS};
+    while (!atomic_load_explicit(&video->stop, memory_order_acquire)) {
+        fill_queue(video);
+        thrd_sleep(&interval, NULL);
+    }
+    return 0;
+}
+
+int furry_video_open(const FurryVideoConfig *config, const char *asset, int loop, FurryVideo **out_video) {
+    if (config == NULL || asset == NULL || out_video == NULL || config->open_decoder == NULL) {
+        return FURRY_ERR;
+    }
+    *out_video = NULL;
+    char path[FURRY_MAX_ASSET * 2];
+    if (config->asset_root != NULL && config->asset_root[0] != '\0') {
+        snprintf(path, sizeof(path), "%s/%s", config->asset_root, asset);
+    } else {
+        snprintf(path, sizeof(path), "%s", asset);
+    }
+    FurryVideo *video = furry_calloc(FURRY_MEM_VIDEO, 1, sizeof(FurryVideo));
+    if (video == NULL) {
+        return FURRY_ERR;
+    }
+    unsigned long long trace_start = furry_trace_on(FURRY_TRACE_HOST) ? furry_trace_now() : 0;
+    int opened = config->open_decoder(path, &video->decoder, config->decoder_user_data);
+    if (trace_start != 0) {
+        furry_trace_record(FURRY_TRACE_ASSET_LOAD, trace_start, furry_trace_now() - trace_start, 0, asset);
+    }
+    if (opened != FURRY_OK) {
+        furry_free(video);
+        return FURRY_ERR;
+    }
+    video->loop = loop != 0;
+    video->offline = config->offline;
+    video->current = VIDEO_NO_SLOT;
+    video->next = VIDEO_NO_SLOT;
+    video->frame_duration = video->decoder.frame_rate > 0.0 ? 1.0 / video->decoder.frame_rate : 1.0 / 30.0;
+    atomic_init(&video->eof, 0);
+    atomic_init(&video->stop, 0);
+    atomic_init(&video->frames_decoded, 0);
+    atomic_init(&video->loops, 0);
+
+    size_t queue = config->queue_frames > 0 ? config->queue_frames : VIDEO_DEFAULT_QUEUE;
+    video->queue_frames = queue;
+    video->slot_count = queue + 2;
+    video->frame_bytes = (size_t)(video->decoder.width > 0 ? video->decoder.width : 0) *
+                         (size_t)(video->decoder.height > 0 ? video->decoder.height : 0) * 4;
+    if (video->frame_bytes == 0 || furry_spsc_init(&video->decoded, FURRY_MEM_VIDEO, sizeof(size_t), queue) != FURRY_OK) {
+        if (video->decoder.close != NULL) {
+            video->decoder.close(video->decoder.state);
+        }
+        furry_free(video);
+        return FURRY_ERR;
+    }
+    if (furry_spsc_init(&video->recycled, FURRY_MEM_VIDEO, sizeof(size_t), video->slot_count) != FURRY_OK) {
+        furry_spsc_free(&video->decoded);
+        if (video->decoder.close != NULL) {
+            video->decoder.close(video->decoder.state);
+        }
+        furry_free(video);
+        return FURRY_ERR;
+    }
+    video->pixels = furry_alloc(FURRY_MEM_VIDEO, video->frame_bytes * video->slot_count);
+    video->slots = furry_calloc(FURRY_MEM_VIDEO, video->slot_count, sizeof(VideoSlot));
+    if (video->pixels == NULL || video->slots == NULL) {
+        furry_video_close(video);
+        return FURRY_ERR;
+    }
+    for (size_t i = 0; i < video->slot_count; ++i) {
+        video->slots[i].pixels = video->pixels + i * video->frame_bytes;
+        furry_spsc_write(&video->recycled, &i, 1);
+    }
+    if (!video->offline) {
+        if (thrd_create(&video->thread, decode_main, video) != thrd_success) {
+            furry_video_close(video);
+            return FURRY_ERR;
+        }
+        video->thread_started = 1;
+    }
+    *out_video = video;
+    return FURRY_OK;
+}
+
+void furry_video_close(FurryVideo *video) {
+    if (video == NULL) {
+        return;
+    }
+    atomic_store_explicit(&video->stop, 1, memory_order_release);
+    if (video->thread_started) {
+        thrd_join(video->thread, NULL);
+    }
+    if (video->decoder.close != NULL) {
+        video->decoder.close(video->decoder.state);
+    }
+    furry_spsc_free(&video->decoded);
+    furry_spsc_free(&video->recycled);
+    furry_free(video->slots);
+    furry_free(video->pixels);
+    furry_free(video);
+}
+
+static void recycle(FurryVideo *video, size_t slot) {
+    furry_spsc_write(&video->recycled, &slot, 1);
+}
+
+int furry_video_present(FurryVideo *video, double now, FurryVideoFrame *out_frame) {
+    if (video == NULL || out_frame == NULL) {
+        return FURRY_ERR;
+    }
+    if (video->offline) {
+        fill_queue(video);
+    }
+    int pulled = 0;
+    /* Advance to the newest due frame; every due frame skipped on the way is a drop. */
+    for (;;) {
+        if (video->next == VIDEO_NO_SLOT && furry_spsc_read(&video->decoded, &video->next, 1) == 0) {
+            video->next = VIDEO_NO_SLOT;
+            break;
+        }
+        if (video->slots[video->next].pts > now) {
+            break;
+        }
+        if (video->current != VIDEO_NO_SLOT) {
+            if (pulled) {
+                video->stats.frames_dropped++;
+            }
+            recycle(video, video->current);
+        }
+        video->current = video->next;
+        video->next = VIDEO_NO_SLOT;
+        pulled = 1;
+    }
+    memset(out_frame, 0, sizeof(*out_frame));
+    if (video->current == VIDEO_NO_SLOT) {
+        return FURRY_OK;
+    }
+    const VideoSlot *frame = &video->slots[video->current];
+    out_frame->pixels = frame->pixels;
+    out_frame->width = video->decoder.width;
+    out_frame->height = video->decoder.height;
+    out_frame->pts = frame->pts;
+    out_frame->frame = frame->frame;
+    out_frame->is_new = pulled;
+    if (out_frame->is_new) {
+        video->stats.frames_presented++;
+    } else {
+        video->stats.frames_repeated++;
+        if (video->next == VIDEO_NO_SLOT && !atomic_load_explicit(&video->eof, memory_order_acquire) &&
+            now >= frame->pts + video->frame_duration) {
+            video->stats.underruns++;
+        }
+    }
+    return FURRY_OK;
+}
+
+int furry_video_finished(const FurryVideo *video, double now) {
+    if (video == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&video->eof, memory_order_acquire) && video->next == VIDEO_NO_SLOT &&
+           furry_spsc_readable((FurrySpscRing *)&video->decoded) == 0 &&
+           (video->current == VIDEO_NO_SLOT || now >= video->slots[video->current].pts + video->frame_duration);
+}
+
+void furry_video_stats(const FurryVideo *video, FurryVideoStats *out_stats) {
+    if (video == NULL || out_stats == NULL) {
+        return;
+    }
+    *out_stats = video->stats;
+    out_stats->frames_decoded = atomic_load_explicit(&video->frames_decoded, memory_order_relaxed);
+    out_stats->loops = atomic_load_explicit(&video->loops, memory_order_relaxed);
+}
+
+typedef struct PatternState {
+    FurryVideoPattern spec;
+    size_t frame;
+} PatternState;
+
+static void busy_wait_us(unsigned us) {
+    struct timespec start;
+    struct timespec now;
+    timespec_get(&start, TIME_UTC);
+    do {
+        timespec_get(&now, TIME_UTC);
+    } while ((now.tv_sec - start.tv_sec) * 1000000L + (now.tv_nsec - start.tv_nsec) / 1000L < (long)us);
+}
+
+static int pattern_read(void *state, unsigned char *out_rgba, double *out_pts, int *out_end) {
+    PatternState *pattern = state;
+    if (pattern->frame >= pattern->spec.frame_count) {
+        *out_end = 1;
+        return FURRY_OK;
+    }
+    if (pattern->spec.decode_cost_us > 0) {
+        busy_wait_us(pattern->spec.decode_cost_us);
+    }
+    int width = pattern->spec.width;
+    int height = pattern->spec.height;
+    size_t frame = pattern->frame;
+    for (int y = 0; y < height; ++y) {
+        unsigned char *row = out_rgba + (size_t)y * (size_t)width * 4;
+        for (int x = 0; x < width; ++x) {
+            unsigned bar = (unsigned)((x + (int)frame * 4) / 16 % 8);
+            row[x * 4 + 0] = (bar & 1) ? 255 : 16;
+            row[x * 4 + 1] = (bar & 2) ? 255 : 16;
+            row[x * 4 + 2] = (bar & 4) ? 255 : 16;
+            row[x * 4 + 3] = 255;
+        }
+    }
+    out_rgba[0] = (unsigned char)(frame & 0xffu);
+    out_rgba[1] = (unsigned char)((frame >> 8) & 0xffu);
+    *out_pts = (double)frame / pattern->spec.frame_rate;
+    *out_end = 0;
+    pattern->frame++;
+    return FURRY_OK;
+}
+
+static int pattern_rewind(void *state) {
+    ((PatternState *)state)->frame = 0;
+    return FURRY_OK;
+}
+
+static void pattern_close(void *state) {
+    furry_free(state);
+}
+
+int furry_video_open_test_pattern(const char *path, FurryVideoDecoder *out_decoder, void *user_data) {
+    (void)path;
+    if (out_decoder == NULL) {
+        return FURRY_ERR;
+    }
+    PatternState *pattern = furry_calloc(FURRY_MEM_VIDEO, 1, sizeof(PatternState));
+    if (pattern == NULL) {
+        return FURRY_ERR;
+    }
+    const FurryVideoPattern defaults = {320, 180, 30.0, 90, 0};
+    pattern->spec = user_data != NULL ? *(const FurryVideoPattern *)user_data : defaults;
+    if (pattern->spec.width <= 0 || pattern->spec.height <= 0 || !(pattern->spec.frame_rate > 0.0)) {
+        furry_free(pattern);
+        return FURRY_ERR;
+    }
+    out_decoder->state = pattern;
+    out_decoder->width = pattern->spec.width;
+    out_decoder->height = pattern->spec.height;
+    out_decoder->frame_rate = pattern->spec.frame_rate;
+    out_decoder->read_frame = pattern_read;
+    out_decoder->rewind = pattern_rewind;
+    out_decoder->close = pattern_close;
+    return FURRY_OK;
+}
@@ -0,0 +1,1312 @@
+#include "furry_vk.h"
+#include "furry_batch.h"
+#include "furry_gpu.h"
+#include "furry_internal.h"
+#include "furry_layout.h"
+#include "furry_text.h"
+#include "furry_ui.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vulkan/vulkan.h>
+
+/* SPIR-V from shaders/, compiled by glslc -mfmt=c at build time. */
+static const uint32_t sprite_vert_spv[] =
+#include "furry_sprite.vert.inc"
+    ;
+static const uint32_t sprite_frag_spv[] =
+#include "furry_sprite.frag.inc"
+    ;
+
+#define GPU_DEFAULT_STAGING (16u * 1024u * 1024u)
+#define GPU_FENCE_TIMEOUT UINT64_MAX
+#define GPU_TEXTURE_WHITE 0u
+#define GPU_TEXTURE_GLYPHS 1u
+#define GPU_FIRST_ASSET_TEXTURE 2u
+#define GPU_ATLAS_SIZE 512
+#define GPU_MAX_SCENE 64
+#define GPU_MAX_UI 512
+#define GPU_MAX_UI_TEXT 64
+#define GPU_GLYPH_H 7
+#define GPU_LINE_HEIGHT 9
+
+typedef struct GpuTexture {
+    char name[FURRY_MAX_ASSET];
+    int width;
+    int height;
+    VkFormat format;
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+    VkDescriptorSet set;
+    /* Premultiplied pixels waiting for the next frame's upload; freed once copied to staging. */
+    unsigned char *pixels;
+    int ready;
+} GpuTexture;
+
+typedef struct GpuFrame {
+    VkCommandPool pool;
+    VkCommandBuffer cmd;
+    VkFence fence;
+    int submitted;
+} GpuFrame;
+
+/* ui_text is laid out again every frame, so glyph evictions never leave stale quads in the retained UI. */
+typedef struct UiText {
+    float x;
+    float y;
+    float max_width;
+    int scale;
+    int layer;
+    unsigned rgba;
+    char text[FURRY_MAX_TEXT];
+} UiText;
+
+struct FurryVkRenderer {
+    int width;
+    int height;
+    unsigned frame_count;
+    char asset_root[FURRY_MAX_ASSET];
+    FurrySoftImageFn load_image;
+    void *user_data;
+    char *pipeline_cache_path;
+    unsigned long long pipeline_cache_key;
+
+    VkInstance instance;
+    VkPhysicalDevice physical;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    VkDevice device;
+    uint32_t queue_family;
+    VkQueue queue;
+
+    VkImage target;
+    VkDeviceMemory target_memory;
+    VkImageView target_view;
+    VkRenderPass render_pass;
+    VkFramebuffer framebuffer;
+
+    VkDescriptorSetLayout set_layout;
+    VkPipelineLayout pipeline_layout;
+    VkPipelineCache pipeline_cache;
+    VkPipeline pipelines[3];
+    VkSampler sampler;
+    VkDescriptorPool descriptor_pool;
+
+    /* Staging ring: host-visible and coherent, mapped for the renderer's lifetime; instances are drawn straight from it. */
+    VkBuffer staging;
+    VkDeviceMemory staging_memory;
+    unsigned char *staging_ptr;
+    FurryStagingRing ring;
+
+    VkBuffer readback;
+    VkDeviceMemory readback_memory;
+    unsigned char *readback_ptr;
+    VkCommandPool transfer_pool;
+    VkCommandBuffer transfer_cmd;
+    VkFence transfer_fence;
+
+    GpuFrame frames[FURRY_GPU_MAX_FRAMES];
+    unsigned frame_index;
+    int rendered;
+
+    GpuTexture *textures;
+    size_t texture_count;
+
+    FurryBatch *batch;
+    FurryLayout *layout;
+    FurryTextCache *text;
+    FurryTextLayout text_layout;
+    FurryMainMenuTheme theme;
+
+    FurrySprite scene[GPU_MAX_SCENE];
+    size_t scene_count;
+    FurrySprite ui[GPU_MAX_UI];
+    size_t ui_count;
+    UiText ui_text[GPU_MAX_UI_TEXT];
+    size_t ui_text_count;
+    int ui_layer;
+    int column_x;
+    int column_w;
+    int cursor_y;
+    int ui_scale;
+
+    FurryVkStats stats;
+};
+
+static int find_memory_type(const FurryVkRenderer *renderer, uint32_t type_bits, VkMemoryPropertyFlags flags, uint32_t *out_index) {
+    for (uint32_t i = 0; i < renderer->memory_properties.memoryTypeCount; ++i) {
+        if ((type_bits & (1u << i)) != 0 && (renderer->memory_properties.memoryTypes[i].propertyFlags & flags) == flags) {
+            *out_index = i;
+            return FURRY_OK;
+        }
+    }
+    return FURRY_ERR;
+}
+
+static int create_buffer(FurryVkRenderer *renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *out_buffer,
+                         VkDeviceMemory *out_memory, unsigned char **out_mapped) {
+    VkBufferCreateInfo info = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    info.size = size;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(renderer->device, &info, NULL, out_buffer) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(renderer->device, *out_buffer, &requirements);
+    VkMemoryAllocateInfo alloc = {.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    alloc.allocationSize = requirements.size;
+    void *mapped = NULL;
+    if (find_memory_type(renderer, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         &alloc.memoryTypeIndex) != FURRY_OK ||
+        vkAllocateMemory(renderer->device, &alloc, NULL, out_memory) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    if (vkBindBufferMemory(renderer->device, *out_buffer, *out_memory, 0) != VK_SUCCESS ||
+        vkMapMemory(renderer->device, *out_memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    *out_mapped = mapped;
+    return FURRY_OK;
+}
+
+static int create_image(FurryVkRenderer *renderer, int width, int height, VkFormat format, VkImageUsageFlags usage, VkComponentMapping swizzle,
+                        VkImage *out_image, VkDeviceMemory *out_memory, VkImageView *out_view) {
+    VkImageCreateInfo info = {.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = format;
+    info.extent.width = (uint32_t)width;
+    info.extent.height = (uint32_t)height;
+    info.extent.depth = 1;
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(renderer->device, &info, NULL, out_image) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(renderer->device, *out_image, &requirements);
+    VkMemoryAllocateInfo alloc = {.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    alloc.allocationSize = requirements.size;
+    if (find_memory_type(renderer, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &alloc.memoryTypeIndex) != FURRY_OK &&
+        find_memory_type(renderer, requirements.memoryTypeBits, 0, &alloc.memoryTypeIndex) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    if (vkAllocateMemory(renderer->device, &alloc, NULL, out_memory) != VK_SUCCESS ||
+        vkBindImageMemory(renderer->device, *out_image, *out_memory, 0) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkImageViewCreateInfo view = {.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    view.image = *out_image;
+    view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view.format = format;
+    view.components = swizzle;
+    view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view.subresourceRange.levelCount = 1;
+    view.subresourceRange.layerCount = 1;
+    return vkCreateImageView(renderer->device, &view, NULL, out_view) == VK_SUCCESS ? FURRY_OK : FURRY_ERR;
+}
+
+static void destroy_texture(FurryVkRenderer *renderer, GpuTexture *texture) {
+    if (texture->view != VK_NULL_HANDLE) {
+        vkDestroyImageView(renderer->device, texture->view, NULL);
+    }
+    if (texture->image != VK_NULL_HANDLE) {
+        vkDestroyImage(renderer->device, texture->image, NULL);
+    }
+    if (texture->memory != VK_NULL_HANDLE) {
+        vkFreeMemory(renderer->device, texture->memory, NULL);
+    }
+    free(texture->pixels);
+    memset(texture, 0, sizeof(*texture));
+}
+
+/* Creates the image and descriptor now; pixels (malloc'd, premultiplied) go up with the next frame. */
+static int add_texture(FurryVkRenderer *renderer, const char *name, int width, int height, VkFormat format, unsigned char *pixels,
+                       unsigned *out_id) {
+    if (renderer->texture_count == FURRY_VK_MAX_TEXTURES) {
+        free(pixels);
+        return FURRY_ERR;
+    }
+    GpuTexture *texture = &renderer->textures[renderer->texture_count];
+    memset(texture, 0, sizeof(*texture));
+    snprintf(texture->name, sizeof(texture->name), "%s", name);
+    texture->width = width;
+    texture->height = height;
+    texture->format = format;
+    texture->pixels = pixels;
+    VkComponentMapping swizzle = {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                  VK_COMPONENT_SWIZZLE_IDENTITY};
+    if (format == VK_FORMAT_R8_UNORM) {
+        swizzle.g = VK_COMPONENT_SWIZZLE_R;
+        swizzle.b = VK_COMPONENT_SWIZZLE_R;
+        swizzle.a = VK_COMPONENT_SWIZZLE_R;
+    }
+    VkDescriptorSetAllocateInfo alloc = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc.descriptorPool = renderer->descriptor_pool;
+    alloc.descriptorSetCount = 1;
+    alloc.pSetLayouts = &renderer->set_layout;
+    if (create_image(renderer, width, height, format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, swizzle, &texture->image,
+                     &texture->memory, &texture->view) != FURRY_OK ||
+        vkAllocateDescriptorSets(renderer->device, &alloc, &texture->set) != VK_SUCCESS) {
+        destroy_texture(renderer, texture);
+        return FURRY_ERR;
+    }
+    VkDescriptorImageInfo image_info = {renderer->sampler, texture->view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkWriteDescriptorSet write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet = texture->set;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &image_info;
+    vkUpdateDescriptorSets(renderer->device, 1, &write, 0, NULL);
+    *out_id = (unsigned)renderer->texture_count++;
+    renderer->stats.textures = renderer->texture_count;
+    return FURRY_OK;
+}
+
+static int resolve_texture(const char *asset, FurryBatchTexture *out_texture, void *user_data) {
+    FurryVkRenderer *renderer = user_data;
+    unsigned id = 0;
+    size_t i = GPU_FIRST_ASSET_TEXTURE;
+    while (i < renderer->texture_count && strcmp(renderer->textures[i].name, asset) != 0) {
+        i++;
+    }
+    if (i < renderer->texture_count) {
+        id = (unsigned)i;
+    } else {
+        FurrySoftImage image;
+        if (furry_soft_load_asset(renderer->asset_root, asset, renderer->load_image, renderer->user_data, &image) != FURRY_OK ||
+            add_texture(renderer, asset, image.width, image.height, VK_FORMAT_R8G8B8A8_UNORM, image.pixels, &id) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    out_texture->texture = id;
+    out_texture->uv[0] = 0.0f;
+    out_texture->uv[1] = 0.0f;
+    out_texture->uv[2] = 1.0f;
+    out_texture->uv[3] = 1.0f;
+    out_texture->width = (float)renderer->textures[id].width;
+    out_texture->height = (float)renderer->textures[id].height;
+    return FURRY_OK;
+}
+
+/* Staging space for the frame being recorded; when the ring is full, waits for the oldest frame in flight to give some back. */
+static int staging_alloc(FurryVkRenderer *renderer, size_t size, size_t alignment, size_t *out_offset) {
+    while (furry_staging_alloc(&renderer->ring, size, alignment, out_offset) != FURRY_OK) {
+        int waited = 0;
+        for (unsigned k = 1; k < renderer->frame_count && !waited; ++k) {
+            unsigned slot = (renderer->frame_index + k) % renderer->frame_count;
+            GpuFrame *frame = &renderer->frames[slot];
+            if (frame->submitted) {
+                if (vkWaitForFences(renderer->device, 1, &frame->fence, VK_TRUE, GPU_FENCE_TIMEOUT) != VK_SUCCESS) {
+                    return FURRY_ERR;
+                }
+                frame->submitted = 0;
+                furry_staging_retire(&renderer->ring, slot);
+                renderer->stats.staging_waits++;
+                waited = 1;
+            }
+        }
+        if (!waited) {
+            return FURRY_ERR;
+        }
+    }
+    return FURRY_OK;
+}
+
+static void image_barrier(VkCommandBuffer cmd, VkImage image, VkImageLayout from, VkImageLayout to, VkPipelineStageFlags src_stage,
+                          VkAccessFlags src_access, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+    VkImageMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = from;
+    barrier.newLayout = to;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+/* Copies a w x h region of src (stride in bytes) through the staging ring into texture at (x, y). */
+static int upload_region(FurryVkRenderer *renderer, VkCommandBuffer cmd, GpuTexture *texture, const unsigned char *src, size_t stride, int x,
+                         int y, int w, int h) {
+    size_t texel = texture->format == VK_FORMAT_R8_UNORM ? 1 : 4;
+    size_t row = (size_t)w * texel;
+    size_t offset = 0;
+    if (staging_alloc(renderer, row * (size_t)h, 16, &offset) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    for (int r = 0; r < h; ++r) {
+        memcpy(renderer->staging_ptr + offset + (size_t)r * row, src + (size_t)(y + r) * stride + (size_t)x * texel, row);
+    }
+    /* Earlier frames may still sample the texture; the barrier orders this write after them. */
+    image_barrier(cmd, texture->image, texture->ready ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_ACCESS_TRANSFER_WRITE_BIT);
+    VkBufferImageCopy copy;
+    memset(&copy, 0, sizeof(copy));
+    copy.bufferOffset = offset;
+    copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.imageSubresource.layerCount = 1;
+    copy.imageOffset.x = x;
+    copy.imageOffset.y = y;
+    copy.imageExtent.width = (uint32_t)w;
+    copy.imageExtent.height = (uint32_t)h;
+    copy.imageExtent.depth = 1;
+    vkCmdCopyBufferToImage(cmd, renderer->staging, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+    image_barrier(cmd, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT);
+    texture->ready = 1;
+    renderer->stats.texture_uploads++;
+    renderer->stats.upload_bytes += row * (size_t)h;
+    return FURRY_OK;
+}
+
+static int upload_textures(FurryVkRenderer *renderer, VkCommandBuffer cmd) {
+    for (size_t i = 0; i < renderer->texture_count; ++i) {
+        GpuTexture *texture = &renderer->textures[i];
+        if (texture->pixels == NULL) {
+            continue;
+        }
+        if (upload_region(renderer, cmd, texture, texture->pixels, (size_t)texture->width * 4, 0, 0, texture->width, texture->height) !=
+            FURRY_OK) {
+            return FURRY_ERR;
+        }
+        free(texture->pixels);
+        texture->pixels = NULL;
+    }
+    GpuTexture *glyphs = &renderer->textures[GPU_TEXTURE_GLYPHS];
+    int atlas_width = 0;
+    int atlas_height = 0;
+    const unsigned char *atlas = furry_text_atlas(renderer->text, &atlas_width, &atlas_height, NULL);
+    int x = 0;
+    int y = 0;
+    int w = atlas_width;
+    int h = atlas_height;
+    if (glyphs->ready && !furry_text_atlas_take_dirty(renderer->text, &x, &y, &w, &h)) {
+        return FURRY_OK;
+    }
+    if (!glyphs->ready) {
+        /* The whole atlas goes up once; from then on only what furry_text_layout wrote. */
+        furry_text_atlas_take_dirty(renderer->text, &x, &y, &w, &h);
+        x = 0;
+        y = 0;
+        w = atlas_width;
+        h = atlas_height;
+    }
+    return upload_region(renderer, cmd, glyphs, atlas, (size_t)atlas_width, x, y, w, h);
+}
+
+static VkShaderModule create_shader(VkDevice device, const uint32_t *code, size_t size) {
+    VkShaderModuleCreateInfo info = {.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    info.codeSize = size;
+    info.pCode = code;
+    VkShaderModule module = VK_NULL_HANDLE;
+    return vkCreateShaderModule(device, &info, NULL, &module) == VK_SUCCESS ? module : VK_NULL_HANDLE;
+}
+
+static unsigned long long device_cache_key(const VkPhysicalDeviceProperties *properties) {
+    unsigned long long key = furry_gpu_cache_key(0, &properties->vendorID, sizeof(properties->vendorID));
+    key = furry_gpu_cache_key(key, &properties->deviceID, sizeof(properties->deviceID));
+    key = furry_gpu_cache_key(key, &properties->driverVersion, sizeof(properties->driverVersion));
+    key = furry_gpu_cache_key(key, properties->pipelineCacheUUID, VK_UUID_SIZE);
+    /* New shaders must not reuse blobs built for old ones. */
+    key = furry_gpu_cache_key(key, sprite_vert_spv, sizeof(sprite_vert_spv));
+    return furry_gpu_cache_key(key, sprite_frag_spv, sizeof(sprite_frag_spv));
+}
+
+static int create_pipeline_cache(FurryVkRenderer *renderer) {
+    VkPipelineCacheCreateInfo info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    void *data = NULL;
+    size_t size = 0;
+    if (renderer->pipeline_cache_path != NULL &&
+        furry_gpu_cache_load(renderer->pipeline_cache_path, renderer->pipeline_cache_key, NULL, 0, &size) == FURRY_OK && size > 0) {
+        data = furry_alloc(FURRY_MEM_RENDER, size);
+        if (data != NULL &&
+            furry_gpu_cache_load(renderer->pipeline_cache_path, renderer->pipeline_cache_key, data, size, &size) == FURRY_OK) {
+            info.initialDataSize = size;
+            info.pInitialData = data;
+            renderer->stats.pipeline_cache_bytes = size;
+        }
+    }
+    VkResult result = vkCreatePipelineCache(renderer->device, &info, NULL, &renderer->pipeline_cache);
+    if (result != VK_SUCCESS && info.initialDataSize > 0) {
+        /* A blob the driver rejects is only a cold start. */
+        info.initialDataSize = 0;
+        info.pInitialData = NULL;
+        renderer->stats.pipeline_cache_bytes = 0;
+        result = vkCreatePipelineCache(renderer->device, &info, NULL, &renderer->pipeline_cache);
+    }
+    furry_free(data);
+    return result == VK_SUCCESS ? FURRY_OK : FURRY_ERR;
+}
+
+static void save_pipeline_cache(FurryVkRenderer *renderer) {
+    size_t size = 0;
+    if (renderer->pipeline_cache_path == NULL || renderer->pipeline_cache == VK_NULL_HANDLE ||
+        vkGetPipelineCacheData(renderer->device, renderer->pipeline_cache, &size, NULL) != VK_SUCCESS || size == 0) {
+        return;
+    }
+    void *data = furry_alloc(FURRY_MEM_RENDER, size);
+    if (data != NULL && vkGetPipelineCacheData(renderer->device, renderer->pipeline_cache, &size, data) == VK_SUCCESS) {
+        furry_gpu_cache_save(renderer->pipeline_cache_path, renderer->pipeline_cache_key, data, size);
+    }
+    furry_free(data);
+}
+
+static int create_pipelines(FurryVkRenderer *renderer) {
+    VkShaderModule vert = create_shader(renderer->device, sprite_vert_spv, sizeof(sprite_vert_spv));
+    VkShaderModule frag = create_shader(renderer->device, sprite_frag_spv, sizeof(sprite_frag_spv));
+    int rc = FURRY_ERR;
+    if (vert == VK_NULL_HANDLE || frag == VK_NULL_HANDLE) {
+        goto done;
+    }
+    VkPipelineShaderStageCreateInfo stages[2] = {{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}, {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}};
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vert;
+    stages[0].pName = "main";
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = frag;
+    stages[1].pName = "main";
+
+    VkVertexInputBindingDescription binding = {0, sizeof(FurrySpriteInstance), VK_VERTEX_INPUT_RATE_INSTANCE};
+    VkVertexInputAttributeDescription attributes[4] = {
+        {0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FurrySpriteInstance, transform)},
+        {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(FurrySpriteInstance, transform) + 4 * sizeof(float)},
+        {2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FurrySpriteInstance, uv)},
+        {3, 0, VK_FORMAT_R32_UINT, offsetof(FurrySpriteInstance, tint)},
+    };
+    VkPipelineVertexInputStateCreateInfo vertex_input = {.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertex_input.vertexBindingDescriptionCount = 1;
+    vertex_input.pVertexBindingDescriptions = &binding;
+    vertex_input.vertexAttributeDescriptionCount = 4;
+    vertex_input.pVertexAttributeDescriptions = attributes;
+    VkPipelineInputAssemblyStateCreateInfo assembly = {.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    VkPipelineViewportStateCreateInfo viewport = {.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewport.viewportCount = 1;
+    viewport.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo raster = {.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    raster.polygonMode = VK_POLYGON_MODE_FILL;
+    raster.cullMode = VK_CULL_MODE_NONE;
+    raster.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    raster.lineWidth = 1.0f;
+    VkPipelineMultisampleStateCreateInfo multisample = {.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkDynamicState dynamic_states[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic = {.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamic.dynamicStateCount = 2;
+    dynamic.pDynamicStates = dynamic_states;
+
+    /* Indexed by FurryBlendMode; textures and tints are premultiplied. */
+    VkPipelineColorBlendAttachmentState blends[3];
+    memset(blends, 0, sizeof(blends));
+    for (int i = 0; i < 3; ++i) {
+        blends[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        blends[i].blendEnable = i != FURRY_BLEND_OPAQUE;
+        blends[i].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        blends[i].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        blends[i].dstColorBlendFactor = i == FURRY_BLEND_ADDITIVE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        blends[i].dstAlphaBlendFactor = i == FURRY_BLEND_ADDITIVE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        blends[i].colorBlendOp = VK_BLEND_OP_ADD;
+        blends[i].alphaBlendOp = VK_BLEND_OP_ADD;
+    }
+    VkPipelineColorBlendStateCreateInfo blend_states[3];
+    VkGraphicsPipelineCreateInfo infos[3];
+    for (int i = 0; i < 3; ++i) {
+        memset(&blend_states[i], 0, sizeof(blend_states[i]));
+        blend_states[i].sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        blend_states[i].attachmentCount = 1;
+        blend_states[i].pAttachments = &blends[i];
+        memset(&infos[i], 0, sizeof(infos[i]));
+        infos[i].sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        infos[i].stageCount = 2;
+        infos[i].pStages = stages;
+        infos[i].pVertexInputState = &vertex_input;
+        infos[i].pInputAssemblyState = &assembly;
+        infos[i].pViewportState = &viewport;
+        infos[i].pRasterizationState = &raster;
+        infos[i].pMultisampleState = &multisample;
+        infos[i].pColorBlendState = &blend_states[i];
+        infos[i].pDynamicState = &dynamic;
+        infos[i].layout = renderer->pipeline_layout;
+        infos[i].renderPass = renderer->render_pass;
+    }
+    if (vkCreateGraphicsPipelines(renderer->device, renderer->pipeline_cache, 3, infos, NULL, renderer->pipelines) == VK_SUCCESS) {
+        rc = FURRY_OK;
+    }
+done:
+    if (vert != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(renderer->device, vert, NULL);
+    }
+    if (frag != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(renderer->device, frag, NULL);
+    }
+    return rc;
+}
+
+static int has_layer(const char *name) {
+    uint32_t count = 0;
+    if (vkEnumerateInstanceLayerProperties(&count, NULL) != VK_SUCCESS || count == 0) {
+        return 0;
+    }
+    VkLayerProperties *layers = furry_alloc(FURRY_MEM_RENDER, count * sizeof(VkLayerProperties));
+    int found = 0;
+    if (layers != NULL && vkEnumerateInstanceLayerProperties(&count, layers) == VK_SUCCESS) {
+        for (uint32_t i = 0; i < count && !found; ++i) {
+            found = strcmp(layers[i].layerName, name) == 0;
+        }
+    }
+    furry_free(layers);
+    return found;
+}
+
+/* Prefers a discrete GPU, then integrated, then anything with a graphics queue (lavapipe reports itself as a CPU). */
+static int pick_device(FurryVkRenderer *renderer) {
+    uint32_t count = 0;
+    if (vkEnumeratePhysicalDevices(renderer->instance, &count, NULL) != VK_SUCCESS || count == 0) {
+        return FURRY_ERR;
+    }
+    VkPhysicalDevice *devices = furry_alloc(FURRY_MEM_RENDER, count * sizeof(VkPhysicalDevice));
+    if (devices == NULL || vkEnumeratePhysicalDevices(renderer->instance, &count, devices) != VK_SUCCESS) {
+        furry_free(devices);
+        return FURRY_ERR;
+    }
+    int best_score = -1;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &family_count, NULL);
+        VkQueueFamilyProperties families[16];
+        family_count = family_count > 16 ? 16 : family_count;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &family_count, families);
+        uint32_t family = 0;
+        while (family < family_count && (families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0) {
+            family++;
+        }
+        if (family == family_count) {
+            continue;
+        }
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(devices[i], &properties);
+        int score = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU     ? 3
+                    : properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ? 2
+                                                                                      : 1;
+        if (score > best_score) {
+            best_score = score;
+            renderer->physical = devices[i];
+            renderer->queue_family = family;
+            snprintf(renderer->stats.device, sizeof(renderer->stats.device), "%s", properties.deviceName);
+            renderer->pipeline_cache_key = device_cache_key(&properties);
+        }
+    }
+    furry_free(devices);
+    return best_score >= 0 ? FURRY_OK : FURRY_ERR;
+}
+
+static int create_device(FurryVkRenderer *renderer, int validation) {
+    VkApplicationInfo app = {.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    app.pApplicationName = "FURRY";
+    app.pEngineName = "FURRY";
+    app.apiVersion = VK_API_VERSION_1_0;
+    const char *layer = "VK_LAYER_KHRONOS_validation";
+    VkInstanceCreateInfo instance_info = {.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instance_info.pApplicationInfo = &app;
+    if (validation && has_layer(layer)) {
+        instance_info.enabledLayerCount = 1;
+        instance_info.ppEnabledLayerNames = &layer;
+    }
+    if (vkCreateInstance(&instance_info, NULL, &renderer->instance) != VK_SUCCESS) {
+        renderer->instance = VK_NULL_HANDLE;
+        return FURRY_ERR;
+    }
+    if (pick_device(renderer) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    vkGetPhysicalDeviceMemoryProperties(renderer->physical, &renderer->memory_properties);
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queue_info.queueFamilyIndex = renderer->queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &priority;
+    VkDeviceCreateInfo device_info = {.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    if (vkCreateDevice(renderer->physical, &device_info, NULL, &renderer->device) != VK_SUCCESS) {
+        renderer->device = VK_NULL_HANDLE;
+        return FURRY_ERR;
+    }
+    vkGetDeviceQueue(renderer->device, renderer->queue_family, 0, &renderer->queue);
+    return FURRY_OK;
+}
+
+static int create_target(FurryVkRenderer *renderer) {
+    VkComponentMapping identity = {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                   VK_COMPONENT_SWIZZLE_IDENTITY};
+    if (create_image(renderer, renderer->width, renderer->height, VK_FORMAT_R8G8B8A8_UNORM,
+                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, identity, &renderer->target, &renderer->target_memory,
+                     &renderer->target_view) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    VkAttachmentDescription attachment;
+    memset(&attachment, 0, sizeof(attachment));
+    attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    VkAttachmentReference color = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass;
+    memset(&subpass, 0, sizeof(subpass));
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color;
+    /* Every frame in flight renders into the one target: order each frame after the previous frame's writes and readback. */
+    VkSubpassDependency dependencies[2];
+    memset(dependencies, 0, sizeof(dependencies));
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    VkRenderPassCreateInfo pass = {.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+    pass.attachmentCount = 1;
+    pass.pAttachments = &attachment;
+    pass.subpassCount = 1;
+    pass.pSubpasses = &subpass;
+    pass.dependencyCount = 2;
+    pass.pDependencies = dependencies;
+    if (vkCreateRenderPass(renderer->device, &pass, NULL, &renderer->render_pass) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkFramebufferCreateInfo framebuffer = {.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+    framebuffer.renderPass = renderer->render_pass;
+    framebuffer.attachmentCount = 1;
+    framebuffer.pAttachments = &renderer->target_view;
+    framebuffer.width = (uint32_t)renderer->width;
+    framebuffer.height = (uint32_t)renderer->height;
+    framebuffer.layers = 1;
+    return vkCreateFramebuffer(renderer->device, &framebuffer, NULL, &renderer->framebuffer) == VK_SUCCESS ? FURRY_OK : FURRY_ERR;
+}
+
+static int create_layouts(FurryVkRenderer *renderer) {
+    VkDescriptorSetLayoutBinding binding;
+    memset(&binding, 0, sizeof(binding));
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayoutCreateInfo set_info = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    set_info.bindingCount = 1;
+    set_info.pBindings = &binding;
+    if (vkCreateDescriptorSetLayout(renderer->device, &set_info, NULL, &renderer->set_layout) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkPushConstantRange push = {VK_SHADER_STAGE_VERTEX_BIT, 0, 2 * sizeof(float)};
+    VkPipelineLayoutCreateInfo layout_info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &renderer->set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push;
+    if (vkCreatePipelineLayout(renderer->device, &layout_info, NULL, &renderer->pipeline_layout) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, FURRY_VK_MAX_TEXTURES};
+    VkDescriptorPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_info.maxSets = FURRY_VK_MAX_TEXTURES;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    if (vkCreateDescriptorPool(renderer->device, &pool_info, NULL, &renderer->descriptor_pool) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkSamplerCreateInfo sampler = {.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    sampler.magFilter = VK_FILTER_LINEAR;
+    sampler.minFilter = VK_FILTER_LINEAR;
+    sampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler.maxLod = 0.0f;
+    return vkCreateSampler(renderer->device, &sampler, NULL, &renderer->sampler) == VK_SUCCESS ? FURRY_OK : FURRY_ERR;
+}
+
+static int create_command_pool(FurryVkRenderer *renderer, VkCommandPool *out_pool, VkCommandBuffer *out_cmd, VkFence *out_fence) {
+    VkCommandPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = renderer->queue_family;
+    if (vkCreateCommandPool(renderer->device, &pool_info, NULL, out_pool) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkCommandBufferAllocateInfo alloc = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    alloc.commandPool = *out_pool;
+    alloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc.commandBufferCount = 1;
+    VkFenceCreateInfo fence_info = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    if (vkAllocateCommandBuffers(renderer->device, &alloc, out_cmd) != VK_SUCCESS ||
+        vkCreateFence(renderer->device, &fence_info, NULL, out_fence) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    return FURRY_OK;
+}
+
+int furry_vk_create(const FurryVkConfig *config, FurryVkRenderer **out_renderer) {
+    if (config == NULL || out_renderer == NULL || config->width <= 0 || config->height <= 0 || config->frames_in_flight > FURRY_GPU_MAX_FRAMES) {
+        return FURRY_ERR;
+    }
+    *out_renderer = NULL;
+    FurryVkRenderer *renderer = furry_calloc(FURRY_MEM_RENDER, 1, sizeof(FurryVkRenderer));
+    if (renderer == NULL) {
+        return FURRY_ERR;
+    }
+    renderer->width = config->width;
+    renderer->height = config->height;
+    renderer->frame_count = config->frames_in_flight >= 2 ? config->frames_in_flight : 2;
+    if (config->asset_root != NULL) {
+        snprintf(renderer->asset_root, sizeof(renderer->asset_root), "%s", config->asset_root);
+    }
+    renderer->load_image = config->load_image;
+    renderer->user_data = config->user_data;
+    renderer->ui_scale = config->height >= 480 ? config->height / 240 : 1;
+    furry_ui_default_main_menu(&renderer->theme);
+    size_t staging_bytes = config->staging_bytes > 0 ? config->staging_bytes : GPU_DEFAULT_STAGING;
+    size_t path_size = config->pipeline_cache_path != NULL ? strlen(config->pipeline_cache_path) + 1 : 0;
+    FurryBatchConfig batch_config = {GPU_MAX_SCENE + GPU_MAX_UI, resolve_texture, renderer};
+    FurryTextConfig text_config = {GPU_ATLAS_SIZE, GPU_ATLAS_SIZE, NULL, NULL};
+    renderer->textures = furry_calloc(FURRY_MEM_RENDER, FURRY_VK_MAX_TEXTURES, sizeof(GpuTexture));
+    renderer->pipeline_cache_path = path_size > 0 ? furry_alloc(FURRY_MEM_RENDER, path_size) : NULL;
+    if (renderer->textures == NULL || (path_size > 0 && renderer->pipeline_cache_path == NULL) ||
+        furry_batch_create(&batch_config, &renderer->batch) != FURRY_OK || furry_layout_create(1, &renderer->layout) != FURRY_OK ||
+        furry_text_create(&text_config, &renderer->text) != FURRY_OK) {
+        furry_vk_destroy(renderer);
+        return FURRY_ERR;
+    }
+    if (path_size > 0) {
+        memcpy(renderer->pipeline_cache_path, config->pipeline_cache_path, path_size);
+    }
+    furry_layout_set_viewport(renderer->layout, (float)config->width, (float)config->height);
+    furry_staging_init(&renderer->ring, staging_bytes);
+
+    if (create_device(renderer, config->validation) != FURRY_OK || create_target(renderer) != FURRY_OK ||
+        create_layouts(renderer) != FURRY_OK || create_pipeline_cache(renderer) != FURRY_OK || create_pipelines(renderer) != FURRY_OK ||
+        create_buffer(renderer, staging_bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &renderer->staging,
+                      &renderer->staging_memory, &renderer->staging_ptr) != FURRY_OK ||
+        create_buffer(renderer, (VkDeviceSize)config->width * (VkDeviceSize)config->height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      &renderer->readback, &renderer->readback_memory, &renderer->readback_ptr) != FURRY_OK ||
+        create_command_pool(renderer, &renderer->transfer_pool, &renderer->transfer_cmd, &renderer->transfer_fence) != FURRY_OK) {
+        furry_vk_destroy(renderer);
+        return FURRY_ERR;
+    }
+    for (unsigned i = 0; i < renderer->frame_count; ++i) {
+        GpuFrame *frame = &renderer->frames[i];
+        if (create_command_pool(renderer, &frame->pool, &frame->cmd, &frame->fence) != FURRY_OK) {
+            furry_vk_destroy(renderer);
+            return FURRY_ERR;
+        }
+    }
+
+    unsigned char *white = malloc(4);
+    int atlas_width = 0;
+    int atlas_height = 0;
+    furry_text_atlas(renderer->text, &atlas_width, &atlas_height, NULL);
+    unsigned id = 0;
+    if (white == NULL) {
+        furry_vk_destroy(renderer);
+        return FURRY_ERR;
+    }
+    memset(white, 0xff, 4);
+    /* Ids 0 and 1 are fixed: GPU_TEXTURE_WHITE for filled rects, GPU_TEXTURE_GLYPHS for the text atlas (uploaded from the cache). */
+    if (add_texture(renderer, "", 1, 1, VK_FORMAT_R8G8B8A8_UNORM, white, &id) != FURRY_OK ||
+        add_texture(renderer, "", atlas_width, atlas_height, VK_FORMAT_R8_UNORM, NULL, &id) != FURRY_OK) {
+        furry_vk_destroy(renderer);
+        return FURRY_ERR;
+    }
+    furry_vk_clear(renderer);
+    *out_renderer = renderer;
+    return FURRY_OK;
+}
+
+void furry_vk_destroy(FurryVkRenderer *renderer) {
+    if (renderer == NULL) {
+        return;
+    }
+    if (renderer->device != VK_NULL_HANDLE) {
+        vkDeviceWaitIdle(renderer->device);
+        save_pipeline_cache(renderer);
+        for (size_t i = 0; i < renderer->texture_count; ++i) {
+            destroy_texture(renderer, &renderer->textures[i]);
+        }
+        for (unsigned i = 0; i < FURRY_GPU_MAX_FRAMES; ++i) {
+            if (renderer->frames[i].fence != VK_NULL_HANDLE) {
+                vkDestroyFence(renderer->device, renderer->frames[i].fence, NULL);
+            }
+            if (renderer->frames[i].pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(renderer->device, renderer->frames[i].pool, NULL);
+            }
+        }
+        if (renderer->transfer_fence != VK_NULL_HANDLE) {
+            vkDestroyFence(renderer->device, renderer->transfer_fence, NULL);
+        }
+        if (renderer->transfer_pool != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(renderer->device, renderer->transfer_pool, NULL);
+        }
+        /* Freeing mapped memory unmaps it. */
+        vkDestroyBuffer(renderer->device, renderer->staging, NULL);
+        vkFreeMemory(renderer->device, renderer->staging_memory, NULL);
+        vkDestroyBuffer(renderer->device, renderer->readback, NULL);
+        vkFreeMemory(renderer->device, renderer->readback_memory, NULL);
+        for (int i = 0; i < 3; ++i) {
+            vkDestroyPipeline(renderer->device, renderer->pipelines[i], NULL);
+        }
+        vkDestroyPipelineCache(renderer->device, renderer->pipeline_cache, NULL);
+        vkDestroySampler(renderer->device, renderer->sampler, NULL);
+        vkDestroyDescriptorPool(renderer->device, renderer->descriptor_pool, NULL);
+        vkDestroyPipelineLayout(renderer->device, renderer->pipeline_layout, NULL);
+        vkDestroyDescriptorSetLayout(renderer->device, renderer->set_layout, NULL);
+        vkDestroyFramebuffer(renderer->device, renderer->framebuffer, NULL);
+        vkDestroyRenderPass(renderer->device, renderer->render_pass, NULL);
+        vkDestroyImageView(renderer->device, renderer->target_view, NULL);
+        vkDestroyImage(renderer->device, renderer->target, NULL);
+        vkFreeMemory(renderer->device, renderer->target_memory, NULL);
+        vkDestroyDevice(renderer->device, NULL);
+    }
+    if (renderer->instance != VK_NULL_HANDLE) {
+        vkDestroyInstance(renderer->instance, NULL);
+    }
+    furry_batch_destroy(renderer->batch);
+    furry_layout_destroy(renderer->layout);
+    furry_text_layout_free(&renderer->text_layout);
+    furry_text_destroy(renderer->text);
+    furry_free(renderer->textures);
+    furry_free(renderer->pipeline_cache_path);
+    furry_free(renderer);
+}
+
+void furry_vk_clear(FurryVkRenderer *renderer) {
+    if (renderer == NULL) {
+        return;
+    }
+    renderer->scene_count = 0;
+    renderer->ui_count = 0;
+    renderer->ui_text_count = 0;
+    renderer->ui_layer = FURRY_BATCH_LAYER_UI;
+    renderer->column_x = 0;
+    renderer->column_w = renderer->width;
+    renderer->cursor_y = 0;
+}
+
+static unsigned theme_color(FurryColor color, unsigned alpha) {
+    return ((unsigned)color.r << 24) | ((unsigned)color.g << 16) | ((unsigned)color.b << 8) | alpha;
+}
+
+/* UI primitives stack in command order; each gets its own batch layer so texture sorting cannot reorder them. */
+static int next_ui_layer(FurryVkRenderer *renderer) {
+    int layer = renderer->ui_layer;
+    if (renderer->ui_layer < FURRY_BATCH_MAX_LAYER) {
+        renderer->ui_layer++;
+    }
+    return layer;
+}
+
+static int add_ui_sprite(FurryVkRenderer *renderer, unsigned texture, float x, float y, float w, float h, unsigned rgba) {
+    if (renderer->ui_count == GPU_MAX_UI) {
+        return FURRY_ERR;
+    }
+    FurrySprite *sprite = &renderer->ui[renderer->ui_count++];
+    memset(sprite, 0, sizeof(*sprite));
+    sprite->texture = texture;
+    sprite->layer = next_ui_layer(renderer);
+    sprite->blend = FURRY_BLEND_ALPHA;
+    sprite->x = x;
+    sprite->y = y;
+    sprite->w = w;
+    sprite->h = h;
+    sprite->uv[2] = 1.0f;
+    sprite->uv[3] = 1.0f;
+    sprite->tint = rgba;
+    return FURRY_OK;
+}
+
+static int add_ui_text(FurryVkRenderer *renderer, int x, int y, unsigned rgba, const char *text, int max_width, int *out_height) {
+    if (renderer->ui_text_count == GPU_MAX_UI_TEXT) {
+        return FURRY_ERR;
+    }
+    UiText *item = &renderer->ui_text[renderer->ui_text_count];
+    item->x = (float)x;
+    item->y = (float)y;
+    item->max_width = (float)max_width;
+    item->scale = renderer->ui_scale;
+    item->rgba = rgba;
+    snprintf(item->text, sizeof(item->text), "%s", text);
+    FurryTextStyle style = {8 * item->scale, item->max_width, (float)(GPU_LINE_HEIGHT * item->scale)};
+    if (furry_text_layout(renderer->text, item->text, &style, &renderer->text_layout) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    item->layer = next_ui_layer(renderer);
+    renderer->ui_text_count++;
+    if (out_height != NULL) {
+        *out_height = (int)renderer->text_layout.height;
+    }
+    return FURRY_OK;
+}
+
+static int add_panel(FurryVkRenderer *renderer, const FurryInstruction *ins) {
+    FurryLayoutSpec spec;
+    if (furry_layout_spec_from_panel(ins->b, ins->c, ins->choices[0].text, ins->choices[0].target, &spec) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    furry_layout_clear(renderer->layout);
+    if (furry_layout_add(renderer->layout, -1, &spec, NULL) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    furry_layout_update(renderer->layout);
+    const FurryRect *rect = furry_layout_rects(renderer->layout, NULL);
+    float x = roundf(rect->x);
+    float y = roundf(rect->y);
+    float w = roundf(rect->w);
+    float h = roundf(rect->h);
+    unsigned border = theme_color(renderer->theme.accent, 255);
+    if (add_ui_sprite(renderer, GPU_TEXTURE_WHITE, x, y, w, h, theme_color(renderer->theme.gradient_top, 220)) != FURRY_OK ||
+        add_ui_sprite(renderer, GPU_TEXTURE_WHITE, x, y, w, 1.0f, border) != FURRY_OK ||
+        add_ui_sprite(renderer, GPU_TEXTURE_WHITE, x, y + h - 1.0f, w, 1.0f, border) != FURRY_OK ||
+        add_ui_sprite(renderer, GPU_TEXTURE_WHITE, x, y, 1.0f, h, border) != FURRY_OK ||
+        add_ui_sprite(renderer, GPU_TEXTURE_WHITE, x + w - 1.0f, y, 1.0f, h, border) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    int pad = 4 * renderer->ui_scale;
+    renderer->column_x = (int)x + pad;
+    renderer->column_w = (int)w - pad * 2;
+    renderer->cursor_y = (int)y + pad;
+    return FURRY_OK;
+}
+
+static int add_ui_image(FurryVkRenderer *renderer, const char *asset) {
+    FurryBatchTexture texture;
+    if (resolve_texture(asset, &texture, renderer) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    float box = 32.0f * (float)renderer->ui_scale;
+    float scale = box / texture.height;
+    if (add_ui_sprite(renderer, texture.texture, (float)renderer->column_x, (float)renderer->cursor_y, texture.width * scale, box, 0xffffffffu) !=
+        FURRY_OK) {
+        return FURRY_ERR;
+    }
+    renderer->cursor_y += (int)box + 2 * renderer->ui_scale;
+    return FURRY_OK;
+}
+
+/* bg and fg as furry_batch_host_command builds them; an fg of an asset already on screen moves it, as the VM's scene state does. */
+static int set_scene_sprite(FurryVkRenderer *renderer, FurryOpCode op, const FurryInstruction *ins) {
+    FurryBatchTexture texture;
+    if (resolve_texture(ins->a, &texture, renderer) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    FurrySprite sprite;
+    memset(&sprite, 0, sizeof(sprite));
+    sprite.texture = texture.texture;
+    memcpy(sprite.uv, texture.uv, sizeof(sprite.uv));
+    sprite.tint = 0xffffffffu;
+    if (op == FURRY_OP_BG) {
+        sprite.layer = FURRY_BATCH_LAYER_BG;
+        sprite.blend = FURRY_BLEND_OPAQUE;
+        sprite.w = (float)renderer->width;
+        sprite.h = (float)renderer->height;
+        renderer->scene_count = 0;
+    } else {
+        sprite.layer = FURRY_BATCH_LAYER_FG;
+        sprite.blend = FURRY_BLEND_ALPHA;
+        sprite.x = strtof(ins->b, NULL) * (float)renderer->width;
+        sprite.y = strtof(ins->c, NULL) * (float)renderer->height;
+        sprite.w = texture.width;
+        sprite.h = texture.height;
+        sprite.pivot_x = 0.5f;
+        sprite.pivot_y = 1.0f;
+        sprite.rotation_deg = strtof(ins->choices[0].text, NULL);
+    }
+    size_t i = 0;
+    while (i < renderer->scene_count && (renderer->scene[i].layer != FURRY_BATCH_LAYER_FG || renderer->scene[i].texture != sprite.texture)) {
+        i++;
+    }
+    if (i == renderer->scene_count) {
+        if (renderer->scene_count == GPU_MAX_SCENE) {
+            return FURRY_ERR;
+        }
+        renderer->scene_count++;
+    }
+    renderer->scene[i] = sprite;
+    return FURRY_OK;
+}
+
+int furry_vk_host_command(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)snapshot;
+    FurryVkRenderer *renderer = user_data;
+    if (renderer == NULL || ins == NULL) {
+        return FURRY_ERR;
+    }
+    int scale = renderer->ui_scale;
+    switch (op) {
+        case FURRY_OP_BG:
+        case FURRY_OP_FG:
+            return set_scene_sprite(renderer, op, ins);
+        case FURRY_OP_UI_BEGIN:
+            renderer->ui_count = 0;
+            renderer->ui_text_count = 0;
+            renderer->ui_layer = FURRY_BATCH_LAYER_UI;
+            renderer->column_x = 8 * scale;
+            renderer->column_w = renderer->width - 16 * scale;
+            renderer->cursor_y = 8 * scale;
+            return FURRY_OK;
+        case FURRY_OP_UI_PANEL:
+            return add_panel(renderer, ins);
+        case FURRY_OP_UI_TEXT: {
+            int height = 0;
+            if (add_ui_text(renderer, renderer->column_x, renderer->cursor_y, 0xf0f0f0ffu, ins->b, renderer->column_w, &height) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            renderer->cursor_y += height;
+            return FURRY_OK;
+        }
+        case FURRY_OP_BUTTON: {
+            int w = furry_soft_text_width(ins->b, scale) + 6 * scale;
+            int h = (GPU_GLYPH_H + 4) * scale;
+            if (add_ui_sprite(renderer, GPU_TEXTURE_WHITE, (float)renderer->column_x, (float)renderer->cursor_y, (float)w, (float)h,
+                              theme_color(renderer->theme.accent, 96)) != FURRY_OK ||
+                add_ui_text(renderer, renderer->column_x + 3 * scale, renderer->cursor_y + 2 * scale, 0xffffffffu, ins->b, 0, NULL) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            renderer->cursor_y += h + 2 * scale;
+            return FURRY_OK;
+        }
+        case FURRY_OP_UI_IMAGE:
+        case FURRY_OP_UI_ANIM:
+        case FURRY_OP_UI_VIDEO:
+            return add_ui_image(renderer, ins->b);
+        default:
+            return FURRY_OK;
+    }
+}
+
+/* The frame's batch: scene, UI and glyph quads; redone once if a text layout evicted glyphs an earlier one in the frame used. */
+static int build_batch(FurryVkRenderer *renderer) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        unsigned generation = 0;
+        int atlas_width = 0;
+        int atlas_height = 0;
+        furry_text_atlas(renderer->text, &atlas_width, &atlas_height, &generation);
+        furry_batch_begin(renderer->batch, (float)renderer->width, (float)renderer->height);
+        for (size_t i = 0; i < renderer->scene_count; ++i) {
+            furry_batch_add(renderer->batch, &renderer->scene[i]);
+        }
+        for (size_t i = 0; i < renderer->ui_count; ++i) {
+            furry_batch_add(renderer->batch, &renderer->ui[i]);
+        }
+        for (size_t t = 0; t < renderer->ui_text_count; ++t) {
+            const UiText *item = &renderer->ui_text[t];
+            FurryTextStyle style = {8 * item->scale, item->max_width, (float)(GPU_LINE_HEIGHT * item->scale)};
+            if (furry_text_layout(renderer->text, item->text, &style, &renderer->text_layout) != FURRY_OK) {
+                return FURRY_ERR;
+            }
+            for (size_t q = 0; q < renderer->text_layout.quad_count; ++q) {
+                const FurryGlyphQuad *quad = &renderer->text_layout.quads[q];
+                FurrySprite sprite;
+                memset(&sprite, 0, sizeof(sprite));
+                sprite.texture = GPU_TEXTURE_GLYPHS;
+                sprite.layer = item->layer;
+                sprite.blend = FURRY_BLEND_ALPHA;
+                sprite.x = item->x + quad->x;
+                sprite.y = item->y + quad->y;
+                sprite.w = quad->w;
+                sprite.h = quad->h;
+                sprite.uv[0] = quad->u / (float)atlas_width;
+                sprite.uv[1] = quad->v / (float)atlas_height;
+                sprite.uv[2] = (quad->u + quad->w) / (float)atlas_width;
+                sprite.uv[3] = (quad->v + quad->h) / (float)atlas_height;
+                sprite.tint = item->rgba;
+                furry_batch_add(renderer->batch, &sprite);
+            }
+        }
+        unsigned after = 0;
+        furry_text_atlas(renderer->text, NULL, NULL, &after);
+        if (after == generation) {
+            return furry_batch_end(renderer->batch);
+        }
+    }
+    return FURRY_ERR;
+}
+
+int furry_vk_render_frame(FurryVkRenderer *renderer) {
+    if (renderer == NULL) {
+        return FURRY_ERR;
+    }
+    unsigned slot = renderer->frame_index;
+    GpuFrame *frame = &renderer->frames[slot];
+    if (frame->submitted) {
+        if (vkWaitForFences(renderer->device, 1, &frame->fence, VK_TRUE, GPU_FENCE_TIMEOUT) != VK_SUCCESS) {
+            return FURRY_ERR;
+        }
+        frame->submitted = 0;
+        furry_staging_retire(&renderer->ring, slot);
+    }
+    if (vkResetFences(renderer->device, 1, &frame->fence) != VK_SUCCESS ||
+        vkResetCommandPool(renderer->device, frame->pool, 0) != VK_SUCCESS || build_batch(renderer) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    VkCommandBufferBeginInfo begin = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(frame->cmd, &begin) != VK_SUCCESS || upload_textures(renderer, frame->cmd) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    size_t instance_count = 0;
+    size_t draw_count = 0;
+    const FurrySpriteInstance *instances = furry_batch_instances(renderer->batch, &instance_count);
+    const FurryDrawCall *draws = furry_batch_draws(renderer->batch, &draw_count);
+    size_t instance_offset = 0;
+    if (instance_count > 0) {
+        if (staging_alloc(renderer, instance_count * sizeof(FurrySpriteInstance), 16, &instance_offset) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        memcpy(renderer->staging_ptr + instance_offset, instances, instance_count * sizeof(FurrySpriteInstance));
+    }
+
+    VkClearValue clear;
+    memset(&clear, 0, sizeof(clear));
+    clear.color.float32[3] = 1.0f;
+    VkRenderPassBeginInfo pass = {.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+    pass.renderPass = renderer->render_pass;
+    pass.framebuffer = renderer->framebuffer;
+    pass.renderArea.extent.width = (uint32_t)renderer->width;
+    pass.renderArea.extent.height = (uint32_t)renderer->height;
+    pass.clearValueCount = 1;
+    pass.pClearValues = &clear;
+    vkCmdBeginRenderPass(frame->cmd, &pass, VK_SUBPASS_CONTENTS_INLINE);
+    VkViewport viewport = {0.0f, 0.0f, (float)renderer->width, (float)renderer->height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0, 0}, {(uint32_t)renderer->width, (uint32_t)renderer->height}};
+    vkCmdSetViewport(frame->cmd, 0, 1, &viewport);
+    vkCmdSetScissor(frame->cmd, 0, 1, &scissor);
+    if (draw_count > 0) {
+        float push[2] = {(float)renderer->width, (float)renderer->height};
+        VkDeviceSize offset = instance_offset;
+        vkCmdBindVertexBuffers(frame->cmd, 0, 1, &renderer->staging, &offset);
+        /* All three pipelines share one layout, so the viewport survives pipeline switches. */
+        vkCmdPushConstants(frame->cmd, renderer->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), push);
+        int blend = -1;
+        unsigned texture = FURRY_VK_MAX_TEXTURES;
+        for (size_t i = 0; i < draw_count; ++i) {
+            const FurryDrawCall *draw = &draws[i];
+            if ((int)draw->blend != blend) {
+                blend = (int)draw->blend;
+                vkCmdBindPipeline(frame->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->pipelines[blend]);
+            }
+            if (draw->texture != texture) {
+                texture = draw->texture;
+                vkCmdBindDescriptorSets(frame->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->pipeline_layout, 0, 1,
+                                        &renderer->textures[texture].set, 0, NULL);
+            }
+            vkCmdDraw(frame->cmd, 4, (uint32_t)draw->instance_count, 0, (uint32_t)draw->first_instance);
+        }
+    }
+    vkCmdEndRenderPass(frame->cmd);
+    if (vkEndCommandBuffer(frame->cmd) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    furry_staging_close_frame(&renderer->ring, slot);
+    VkSubmitInfo submit = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &frame->cmd;
+    if (vkQueueSubmit(renderer->queue, 1, &submit, frame->fence) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    frame->submitted = 1;
+    renderer->rendered = 1;
+    renderer->frame_index = (slot + 1) % renderer->frame_count;
+    renderer->stats.frames++;
+    renderer->stats.draws += draw_count;
+    renderer->stats.instances += instance_count;
+    return FURRY_OK;
+}
+
+int furry_vk_wait_idle(FurryVkRenderer *renderer) {
+    if (renderer == NULL) {
+        return FURRY_ERR;
+    }
+    /* Oldest first, so the staging tail moves forward in submission order. */
+    for (unsigned k = 0; k < renderer->frame_count; ++k) {
+        unsigned slot = (renderer->frame_index + k) % renderer->frame_count;
+        GpuFrame *frame = &renderer->frames[slot];
+        if (frame->submitted) {
+            if (vkWaitForFences(renderer->device, 1, &frame->fence, VK_TRUE, GPU_FENCE_TIMEOUT) != VK_SUCCESS) {
+                return FURRY_ERR;
+            }
+            frame->submitted = 0;
+            furry_staging_retire(&renderer->ring, slot);
+        }
+    }
+    return FURRY_OK;
+}
+
+int furry_vk_read_pixels(FurryVkRenderer *renderer, unsigned char *out_pixels, size_t out_size) {
+    size_t size = renderer != NULL ? (size_t)renderer->width * (size_t)renderer->height * 4 : 0;
+    if (renderer == NULL || out_pixels == NULL || out_size < size || !renderer->rendered || furry_vk_wait_idle(renderer) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    VkCommandBufferBeginInfo begin = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkResetCommandPool(renderer->device, renderer->transfer_pool, 0) != VK_SUCCESS ||
+        vkBeginCommandBuffer(renderer->transfer_cmd, &begin) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    VkBufferImageCopy copy;
+    memset(&copy, 0, sizeof(copy));
+    copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.imageSubresource.layerCount = 1;
+    copy.imageExtent.width = (uint32_t)renderer->width;
+    copy.imageExtent.height = (uint32_t)renderer->height;
+    copy.imageExtent.depth = 1;
+    vkCmdCopyImageToBuffer(renderer->transfer_cmd, renderer->target, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderer->readback, 1, &copy);
+    VkBufferMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = renderer->readback;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(renderer->transfer_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+    VkSubmitInfo submit = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &renderer->transfer_cmd;
+    if (vkEndCommandBuffer(renderer->transfer_cmd) != VK_SUCCESS || vkResetFences(renderer->device, 1, &renderer->transfer_fence) != VK_SUCCESS ||
+        vkQueueSubmit(renderer->queue, 1, &submit, renderer->transfer_fence) != VK_SUCCESS ||
+        vkWaitForFences(renderer->device, 1, &renderer->transfer_fence, VK_TRUE, GPU_FENCE_TIMEOUT) != VK_SUCCESS) {
+        return FURRY_ERR;
+    }
+    memcpy(out_pixels, renderer->readback_ptr, size);
+    return FURRY_OK;
+}
+
+void furry_vk_stats(const FurryVkRenderer *renderer, FurryVkStats *out_stats) {
+    if (renderer == NULL || out_stats == NULL) {
+        return;
+    }
+    *out_stats = renderer->stats;
+}
@@ -0,0 +1,386 @@
+#include "furry_worker.h"
+#include "furry_internal.h"
+#include "furry_ui_tree.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#define WORKER_SPIN_YIELDS 64
+#define WORKER_BACKOFF_NS 50000L
+#define WORKER_INPUT_WAIT_NS 100000000L
+
+struct FurryWorker {
+    const FurryProgram *program;
+    FurryRuntimeConfig runtime;
+    FurryWorkerConfig config;
+    int (*host_save)(const char *, const FurryRuntimeSnapshot *, void *);
+    int (*host_load)(const char *, FurryRuntimeSnapshot *, void *);
+    unsigned long long (*host_clock)(void *);
+    void *host_user_data;
+    unsigned long long started_ns;
+    FurrySpscRing commands;
+    FurrySpscRing inputs;
+    thrd_t thread;
+    /* The VM sleeps on input_ready while it waits for an advance or choice. */
+    mtx_t input_lock;
+    cnd_t input_ready;
+    atomic_int stop;
+    atomic_int done;
+    int result;
+
+    /* VM thread. */
+    unsigned long long sequence;
+    FurryHostCommand staging;
+
+    /* Render thread. */
+    size_t inputs_dropped;
+
+    atomic_size_t published;
+    atomic_size_t stalls;
+    atomic_size_t max_depth;
+};
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+/* VM-side wait: spin briefly, then sleep. The render thread is never involved. */
+static void backoff(unsigned *spins) {
+    if (*spins < WORKER_SPIN_YIELDS) {
+        (*spins)++;
+        thrd_yield();
+        return;
+    }
+    struct timespec interval = {0, WORKER_BACKOFF_NS};
+    thrd_sleep(&interval, NULL);
+}
+
+static int publish(FurryWorker *worker, FurryHostCommand *cmd) {
+    cmd->sequence = ++worker->sequence;
+    cmd->issued_ns = now_ns();
+    unsigned spins = 0;
+    int stalled = 0;
+    while (furry_spsc_write(&worker->commands, cmd, 1) != 1) {
+        if (atomic_load_explicit(&worker->stop, memory_order_acquire)) {
+            return FURRY_ERR;
+        }
+        if (!stalled) {
+            stalled = 1;
+            atomic_fetch_add_explicit(&worker->stalls, 1, memory_order_relaxed);
+        }
+        backoff(&spins);
+    }
+    size_t depth = furry_spsc_readable(&worker->commands);
+    if (depth > atomic_load_explicit(&worker->max_depth, memory_order_relaxed)) {
+        atomic_store_explicit(&worker->max_depth, depth, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&worker->published, 1, memory_order_relaxed);
+    if (worker->config.wake != NULL) {
+        worker->config.wake(worker->config.wake_user_data);
+    }
+    return FURRY_OK;
+}
+
+static void signal_input(FurryWorker *worker) {
+    mtx_lock(&worker->input_lock);
+    cnd_signal(&worker->input_ready);
+    mtx_unlock(&worker->input_lock);
+}
+
+/*
+ * Blocks until input arrives: a VN waiting on dialogue costs no CPU. Spawned
+ * contexts get their turns meanwhile, waking the thread when one is due; the
+ * timeout otherwise only bounds a missed stop.
+ */
+static int wait_input(FurryWorker *worker, FurryWorkerInputType type, int *out_value) {
+    for (;;) {
+        long long wait_ms = -1;
+        if (furry_run_background(&wait_ms) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+        FurryWorkerInput input;
+        while (furry_spsc_read(&worker->inputs, &input, 1) == 1) {
+            if (input.type == FURRY_INPUT_STOP) {
+                atomic_store_explicit(&worker->stop, 1, memory_order_release);
+                return FURRY_ERR;
+            }
+            if (input.type == type) {
+                *out_value = input.value;
+                return FURRY_OK;
+            }
+        }
+        mtx_lock(&worker->input_lock);
+        if (wait_ms != 0 && !atomic_load_explicit(&worker->stop, memory_order_acquire) && furry_spsc_readable(&worker->inputs) == 0) {
+            long wait_ns = wait_ms > 0 && wait_ms < WORKER_INPUT_WAIT_NS / 1000000L ? (long)wait_ms * 1000000L : WORKER_INPUT_WAIT_NS;
+            struct timespec deadline;
+            timespec_get(&deadline, TIME_UTC);
+            deadline.tv_nsec += wait_ns;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            cnd_timedwait(&worker->input_ready, &worker->input_lock, &deadline);
+        }
+        mtx_unlock(&worker->input_lock);
+        if (atomic_load_explicit(&worker->stop, memory_order_acquire)) {
+            return FURRY_ERR;
+        }
+    }
+}
+
+static FurryHostCommand *begin_command(FurryWorker *worker, FurryOpCode op) {
+    FurryHostCommand *cmd = &worker->staging;
+    cmd->op = op;
+    cmd->i = 0;
+    cmd->ui_patch = 0;
+    cmd->bind_update = 0;
+    cmd->ui_index = 0;
+    cmd->a[0] = '\0';
+    cmd->b[0] = '\0';
+    cmd->c[0] = '\0';
+    cmd->choice_count = 0;
+    return cmd;
+}
+
+static void copy_text(char *dst, const char *src) {
+    size_t len = strlen(src);
+    if (len >= FURRY_MAX_TEXT) {
+        len = FURRY_MAX_TEXT - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static int worker_host(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)snapshot;
+    FurryWorker *worker = user_data;
+    FurryHostCommand *cmd = begin_command(worker, op);
+    cmd->i = ins->i;
+    copy_text(cmd->a, ins->a);
+    copy_text(cmd->b, ins->b);
+    copy_text(cmd->c, ins->c);
+    /* FG carries its transform in choices[0]. */
+    size_t choice_count = op == FURRY_OP_FG ? 1 : ins->choice_count;
+    memcpy(cmd->choices, ins->choices, choice_count * sizeof(FurryChoice));
+    cmd->choice_count = choice_count;
+    return publish(worker, cmd);
+}
+
+static int worker_say(const char *speaker, const char *text, void *user_data) {
+    FurryWorker *worker = user_data;
+    FurryHostCommand *cmd = begin_command(worker, FURRY_OP_SAY);
+    copy_text(cmd->a, speaker);
+    copy_text(cmd->b, text);
+    if (publish(worker, cmd) != FURRY_OK) {
+        return FURRY_ERR;
+    }
+    int ignored;
+    return worker->config.wait_on_say ? wait_input(worker, FURRY_INPUT_ADVANCE, &ignored) : FURRY_OK;
+}
+
+static int worker_choose(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    FurryWorker *worker = user_data;
+    FurryHostCommand *cmd = begin_command(worker, FURRY_OP_CHOICE);
+    copy_text(cmd->a, prompt);
+    memcpy(cmd->choices, choices, count * sizeof(FurryChoice));
+    cmd->choice_count = count;
+    int selected = -1;
+    if (publish(worker, cmd) != FURRY_OK || wait_input(worker, FURRY_INPUT_CHOICE, &selected) != FURRY_OK) {
+        return -1;
+    }
+    return selected;
+}
+
+static int worker_ui_patch(const FurryUiPatch *patch, void *user_data) {
+    FurryWorker *worker = user_data;
+    FurryHostCommand *cmd = begin_command(worker, patch->kind);
+    cmd->ui_patch = (int)patch->type + 1;
+    cmd->ui_index = patch->index;
+    cmd->i = patch->field;
+    copy_text(cmd->a, patch->id);
+    copy_text(cmd->b, patch->layer);
+    for (int v = 0; v < FURRY_UI_NODE_VALUES; ++v) {
+        copy_text(cmd->choices[v].text, patch->values[v]);
+        cmd->choices[v].target[0] = '\0';
+    }
+    cmd->choice_count = FURRY_UI_NODE_VALUES;
+    return publish(worker, cmd);
+}
+
+static int worker_bind_update(const FurryBindUpdate *updates, size_t count, void *user_data) {
+    FurryWorker *worker = user_data;
+    for (size_t u = 0; u < count; ++u) {
+        FurryHostCommand *cmd = begin_command(worker, FURRY_OP_UI_BIND);
+        cmd->bind_update = 1;
+        copy_text(cmd->a, updates[u].id);
+        copy_text(cmd->b, updates[u].layer);
+        copy_text(cmd->c, updates[u].value);
+        copy_text(cmd->choices[0].text, updates[u].key);
+        cmd->choices[0].target[0] = '\0';
+        cmd->choice_count = 1;
+        if (publish(worker, cmd) != FURRY_OK) {
+            return FURRY_ERR;
+        }
+    }
+    return FURRY_OK;
+}
+
+/* Slot callbacks run on the VM thread with the caller's own user data. */
+static int worker_save(const char *slot, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    FurryWorker *worker = user_data;
+    return worker->host_save(slot, snapshot, worker->host_user_data);
+}
+
+static int worker_load(const char *slot, FurryRuntimeSnapshot *snapshot, void *user_data) {
+    FurryWorker *worker = user_data;
+    return worker->host_load(slot, snapshot, worker->host_user_data);
+}
+
+/* Script time for wait: the host's clock, or milliseconds since the worker started. */
+static unsigned long long worker_clock(void *user_data) {
+    FurryWorker *worker = user_data;
+    if (worker->host_clock != NULL) {
+        return worker->host_clock(worker->host_user_data);
+    }
+    return (now_ns() - worker->started_ns) / 1000000ull;
+}
+
+static int worker_main(void *arg) {
+    FurryWorker *worker = arg;
+    furry_trace_thread_name("furry vm");
+    worker->result = furry_run_program(worker->program, &worker->runtime);
+
+    FurryHostCommand *cmd = begin_command(worker, FURRY_OP_END);
+    cmd->i = worker->result;
+    publish(worker, cmd);
+    atomic_store_explicit(&worker->done, 1, memory_order_release);
+    return 0;
+}
+
+int furry_worker_start(const FurryProgram *program, const FurryRuntimeConfig *runtime_config, const FurryWorkerConfig *config,
+                       FurryWorker **out_worker) {
+    if (program == NULL || out_worker == NULL) {
+        return FURRY_ERR;
+    }
+    *out_worker = NULL;
+    FurryWorker *worker = furry_calloc(FURRY_MEM_VM, 1, sizeof(FurryWorker));
+    if (worker == NULL) {
+        return FURRY_ERR;
+    }
+    worker->program = program;
+    if (runtime_config != NULL) {
+        worker->runtime = *runtime_config;
+        worker->host_save = runtime_config->save_slot;
+        worker->host_load = runtime_config->load_slot;
+        worker->host_clock = runtime_config->clock_ms;
+        worker->host_user_data = runtime_config->user_data;
+    }
+    worker->runtime.choose_option = worker_choose;
+    worker->runtime.on_host_command = worker_host;
+    worker->runtime.on_say = worker_say;
+    worker->runtime.on_ui_patch = worker_ui_patch;
+    worker->runtime.on_bind_update = worker->runtime.on_bind_update != NULL ? worker_bind_update : NULL;
+    worker->runtime.on_scene_restore = NULL;
+    worker->runtime.on_skip_stop = NULL;
+    worker->runtime.save_slot = worker->host_save != NULL ? worker_save : NULL;
+    worker->runtime.load_slot = worker->host_load != NULL ? worker_load : NULL;
+    worker->runtime.clock_ms = worker_clock;
+    worker->runtime.user_data = worker;
+    if (config != NULL) {
+        worker->config = *config;
+    }
+    if (worker->config.command_capacity == 0) {
+        worker->config.command_capacity = 64;
+    }
+    if (worker->config.input_capacity == 0) {
+        worker->config.input_capacity = 16;
+    }
+    worker->started_ns = now_ns();
+    atomic_init(&worker->stop, 0);
+    atomic_init(&worker->done, 0);
+    atomic_init(&worker->published, 0);
+    atomic_init(&worker->stalls, 0);
+    atomic_init(&worker->max_depth, 0);
+
+    if (mtx_init(&worker->input_lock, mtx_plain) != thrd_success) {
+        furry_free(worker);
+        return FURRY_ERR;
+    }
+    if (cnd_init(&worker->input_ready) != thrd_success) {
+        mtx_destroy(&worker->input_lock);
+        furry_free(worker);
+        return FURRY_ERR;
+    }
+    if (furry_spsc_init(&worker->commands, FURRY_MEM_VM, sizeof(FurryHostCommand), worker->config.command_capacity) != FURRY_OK) {
+        cnd_destroy(&worker->input_ready);
+        mtx_destroy(&worker->input_lock);
+        furry_free(worker);
+        return FURRY_ERR;
+    }
+    if (furry_spsc_init(&worker->inputs, FURRY_MEM_VM, sizeof(FurryWorkerInput), worker->config.input_capacity) != FURRY_OK ||
+        thrd_create(&worker->thread, worker_main, worker) != thrd_success) {
+        furry_spsc_free(&worker->inputs);
+        furry_spsc_free(&worker->commands);
+        cnd_destroy(&worker->input_ready);
+        mtx_destroy(&worker->input_lock);
+        furry_free(worker);
+        return FURRY_ERR;
+    }
+    *out_worker = worker;
+    return FURRY_OK;
+}
+
+size_t furry_worker_poll(FurryWorker *worker, FurryHostCommand *out_commands, size_t max_commands) {
+    if (worker == NULL || out_commands == NULL) {
+        return 0;
+    }
+    return furry_spsc_read(&worker->commands, out_commands, max_commands);
+}
+
+int furry_worker_send(FurryWorker *worker, const FurryWorkerInput *input) {
+    if (worker == NULL || input == NULL) {
+        return FURRY_ERR;
+    }
+    if (furry_spsc_write(&worker->inputs, input, 1) != 1) {
+        worker->inputs_dropped++;
+        return FURRY_ERR;
+    }
+    signal_input(worker);
+    return FURRY_OK;
+}
+
+int furry_worker_finished(FurryWorker *worker) {
+    return worker == NULL || atomic_load_explicit(&worker->done, memory_order_acquire);
+}
+
+void furry_worker_stats(FurryWorker *worker, FurryWorkerStats *out_stats) {
+    if (worker == NULL || out_stats == NULL) {
+        return;
+    }
+    out_stats->commands_published = atomic_load_explicit(&worker->published, memory_order_relaxed);
+    out_stats->producer_stalls = atomic_load_explicit(&worker->stalls, memory_order_relaxed);
+    out_stats->max_queue_depth = atomic_load_explicit(&worker->max_depth, memory_order_relaxed);
+    out_stats->inputs_dropped = worker->inputs_dropped;
+}
+
+int furry_worker_join(FurryWorker *worker) {
+    if (worker == NULL) {
+        return FURRY_ERR;
+    }
+    if (!atomic_load_explicit(&worker->done, memory_order_acquire)) {
+        atomic_store_explicit(&worker->stop, 1, memory_order_release);
+        signal_input(worker);
+    }
+    thrd_join(worker->thread, NULL);
+    int result = worker->result;
+    furry_spsc_free(&worker->inputs);
+    furry_spsc_free(&worker->commands);
+    cnd_destroy(&worker->input_ready);
+    mtx_destroy(&worker->input_lock);
+    furry_free(worker);
+    return result;
+}
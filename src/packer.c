@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "furry.h"
+#include "furry_pack.h"
+
+/* furry_packer: builds an asset pack from loose files and optionally checks a script against it. */
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: furry_packer [-z] [-a alignment] [-C dir] [-s script] out.fpk asset...\n"
+            "  -z            compress entries with the built-in LZ codec\n"
+            "  -a alignment  entry alignment in bytes (power of two, default 64)\n"
+            "  -C dir        read assets from dir; they are stored under the names given\n"
+            "  -s script     after packing, fail if the script references an asset not in the pack\n");
+}
+
+static char *read_text_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    char *text = NULL;
+    size_t size = 0;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long end = ftell(file);
+        if (end >= 0 && fseek(file, 0, SEEK_SET) == 0 && (text = malloc((size_t)end + 1)) != NULL) {
+            size = fread(text, 1, (size_t)end, file);
+            text[size] = '\0';
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+static int check_script(const char *pack_path, const char *script_path) {
+    char *script = read_text_file(script_path);
+    if (script == NULL) {
+        fprintf(stderr, "cannot read %s\n", script_path);
+        return 1;
+    }
+    FurryProgram program;
+    FurryCompileError error;
+    int rc = furry_compile_script_ex(script, &program, &error);
+    free(script);
+    if (rc != 0) {
+        fprintf(stderr, "%s:%d: %s\n", script_path, error.line, error.message);
+        return 1;
+    }
+    FurryPack *pack = NULL;
+    if (furry_pack_open(pack_path, &pack) != 0) {
+        furry_free_program(&program);
+        fprintf(stderr, "cannot open %s\n", pack_path);
+        return 1;
+    }
+    rc = furry_pack_check_program(pack, &program, &error);
+    if (rc != 0) {
+        fprintf(stderr, "%s: instruction %d: %s\n", script_path, error.line, error.message);
+    }
+    furry_pack_close(pack);
+    furry_free_program(&program);
+    return rc != 0;
+}
+
+int main(int argc, char **argv) {
+    FurryPackWriterConfig config = {0, 0};
+    const char *dir = NULL;
+    const char *script = NULL;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        if (strcmp(argv[arg], "-z") == 0) {
+            config.compress = 1;
+        } else if (strcmp(argv[arg], "-a") == 0 && arg + 1 < argc) {
+            config.alignment = (size_t)strtoul(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "-C") == 0 && arg + 1 < argc) {
+            dir = argv[++arg];
+        } else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+            script = argv[++arg];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (argc - arg < 1) {
+        usage();
+        return 2;
+    }
+    const char *out_path = argv[arg++];
+
+    FurryPackWriter *writer = NULL;
+    if (furry_pack_writer_create(&config, &writer) != 0) {
+        fprintf(stderr, "invalid alignment\n");
+        return 2;
+    }
+    for (; arg < argc; ++arg) {
+        char file_path[4096];
+        int written = dir != NULL ? snprintf(file_path, sizeof(file_path), "%s/%s", dir, argv[arg])
+                                  : snprintf(file_path, sizeof(file_path), "%s", argv[arg]);
+        if (written < 0 || (size_t)written >= sizeof(file_path) || furry_pack_writer_add_file(writer, argv[arg], file_path) != 0) {
+            fprintf(stderr, "cannot add %s\n", file_path);
+            furry_pack_writer_destroy(writer);
+            return 1;
+        }
+    }
+    int rc = furry_pack_writer_finish(writer, out_path);
+    furry_pack_writer_destroy(writer);
+    if (rc != 0) {
+        fprintf(stderr, "cannot write %s (duplicate asset path?)\n", out_path);
+        return 1;
+    }
+
+    FurryPack *pack = NULL;
+    if (furry_pack_open(out_path, &pack) == 0) {
+        size_t raw = 0;
+        size_t stored = 0;
+        FurryPackEntry entry;
+        for (size_t i = 0; furry_pack_entry_at(pack, i, &entry) == 0; ++i) {
+            raw += entry.size;
+            stored += entry.stored_size;
+        }
+        printf("%s: %zu assets, %zu bytes stored for %zu bytes of data\n", out_path, furry_pack_count(pack), stored, raw);
+        furry_pack_close(pack);
+    }
+    return script != NULL ? check_script(out_path, script) : 0;
+}
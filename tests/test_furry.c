@@ -1,7 +1,39 @@
 #include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+#include <time.h>
 
 #include "furry.h"
+#include "furry_alloc.h"
+#include "furry_anim.h"
+#include "furry_audio.h"
+#include "furry_batch.h"
+#include "furry_builder.h"
+#include "furry_cache.h"
+#include "furry_gpu.h"
+#include "furry_layout.h"
+#include "furry_lazy.h"
+#include "furry_locale.h"
+#include "furry_pack.h"
+#include "furry_platform.h"
+#include "furry_replay.h"
+#include "furry_save.h"
+#include "furry_seen.h"
+#include "furry_soft.h"
+#include "furry_text.h"
+#include "furry_trace.h"
+#include "furry_ui_tree.h"
+#include "furry_video.h"
+#include "furry_worker.h"
+#if defined(FURRY_HAVE_SDL3)
+#include "furry_sdl.h"
+#endif
+#if defined(FURRY_HAVE_VULKAN)
+#include "furry_vk.h"
+#endif
 
 static int pick_first(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
     (void)prompt;
@@ -47,6 +79,355 @@ static int load_slot(const char *slot, FurryRuntimeSnapshot *snapshot, void *use
     return 0;
 }
 
+static int capture_save(const char *slot, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)slot;
+    *(FurryRuntimeSnapshot *)user_data = *snapshot;
+    return 0;
+}
+
+static const char *snapshot_var(const FurryRuntimeSnapshot *snapshot, const char *key) {
+    for (size_t i = 0; i < snapshot->var_count; ++i) {
+        if (strcmp(snapshot->vars[i].key, key) == 0) {
+            return snapshot->vars[i].value;
+        }
+    }
+    return "";
+}
+
+typedef struct LocaleCapture {
+    char ui_text[FURRY_MAX_TEXT];
+    char choice[FURRY_MAX_TEXT];
+} LocaleCapture;
+
+static int capture_ui_text(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)snapshot;
+    if (op == FURRY_OP_UI_TEXT) {
+        strcpy(((LocaleCapture *)user_data)->ui_text, ins->b);
+    }
+    return 0;
+}
+
+static int capture_choice(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    (void)prompt;
+    (void)count;
+    strcpy(((LocaleCapture *)user_data)->choice, choices[0].text);
+    return 0;
+}
+
+/* Switches tables while the run holds a string from the old one, which must stay readable. */
+static int switch_mid_choice(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    (void)prompt;
+    (void)choices;
+    (void)count;
+    FurryLocale *locale = user_data;
+    const char *held = furry_locale_lookup(locale, furry_locale_string_id("Left"));
+    assert(held != NULL && strcmp(held, "Gauche") == 0);
+    assert(furry_locale_switch(locale, "test_locale_de.fyl") == 0);
+    assert(strcmp(held, "Gauche") == 0);
+    assert(furry_locale_lookup(locale, furry_locale_string_id("Left")) != held);
+    return 0;
+}
+
+static void write_translation(const char *template_path, const char *out_path, const char *from, const char *to) {
+    FILE *in = fopen(template_path, "r");
+    FILE *out = fopen(out_path, "w");
+    assert(in != NULL && out != NULL);
+    char line[FURRY_MAX_TEXT + 32];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char *hit = strstr(line, from);
+        if (hit != NULL) {
+            fprintf(out, "%.*s%s%s", (int)(hit - line), line, to, hit + strlen(from));
+        }
+    }
+    fclose(in);
+    fclose(out);
+}
+
+typedef struct SaveStoreRun {
+    int pick;
+    char x_at_bg[FURRY_MAX_VALUE];
+} SaveStoreRun;
+
+static int pick_from_run(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    (void)prompt;
+    (void)choices;
+    (void)count;
+    return ((SaveStoreRun *)user_data)->pick;
+}
+
+static int record_x_at_bg(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)ins;
+    if (op == FURRY_OP_BG) {
+        strcpy(((SaveStoreRun *)user_data)->x_at_bg, snapshot_var(snapshot, "x"));
+    }
+    return 0;
+}
+
+typedef struct SceneLog {
+    int pick;
+    int restores;
+    char text[512];
+    FurrySceneState scene;
+    int says;
+    int stops;
+    FurrySkipStop last_stop;
+    FurrySkipMode next_mode;
+} SceneLog;
+
+static int pick_scene_mode(const char *prompt, const FurryChoice *choices, size_t count, void *user_data) {
+    (void)prompt;
+    (void)choices;
+    (void)count;
+    return ((SceneLog *)user_data)->pick;
+}
+
+static int log_scene_host(FurryOpCode op, const FurryInstruction *ins, const FurryRuntimeSnapshot *snapshot, void *user_data) {
+    (void)snapshot;
+    SceneLog *log = user_data;
+    size_t used = strlen(log->text);
+    if (op == FURRY_OP_BG || op == FURRY_OP_MUSIC) {
+        snprintf(log->text + used, sizeof(log->text) - used, "%s %s;", op == FURRY_OP_BG ? "bg" : "music", ins->a);
+    } else if (op == FURRY_OP_FG) {
+        snprintf(log->text + used, sizeof(log->text) - used, "fg %s@%s,%s,%s,%s;", ins->a, ins->b, ins->c, ins->choices[0].text,
+                 ins->choices[0].target);
+    } else if (op == FURRY_OP_UI_TEXT) {
+        snprintf(log->text + used, sizeof(log->text) - used, "text %s;", ins->b);
+    }
+    return 0;
+}
+
+static int capture_scene(const FurrySceneState *scene, void *user_data) {
+    SceneLog *log = user_data;
+    log->scene = *scene;
+    log->restores++;
+    return 0;
+}
+
+static int count_scene_say(const char *speaker, const char *text, void *user_data) {
+    (void)speaker;
+    (void)text;
+    ((SceneLog *)user_data)->says++;
+    return 0;
+}
+
+static FurrySkipMode next_skip_mode(FurrySkipStop reason, void *user_data) {
+    SceneLog *log = user_data;
+    log->stops++;
+    log->last_stop = reason;
+    return log->next_mode;
+}
+
+/* furry_run_background from inside a say, as a synchronous host would while the player reads. */
+typedef struct PumpState {
+    SceneLog log;
+    unsigned long long now_ms;
+    long long waits[2];
+} PumpState;
+
+static unsigned long long pump_clock(void *user_data) {
+    return ((PumpState *)user_data)->now_ms;
+}
+
+static int pump_on_say(const char *speaker, const char *text, void *user_data) {
+    PumpState *pump = user_data;
+    (void)speaker;
+    (void)text;
+    assert(furry_run_background(&pump->waits[0]) == 0);
+    pump->now_ms = 1000;
+    assert(furry_run_background(&pump->waits[1]) == 0);
+    return 0;
+}
+
+static void remove_save_store_files(const char *path) {
+    char extra[128];
+    remove(path);
+    snprintf(extra, sizeof(extra), "%s.idx", path);
+    remove(extra);
+    snprintf(extra, sizeof(extra), "%s.tmp", path);
+    remove(extra);
+}
+
+typedef struct DcSource {
+    float level;
+    unsigned channels;
+    size_t length;
+    size_t position;
+} DcSource;
+
+static DcSource dc_sources[8];
+static size_t dc_source_count;
+
+static size_t dc_read(void *state, float *out_frames, size_t frame_count) {
+    DcSource *dc = state;
+    size_t n = dc->length - dc->position;
+    n = n < frame_count ? n : frame_count;
+    for (size_t i = 0; i < n * dc->channels; ++i) {
+        out_frames[i] = dc->level;
+    }
+    dc->position += n;
+    return n;
+}
+
+static int dc_seek(void *state, size_t frame) {
+    ((DcSource *)state)->position = frame;
+    return 0;
+}
+
+/* Constant-level sources: music is mono at half rate (exercises resampling), sfx are stereo. */
+static int open_dc(const char *path, FurryAudioDecoder *out_decoder, void *user_data) {
+    (void)user_data;
+    DcSource *dc = &dc_sources[dc_source_count++ % 8];
+    memset(dc, 0, sizeof(*dc));
+    if (strstr(path, "music") != NULL) {
+        dc->level = 0.5f;
+        dc->channels = 1;
+        dc->length = 2400;
+    } else if (strstr(path, "blip") != NULL) {
+        dc->level = 0.25f;
+        dc->channels = 2;
+        dc->length = 480;
+    } else if (strstr(path, "voice") != NULL) {
+        dc->level = 0.1f;
+        dc->channels = 2;
+        dc->length = 9600;
+    } else {
+        return 1;
+    }
+    out_decoder->state = dc;
+    out_decoder->channels = dc->channels;
+    out_decoder->sample_rate = dc->channels == 1 ? 24000 : 48000;
+    out_decoder->read = dc_read;
+    out_decoder->seek = dc_seek;
+    out_decoder->close = NULL;
+    return 0;
+}
+
+typedef struct UiPatchLog {
+    size_t count[3];
+    char order[16][FURRY_MAX_NAME];
+    size_t total;
+} UiPatchLog;
+
+static int log_ui_patch(const FurryUiPatch *patch, void *user_data) {
+    UiPatchLog *log = user_data;
+    log->count[patch->type]++;
+    if (log->total < 16) {
+        snprintf(log->order[log->total], sizeof(log->order[0]), "%c:%s", "cur"[patch->type], patch->id);
+    }
+    log->total++;
+    return 0;
+}
+
+/* Patches go to the embedded UiPatchLog; each bind sync is recorded as "layer/id=value " entries. */
+typedef struct BindLog {
+    UiPatchLog patches;
+    size_t calls;
+    size_t updates;
+    char text[8][128];
+} BindLog;
+
+static int log_bind_update(const FurryBindUpdate *updates, size_t count, void *user_data) {
+    BindLog *log = user_data;
+    if (log->calls < 8) {
+        char *out = log->text[log->calls];
+        for (size_t u = 0; u < count; ++u) {
+            size_t used = strlen(out);
+            snprintf(out + used, sizeof(log->text[0]) - used, "%s/%s=%s ", updates[u].layer, updates[u].id, updates[u].value);
+        }
+    }
+    log->calls++;
+    log->updates += count;
+    return 0;
+}
+
+typedef struct WakeSignal {
+    mtx_t lock;
+    cnd_t ready;
+    int pending;
+    int wakes;
+} WakeSignal;
+
+static void wake_signal(void *user_data) {
+    WakeSignal *signal = user_data;
+    mtx_lock(&signal->lock);
+    signal->pending = 1;
+    signal->wakes++;
+    cnd_signal(&signal->ready);
+    mtx_unlock(&signal->lock);
+}
+
+typedef struct CountingAllocator {
+    size_t live_bytes;
+    size_t calls;
+} CountingAllocator;
+
+static void *counting_alloc(void *ptr, size_t old_size, size_t new_size, FurryMemTag tag, void *user_data) {
+    (void)tag;
+    CountingAllocator *counter = user_data;
+    counter->calls++;
+    counter->live_bytes += new_size;
+    counter->live_bytes -= ptr != NULL ? old_size : 0;
+    if (new_size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    return realloc(ptr, new_size);
+}
+
+/* Fails the countdown-th new allocation; heap-compatible with the default allocator. */
+static void *failing_alloc(void *ptr, size_t old_size, size_t new_size, FurryMemTag tag, void *user_data) {
+    (void)old_size;
+    (void)tag;
+    int *countdown = user_data;
+    if (new_size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    if (ptr == NULL && --*countdown == 0) {
+        return NULL;
+    }
+    return realloc(ptr, new_size);
+}
+
+/* Texture id is the first letter of the asset; every asset is a 64x128 atlas cell. */
+static int resolve_letter_texture(const char *asset, FurryBatchTexture *out_texture, void *user_data) {
+    (void)user_data;
+    out_texture->texture = (unsigned)(asset[0] - 'a');
+    out_texture->uv[0] = 0.0f;
+    out_texture->uv[1] = 0.0f;
+    out_texture->uv[2] = 0.25f;
+    out_texture->uv[3] = 0.5f;
+    out_texture->width = 64.0f;
+    out_texture->height = 128.0f;
+    return 0;
+}
+
+/* Bitwise CRC-32 (IEEE), for patching pack headers in the corruption tests. */
+static uint32_t test_crc32(const unsigned char *data, size_t size) {
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static int open_pack_bytes(const unsigned char *bytes, size_t size) {
+    FILE *file = fopen("test_corrupt.fpk", "wb");
+    assert(file != NULL && fwrite(bytes, 1, size, file) == size && fclose(file) == 0);
+    FurryPack *pack = NULL;
+    int rc = furry_pack_open("test_corrupt.fpk", &pack);
+    furry_pack_close(pack);
+    remove("test_corrupt.fpk");
+    return rc;
+}
+
+static int near(float value, float expected) {
+    return value > expected - 0.002f && value < expected + 0.002f;
+}
+
 int main(void) {
     assert(strcmp(furry_version(), "0.4.0") == 0);
     assert(strcmp(furry_audio_backend_name(), "miniaudio") == 0 || strcmp(furry_audio_backend_name(), "none") == 0);
@@ -110,6 +491,1373 @@ int main(void) {
     assert(furry_compile_script_ex("start:\ngoto missing\nend\n", &program, &compile_error) != 0);
     assert(strstr(compile_error.message, "unknown label target") != NULL);
 
+    const char *expr_script =
+        "start:\n"
+        "set route=tech\n"
+        "set affinity := 4 * (2 + 1) - 2\n"
+        "set label := route\n"
+        "if affinity >= 10 && route == \"tech\"|fast\n"
+        "set result=slow\n"
+        "goto done\n"
+        "fast:\n"
+        "set result=fast\n"
+        "if missing == 0 || 1 / missing|done\n"
+        "set result=no_short_circuit\n"
+        "done:\n"
+        "set neg := -affinity % 3 != 0\n"
+        "save out\n"
+        "end\n";
+    assert(furry_compile_script(expr_script, &program) == 0);
+    FurryRuntimeSnapshot expr_snap;
+    memset(&expr_snap, 0, sizeof(expr_snap));
+    FurryRuntimeConfig expr_config = {.max_steps = 100, .save_slot = capture_save, .user_data = &expr_snap};
+    assert(furry_run_program(&program, &expr_config) == 0);
+    furry_free_program(&program);
+    assert(strcmp(snapshot_var(&expr_snap, "affinity"), "10") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "label"), "tech") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "result"), "fast") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "neg"), "1") == 0);
+
+    /* 64-bit edges wrap instead of trapping: LLONG_MIN / -1, % -1, and overflowing + - * and negation. */
+    const char *wrap_script =
+        "start:\n"
+        "set min=-9223372036854775808\n"
+        "set max=9223372036854775807\n"
+        "set div := min / -1\n"
+        "set mod := min % -1\n"
+        "set sum := max + 1\n"
+        "set diff := min - 1\n"
+        "set prod := max * 2\n"
+        "set neg := -min\n"
+        "save out\n"
+        "end\n";
+    assert(furry_compile_script(wrap_script, &program) == 0);
+    memset(&expr_snap, 0, sizeof(expr_snap));
+    assert(furry_run_program(&program, &expr_config) == 0);
+    furry_free_program(&program);
+    assert(strcmp(snapshot_var(&expr_snap, "div"), "-9223372036854775808") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "mod"), "0") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "sum"), "-9223372036854775808") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "diff"), "9223372036854775807") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "prod"), "-2") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "neg"), "-9223372036854775808") == 0);
+
+    /* FURRY_MAX_VARS limits the variables a run holds, not the names a script may mention. */
+    static char many_vars[8192];
+    size_t many_len = (size_t)snprintf(many_vars, sizeof(many_vars), "start:\ngoto live\n");
+    for (int v = 0; v < 200; ++v) {
+        many_len += (size_t)snprintf(many_vars + many_len, sizeof(many_vars) - many_len, "set v%d=1\n", v);
+    }
+    snprintf(many_vars + many_len, sizeof(many_vars) - many_len, "live:\nset v199=last\nset total := 40 + 2\nsave out\nend\n");
+    assert(furry_compile_script(many_vars, &program) == 0);
+    assert(program.var_name_count == 201);
+    memset(&expr_snap, 0, sizeof(expr_snap));
+    assert(furry_run_program(&program, &expr_config) == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "v199"), "last") == 0 && strcmp(snapshot_var(&expr_snap, "total"), "42") == 0);
+    furry_free_program(&program);
+    memcpy(strstr(many_vars, "goto live"), "#oto live", 9);
+    assert(furry_compile_script(many_vars, &program) == 0);
+    assert(furry_run_program(&program, &expr_config) != 0);
+    furry_free_program(&program);
+
+    assert(furry_compile_script_ex("start:\nif (a > 1|start\nend\n", &program, &compile_error) != 0);
+    assert(strstr(compile_error.message, "expected ')'") != NULL);
+    assert(furry_compile_script_ex("start:\nset big := 3000000000\nend\n", &program, &compile_error) != 0);
+    assert(strstr(compile_error.message, "integer literal out of range") != NULL);
+    assert(furry_compile_script_ex("start:\nset big := 2147483648\nend\n", &program, &compile_error) != 0);
+    assert(furry_compile_script("start:\nset big := 2147483647\nend\n", &program) == 0);
+    furry_free_program(&program);
+    assert(furry_compile_script_ex("start:\nif a >= 1|nowhere\nend\n", &program, &compile_error) != 0);
+    assert(strstr(compile_error.message, "unknown label target") != NULL);
+
+    FurryProgramBuilder *builder = NULL;
+    assert(furry_builder_create(&builder) == 0);
+    FurryBuilderOption routes[2] = {{"Tech | fast -> lane", "tech"}, {"Social", "social"}};
+    assert(furry_emit_label(builder, "start") == 0);
+    assert(furry_emit_set_expr(builder, "affinity", "4 * 2 + 2") == 0);
+    assert(furry_emit_ui_begin(builder, "hud") == 0);
+    assert(furry_emit_ui_panel(builder, "root", 0, 0.25, 1, 0.5) == 0);
+    assert(furry_emit_ui_text(builder, "title", "A|B: C") == 0);
+    assert(furry_emit_ui_end(builder) == 0);
+    assert(furry_emit_choice(builder, "Route?", routes, 2) == 0);
+    assert(furry_emit_label(builder, "tech") == 0);
+    assert(furry_emit_set(builder, "label", "a|b") == 0);
+    assert(furry_emit_if(builder, "affinity >= 10", "done") == 0);
+    assert(furry_emit_set(builder, "result", "slow") == 0);
+    assert(furry_emit_label(builder, "done") == 0);
+    assert(furry_emit_save(builder, "snap") == 0);
+    assert(furry_emit_end(builder) == 0);
+    assert(furry_emit_label(builder, "social") == 0);
+    assert(furry_emit_end(builder) == 0);
+    assert(furry_builder_finish(builder, &program, &compile_error) == 0);
+    assert(program.count == 16 && strcmp(program.code[3].c, "0.25") == 0 && strcmp(program.code[3].choices[0].target, "0.5") == 0);
+    assert(strcmp(program.code[4].b, "A|B: C") == 0 && strcmp(program.code[6].choices[0].text, "Tech | fast -> lane") == 0);
+    memset(&expr_snap, 0, sizeof(expr_snap));
+    FurryRuntimeConfig builder_config = {.max_steps = 100, .choose_option = pick_first, .save_slot = capture_save, .user_data = &expr_snap};
+    assert(furry_run_program(&program, &builder_config) == 0);
+    furry_free_program(&program);
+    assert(strcmp(snapshot_var(&expr_snap, "affinity"), "10") == 0 && strcmp(snapshot_var(&expr_snap, "label"), "a|b") == 0);
+    assert(strcmp(snapshot_var(&expr_snap, "result"), "") == 0);
+
+    assert(furry_emit_label(builder, "start") == 0);
+    assert(furry_emit_ui_image(builder, "logo", "logo.bmp") != 0);
+    assert(furry_emit_end(builder) != 0);
+    assert(furry_builder_error(builder) != NULL);
+    assert(furry_builder_finish(builder, &program, &compile_error) != 0);
+    assert(compile_error.line == 2 && strstr(compile_error.message, "media") != NULL);
+    assert(furry_builder_error(builder) == NULL);
+    assert(furry_emit_goto(builder, "nowhere") == 0);
+    assert(furry_builder_finish(builder, &program, &compile_error) != 0);
+    assert(strstr(compile_error.message, "unknown label target") != NULL);
+    furry_builder_destroy(builder);
+
+    /* A cache too small for any entry evicts everything, which also clears leftovers from earlier runs. */
+    const char *purge_script = "start:\nset purge=1\nend\n";
+    FurryCompileCache *cache = NULL;
+    FurryCompileCacheStats cache_stats;
+    FurryCompileCacheConfig tiny_cache = {.max_bytes = 1};
+    assert(furry_compile_cache_open("test_cache", &tiny_cache, &cache) == 0);
+    assert(furry_compile_cached(cache, purge_script, &program, &compile_error) == 0);
+    furry_free_program(&program);
+    furry_compile_cache_stats(cache, &cache_stats);
+    assert(cache_stats.misses == 1 && cache_stats.stores == 1 && cache_stats.evictions >= 1);
+    furry_compile_cache_close(cache);
+
+    assert(furry_compile_cache_open("test_cache", NULL, &cache) == 0);
+    FurryProgram fresh_program;
+    assert(furry_compile_script_ex(expr_script, &fresh_program, &compile_error) == 0);
+    assert(furry_compile_cached(cache, expr_script, &program, &compile_error) == 0);
+    furry_free_program(&program);
+    assert(furry_compile_cached(cache, expr_script, &program, &compile_error) == 0);
+    FurryProgram failed_program;
+    assert(furry_compile_cached(cache, "start:\nif (a > 1|start\nend\n", &failed_program, &compile_error) != 0);
+    furry_compile_cache_stats(cache, &cache_stats);
+    assert(cache_stats.hits == 1 && cache_stats.misses == 2 && cache_stats.stores == 1 && cache_stats.evictions == 0);
+    assert(program.count == fresh_program.count && program.expr_count == fresh_program.expr_count);
+    assert(program.var_name_count == fresh_program.var_name_count && program.expr_strings_size == fresh_program.expr_strings_size);
+    for (size_t i = 0; i < program.count; ++i) {
+        const FurryInstruction *hit = &program.code[i];
+        const FurryInstruction *ref = &fresh_program.code[i];
+        assert(hit->op == ref->op && hit->i == ref->i && hit->target == ref->target && hit->slot == ref->slot);
+        assert(hit->name_id == ref->name_id && hit->text_id == ref->text_id && hit->choice_count == ref->choice_count);
+        assert(strcmp(hit->a, ref->a) == 0 && strcmp(hit->b, ref->b) == 0 && strcmp(hit->c, ref->c) == 0);
+        for (size_t c = 0; c < hit->choice_count; ++c) {
+            assert(strcmp(hit->choices[c].text, ref->choices[c].text) == 0 && strcmp(hit->choices[c].target, ref->choices[c].target) == 0);
+        }
+    }
+    for (size_t i = 0; i < program.expr_count; ++i) {
+        assert(program.expr_code[i].op == fresh_program.expr_code[i].op && program.expr_code[i].arg == fresh_program.expr_code[i].arg);
+    }
+    assert(memcmp(program.expr_strings, fresh_program.expr_strings, program.expr_strings_size) == 0);
+    furry_free_program(&fresh_program);
+    memset(&expr_snap, 0, sizeof(expr_snap));
+    assert(furry_run_program(&program, &expr_config) == 0);
+    furry_free_program(&program);
+    assert(strcmp(snapshot_var(&expr_snap, "affinity"), "10") == 0 && strcmp(snapshot_var(&expr_snap, "result"), "fast") == 0);
+    furry_compile_cache_close(cache);
+
+    assert(furry_compile_cache_open("test_cache", &tiny_cache, &cache) == 0);
+    assert(furry_compile_cached(cache, purge_script, &program, &compile_error) == 0);
+    furry_free_program(&program);
+    furry_compile_cache_stats(cache, &cache_stats);
+    assert(cache_stats.evictions == 2);
+    furry_compile_cache_close(cache);
+    assert(remove("test_cache") == 0);
+
+    FurryLazyProgram *lazy = NULL;
+    FurryLazyStats lazy_stats;
+    assert(furry_compile_script_ex(expr_script, &fresh_program, &compile_error) == 0);
+    for (int background = 0; background <= 1; ++background) {
+        FurryLazyConfig lazy_config = {.background = background};
+        assert(furry_lazy_open(expr_script, &lazy_config, &lazy, &compile_error) == 0);
+        const FurryProgram *lazy_program = furry_lazy_program(lazy);
+        furry_lazy_stats(lazy, &lazy_stats);
+        assert(lazy_program->count == fresh_program.count && lazy_stats.blocks == 3);
+        if (!background) {
+            assert(lazy_stats.installed_blocks == 1 && lazy_stats.background_blocks == 0);
+            assert(lazy_program->code[7].op == FURRY_OP_LABEL && strcmp(lazy_program->code[7].a, "fast") == 0);
+            assert(lazy_program->code[8].a[0] == '\0');
+            memset(&expr_snap, 0, sizeof(expr_snap));
+            expr_config.lazy = lazy;
+            assert(furry_run_program(lazy_program, &expr_config) == 0);
+            expr_config.lazy = NULL;
+            assert(strcmp(snapshot_var(&expr_snap, "result"), "fast") == 0 && strcmp(snapshot_var(&expr_snap, "neg"), "1") == 0);
+        }
+        assert(furry_lazy_finish(lazy, &compile_error) == 0);
+        furry_lazy_stats(lazy, &lazy_stats);
+        assert(lazy_stats.installed_blocks == 3);
+        for (size_t i = 0; i < fresh_program.count; ++i) {
+            const FurryInstruction *got = &lazy_program->code[i];
+            const FurryInstruction *ref = &fresh_program.code[i];
+            assert(got->op == ref->op && got->target == ref->target && got->text_id == ref->text_id && strcmp(got->a, ref->a) == 0);
+        }
+        furry_lazy_close(lazy);
+    }
+    furry_free_program(&fresh_program);
+    const char *lazy_bad = "start:\nsay A|ok\nend\n\n# later\nlater:\nsay B|fine\nbogus line\nend\nother:\ngoto nowhere\n";
+    FurryCompileError eager_error;
+    assert(furry_compile_script_ex(lazy_bad, &program, &eager_error) != 0);
+    assert(furry_lazy_open(lazy_bad, NULL, &lazy, &compile_error) == 0);
+    FurryRuntimeConfig lazy_run = {.max_steps = 10, .lazy = lazy};
+    assert(furry_run_program(furry_lazy_program(lazy), &lazy_run) == 0);
+    assert(furry_lazy_finish(lazy, &compile_error) != 0);
+    assert(compile_error.line == eager_error.line && strcmp(compile_error.message, eager_error.message) == 0);
+    assert(furry_lazy_ensure(lazy, 8, &compile_error) != 0 && strstr(compile_error.message, "unknown label target") != NULL);
+    furry_lazy_close(lazy);
+
+    const char *locale_script =
+        "start:\n"
+        "ui_begin hud\n"
+        "ui_text title|Hello\n"
+        "ui_end\n"
+        "say Guide|Welcome\n"
+        "choice Where?|Left->done|Right->done\n"
+        "done:\n"
+        "end\n";
+    assert(furry_compile_script(locale_script, &program) == 0);
+    assert(program.code[5].op == FURRY_OP_CHOICE && program.code[5].choices[1].target_index == 6);
+    assert(furry_locale_export_template(&program, "test_locale_en.txt") == 0);
+    write_translation("test_locale_en.txt", "test_locale_de.txt", "Hello", "Hallo");
+    write_translation("test_locale_en.txt", "test_locale_fr.txt", "Left", "Gauche");
+    assert(furry_locale_build_table("test_locale_de.txt", "test_locale_de.fyl") == 0);
+    assert(furry_locale_build_table("test_locale_fr.txt", "test_locale_fr.fyl") == 0);
+
+    FurryLocale *locale = NULL;
+    assert(furry_locale_open("test_locale_de.fyl", &locale) == 0);
+    assert(furry_locale_string_count(locale) == 1);
+    assert(furry_locale_report_missing(locale, &program, NULL) == 5);
+    LocaleCapture capture;
+    memset(&capture, 0, sizeof(capture));
+    FurryRuntimeConfig locale_config = {
+        .max_steps = 100, .choose_option = capture_choice, .on_host_command = capture_ui_text, .user_data = &capture, .locale = locale};
+    assert(furry_run_program(&program, &locale_config) == 0);
+    assert(strcmp(capture.ui_text, "Hallo") == 0);
+    assert(strcmp(capture.choice, "Left") == 0);
+
+    assert(furry_locale_switch(locale, "test_locale_fr.fyl") == 0);
+    assert(furry_run_program(&program, &locale_config) == 0);
+    assert(strcmp(capture.ui_text, "Hello") == 0);
+    assert(strcmp(capture.choice, "Gauche") == 0);
+    assert(furry_locale_switch(locale, "missing_table.fyl") != 0);
+    FurryRuntimeConfig switch_config = {.max_steps = 100, .choose_option = switch_mid_choice, .user_data = locale, .locale = locale};
+    assert(furry_run_program(&program, &switch_config) == 0);
+    assert(furry_locale_switch(locale, "test_locale_fr.fyl") == 0);
+    assert(furry_locale_lookup(locale, furry_locale_string_id("Left")) != NULL);
+    furry_locale_close(locale);
+    furry_free_program(&program);
+    remove("test_locale_en.txt");
+    remove("test_locale_de.txt");
+    remove("test_locale_fr.txt");
+    remove("test_locale_de.fyl");
+    remove("test_locale_fr.fyl");
+
+    assert(furry_locale_string_id("line 69888") == furry_locale_string_id("line 571866"));
+    assert(furry_compile_script_ex("say A|line 69888\nsay B|line 571866\nend\n", &program, &compile_error) != 0);
+    assert(compile_error.line == 2 && strstr(compile_error.message, "lines 1 and 2") != NULL);
+
+    remove_save_store_files("test_saves.log");
+    FurrySaveStore *store = NULL;
+    FurrySaveStoreConfig store_config = {.compact_min_bytes = 512};
+    assert(furry_save_store_open("test_saves.log", &store_config, &store) == 0);
+    FurryRuntimeSnapshot slot_snap;
+    memset(&slot_snap, 0, sizeof(slot_snap));
+    slot_snap.ip = 3;
+    slot_snap.callstack_depth = 1;
+    slot_snap.callstack[0] = 9;
+    slot_snap.var_count = 1;
+    strcpy(slot_snap.vars[0].key, "route");
+    for (int i = 0; i < 40; ++i) {
+        snprintf(slot_snap.vars[0].value, sizeof(slot_snap.vars[0].value), "v%d", i);
+        assert(furry_save_store_put(store, "auto", &slot_snap) == 0);
+        assert(furry_save_store_put(store, i % 2 == 0 ? "even" : "odd", &slot_snap) == 0);
+        if (i % 4 == 0) {
+            assert(furry_save_store_flush(store) == 0);
+        }
+    }
+    FurryRuntimeSnapshot loaded_snap;
+    assert(furry_save_store_get(store, "auto", &loaded_snap) == 0);
+    assert(strcmp(loaded_snap.vars[0].value, "v39") == 0);
+    assert(furry_save_store_flush(store) == 0);
+    assert(furry_save_store_get(store, "even", &loaded_snap) == 0);
+    assert(strcmp(loaded_snap.vars[0].value, "v38") == 0 && loaded_snap.ip == 3 && loaded_snap.callstack[0] == 9);
+    assert(furry_save_store_get(store, "missing", &loaded_snap) != 0);
+    FurrySaveSlotInfo slots[8];
+    assert(furry_save_store_list(store, slots, 8) == 3);
+    FurrySaveStoreStats store_stats;
+    furry_save_store_stats(store, &store_stats);
+    assert(store_stats.compactions >= 1);
+    assert(store_stats.fsyncs == store_stats.batches && store_stats.batches < 80);
+    furry_save_store_close(store);
+
+    FILE *torn = fopen("test_saves.log", "ab");
+    assert(torn != NULL);
+    fwrite("FSVRgarbage", 1, 11, torn);
+    fclose(torn);
+    assert(furry_save_store_open("test_saves.log", &store_config, &store) == 0);
+    assert(furry_save_store_get(store, "odd", &loaded_snap) == 0);
+    assert(strcmp(loaded_snap.vars[0].value, "v39") == 0);
+
+    const char *store_script =
+        "start:\n"
+        "choice Mode|Save->do_save|Load->do_load\n"
+        "do_save:\n"
+        "set x=7\n"
+        "save vm_slot\n"
+        "bg resumed\n"
+        "end\n"
+        "do_load:\n"
+        "load vm_slot\n"
+        "end\n";
+    assert(furry_compile_script(store_script, &program) == 0);
+    SaveStoreRun store_run = {0};
+    FurryRuntimeConfig store_vm_config = {
+        .max_steps = 100, .choose_option = pick_from_run, .on_host_command = record_x_at_bg, .user_data = &store_run, .save_store = store};
+    assert(furry_run_program(&program, &store_vm_config) == 0);
+    assert(strcmp(store_run.x_at_bg, "7") == 0);
+    store_run.pick = 1;
+    store_run.x_at_bg[0] = '\0';
+    assert(furry_run_program(&program, &store_vm_config) == 0);
+    assert(strcmp(store_run.x_at_bg, "7") == 0);
+
+    FurryReplay *replay = NULL;
+    FurryRuntimeConfig record_config;
+    store_run.x_at_bg[0] = '\0';
+    assert(furry_replay_record_begin(&program, &store_vm_config, &replay, &record_config) == 0);
+    furry_replay_record_end(replay, furry_run_program(&program, &record_config));
+    assert(strcmp(store_run.x_at_bg, "7") == 0);
+    assert(furry_replay_save(replay, "test_replay.fyr") == 0);
+    furry_replay_destroy(replay);
+    assert(furry_replay_load("test_replay.fyr", &replay) == 0);
+    FurryReplayStats replay_stats;
+    furry_replay_stats(replay, &replay_stats);
+    assert(replay_stats.steps == 3 && replay_stats.choices == 1 && replay_stats.loads == 1 && replay_stats.result == 0);
+    assert(furry_replay_run(&program, replay) == 0);
+    furry_free_program(&program);
+    assert(furry_compile_script(store_script, &program) == 0);
+    assert(furry_replay_run(&program, replay) == 0);
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nchoice Mode|Save->do_load|Load->do_load\ndo_load:\nload vm_slot\nend\n", &program) == 0);
+    assert(furry_replay_run(&program, replay) != 0);
+    furry_replay_destroy(replay);
+    remove("test_replay.fyr");
+
+    const char *scene_script =
+        "start:\n"
+        "choice Mode|Play->play|Resume->resume\n"
+        "play:\n"
+        "bg room.png\n"
+        "fg hero.png|0.25|1|0|idle\n"
+        "fg cat.png|0.75|1|0|none\n"
+        "fg hero.png|0.5|1|15|walk\n"
+        "music theme.ogg\n"
+        "ui_begin hud\n"
+        "ui_text title|Chapter 1\n"
+        "ui_end\n"
+        "save scene_slot\n"
+        "end\n"
+        "resume:\n"
+        "load scene_slot\n"
+        "end\n";
+    furry_free_program(&program);
+    assert(furry_compile_script(scene_script, &program) == 0);
+    SceneLog scene_log;
+    memset(&scene_log, 0, sizeof(scene_log));
+    FurryRuntimeConfig scene_config = {
+        .max_steps = 100, .choose_option = pick_scene_mode, .on_host_command = log_scene_host, .user_data = &scene_log, .save_store = store};
+    assert(furry_run_program(&program, &scene_config) == 0);
+    scene_log.pick = 1;
+    scene_log.text[0] = '\0';
+    assert(furry_run_program(&program, &scene_config) == 0);
+    assert(strcmp(scene_log.text, "bg room.png;fg hero.png@0.5,1,15,walk;fg cat.png@0.75,1,0,none;music theme.ogg;text Chapter 1;") == 0);
+    scene_log.text[0] = '\0';
+    scene_config.on_scene_restore = capture_scene;
+    assert(furry_run_program(&program, &scene_config) == 0);
+    assert(strcmp(scene_log.text, "text Chapter 1;") == 0 && scene_log.restores == 1);
+    assert(strcmp(scene_log.scene.bg, "room.png") == 0 && strcmp(scene_log.scene.music, "theme.ogg") == 0);
+    assert(scene_log.scene.sprite_count == 2 && strcmp(scene_log.scene.sprites[0].asset, "hero.png") == 0);
+    assert(scene_log.scene.sprites[0].x == 0.5f && scene_log.scene.sprites[0].rotation == 15.0f);
+    assert(strcmp(scene_log.scene.sprites[0].animation, "walk") == 0);
+    assert(scene_log.scene.layer_count == 1 && strcmp(scene_log.scene.layers[0].name, "hud") == 0);
+    assert(furry_replay_record_begin(&program, &scene_config, &replay, &record_config) == 0);
+    furry_replay_record_end(replay, furry_run_program(&program, &record_config));
+    assert(scene_log.restores == 2);
+    assert(furry_replay_run(&program, replay) == 0);
+    furry_replay_destroy(replay);
+
+    const char *skip_script =
+        "start:\n"
+        "bg a.png\n"
+        "fg hero.png|0|1|0|idle\n"
+        "say N|one\n"
+        "ui_begin hud\n"
+        "ui_text title|Chapter 1\n"
+        "ui_end\n"
+        "bg b.png\n"
+        "fg cat.png|1|1|0|none\n"
+        "music theme.ogg\n"
+        "sfx click.wav\n"
+        "say N|two\n"
+        "choice Go|On->next\n"
+        "next:\n"
+        "say N|three\n"
+        "end\n";
+    furry_free_program(&program);
+    assert(furry_compile_script(skip_script, &program) == 0);
+    FurrySeenSet *seen = NULL;
+    FurrySeenSet *seen_loaded = NULL;
+    assert(furry_seen_create(&program, &seen) == 0 && furry_seen_count(seen) == 0);
+    memset(&scene_log, 0, sizeof(scene_log));
+    FurryRuntimeConfig skip_config = {.max_steps = 100,
+                                      .choose_option = pick_scene_mode,
+                                      .on_host_command = log_scene_host,
+                                      .on_say = count_scene_say,
+                                      .on_skip_stop = next_skip_mode,
+                                      .user_data = &scene_log,
+                                      .seen = seen};
+    assert(furry_run_program(&program, &skip_config) == 0 && scene_log.says == 3);
+    assert(strcmp(scene_log.text, "bg a.png;fg hero.png@0,1,0,idle;text Chapter 1;bg b.png;fg cat.png@1,1,0,none;music theme.ogg;") == 0);
+    assert(furry_seen_count(seen) == program.count - 1 && furry_seen_contains(seen, 0) && furry_seen_contains(seen, 3));
+    assert(furry_seen_save(seen, "test_seen.fys") == 0);
+    assert(furry_seen_create(&program, &seen_loaded) == 0 && furry_seen_load(seen_loaded, "test_seen.fys") == 0);
+    assert(furry_seen_count(seen_loaded) == furry_seen_count(seen));
+    furry_seen_destroy(seen);
+
+    /* Seen up to the choice: one coalesced scene, the layer re-run, no say. */
+    memset(&scene_log, 0, sizeof(scene_log));
+    skip_config.seen = seen_loaded;
+    skip_config.skip_mode = FURRY_SKIP_SEEN;
+    assert(furry_run_program(&program, &skip_config) == 0);
+    assert(strcmp(scene_log.text, "bg b.png;fg cat.png@1,1,0,none;music theme.ogg;text Chapter 1;") == 0);
+    assert(scene_log.stops == 1 && scene_log.last_stop == FURRY_SKIP_STOP_CHOICE && scene_log.says == 1);
+    memset(&scene_log, 0, sizeof(scene_log));
+    scene_log.next_mode = FURRY_SKIP_SEEN;
+    assert(furry_run_program(&program, &skip_config) == 0);
+    assert(scene_log.stops == 2 && scene_log.last_stop == FURRY_SKIP_STOP_END && scene_log.says == 0);
+    furry_seen_destroy(seen_loaded);
+
+    assert(furry_seen_create(&program, &seen) == 0);
+    memset(&scene_log, 0, sizeof(scene_log));
+    skip_config.seen = seen;
+    assert(furry_run_program(&program, &skip_config) == 0);
+    assert(scene_log.stops == 1 && scene_log.last_stop == FURRY_SKIP_STOP_UNSEEN && scene_log.says == 3);
+    assert(strncmp(scene_log.text, "bg a.png;fg hero.png@0,1,0,idle;text Chapter 1;", 47) == 0);
+    memset(&scene_log, 0, sizeof(scene_log));
+    skip_config.skip_mode = FURRY_SKIP_ALL;
+    skip_config.skip_budget = 3;
+    assert(furry_run_program(&program, &skip_config) == 0);
+    assert(scene_log.stops == 1 && scene_log.last_stop == FURRY_SKIP_STOP_BUDGET && scene_log.says == 3);
+    furry_seen_destroy(seen);
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nsay N|edited\nend\n", &program) == 0);
+    assert(furry_seen_create(&program, &seen) == 0);
+    assert(furry_seen_load(seen, "test_seen.fys") != 0 && furry_seen_count(seen) == 0);
+    furry_seen_destroy(seen);
+    remove("test_seen.fys");
+
+    /* Spawned contexts on the virtual clock: each wait jumps straight to the next wakeup, in spawn order. */
+    const char *context_script =
+        "start:\n"
+        "spawn a\n"
+        "spawn b\n"
+        "wait 250\n"
+        "bg main.png\n"
+        "end\n"
+        "a:\n"
+        "bg a0.png\n"
+        "wait 100\n"
+        "bg a1.png\n"
+        "wait 100\n"
+        "bg a2.png\n"
+        "end\n"
+        "b:\n"
+        "music b0.ogg\n"
+        "wait 150\n"
+        "music b1.ogg\n"
+        "wait_event never\n";
+    furry_free_program(&program);
+    assert(furry_compile_script(context_script, &program) == 0);
+    memset(&scene_log, 0, sizeof(scene_log));
+    FurryRuntimeConfig context_config = {.max_steps = 100, .on_host_command = log_scene_host, .user_data = &scene_log};
+    assert(furry_run_program(&program, &context_config) == 0);
+    assert(strcmp(scene_log.text, "bg a0.png;music b0.ogg;bg a1.png;music b1.ogg;bg a2.png;bg main.png;") == 0);
+
+    /* Shared variables, a context's own call stack, and a signal that wakes the main script. */
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nspawn counter\nwait_event done\nif_eq n|3|ok\nbg fail.png\nend\nok:\nbg ok.png\nend\n"
+                                "counter:\ncall bump\ncall bump\ncall bump\nsignal done\nreturn\nbump:\nadd n=1\nreturn\n",
+                                &program) == 0);
+    memset(&scene_log, 0, sizeof(scene_log));
+    assert(furry_run_program(&program, &context_config) == 0 && strcmp(scene_log.text, "bg ok.png;") == 0);
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nspawn idle\nwait_event nobody\nend\nidle:\nwait_event never\n", &program) == 0);
+    assert(furry_run_program(&program, &context_config) != 0);
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nspawn chat\nwait 0\nend\nchat:\nsay A|not here\nend\n", &program) == 0);
+    assert(furry_run_program(&program, &context_config) != 0);
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nwait -5\nend\n", &program) != 0);
+
+    /* A context that never waits is cut off at its budget: two passes of add + goto. */
+    assert(furry_compile_script("start:\nspawn spin\nwait 0\nif_eq k|2|ok\nend\nok:\nbg ok.png\nend\nspin:\nadd k=1\ngoto spin\n", &program) == 0);
+    memset(&scene_log, 0, sizeof(scene_log));
+    context_config.context_budget = 4;
+    assert(furry_run_program(&program, &context_config) == 0 && strcmp(scene_log.text, "bg ok.png;") == 0);
+    context_config.context_budget = 0;
+    /* Not even a ui block keeps a turn going past max_steps. */
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nspawn bgl\nwait 10\nsay A|done\nend\nbgl:\nui_begin hud\nspin:\nset x=1\ngoto spin\nui_end\nend\n",
+                                &program) == 0);
+    FurryRuntimeConfig spin_config = {.max_steps = 1000};
+    assert(furry_run_program(&program, &spin_config) != 0);
+
+    /* Hundreds of contexts; one more than max_contexts fails the run. */
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nloop:\nspawn crowd\nadd i=1\nif i < 300|loop\nwait 10\nif_eq total|600|ok\nend\nok:\nbg ok.png\nend\n"
+                                "crowd:\nadd total=1\nwait 5\nadd total=1\nend\n",
+                                &program) == 0);
+    memset(&scene_log, 0, sizeof(scene_log));
+    context_config.max_steps = 5000;
+    assert(furry_run_program(&program, &context_config) != 0);
+    context_config.max_contexts = 300;
+    assert(furry_run_program(&program, &context_config) == 0 && strcmp(scene_log.text, "bg ok.png;") == 0);
+
+    /* While a say waits for the player, the host runs the due contexts on its own clock. */
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nspawn ambient\nsay A|hi\nend\nambient:\nbg pumped.png\nwait 1000\ngoto ambient\n", &program) == 0);
+    PumpState pump;
+    memset(&pump, 0, sizeof(pump));
+    FurryRuntimeConfig pump_config = {.max_steps = 100,
+                                      .on_host_command = log_scene_host,
+                                      .on_say = pump_on_say,
+                                      .clock_ms = pump_clock,
+                                      .user_data = &pump};
+    assert(furry_run_program(&program, &pump_config) == 0);
+    assert(strcmp(pump.log.text, "bg pumped.png;bg pumped.png;") == 0 && pump.waits[0] == 1000 && pump.waits[1] == 1000);
+    long long no_wait = 0;
+    assert(furry_run_background(&no_wait) != 0 && no_wait == -1);
+
+    /* The threaded runtime runs them on the real clock while it waits for an advance. */
+    FurryWorker *ambient_worker = NULL;
+    FurryWorkerConfig ambient_worker_config = {.wait_on_say = 1};
+    FurryRuntimeConfig ambient_runtime = {.max_steps = 100};
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nspawn ambient\nsay A|hi\nend\nambient:\nbg tick.png\nwait 2\ngoto ambient\n", &program) == 0);
+    assert(furry_worker_start(&program, &ambient_runtime, &ambient_worker_config, &ambient_worker) == 0);
+    FurryHostCommand ambient_cmd;
+    int ambient_ticks = 0;
+    int ambient_ended = 0;
+    while (!ambient_ended) {
+        if (furry_worker_poll(ambient_worker, &ambient_cmd, 1) == 0) {
+            thrd_yield();
+            continue;
+        }
+        if (ambient_cmd.op == FURRY_OP_BG && ++ambient_ticks == 3) {
+            FurryWorkerInput advance = {.type = FURRY_INPUT_ADVANCE};
+            assert(furry_worker_send(ambient_worker, &advance) == 0);
+        }
+        ambient_ended = ambient_cmd.op == FURRY_OP_END;
+    }
+    assert(furry_worker_join(ambient_worker) == 0 && ambient_ticks >= 3);
+
+    FurryProgramBuilder *context_builder = NULL;
+    assert(furry_builder_create(&context_builder) == 0);
+    assert(furry_emit_label(context_builder, "start") == 0 && furry_emit_spawn(context_builder, "helper") == 0);
+    assert(furry_emit_wait_event(context_builder, "ready") == 0 && furry_emit_end(context_builder) == 0);
+    assert(furry_emit_label(context_builder, "helper") == 0 && furry_emit_wait(context_builder, 20) == 0);
+    assert(furry_emit_signal(context_builder, "ready") == 0 && furry_emit_end(context_builder) == 0);
+    furry_free_program(&program);
+    assert(furry_builder_finish(context_builder, &program, NULL) == 0);
+    assert(furry_run_program(&program, &context_config) == 0);
+    assert(furry_emit_wait(context_builder, -1) != 0);
+    furry_builder_destroy(context_builder);
+
+    furry_free_program(&program);
+    furry_save_store_close(store);
+    remove_save_store_files("test_saves.log");
+
+    static unsigned char pack_raw[3000];
+    static unsigned char pack_text[8192];
+    static unsigned char pack_out[8192];
+    unsigned noise = 12345u;
+    for (size_t i = 0; i < sizeof(pack_raw); ++i) {
+        noise = noise * 1103515245u + 12345u;
+        pack_raw[i] = (unsigned char)(noise >> 16);
+    }
+    for (size_t i = 0; i < sizeof(pack_text); ++i) {
+        pack_text[i] = (unsigned char)("say Narrator|The night is long.\n"[i % 32] + (i % 997 == 0));
+    }
+    size_t lz_size = furry_lz_compress(pack_text, sizeof(pack_text), pack_out, sizeof(pack_out));
+    assert(lz_size > 0 && lz_size < sizeof(pack_text) / 4);
+    static unsigned char lz_round[8192];
+    assert(furry_lz_decompress(pack_out, lz_size, lz_round, sizeof(pack_text)) == 0);
+    assert(memcmp(lz_round, pack_text, sizeof(pack_text)) == 0);
+    assert(furry_lz_decompress(pack_out, lz_size, lz_round, sizeof(pack_text) - 1) != 0);
+    assert(furry_lz_decompress(pack_out, lz_size - 1, lz_round, sizeof(pack_text)) != 0);
+    lz_size = furry_lz_compress(pack_text, 3, pack_out, furry_lz_bound(3));
+    assert(lz_size == 4 && furry_lz_decompress(pack_out, lz_size, lz_round, 3) == 0 && memcmp(lz_round, pack_text, 3) == 0);
+
+    FurryPackWriter *pack_writer = NULL;
+    FurryPackWriterConfig pack_config = {.alignment = 64, .compress = 1};
+    assert(furry_pack_writer_create(&pack_config, &pack_writer) == 0);
+    assert(furry_pack_writer_add(pack_writer, "bg/city.png", pack_raw, sizeof(pack_raw)) == 0);
+    assert(furry_pack_writer_add(pack_writer, "./music\\theme.ogg", pack_text, sizeof(pack_text)) == 0);
+    assert(furry_pack_writer_add(pack_writer, "sfx/click.wav", "RIFF", 4) == 0);
+    assert(furry_pack_writer_finish(pack_writer, "test_assets.fpk") == 0);
+    assert(furry_pack_writer_add(pack_writer, "bg/city.png", "dup", 3) == 0);
+    assert(furry_pack_writer_finish(pack_writer, "test_assets_dup.fpk") != 0);
+    furry_pack_writer_destroy(pack_writer);
+    remove("test_assets_dup.fpk");
+
+    FurryPack *pack = NULL;
+    assert(furry_pack_open("test_assets.fpk", &pack) == 0);
+    assert(furry_pack_count(pack) == 3);
+    FurryPackEntry pack_entry;
+    assert(furry_pack_find(pack, "bg\\city.png", &pack_entry) == 0);
+    assert(!pack_entry.compressed && pack_entry.size == sizeof(pack_raw) && ((size_t)pack_entry.data & 63u) == 0);
+    assert(memcmp(pack_entry.data, pack_raw, sizeof(pack_raw)) == 0);
+    assert(furry_pack_find(pack, "music/theme.ogg", &pack_entry) == 0);
+    assert(pack_entry.compressed && pack_entry.data == NULL && pack_entry.stored_size < pack_entry.size);
+    assert(furry_pack_read(pack, &pack_entry, pack_out, sizeof(pack_out)) == 0);
+    assert(memcmp(pack_out, pack_text, sizeof(pack_text)) == 0);
+    assert(furry_pack_find(pack, "music/Theme.ogg", NULL) != 0);
+    assert(furry_compile_script("start:\nbg bg/city.png\nmusic music/theme.ogg\nsfx sfx/click.wav\nend\n", &program) == 0);
+    assert(furry_pack_check_program(pack, &program, &compile_error) == 0);
+    furry_free_program(&program);
+    assert(furry_compile_script("start:\nbg bg/city.png\nsfx sfx/missing.wav\nend\n", &program) == 0);
+    assert(furry_pack_check_program(pack, &program, &compile_error) != 0);
+    assert(compile_error.line == 3 && strstr(compile_error.message, "sfx/missing.wav") != NULL);
+    furry_free_program(&program);
+    furry_pack_close(pack);
+
+    /* Corrupt and truncated packs are rejected before anything is read past the mapping. */
+    static unsigned char pack_bytes[16384];
+    FILE *pack_file = fopen("test_assets.fpk", "rb");
+    assert(pack_file != NULL);
+    size_t pack_size = fread(pack_bytes, 1, sizeof(pack_bytes), pack_file);
+    fclose(pack_file);
+    assert(pack_size > 48 && pack_size < sizeof(pack_bytes) && open_pack_bytes(pack_bytes, pack_size) == 0);
+    assert(open_pack_bytes(pack_bytes, 100) != 0);
+    unsigned char bad_header[48];
+    memcpy(bad_header, pack_bytes, sizeof(bad_header));
+    uint32_t huge_count = 0x10000000u;
+    uint64_t huge_names = 48u + (uint64_t)huge_count * 48u;
+    uint64_t no_names = 0;
+    uint64_t header_end = sizeof(bad_header);
+    memcpy(bad_header + 8, &huge_count, sizeof(huge_count));
+    memcpy(bad_header + 16, &huge_names, sizeof(huge_names));
+    memcpy(bad_header + 24, &no_names, sizeof(no_names));
+    memcpy(bad_header + 32, &header_end, sizeof(header_end));
+    assert(open_pack_bytes(bad_header, sizeof(bad_header)) != 0);
+    /* An entry starting past the end, with a valid index checksum. */
+    uint64_t names_offset;
+    uint64_t names_size;
+    memcpy(&names_offset, pack_bytes + 16, sizeof(names_offset));
+    memcpy(&names_size, pack_bytes + 24, sizeof(names_size));
+    uint64_t past_end = (uint64_t)pack_size + 4096u;
+    memcpy(pack_bytes + 48 + 8, &past_end, sizeof(past_end));
+    uint32_t index_crc = test_crc32(pack_bytes + 48, (size_t)(names_offset + names_size - 48));
+    memcpy(pack_bytes + 40, &index_crc, sizeof(index_crc));
+    assert(open_pack_bytes(pack_bytes, pack_size) != 0);
+    remove("test_assets.fpk");
+
+    FurryAudioConfig audio_config;
+    furry_audio_default_config(&audio_config);
+    audio_config.offline = 1;
+    audio_config.max_sfx_voices = 2;
+    audio_config.crossfade_ms = 50;
+    audio_config.duck_release_ms = 5;
+    audio_config.open_decoder = open_dc;
+    FurryAudio *audio = NULL;
+    static float mix_out[4800 * 2];
+    assert(furry_audio_create(&audio_config, &audio) == 0);
+    assert(furry_audio_play_music(audio, "music_a", 1) == 0);
+    assert(furry_audio_render(audio, mix_out, 4800) == 4800);
+    assert(near(mix_out[0], 0.5f) && near(mix_out[4799 * 2 + 1], 0.5f));
+    assert(furry_audio_music_position(audio) == 4800);
+    assert(furry_audio_set_bus_volume(audio, FURRY_AUDIO_BUS_MUSIC, 0.5f, 0) == 0);
+    for (int i = 0; i < 3; ++i) {
+        assert(furry_audio_play_sfx(audio, "blip", FURRY_AUDIO_BUS_SFX, 1.0f) == 0);
+    }
+    assert(furry_audio_play_sfx(audio, "missing", FURRY_AUDIO_BUS_SFX, 1.0f) != 0);
+    furry_audio_render(audio, mix_out, 480);
+    assert(near(mix_out[0], 0.75f));
+    FurryAudioStats audio_stats;
+    furry_audio_stats(audio, &audio_stats);
+    assert(audio_stats.voices_stolen == 1 && audio_stats.underruns == 0 && audio_stats.active_streams == 1);
+    assert(furry_audio_play_sfx(audio, "voice", FURRY_AUDIO_BUS_VOICE, 1.0f) == 0);
+    furry_audio_render(audio, mix_out, 4800);
+    assert(near(mix_out[4799 * 2], 0.25f * audio_config.duck_level + 0.1f));
+    assert(furry_audio_play_music(audio, "music_b", 1) == 0);
+    furry_audio_render(audio, mix_out, 4800);
+    furry_audio_update(audio);
+    furry_audio_stats(audio, &audio_stats);
+    assert(audio_stats.active_streams == 1);
+    assert(furry_audio_stop_music(audio, 0) == 0);
+    furry_audio_render(audio, mix_out, 256);
+    furry_audio_update(audio);
+    furry_audio_stats(audio, &audio_stats);
+    assert(audio_stats.active_streams == 0 && audio_stats.frames_rendered == 4800 * 3 + 480 + 256);
+    assert(furry_audio_music_position(audio) == 0);
+    assert(furry_audio_play_music_at(audio, "music_a", 1, 1000) == 0);
+    furry_audio_render(audio, mix_out, 256);
+    assert(furry_audio_music_position(audio) == 1256);
+    assert(furry_audio_stop_music(audio, 0) == 0);
+    furry_audio_render(audio, mix_out, 256);
+    furry_audio_update(audio);
+
+    assert(furry_compile_script("start:\nmusic music_c\nsfx blip\nend\n", &program) == 0);
+    FurryRuntimeConfig audio_vm_config = {.max_steps = 10, .audio = audio};
+    assert(furry_run_program(&program, &audio_vm_config) == 0);
+    furry_audio_render(audio, mix_out, 256);
+    assert(near(mix_out[0], 0.5f * 0.5f + 0.25f));
+    furry_free_program(&program);
+    furry_audio_destroy(audio);
+
+    FILE *wav = fopen("test_audio.wav", "wb");
+    assert(wav != NULL);
+    const unsigned char wav_header[44] = {'R', 'I', 'F', 'F', 36 + 8, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0,
+                                          0x80, 0xbb, 0, 0, 0, 0x77, 1, 0, 2, 0, 16, 0, 'd', 'a', 't', 'a', 8, 0, 0, 0};
+    const unsigned char wav_samples[8] = {0x00, 0x40, 0x00, 0xc0, 0x00, 0x40, 0x00, 0xc0};
+    fwrite(wav_header, 1, sizeof(wav_header), wav);
+    fwrite(wav_samples, 1, sizeof(wav_samples), wav);
+    fclose(wav);
+    FurryAudioDecoder wav_decoder;
+    float wav_frames[8];
+    assert(furry_audio_open_wav("test_audio.wav", &wav_decoder, NULL) == 0);
+    assert(wav_decoder.channels == 1 && wav_decoder.sample_rate == 48000);
+    assert(wav_decoder.read(wav_decoder.state, wav_frames, 8) == 4);
+    assert(near(wav_frames[0], 0.5f) && near(wav_frames[1], -0.5f));
+    assert(wav_decoder.seek(wav_decoder.state, 3) == 0 && wav_decoder.read(wav_decoder.state, wav_frames, 8) == 1);
+    wav_decoder.close(wav_decoder.state);
+    remove("test_audio.wav");
+
+    const char *worker_script =
+        "start:\n"
+        "bg one\n"
+        "bg two\n"
+        "bg three\n"
+        "bg four\n"
+        "say Guide|Pick one\n"
+        "choice Route|Left->left|Right->right\n"
+        "left:\n"
+        "bg left_room\n"
+        "end\n"
+        "right:\n"
+        "fg guide.png|0.5|0.9|0|idle\n"
+        "end\n";
+    assert(furry_compile_script(worker_script, &program) == 0);
+    FurryWorkerConfig worker_config = {.command_capacity = 2, .wait_on_say = 1};
+    FurryRuntimeConfig worker_runtime = {.max_steps = 100};
+    FurryWorker *worker = NULL;
+    assert(furry_worker_start(&program, &worker_runtime, &worker_config, &worker) == 0);
+    FurryWorkerStats worker_stats;
+    do {
+        furry_worker_stats(worker, &worker_stats);
+    } while (worker_stats.producer_stalls == 0);
+    FurryOpCode worker_ops[16];
+    size_t worker_op_count = 0;
+    FurryHostCommand worker_cmd;
+    unsigned long long last_sequence = 0;
+    for (;;) {
+        if (furry_worker_poll(worker, &worker_cmd, 1) == 0) {
+            continue;
+        }
+        assert(worker_cmd.sequence == last_sequence + 1 && worker_op_count < 16);
+        last_sequence = worker_cmd.sequence;
+        worker_ops[worker_op_count++] = worker_cmd.op;
+        if (worker_cmd.op == FURRY_OP_SAY) {
+            assert(strcmp(worker_cmd.a, "Guide") == 0 && strcmp(worker_cmd.b, "Pick one") == 0);
+            FurryWorkerInput advance = {FURRY_INPUT_ADVANCE, 0};
+            assert(furry_worker_send(worker, &advance) == 0);
+        } else if (worker_cmd.op == FURRY_OP_CHOICE) {
+            assert(worker_cmd.choice_count == 2 && strcmp(worker_cmd.choices[1].text, "Right") == 0);
+            FurryWorkerInput pick = {FURRY_INPUT_CHOICE, 1};
+            assert(furry_worker_send(worker, &pick) == 0);
+        } else if (worker_cmd.op == FURRY_OP_END) {
+            assert(worker_cmd.i == 0);
+            break;
+        }
+    }
+    assert(worker_op_count == 8 && worker_ops[4] == FURRY_OP_SAY && worker_ops[6] == FURRY_OP_FG);
+    furry_worker_stats(worker, &worker_stats);
+    assert(worker_stats.commands_published == 8 && worker_stats.max_queue_depth <= 2);
+    assert(furry_worker_join(worker) == 0);
+
+    assert(furry_worker_start(&program, &worker_runtime, &worker_config, &worker) == 0);
+    assert(furry_worker_join(worker) != 0);
+
+    /* An event-driven frontend: sleep until the VM wakes us, answer through the router as a key press would. */
+    WakeSignal wake = {.pending = 0};
+    assert(mtx_init(&wake.lock, mtx_plain) == thrd_success && cnd_init(&wake.ready) == thrd_success);
+    FurryWorkerConfig wake_config = {.command_capacity = 2, .wait_on_say = 1, .wake = wake_signal, .wake_user_data = &wake};
+    FurryInputRouter router;
+    furry_router_reset(&router);
+    assert(furry_worker_start(&program, &worker_runtime, &wake_config, &worker) == 0);
+    int worker_ended = 0;
+    size_t routed = 0;
+    while (!worker_ended) {
+        mtx_lock(&wake.lock);
+        while (!wake.pending) {
+            cnd_wait(&wake.ready, &wake.lock);
+        }
+        wake.pending = 0;
+        mtx_unlock(&wake.lock);
+        while (furry_worker_poll(worker, &worker_cmd, 1) == 1) {
+            furry_router_command(&router, &worker_cmd);
+            worker_ended |= worker_cmd.op == FURRY_OP_END;
+            FurryPlatformEvent key = {.type = FURRY_EVENT_KEY, .key = router.waiting == FURRY_ROUTER_CHOICE ? '1' : FURRY_KEY_RETURN};
+            FurryWorkerInput routed_input;
+            if (furry_router_event(&router, &key, &routed_input)) {
+                assert(furry_worker_send(worker, &routed_input) == 0);
+                routed++;
+            }
+        }
+    }
+    assert(routed == 2 && wake.wakes >= 8 && furry_worker_join(worker) == 0);
+    cnd_destroy(&wake.ready);
+    mtx_destroy(&wake.lock);
+    furry_free_program(&program);
+
+    FurryPacer pacer;
+    furry_pacer_init(&pacer, 50.0);
+    assert(furry_pacer_timeout(&pacer, 1000, 0) == 0 && furry_pacer_due(&pacer, 1000, 0));
+    furry_pacer_frame_done(&pacer, 1000);
+    /* Still screen, nothing changed: block on events. */
+    assert(furry_pacer_timeout(&pacer, 2000, 0) == FURRY_PACER_FOREVER && !furry_pacer_due(&pacer, 2000, 0));
+    furry_pacer_input(&pacer, 3000);
+    assert(furry_pacer_timeout(&pacer, 4000, 0) == 20001000 - 4000);
+    assert(furry_pacer_timeout(&pacer, 20001000, 0) == 0);
+    furry_pacer_frame_done(&pacer, 20001000);
+    assert(pacer.stats.latency_samples == 1 && pacer.stats.latency_max_ns == 20001000 - 3000);
+    /* Animating keeps the 20 ms cadence without drifting. */
+    assert(furry_pacer_timeout(&pacer, 30000000, 1) == 40001000 - 30000000);
+    furry_pacer_frame_done(&pacer, 40002500);
+    assert(furry_pacer_timeout(&pacer, 40002500, 1) == 60001000 - 40002500);
+    /* After a long idle stretch the next frame is due at once, with no burst to catch up. */
+    furry_pacer_invalidate(&pacer);
+    assert(furry_pacer_timeout(&pacer, 900000000, 0) == 0);
+    furry_pacer_frame_done(&pacer, 900000000);
+    assert(furry_pacer_timeout(&pacer, 900000000, 1) == 20000000);
+    assert(pacer.stats.frames == 4 && pacer.stats.idle_waits == 1 && pacer.stats.inputs == 1);
+    furry_pacer_init(&pacer, 0.0);
+    furry_pacer_frame_done(&pacer, 5);
+    assert(furry_pacer_timeout(&pacer, 6, 1) == 0 && furry_pacer_timeout(&pacer, 6, 0) == FURRY_PACER_FOREVER);
+
+    FurryHostCommand route_cmd;
+    memset(&route_cmd, 0, sizeof(route_cmd));
+    FurryWorkerInput route_input;
+    FurryPlatformEvent route_event = {.type = FURRY_EVENT_KEY, .key = FURRY_KEY_RETURN};
+    furry_router_reset(&router);
+    assert(furry_router_event(&router, &route_event, &route_input) == 0);
+    route_cmd.op = FURRY_OP_SAY;
+    furry_router_command(&router, &route_cmd);
+    route_event.repeat = 1;
+    assert(furry_router_event(&router, &route_event, &route_input) == 0);
+    route_event.type = FURRY_EVENT_POINTER;
+    route_event.button = 1;
+    assert(furry_router_event(&router, &route_event, &route_input) == 1 && route_input.type == FURRY_INPUT_ADVANCE);
+    assert(furry_router_event(&router, &route_event, &route_input) == 0);
+    route_cmd.op = FURRY_OP_CHOICE;
+    route_cmd.choice_count = 3;
+    furry_router_command(&router, &route_cmd);
+    route_event.type = FURRY_EVENT_KEY;
+    route_event.repeat = 0;
+    route_event.key = '4';
+    assert(furry_router_event(&router, &route_event, &route_input) == 0);
+    route_event.key = '3';
+    assert(furry_router_event(&router, &route_event, &route_input) == 1 && route_input.type == FURRY_INPUT_CHOICE && route_input.value == 2);
+
+#if defined(FURRY_HAVE_SDL3)
+    {
+        FurrySdlConfig sdl_config = {.width = 320, .height = 240, .hidden = 1, .video_driver = "offscreen", .target_hz = 60.0};
+        FurrySdlPlatform *sdl = NULL;
+        if (furry_sdl_create(&sdl_config, &sdl) == 0) {
+            assert(furry_sdl_step(sdl, 0) == 1);
+            /* Idle: the step waits out its cap instead of spinning. */
+            assert(furry_sdl_step(sdl, 20000000) == 1);
+            FurrySdlStats sdl_stats;
+            furry_sdl_stats(sdl, &sdl_stats);
+            assert(sdl_stats.pacing.frames == 1 && sdl_stats.pacing.idle_waits >= 1);
+            furry_sdl_wake(sdl);
+            assert(furry_sdl_step(sdl, 20000000) == 1);
+            furry_sdl_stats(sdl, &sdl_stats);
+            assert(sdl_stats.wakes == 1);
+            furry_sdl_quit(sdl);
+            assert(furry_sdl_step(sdl, 0) == 0);
+            furry_sdl_destroy(sdl);
+        } else {
+            printf("skipping SDL3 platform test: no video driver\n");
+        }
+    }
+#endif
+
+    FurryUiTree *ui_tree = NULL;
+    UiPatchLog ui_log;
+    memset(&ui_log, 0, sizeof(ui_log));
+    assert(furry_ui_tree_create(&ui_tree) == 0);
+    const char *title_values[FURRY_UI_NODE_VALUES] = {"Title"};
+    const char *panel_values[FURRY_UI_NODE_VALUES] = {"0", "0", "1", "1"};
+    assert(furry_ui_tree_begin(ui_tree, "hud", 0) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_TEXT, "title", title_values) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_PANEL, "root", panel_values) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_TEXT, "hint", title_values) == 0);
+    assert(furry_ui_tree_end(ui_tree, log_ui_patch, &ui_log) == 0);
+    assert(ui_log.count[FURRY_UI_PATCH_CREATE] == 3 && ui_log.total == 3);
+    memset(&ui_log, 0, sizeof(ui_log));
+    title_values[0] = "Chapter 2";
+    assert(furry_ui_tree_begin(ui_tree, "hud", 0) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_TEXT, "title", title_values) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_PANEL, "root", panel_values) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_IMAGE, "logo", NULL) == 0);
+    assert(furry_ui_tree_end(ui_tree, log_ui_patch, &ui_log) == 0);
+    assert(ui_log.total == 3);
+    assert(strcmp(ui_log.order[0], "r:hint") == 0 && strcmp(ui_log.order[1], "u:title") == 0 && strcmp(ui_log.order[2], "c:logo") == 0);
+    assert(furry_ui_tree_node_count(ui_tree, "hud") == 3);
+    assert(furry_ui_tree_begin(ui_tree, "hud", 0) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_TEXT, "dup", NULL) == 0);
+    assert(furry_ui_tree_node(ui_tree, FURRY_OP_UI_TEXT, "dup", NULL) == 0);
+    assert(furry_ui_tree_end(ui_tree, log_ui_patch, &ui_log) != 0);
+    memset(&ui_log, 0, sizeof(ui_log));
+    assert(furry_ui_tree_clear(ui_tree, "hud", log_ui_patch, &ui_log) == 0);
+    assert(ui_log.count[FURRY_UI_PATCH_REMOVE] == 3 && furry_ui_tree_node_count(ui_tree, "hud") == 0);
+
+    const char *ui_script =
+        "start:\n"
+        "set visits := 0\n"
+        "menu:\n"
+        "set visits := visits + 1\n"
+        "ui_begin menu\n"
+        "ui_panel root|0|0|1|1\n"
+        "ui_text title|Main Menu\n"
+        "button play|Play|start\n"
+        "ui_end\n"
+        "ui_begin status\n"
+        "ui_text label|Status\n"
+        "if visits >= 3|late\n"
+        "ui_text early|Early\n"
+        "late:\n"
+        "ui_end\n"
+        "if visits < 4|menu\n"
+        "end\n";
+    assert(furry_compile_script(ui_script, &program) == 0);
+    memset(&ui_log, 0, sizeof(ui_log));
+    FurryRuntimeConfig ui_config = {.max_steps = 200, .ui_tree = ui_tree, .on_ui_patch = log_ui_patch, .user_data = &ui_log};
+    assert(furry_run_program(&program, &ui_config) == 0);
+    FurryUiTreeStats ui_stats;
+    furry_ui_tree_stats(ui_tree, &ui_stats);
+    assert(ui_stats.skipped == 3);
+    assert(ui_log.count[FURRY_UI_PATCH_CREATE] == 5 && ui_log.count[FURRY_UI_PATCH_REMOVE] == 1 && ui_log.total == 6);
+    assert(furry_ui_tree_node_count(ui_tree, "menu") == 3 && furry_ui_tree_node_count(ui_tree, "status") == 1);
+    furry_free_program(&program);
+
+    /* The same tree and program struct, recompiled with a changed menu at the same ip: the menu is rebuilt, not skipped. */
+    char edited_ui_script[512];
+    snprintf(edited_ui_script, sizeof(edited_ui_script), "%s", ui_script);
+    memcpy(strstr(edited_ui_script, "Main Menu"), "Game Menu", 9);
+    assert(furry_compile_script(edited_ui_script, &program) == 0);
+    memset(&ui_log, 0, sizeof(ui_log));
+    ui_config.max_steps = 9;
+    assert(furry_run_program(&program, &ui_config) != 0);
+    assert(ui_log.count[FURRY_UI_PATCH_UPDATE] == 1);
+    furry_free_program(&program);
+    furry_ui_tree_destroy(ui_tree);
+
+    const char *bind_script =
+        "start:\n"
+        "set route=a\n"
+        "set gold=0\n"
+        "ui_begin hud\n"
+        "ui_text caption|Route\n"
+        "ui_bind route_label|route\n"
+        "ui_bind purse|gold\n"
+        "ui_end\n"
+        "set gold=5\n"
+        "set route=a\n"
+        "say N|one\n"
+        "set scratch=1\n"
+        "add gold=0\n"
+        "say N|two\n"
+        "status:\n"
+        "ui_begin status\n"
+        "ui_bind mana_label|mana\n"
+        "if pass != 1|nohp\n"
+        "ui_bind hp_label|hp\n"
+        "nohp:\n"
+        "ui_end\n"
+        "if_eq pass|2|done\n"
+        "add pass=1\n"
+        "set mana=3\n"
+        "set hp=9\n"
+        "say N|tick\n"
+        "goto status\n"
+        "done:\n"
+        "set hp=1\n"
+        "set gold=6\n"
+        "say N|final\n"
+        "end\n";
+    assert(furry_compile_script(bind_script, &program) == 0);
+    assert(furry_ui_tree_create(&ui_tree) == 0);
+    BindLog bind_log;
+    memset(&bind_log, 0, sizeof(bind_log));
+    FurryRuntimeConfig bind_config = {.max_steps = 200, .ui_tree = ui_tree, .on_ui_patch = log_ui_patch, .on_bind_update = log_bind_update,
+                                      .user_data = &bind_log};
+    assert(furry_run_program(&program, &bind_config) == 0);
+    assert(bind_log.calls == 6 && bind_log.updates == 7);
+    assert(strcmp(bind_log.text[0], "hud/route_label=a hud/purse=0 ") == 0);
+    assert(strcmp(bind_log.text[1], "hud/purse=5 ") == 0);
+    assert(strcmp(bind_log.text[2], "status/mana_label= ") == 0);
+    assert(strcmp(bind_log.text[3], "status/mana_label=3 ") == 0);
+    assert(strcmp(bind_log.text[4], "status/hp_label=9 ") == 0);
+    assert(strcmp(bind_log.text[5], "hud/purse=6 ") == 0);
+    furry_free_program(&program);
+    furry_ui_tree_destroy(ui_tree);
+
+    FurryLayout *layout = NULL;
+    assert(furry_layout_create(0, &layout) == 0);
+    furry_layout_set_viewport(layout, 1000.0f, 500.0f);
+    FurryLayoutSpec centered = {{0.0f, FURRY_LAYOUT_PX}, {0.0f, FURRY_LAYOUT_PX}, {0.5f, FURRY_LAYOUT_PARENT}, {0.5f, FURRY_LAYOUT_VIEWPORT},
+                                0.5f, 0.5f, 0.5f, 0.5f};
+    FurryLayoutSpec corner = {{-10.0f, FURRY_LAYOUT_PX}, {0.0f, FURRY_LAYOUT_PX}, {100.0f, FURRY_LAYOUT_PX}, {50.0f, FURRY_LAYOUT_PX},
+                              1.0f, 1.0f, 1.0f, 1.0f};
+    FurryLayoutSpec panel_spec;
+    assert(furry_layout_spec_from_panel("0.1", "25%", "40px", "0.2vp", &panel_spec) == 0);
+    assert(panel_spec.y.unit == FURRY_LAYOUT_PARENT && panel_spec.y.value == 0.25f && panel_spec.w.unit == FURRY_LAYOUT_PX);
+    assert(furry_layout_spec_from_panel("0.1", "left", "1", "1", &panel_spec) != 0);
+    assert(furry_layout_spec_from_panel("0.1", "25%", "40px", "0.2vp", &panel_spec) == 0);
+    int layout_root = -1;
+    int layout_child = -1;
+    int layout_grandchild = -1;
+    int layout_sibling = -1;
+    assert(furry_layout_add(layout, -1, &centered, &layout_root) == 0);
+    assert(furry_layout_add(layout, layout_root, &corner, &layout_child) == 0);
+    assert(furry_layout_add(layout, layout_child, &panel_spec, &layout_grandchild) == 0);
+    assert(furry_layout_add(layout, -1, &corner, &layout_sibling) == 0);
+    assert(furry_layout_add(layout, 99, &corner, NULL) != 0);
+    assert(furry_layout_update(layout) == 4);
+    size_t rect_count = 0;
+    const FurryRect *rects = furry_layout_rects(layout, &rect_count);
+    assert(rect_count == 4);
+    assert(rects[layout_root].x == 250.0f && rects[layout_root].y == 125.0f && rects[layout_root].w == 500.0f && rects[layout_root].h == 250.0f);
+    assert(rects[layout_child].x == 640.0f && rects[layout_child].y == 325.0f);
+    assert(rects[layout_grandchild].x == 650.0f && rects[layout_grandchild].y == 337.5f && rects[layout_grandchild].h == 100.0f);
+    assert(furry_layout_update(layout) == 0);
+    corner.w.value = 200.0f;
+    assert(furry_layout_set_spec(layout, layout_child, &corner) == 0);
+    assert(furry_layout_set_spec(layout, layout_grandchild, &panel_spec) == 0);
+    assert(furry_layout_update(layout) == 2);
+    assert(rects[layout_child].x == 540.0f && rects[layout_grandchild].x == 560.0f);
+    assert(rects[layout_sibling].x == 890.0f);
+    furry_layout_set_viewport(layout, 2000.0f, 1000.0f);
+    assert(furry_layout_update(layout) == 4);
+    assert(rects[layout_root].w == 1000.0f && rects[layout_grandchild].h == 200.0f);
+    furry_layout_destroy(layout);
+
+    const char *soft_script =
+        "start:\n"
+        "bg sky.png\n"
+        "fg hero.png|0.5|0.95|15|idle\n"
+        "ui_begin hud\n"
+        "ui_panel box|0.05|0.6|0.9|0.35\n"
+        "ui_text line|Hello, FURRY!\n"
+        "button go|Go|start\n"
+        "ui_end\n"
+        "end\n";
+    assert(furry_compile_script(soft_script, &program) == 0);
+    FurrySoftConfig soft_config = {.width = 160, .height = 120};
+    FurrySoftRenderer *soft = NULL;
+    assert(furry_soft_create(&soft_config, &soft) == 0);
+    FurryRuntimeConfig soft_vm_config = {.max_steps = 100, .on_host_command = furry_soft_host_command, .user_data = soft};
+    assert(furry_run_program(&program, &soft_vm_config) == 0);
+    furry_free_program(&program);
+    unsigned soft_hash = furry_soft_hash(soft);
+    if (soft_hash != 0x46129977u) {
+        furry_soft_write_ppm(soft, "soft_golden_actual.ppm");
+        fprintf(stderr, "soft golden mismatch: 0x%08xu, wrote soft_golden_actual.ppm\n", soft_hash);
+    }
+    assert(soft_hash == 0x46129977u);
+    int soft_w = 0;
+    int soft_h = 0;
+    const unsigned char *soft_pixels = furry_soft_pixels(soft, &soft_w, &soft_h);
+    assert(soft_w == 160 && soft_h == 120);
+    const unsigned char *border_px = soft_pixels + ((size_t)72 * 160 + 8) * 4;
+    assert(border_px[0] == 83 && border_px[1] == 196 && border_px[2] == 255 && border_px[3] == 255);
+    FurrySoftStats soft_stats;
+    furry_soft_stats(soft, &soft_stats);
+    assert(soft_stats.sprites == 1 && soft_stats.glyphs == strlen("Hello,FURRY!") + strlen("Go"));
+    assert(furry_soft_text_width("Go", 2) == 22);
+
+    assert(furry_soft_write_ppm(soft, "soft_golden.ppm") == 0);
+    FurrySoftImage soft_image;
+    assert(furry_soft_load_ppm("soft_golden.ppm", &soft_image, NULL) == 0);
+    assert(soft_image.width == 160 && soft_image.height == 120);
+    assert(memcmp(soft_image.pixels + ((size_t)72 * 160 + 8) * 4, border_px, 4) == 0);
+    free(soft_image.pixels);
+    assert(furry_soft_write_png(soft, "soft_golden.png") == 0);
+    FILE *png = fopen("soft_golden.png", "rb");
+    assert(png != NULL);
+    unsigned char png_header[24];
+    assert(fread(png_header, 1, sizeof(png_header), png) == sizeof(png_header));
+    fclose(png);
+    assert(memcmp(png_header, "\x89PNG\r\n\x1a\n", 8) == 0 && memcmp(png_header + 12, "IHDR", 4) == 0);
+    assert(png_header[19] == 160 && png_header[23] == 120);
+    furry_soft_destroy(soft);
+    remove("soft_golden.ppm");
+    remove("soft_golden.png");
+
+    unsigned codepoint = 0;
+    assert(furry_utf8_decode("A", 1, &codepoint) == 1 && codepoint == 'A');
+    assert(furry_utf8_decode("\xc3\xa9", 2, &codepoint) == 2 && codepoint == 0xe9u);
+    assert(furry_utf8_decode("\xe3\x81\x82", 3, &codepoint) == 3 && codepoint == 0x3042u);
+    assert(furry_utf8_decode("\xf0\x9f\x98\x80", 4, &codepoint) == 4 && codepoint == 0x1f600u);
+    assert(furry_utf8_decode("\xc0\xaf", 2, &codepoint) == 2 && codepoint == 0xfffdu);
+    assert(furry_utf8_decode("\xe3\x81", 2, &codepoint) == 2 && codepoint == 0xfffdu);
+    assert(furry_utf8_decode("\xff", 1, &codepoint) == 1 && codepoint == 0xfffdu);
+
+    FurryTextCache *text_cache = NULL;
+    assert(furry_text_create(NULL, &text_cache) == 0);
+    FurryTextLayout text_layout = {0};
+    FurryTextStyle text_style = {8, 60.0f, 0.0f};
+    assert(furry_text_layout(text_cache, "the quick brown fox", &text_style, &text_layout) == 0);
+    assert(text_layout.line_count == 2 && text_layout.height == 18.0f);
+    assert(text_layout.quad_count == 16);
+    assert(text_layout.quads[8].codepoint == 'b' && text_layout.quads[8].x == 0.0f && text_layout.quads[8].y == 9.0f);
+    assert(text_layout.quads[14].codepoint == 'o' && text_layout.quads[14].x == 42.0f && text_layout.quads[14].y == 9.0f);
+    assert(text_layout.width <= 60.0f);
+    FurryTextStats text_stats;
+    furry_text_stats(text_cache, &text_stats);
+    size_t first_misses = text_stats.glyph_misses;
+    assert(furry_text_layout(text_cache, "the quick brown fox", &text_style, &text_layout) == 0);
+    furry_text_stats(text_cache, &text_stats);
+    assert(text_stats.glyph_misses == first_misses && text_stats.glyph_hits >= 19);
+    int dirty_x = 0;
+    int dirty_y = 0;
+    int dirty_w = 0;
+    int dirty_h = 0;
+    assert(furry_text_atlas_take_dirty(text_cache, &dirty_x, &dirty_y, &dirty_w, &dirty_h) == 1 && dirty_w > 0 && dirty_h == 7);
+    assert(furry_text_atlas_take_dirty(text_cache, &dirty_x, &dirty_y, &dirty_w, &dirty_h) == 0);
+    assert(furry_text_layout(text_cache, "abcdefghijkl", &text_style, &text_layout) == 0);
+    assert(text_layout.line_count == 2 && text_layout.quads[10].x == 0.0f && text_layout.quads[10].y == 9.0f);
+    assert(furry_text_layout(text_cache, "self-explanatory", &text_style, &text_layout) == 0);
+    assert(text_layout.line_count == 3 && text_layout.quads[5].codepoint == 'e' && text_layout.quads[5].x == 0.0f && text_layout.quads[5].y == 9.0f);
+    assert(furry_text_layout(text_cache, "a\n\nb", &text_style, &text_layout) == 0);
+    assert(text_layout.line_count == 3 && text_layout.quads[1].y == 18.0f);
+    assert(furry_text_layout(text_cache, "\xe3\x81\x82\xe3\x81\x84\xe3\x81\x86\xe3\x81\x88\xe3\x81\x8a\xe3\x81\x8b\xe3\x81\x8d\xe3\x81\x8f\xe3\x81\x91\xe3\x81\x93\xe3\x81\x95",
+                             &text_style, &text_layout) == 0);
+    assert(text_layout.line_count == 2 && text_layout.quads[10].codepoint == 0x3055u && text_layout.quads[10].x == 0.0f);
+    furry_text_destroy(text_cache);
+
+    FurryTextConfig tiny_atlas = {16, 16, NULL, NULL};
+    assert(furry_text_create(&tiny_atlas, &text_cache) == 0);
+    text_style.max_width = 0.0f;
+    assert(furry_text_layout(text_cache, "abcd", &text_style, &text_layout) == 0);
+    unsigned atlas_generation = 0;
+    furry_text_atlas(text_cache, NULL, NULL, &atlas_generation);
+    assert(atlas_generation == 0);
+    assert(furry_text_layout(text_cache, "ab", &text_style, &text_layout) == 0);
+    assert(furry_text_layout(text_cache, "ef", &text_style, &text_layout) == 0);
+    furry_text_atlas(text_cache, NULL, NULL, &atlas_generation);
+    furry_text_stats(text_cache, &text_stats);
+    assert(atlas_generation == 1 && text_stats.evictions == 2 && text_stats.cached_glyphs == 4);
+    assert(furry_text_layout(text_cache, "ab", &text_style, &text_layout) == 0);
+    furry_text_stats(text_cache, &text_stats);
+    assert(text_stats.evictions == 2);
+    assert(furry_text_layout(text_cache, "abcde", &text_style, &text_layout) != 0);
+    furry_text_layout_free(&text_layout);
+    furry_text_destroy(text_cache);
+
+    FurryBatch *batch = NULL;
+    assert(furry_batch_create(NULL, &batch) == 0);
+    furry_batch_begin(batch, 800.0f, 600.0f);
+    FurrySprite sprite = {2, FURRY_BATCH_LAYER_FG, FURRY_BLEND_ALPHA, 100.0f, 100.0f, 10.0f, 20.0f, 0.5f, 1.0f, 90.0f, {0.0f, 0.0f, 1.0f, 1.0f}, 0xffffffffu};
+    assert(furry_batch_add(batch, &sprite) == 0);
+    sprite.texture = 1;
+    sprite.rotation_deg = 0.0f;
+    assert(furry_batch_add(batch, &sprite) == 0);
+    sprite.texture = 2;
+    sprite.tint = 0xff0000ffu;
+    assert(furry_batch_add(batch, &sprite) == 0);
+    sprite.texture = 1;
+    sprite.layer = FURRY_BATCH_LAYER_UI;
+    assert(furry_batch_add(batch, &sprite) == 0);
+    sprite.x = -50.0f;
+    assert(furry_batch_add(batch, &sprite) == 0);
+    sprite.x = 0.0f;
+    sprite.texture = 0;
+    sprite.layer = FURRY_BATCH_LAYER_BG;
+    sprite.blend = FURRY_BLEND_OPAQUE;
+    sprite.pivot_x = 0.0f;
+    sprite.pivot_y = 0.0f;
+    sprite.w = 800.0f;
+    sprite.h = 600.0f;
+    assert(furry_batch_add(batch, &sprite) == 0);
+    sprite.layer = 256;
+    assert(furry_batch_add(batch, &sprite) != 0);
+    assert(furry_batch_end(batch) == 0);
+    size_t draw_count = 0;
+    size_t instance_count = 0;
+    const FurryDrawCall *draws = furry_batch_draws(batch, &draw_count);
+    const FurrySpriteInstance *instances = furry_batch_instances(batch, &instance_count);
+    assert(draw_count == 4 && instance_count == 5);
+    assert(draws[0].texture == 0 && draws[0].blend == FURRY_BLEND_OPAQUE && draws[0].instance_count == 1);
+    assert(draws[1].texture == 1 && draws[1].first_instance == 1 && draws[1].instance_count == 1);
+    assert(draws[2].texture == 2 && draws[2].first_instance == 2 && draws[2].instance_count == 2);
+    assert(draws[3].texture == 1 && draws[3].first_instance == 4);
+    assert(instances[0].transform[0] == 800.0f && instances[0].transform[3] == 600.0f);
+    assert(near(instances[2].transform[0], 0.0f) && near(instances[2].transform[1], -20.0f) && near(instances[2].transform[2], 10.0f));
+    assert(near(instances[2].transform[4], 120.0f) && near(instances[2].transform[5], 95.0f));
+    assert(instances[2].tint == 0xffffffffu && instances[3].tint == 0xff0000ffu);
+    FurryBatchStats batch_stats;
+    furry_batch_stats(batch, &batch_stats);
+    assert(batch_stats.submitted == 6 && batch_stats.culled == 1 && batch_stats.draws == 4);
+    assert(batch_stats.texture_changes == 3 && batch_stats.blend_changes == 1);
+    furry_batch_destroy(batch);
+
+    FurryBatchConfig batch_config = {0, resolve_letter_texture, NULL};
+    assert(furry_batch_create(&batch_config, &batch) == 0);
+    assert(furry_compile_script("start:\nfg alice.png|0.25|1|0|idle\nbg street.png\nfg bob.png|0.5|1|0|idle\nfg ann.png|0.75|1|0|idle\nend\n",
+                                &program) == 0);
+    furry_batch_begin(batch, 1280.0f, 720.0f);
+    FurryRuntimeConfig batch_vm_config = {.max_steps = 100, .on_host_command = furry_batch_host_command, .user_data = batch};
+    assert(furry_run_program(&program, &batch_vm_config) == 0);
+    furry_free_program(&program);
+    assert(furry_batch_end(batch) == 0);
+    draws = furry_batch_draws(batch, &draw_count);
+    instances = furry_batch_instances(batch, &instance_count);
+    assert(draw_count == 3 && draws[0].texture == 's' - 'a' && draws[0].blend == FURRY_BLEND_OPAQUE);
+    assert(draws[1].texture == 0 && draws[1].instance_count == 2 && draws[2].texture == 1);
+    assert(instances[0].transform[0] == 1280.0f && instances[1].transform[4] == 288.0f && instances[1].transform[5] == 592.0f);
+    assert(instances[2].transform[4] == 928.0f && instances[1].uv[2] == 0.25f);
+    furry_batch_destroy(batch);
+
+    FurryAnim *anim = NULL;
+    assert(furry_anim_create(2, &anim) == 0);
+    assert(furry_anim_define_builtins(anim) == 0);
+    const FurryAnimKey slide[] = {{FURRY_ANIM_X, 0.0f, 0.0f, FURRY_EASE_LINEAR},
+                                  {FURRY_ANIM_ALPHA, 0.0f, 0.0f, FURRY_EASE_OUT_QUAD},
+                                  {FURRY_ANIM_ALPHA, 0.5f, 1.0f, FURRY_EASE_LINEAR},
+                                  {FURRY_ANIM_X, 1.0f, 100.0f, FURRY_EASE_LINEAR}};
+    assert(furry_anim_define(anim, "slide", slide, 4) == 0);
+    const FurryAnimKey unsorted[] = {{FURRY_ANIM_X, 1.0f, 0.0f, FURRY_EASE_LINEAR}, {FURRY_ANIM_X, 0.5f, 1.0f, FURRY_EASE_LINEAR}};
+    assert(furry_anim_define(anim, "bad", unsorted, 2) != 0);
+    FurryAnimMode anim_mode = FURRY_ANIM_ONCE;
+    assert(furry_anim_parse_mode("pingpong", &anim_mode) == 0 && anim_mode == FURRY_ANIM_PINGPONG);
+    assert(furry_anim_parse_mode("bounce", &anim_mode) != 0);
+    unsigned once_handle = 0;
+    unsigned loop_handle = 0;
+    unsigned pingpong_handle = 0;
+    assert(furry_anim_play(anim, "missing", FURRY_ANIM_ONCE, 0, &once_handle) != 0);
+    assert(furry_anim_play(anim, "slide", FURRY_ANIM_ONCE, 7, &once_handle) == 0 && once_handle != 0);
+    assert(furry_anim_play(anim, "slide", FURRY_ANIM_LOOP, 8, &loop_handle) == 0);
+    assert(furry_anim_play(anim, "slide", FURRY_ANIM_PINGPONG, 9, &pingpong_handle) == 0);
+    float anim_values[FURRY_ANIM_PROPERTY_COUNT];
+    assert(furry_anim_sample(anim, once_handle, anim_values) == 0);
+    assert(anim_values[FURRY_ANIM_X] == 0.0f && anim_values[FURRY_ANIM_ALPHA] == 0.0f && anim_values[FURRY_ANIM_SCALE] == 1.0f);
+    assert(furry_anim_update(anim, 0.25f) == 0);
+    assert(furry_anim_sample(anim, once_handle, anim_values) == 0);
+    assert(near(anim_values[FURRY_ANIM_X], 25.0f) && near(anim_values[FURRY_ANIM_ALPHA], 0.75f));
+    assert(furry_anim_update(anim, 0.5f) == 0);
+    assert(furry_anim_sample(anim, once_handle, anim_values) == 0);
+    assert(near(anim_values[FURRY_ANIM_X], 75.0f) && near(anim_values[FURRY_ANIM_ALPHA], 1.0f));
+    size_t anim_event_count = 0;
+    furry_anim_events(anim, &anim_event_count);
+    assert(anim_event_count == 0);
+    assert(furry_anim_update(anim, 0.5f) == 0);
+    const FurryAnimEvent *anim_events = furry_anim_events(anim, &anim_event_count);
+    assert(anim_event_count == 3);
+    assert(anim_events[0].type == FURRY_ANIM_FINISHED && anim_events[0].handle == once_handle && anim_events[0].tag == 7);
+    assert(anim_events[1].type == FURRY_ANIM_LOOPED && anim_events[1].tag == 8 && anim_events[2].tag == 9);
+    assert(furry_anim_sample(anim, once_handle, anim_values) == 0 && anim_values[FURRY_ANIM_X] == 100.0f);
+    assert(furry_anim_sample(anim, loop_handle, anim_values) == 0 && near(anim_values[FURRY_ANIM_X], 25.0f));
+    assert(near(anim_values[FURRY_ANIM_ALPHA], 0.75f));
+    assert(furry_anim_sample(anim, pingpong_handle, anim_values) == 0 && near(anim_values[FURRY_ANIM_X], 75.0f));
+    assert(furry_anim_update(anim, 0.5f) == 0);
+    assert(furry_anim_sample(anim, pingpong_handle, anim_values) == 0 && near(anim_values[FURRY_ANIM_X], 25.0f));
+    assert(near(anim_values[FURRY_ANIM_ALPHA], 0.75f));
+    assert(furry_anim_update(anim, 0.5f) == 0);
+    assert(furry_anim_sample(anim, pingpong_handle, anim_values) == 0 && near(anim_values[FURRY_ANIM_X], 25.0f));
+    assert(furry_anim_events(anim, &anim_event_count) != NULL && anim_event_count == 2);
+    assert(furry_anim_sample(anim, once_handle, anim_values) == 0 && anim_values[FURRY_ANIM_X] == 100.0f);
+    assert(furry_anim_stop(anim, once_handle) == 0);
+    assert(furry_anim_sample(anim, once_handle, anim_values) != 0 && furry_anim_stop(anim, once_handle) != 0);
+    unsigned reused_handle = 0;
+    assert(furry_anim_play(anim, "fade_in", FURRY_ANIM_ONCE, 0, &reused_handle) == 0);
+    assert(furry_anim_slot(reused_handle) == furry_anim_slot(once_handle) && reused_handle != once_handle);
+    assert(furry_anim_active(anim) == 3);
+    size_t anim_slots = 0;
+    const float *alpha_values = furry_anim_values(anim, FURRY_ANIM_ALPHA, &anim_slots);
+    assert(anim_slots == 3 && alpha_values[furry_anim_slot(reused_handle)] == 0.0f);
+    furry_anim_destroy(anim);
+
+    /* A growth that runs out of memory part way leaves the playing instances as they were. */
+    assert(furry_anim_create(1, &anim) == 0);
+    assert(furry_anim_define(anim, "slide", slide, 4) == 0);
+    assert(furry_anim_play(anim, "slide", FURRY_ANIM_ONCE, 0, &once_handle) == 0);
+    assert(furry_anim_update(anim, 0.25f) == 0);
+    for (int fail_at = 1;; ++fail_at) {
+        int countdown = fail_at;
+        FurryAllocator failing = {failing_alloc, &countdown};
+        furry_set_allocator(&failing);
+        int played = furry_anim_play(anim, "slide", FURRY_ANIM_LOOP, 0, &loop_handle);
+        furry_set_allocator(NULL);
+        assert(furry_anim_update(anim, 0.0f) == 0);
+        assert(furry_anim_sample(anim, once_handle, anim_values) == 0 && near(anim_values[FURRY_ANIM_X], 25.0f));
+        assert(near(anim_values[FURRY_ANIM_ALPHA], 0.75f) && anim_values[FURRY_ANIM_SCALE] == 1.0f);
+        if (played == 0) {
+            assert(fail_at > 1);
+            break;
+        }
+    }
+    furry_anim_destroy(anim);
+
+    FurryVideoPattern pattern = {8, 4, 10.0, 5, 0};
+    FurryVideoConfig video_config;
+    furry_video_default_config(&video_config);
+    FurryVideo *video = NULL;
+    assert(furry_video_open(&video_config, "clip.mp4", 0, &video) != 0);
+    video_config.queue_frames = 3;
+    video_config.offline = 1;
+    video_config.open_decoder = furry_video_open_test_pattern;
+    video_config.decoder_user_data = &pattern;
+    assert(furry_video_open(&video_config, "clip.mp4", 0, &video) == 0);
+    FurryVideoFrame video_frame;
+    assert(furry_video_present(video, 0.0, &video_frame) == 0);
+    assert(video_frame.pixels != NULL && video_frame.width == 8 && video_frame.is_new && video_frame.frame == 0 && video_frame.pixels[0] == 0);
+    assert(furry_video_present(video, 0.05, &video_frame) == 0 && !video_frame.is_new && video_frame.frame == 0);
+    assert(furry_video_present(video, 0.1, &video_frame) == 0 && video_frame.is_new && video_frame.pixels[0] == 1);
+    assert(furry_video_present(video, 0.35, &video_frame) == 0 && video_frame.frame == 3 && video_frame.pixels[0] == 3);
+    assert(furry_video_present(video, 0.45, &video_frame) == 0 && video_frame.frame == 4);
+    assert(furry_video_finished(video, 0.45) == 0 && furry_video_finished(video, 0.5) == 1);
+    assert(furry_video_present(video, 0.6, &video_frame) == 0 && !video_frame.is_new && video_frame.frame == 4);
+    FurryVideoStats video_stats;
+    furry_video_stats(video, &video_stats);
+    assert(video_stats.frames_decoded == 5 && video_stats.frames_presented == 4 && video_stats.frames_dropped == 1);
+    assert(video_stats.frames_repeated == 2 && video_stats.underruns == 0 && video_stats.loops == 0);
+    furry_video_close(video);
+
+    assert(furry_video_open(&video_config, "clip.mp4", 1, &video) == 0);
+    for (int step = 0; step <= 12; ++step) {
+        assert(furry_video_present(video, step * 0.1, &video_frame) == 0 && video_frame.is_new);
+        assert(video_frame.frame == (size_t)(step % 5) && video_frame.pixels[0] == step % 5);
+        assert(video_frame.pts > step * 0.1 - 0.001 && video_frame.pts < step * 0.1 + 0.001);
+    }
+    assert(furry_video_finished(video, 10.0) == 0);
+    furry_video_stats(video, &video_stats);
+    assert(video_stats.loops >= 2 && video_stats.frames_dropped == 0 && video_stats.frames_presented == 13);
+    furry_video_close(video);
+
+    video_config.offline = 0;
+    assert(furry_video_open(&video_config, "clip.mp4", 1, &video) == 0);
+    for (int spin = 0; spin < 2000; ++spin) {
+        furry_video_stats(video, &video_stats);
+        if (video_stats.frames_decoded >= 3) {
+            break;
+        }
+        struct timespec nap = {0, 1000000L};
+        thrd_sleep(&nap, NULL);
+    }
+    assert(furry_video_present(video, 0.0, &video_frame) == 0 && video_frame.pixels != NULL && video_frame.frame == 0);
+    furry_video_close(video);
+
     assert(furry_media_is_supported("video.mp4") == 1);
     assert(furry_media_is_supported("anim.gif") == 1);
     assert(furry_media_is_supported("archive.zip") == 0);
@@ -131,5 +1879,156 @@ int main(void) {
     assert(decoded.callstack_depth == 2);
     assert(decoded.var_count == 1);
 
+    FurryTraceConfig trace_config = {.events_per_thread = 64};
+    assert(furry_trace_begin(FURRY_TRACE_VM, &trace_config) == 0 && furry_trace_level() == FURRY_TRACE_VM);
+    furry_trace_thread_name("test main");
+    assert(furry_compile_script("set x=1\nbg room.png\nset x=2\nset x=3\nchoice Go|Left->done|Right->done\ndone:\nend\n", &program) == 0);
+    SaveStoreRun trace_run = {0, ""};
+    FurryRuntimeConfig trace_runtime = {.max_steps = 50, .choose_option = pick_from_run, .on_host_command = record_x_at_bg, .user_data = &trace_run};
+    assert(furry_run_program(&program, &trace_runtime) == 0 && strcmp(trace_run.x_at_bg, "1") == 0);
+    FurryTraceStats trace_stats;
+    furry_trace_stats(&trace_stats);
+    assert(trace_stats.threads == 1 && trace_stats.dropped == 0);
+    FurryTraceEvent trace_events[64];
+    size_t trace_count = furry_trace_drain(trace_events, 64);
+    assert(trace_count == trace_stats.recorded);
+    /* compile, validate, batch [set bg], bg, batch [set set choice], choice, batch [end]: the jump lands past the label. */
+    unsigned trace_seen = 0;
+    unsigned trace_batched = 0;
+    for (size_t i = 0; i < trace_count; ++i) {
+        trace_seen |= 1u << trace_events[i].kind;
+        assert(trace_events[i].thread == 1 && trace_events[i].start_ns > 0);
+        if (trace_events[i].kind == FURRY_TRACE_BATCH) {
+            trace_batched += trace_events[i].arg;
+        } else if (trace_events[i].kind == FURRY_TRACE_HOST_COMMAND) {
+            assert(trace_events[i].arg == FURRY_OP_BG && strcmp(trace_events[i].detail, "room.png") == 0);
+        }
+    }
+    assert(trace_seen == (1u << FURRY_TRACE_COMPILE | 1u << FURRY_TRACE_VALIDATE | 1u << FURRY_TRACE_BATCH |
+                          1u << FURRY_TRACE_HOST_COMMAND | 1u << FURRY_TRACE_CHOOSE));
+    assert(trace_batched == 6);
+    furry_trace_set_level(FURRY_TRACE_HOST);
+    assert(furry_run_program(&program, &trace_runtime) == 0);
+    furry_trace_set_level(FURRY_TRACE_OFF);
+    assert(furry_run_program(&program, &trace_runtime) == 0);
+    furry_free_program(&program);
+    furry_trace_stats(&trace_stats);
+    assert(trace_stats.recorded == trace_count + 2);
+    const char *trace_path = "test_trace.json";
+    assert(furry_trace_export_chrome(trace_path) == 0);
+    FILE *trace_file = fopen(trace_path, "rb");
+    assert(trace_file != NULL);
+    char trace_json[2048];
+    size_t trace_len = fread(trace_json, 1, sizeof(trace_json) - 1, trace_file);
+    trace_json[trace_len] = '\0';
+    fclose(trace_file);
+    remove(trace_path);
+    assert(strncmp(trace_json, "{\"displayTimeUnit\"", 18) == 0 && strstr(trace_json, "\"test main\"") != NULL &&
+           strstr(trace_json, "\"on_host_command\"") != NULL && strstr(trace_json, "\"detail\":\"room.png\"") != NULL);
+    assert(furry_trace_drain(trace_events, 64) == 0);
+    furry_trace_end();
+    assert(furry_trace_level() == FURRY_TRACE_OFF);
+
+    FurryStagingRing ring;
+    size_t staging_offset = 0;
+    furry_staging_init(&ring, 256);
+    assert(furry_staging_alloc(&ring, 100, 16, &staging_offset) == 0 && staging_offset == 0);
+    furry_staging_close_frame(&ring, 0);
+    assert(furry_staging_alloc(&ring, 100, 16, &staging_offset) == 0 && staging_offset == 112);
+    furry_staging_close_frame(&ring, 1);
+    /* 44 bytes are left before the end, and an allocation never wraps around it. */
+    assert(furry_staging_alloc(&ring, 64, 16, &staging_offset) != 0 && furry_staging_used(&ring) == 212);
+    furry_staging_retire(&ring, 0);
+    assert(furry_staging_alloc(&ring, 64, 16, &staging_offset) == 0 && staging_offset == 0);
+    assert(furry_staging_alloc(&ring, 64, 16, &staging_offset) != 0);
+    furry_staging_close_frame(&ring, 2);
+    furry_staging_retire(&ring, 1);
+    furry_staging_retire(&ring, 2);
+    assert(furry_staging_used(&ring) == 0 && ring.skipped == 56);
+    assert(furry_staging_alloc(&ring, 257, 16, &staging_offset) != 0 && furry_staging_alloc(&ring, 8, 3, &staging_offset) != 0);
+
+    const char *gpu_cache_path = "test_pipeline.fyp";
+    const char gpu_blob[] = "driver pipeline blob";
+    unsigned long long gpu_key = furry_gpu_cache_key(0, "device", 6);
+    assert(gpu_key != furry_gpu_cache_key(0, "devicf", 6) && gpu_key == furry_gpu_cache_key(furry_gpu_cache_key(0, "dev", 3), "ice", 3));
+    assert(furry_gpu_cache_save(gpu_cache_path, gpu_key, gpu_blob, sizeof(gpu_blob)) == 0);
+    size_t gpu_size = 0;
+    char gpu_loaded[64];
+    assert(furry_gpu_cache_load(gpu_cache_path, gpu_key, NULL, 0, &gpu_size) == 0 && gpu_size == sizeof(gpu_blob));
+    assert(furry_gpu_cache_load(gpu_cache_path, gpu_key, gpu_loaded, 4, &gpu_size) != 0);
+    assert(furry_gpu_cache_load(gpu_cache_path, gpu_key, gpu_loaded, sizeof(gpu_loaded), &gpu_size) == 0 &&
+           memcmp(gpu_loaded, gpu_blob, sizeof(gpu_blob)) == 0);
+    assert(furry_gpu_cache_load(gpu_cache_path, gpu_key + 1, NULL, 0, &gpu_size) != 0 && gpu_size == 0);
+    FILE *gpu_file = fopen(gpu_cache_path, "r+b");
+    assert(gpu_file != NULL && fseek(gpu_file, -3, SEEK_END) == 0 && fputc('X', gpu_file) != EOF);
+    fclose(gpu_file);
+    assert(furry_gpu_cache_load(gpu_cache_path, gpu_key, NULL, 0, &gpu_size) != 0);
+    remove(gpu_cache_path);
+
+#if defined(FURRY_HAVE_VULKAN)
+    {
+        /* Headless: runs on any ICD, lavapipe included; machines without one skip. */
+        FurryVkConfig vk_config = {.width = 64, .height = 48, .pipeline_cache_path = "test_vk.fyp", .staging_bytes = 64 * 1024};
+        FurryVkRenderer *vk = NULL;
+        if (furry_vk_create(&vk_config, &vk) == 0) {
+            FurryInstruction vk_ins;
+            memset(&vk_ins, 0, sizeof(vk_ins));
+            strcpy(vk_ins.a, "missing_bg.ppm");
+            assert(furry_vk_host_command(FURRY_OP_BG, &vk_ins, NULL, vk) == 0);
+            strcpy(vk_ins.b, "Hi");
+            assert(furry_vk_host_command(FURRY_OP_UI_BEGIN, &vk_ins, NULL, vk) == 0);
+            assert(furry_vk_host_command(FURRY_OP_UI_TEXT, &vk_ins, NULL, vk) == 0);
+            for (int frame = 0; frame < 5; ++frame) {
+                assert(furry_vk_render_frame(vk) == 0);
+            }
+            unsigned char vk_pixels[64 * 48 * 4];
+            assert(furry_vk_read_pixels(vk, vk_pixels, sizeof(vk_pixels)) == 0);
+            /* The middle of the placeholder background is opaque. */
+            assert(vk_pixels[(24 * 64 + 32) * 4 + 3] == 255);
+            FurryVkStats vk_stats;
+            furry_vk_stats(vk, &vk_stats);
+            assert(vk_stats.frames == 5 && vk_stats.draws >= 5 && vk_stats.textures == 3);
+            /* White pixel, atlas and background each go up once. */
+            assert(vk_stats.texture_uploads == 3);
+            furry_vk_destroy(vk);
+            assert(furry_vk_create(&vk_config, &vk) == 0);
+            furry_vk_stats(vk, &vk_stats);
+            assert(vk_stats.pipeline_cache_bytes > 0);
+            furry_vk_destroy(vk);
+            remove("test_vk.fyp");
+        } else {
+            printf("skipping Vulkan renderer test: no device\n");
+        }
+    }
+#endif
+
+    CountingAllocator counter = {0, 0};
+    FurryAllocator counting = {counting_alloc, &counter};
+    furry_set_allocator(&counting);
+    FurryMemoryStats mem_before;
+    FurryMemoryStats mem;
+    furry_memory_stats(&mem_before);
+    furry_memory_reset_peaks();
+    assert(furry_compile_script("start:\nset gold=5\nchoice Go|Left->done|Right->done\ndone:\nsay N|bye\nend\n", &program) == 0);
+    furry_memory_stats(&mem);
+    assert(mem.current_bytes[FURRY_MEM_COMPILER] > mem_before.current_bytes[FURRY_MEM_COMPILER]);
+    assert(mem.peak_bytes[FURRY_MEM_SCRATCH] >= sizeof(FurryInstruction) &&
+           mem.current_bytes[FURRY_MEM_SCRATCH] == mem_before.current_bytes[FURRY_MEM_SCRATCH]);
+    FurryRuntimeConfig mem_config = {.max_steps = 50, .choose_option = pick_first};
+    assert(furry_run_program(&program, &mem_config) == 0);
+    furry_free_program(&program);
+    FurryTextCache *mem_text = NULL;
+    assert(furry_text_create(NULL, &mem_text) == 0);
+    furry_text_destroy(mem_text);
+    furry_memory_stats(&mem);
+    assert(mem.peak_bytes[FURRY_MEM_VM] > mem_before.current_bytes[FURRY_MEM_VM] && mem.peak_bytes[FURRY_MEM_TEXT] > 0);
+    for (int tag = 0; tag < FURRY_MEM_TAG_COUNT; ++tag) {
+        assert(mem.current_bytes[tag] == mem_before.current_bytes[tag]);
+        assert(mem.allocations[tag] >= mem_before.allocations[tag]);
+    }
+    assert(counter.calls > 0 && counter.live_bytes == 0);
+    assert(strcmp(furry_memory_tag_name(FURRY_MEM_VM), "vm") == 0);
+    furry_set_allocator(NULL);
+
     return 0;
 }